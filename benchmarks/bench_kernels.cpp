@@ -0,0 +1,129 @@
+#include <vector>
+#include <string>
+#include <Eigen/Core>
+#include "singularities.h"
+#include "vertex.h"
+#include "quadpanel.h"
+#include "tripanel.h"
+#include "benchmark.h"
+
+// Results are accumulated here so that benchmarked calls are not optimized
+// away
+
+volatile double kernel_sink = 0.;
+
+/******************************************************************************/
+//
+// Benchmarks of singularity kernels, called directly and through panels, for
+// field points in the near field (exact panel formulas), far field (point
+// singularity approximation), and on the panel itself
+//
+/******************************************************************************/
+void benchmark_kernels ( BenchmarkRunner & runner )
+{
+    Vertex v1, v2, v3, v4;
+    QuadPanel quad;
+    TriPanel tri;
+    Eigen::Vector3d cen;
+    double xn, yn, zn, xf, yf, zf;
+
+    // Unit panels at z = 0. Field points: near field (within a few panel
+    // lengths) and far field (beyond Panel::_farfield_distance_factor panel
+    // lengths).
+
+    v1.setCoordinates(0., 0., 0.);
+    v2.setCoordinates(1., 0., 0.);
+    v3.setCoordinates(1., 1., 0.);
+    v4.setCoordinates(0., 1., 0.);
+    quad.addVertex(&v1);
+    quad.addVertex(&v2);
+    quad.addVertex(&v3);
+    quad.addVertex(&v4);
+    quad.setSourceStrength(1.0);
+    quad.setDoubletStrength(1.0);
+    tri.addVertex(&v1);
+    tri.addVertex(&v2);
+    tri.addVertex(&v3);
+    tri.setSourceStrength(1.0);
+    tri.setDoubletStrength(1.0);
+
+    xn = 0.7;
+    yn = 0.4;
+    zn = 0.3;
+    xf = 15.;
+    yf = 6.;
+    zf = 5.;
+
+    // Kernels in panel coordinates
+
+    runner.run("kernel/quad_source_potential/near", [&] () {
+        kernel_sink += quad_source_potential(0.2, -0.1, 0.3, -0.5, -0.5,
+                                 0.5, -0.5, 0.5, 0.5, -0.5, 0.5, false, "top");
+    });
+    runner.run("kernel/quad_source_potential/onpanel", [&] () {
+        kernel_sink += quad_source_potential(0.0, 0.0, 0.0, -0.5, -0.5,
+                                 0.5, -0.5, 0.5, 0.5, -0.5, 0.5, true, "top");
+    });
+    runner.run("kernel/quad_doublet_potential/near", [&] () {
+        kernel_sink += quad_doublet_potential(0.2, -0.1, 0.3, -0.5, -0.5,
+                                 0.5, -0.5, 0.5, 0.5, -0.5, 0.5, false, "top");
+    });
+    runner.run("kernel/quad_doublet_velocity/near", [&] () {
+        kernel_sink += quad_doublet_velocity(0.2, -0.1, 0.3, -0.5, -0.5,
+                              0.5, -0.5, 0.5, 0.5, -0.5, 0.5, false, "top")(2);
+    });
+    runner.run("kernel/tri_source_potential/near", [&] () {
+        kernel_sink += tri_source_potential(0.2, -0.1, 0.3, -0.5, -0.5,
+                                           0.5, -0.5, 0.0, 0.5, false, "top");
+    });
+    runner.run("kernel/point_source_potential/far", [&] () {
+        kernel_sink += point_source_potential(xf, yf, zf);
+    });
+    runner.run("kernel/point_doublet_velocity/far", [&] () {
+        kernel_sink += point_doublet_velocity(xf, yf, zf)(2);
+    });
+    runner.run("kernel/vortex_velocity/near", [&] () {
+        kernel_sink += vortex_velocity(xn, yn, zn, 0., 0., 0., 1., 0., 0.,
+                                       1.E-6, false)(2);
+    });
+
+    // Panel influence coefficients, including transformation to panel
+    // coordinates and the far-field switch
+
+    runner.run("panel/quad_sourcePhiCoeff/near", [&] () {
+        kernel_sink += quad.sourcePhiCoeff(xn, yn, zn, false, "top");
+    });
+    runner.run("panel/quad_sourcePhiCoeff/far", [&] () {
+        kernel_sink += quad.sourcePhiCoeff(xf, yf, zf, false, "top");
+    });
+    cen = quad.centroid();
+    runner.run("panel/quad_sourcePhiCoeff/onpanel", [&] () {
+        kernel_sink += quad.sourcePhiCoeff(cen(0), cen(1), cen(2), true,
+                                           "bottom");
+    });
+    runner.run("panel/quad_doubletPhiCoeff/near", [&] () {
+        kernel_sink += quad.doubletPhiCoeff(xn, yn, zn, false, "top");
+    });
+    runner.run("panel/quad_doubletPhiCoeff/far", [&] () {
+        kernel_sink += quad.doubletPhiCoeff(xf, yf, zf, false, "top");
+    });
+    runner.run("panel/quad_doubletPhiCoeff/onpanel", [&] () {
+        kernel_sink += quad.doubletPhiCoeff(cen(0), cen(1), cen(2), true,
+                                            "bottom");
+    });
+    runner.run("panel/quad_inducedVelocity/near", [&] () {
+        kernel_sink += quad.inducedVelocity(xn, yn, zn, false, "top")(2);
+    });
+    runner.run("panel/quad_inducedVelocity/far", [&] () {
+        kernel_sink += quad.inducedVelocity(xf, yf, zf, false, "top")(2);
+    });
+    runner.run("panel/tri_sourcePhiCoeff/near", [&] () {
+        kernel_sink += tri.sourcePhiCoeff(xn, yn, zn, false, "top");
+    });
+    runner.run("panel/tri_doubletPhiCoeff/near", [&] () {
+        kernel_sink += tri.doubletPhiCoeff(xn, yn, zn, false, "top");
+    });
+    runner.run("panel/tri_inducedVelocity/far", [&] () {
+        kernel_sink += tri.inducedVelocity(xf, yf, zf, false, "top")(2);
+    });
+}
@@ -0,0 +1,81 @@
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include "util.h"
+#include "benchmark.h"
+
+#ifndef LORAAX_SAMPLE_DIR
+    #define LORAAX_SAMPLE_DIR "sample_cases"
+#endif
+
+void print_usage ()
+{
+    std::cout << "Usage: loraax_bench [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "  --json FILE              Write results as JSON to FILE"
+              << std::endl;
+    std::cout << "  --filter TEXT            Only run benchmarks with TEXT in "
+              << "their name" << std::endl;
+    std::cout << "  --min-time SECONDS       Minimum time per repetition "
+              << "(default 0.1)" << std::endl;
+    std::cout << "  --reps N                 Number of repetitions (default 5)"
+              << std::endl;
+    std::cout << "  --samples DIR            Directory with sample cases"
+              << std::endl;
+    std::cout << "  -h, --help               Display usage information and exit"
+              << std::endl;
+}
+
+int main ( int argc, char* argv[] )
+{
+    BenchmarkRunner runner;
+    std::string jsonfile, sampledir, arg;
+    int i;
+
+    jsonfile = "";
+    sampledir = LORAAX_SAMPLE_DIR;
+    for ( i = 1; i < argc; i++ )
+    {
+        arg = argv[i];
+        if ( (arg == "--help") || (arg == "-h") )
+        {
+            print_usage();
+            return 0;
+        }
+        else if (i+1 >= argc)
+        {
+            print_usage();
+            return 1;
+        }
+        else if (arg == "--json")
+            jsonfile = argv[++i];
+        else if (arg == "--filter")
+            runner.setFilter(argv[++i]);
+        else if (arg == "--min-time")
+            runner.setMinTime(std::atof(argv[++i]));
+        else if (arg == "--reps")
+            runner.setRepetitions(std::atoi(argv[++i]));
+        else if (arg == "--samples")
+            sampledir = argv[++i];
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    benchmark_kernels(runner);
+    if (benchmark_solver(runner, sampledir) != 0)
+    {
+        print_warning("main", "Solver benchmarks failed.");
+        return 2;
+    }
+
+    if (jsonfile != "")
+    {
+        if (runner.writeJSON(jsonfile) != 0)
+            return 3;
+    }
+
+    return 0;
+}
@@ -0,0 +1,238 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include "util.h"
+#include "settings.h"
+#include "aircraft.h"
+#include "benchmark.h"
+
+/******************************************************************************/
+//
+// Writes a copy of a geometry file with the given chordwise and spanwise
+// numbers of points
+//
+/******************************************************************************/
+int write_scaled_geometry ( const std::string & template_file,
+                            const std::string & fname, int nchord, int nspan )
+{
+    std::ifstream fin;
+    std::ofstream fout;
+    std::stringstream buffer;
+    std::string text;
+    std::string::size_type pos1, pos2;
+
+    fin.open(template_file.c_str());
+    if (! fin.is_open())
+    {
+        print_warning("write_scaled_geometry",
+                      "Unable to open " + template_file + ".");
+        return 1;
+    }
+    buffer << fin.rdbuf();
+    fin.close();
+    text = buffer.str();
+
+    pos1 = text.find("<NChord>");
+    pos2 = text.find("</NChord>");
+    if ( (pos1 == std::string::npos) || (pos2 == std::string::npos) )
+        return 1;
+    text.replace(pos1+8, pos2-pos1-8, int2string(nchord));
+    pos1 = text.find("<NSpan>");
+    pos2 = text.find("</NSpan>");
+    if ( (pos1 == std::string::npos) || (pos2 == std::string::npos) )
+        return 1;
+    text.replace(pos1+7, pos2-pos1-7, int2string(nspan));
+
+    fout.open(fname.c_str());
+    if (! fout.is_open())
+    {
+        print_warning("write_scaled_geometry",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+    fout << text;
+    fout.close();
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Benchmarks in-place section updates on an inviscid copy of the current
+// geometry file, alternating the middle section of the first wing between its
+// original geometry and a changed chord and twist. Afterwards, the updated
+// solution is checked against a full solution of the changed geometry.
+// Returns 1 if they differ by more than the tolerance.
+//
+/******************************************************************************/
+int benchmark_section_update ( BenchmarkRunner & runner,
+                               const std::string & geom_file,
+                               const std::string & size )
+{
+    Aircraft *ac;
+    Section *sec;
+    std::vector<section_update> orig, changed;
+    Eigen::VectorXd mun;
+    std::string label;
+    double err, cl, cldiff;
+    bool viscous0, current_changed;
+    const double tol = 1.E-06;
+
+    viscous0 = viscous;
+    viscous = false;
+    ac = new Aircraft;
+    if (ac->readXML(geom_file) != 0)
+    {
+        delete ac;
+        viscous = viscous0;
+        return 1;
+    }
+    label = int2string(ac->systemSize()) + " panels";
+
+    ac->setSourceStrengths(true);
+    ac->constructSystem(true);
+    ac->factorize();
+    ac->solveSystem();
+    ac->setDoubletStrengths();
+    ac->computeSurfaceQuantities();
+    ac->computeForceMoment();
+
+    orig.resize(1);
+    orig[0].wing = 0;
+    orig[0].section = ac->wing(0).nSections()/2;
+    sec = &ac->wing(0).section(orig[0].section);
+    orig[0].xle = sec->xle();
+    orig[0].zle = sec->zle();
+    orig[0].chord = sec->chord();
+    orig[0].twist = sec->twist();
+    changed = orig;
+    changed[0].chord *= 1.02;
+    changed[0].twist += 1.;
+
+    current_changed = false;
+    runner.run("solver/updateSections" + size, [&] () {
+        ac->updateSections(current_changed ? orig : changed);
+        current_changed = ! current_changed;
+    }, label, true);
+    if (! current_changed)
+        ac->updateSections(changed);
+
+    // Compare with full solution
+
+    mun = ac->solution();
+    cl = ac->trefftzLiftCoefficient();
+    ac->constructSystem(true);
+    ac->factorize();
+    ac->solveSystem();
+    ac->setDoubletStrengths();
+    ac->computeSurfaceQuantities();
+    ac->computeForceMoment();
+    err = (mun - ac->solution()).norm() / ac->solution().norm();
+    cldiff = std::abs(cl - ac->trefftzLiftCoefficient());
+    std::cout << "solver/updateSections" << size
+              << " check: relative solution difference " << err
+              << ", CL difference " << cldiff << std::endl;
+
+    delete ac;
+    viscous = viscous0;
+    if (err > tol)
+    {
+        print_warning("benchmark_section_update",
+                      "Updated solution differs from full solution.");
+        return 1;
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Benchmarks of solver phases on the naca0012 sample case at several panel
+// counts: system assembly, LU factorization and solution, wake convection,
+// farfield velocity, viscous BL (Xfoil) calculations, and in-place section
+// updates (inviscid)
+//
+/******************************************************************************/
+int benchmark_solver ( BenchmarkRunner & runner,
+                       const std::string & template_dir )
+{
+    Aircraft *ac;
+    std::string geom_file, label, size;
+    unsigned int i, nsizes;
+    const int nchord[] = {21, 41, 61};
+    const int nspan[] = {11, 21, 31};
+
+    nsizes = 3;
+    for ( i = 0; i < nsizes; i++ )
+    {
+        if (read_settings(template_dir + "/naca0012_inputs.xml",
+                          geom_file) != 0)
+            return 1;
+        if (write_scaled_geometry(template_dir + "/naca0012.xml",
+                                  "bench_naca0012.xml", nchord[i],
+                                  nspan[i]) != 0)
+            return 1;
+
+        // Small farfield box around the wing for the farfield benchmark
+
+        enable_farfield = true;
+        farfield_cenx = 0.5;
+        farfield_ceny = 0.;
+        farfield_cenz = 0.;
+        farfield_lenx = 4.;
+        farfield_leny = 12.;
+        farfield_lenz = 4.;
+        farfield_nx = 9;
+        farfield_ny = 9;
+        farfield_nz = 9;
+        farfield_maxlevel = 0;
+
+        ac = new Aircraft;
+        if (ac->readXML("bench_naca0012.xml") != 0)
+        {
+            delete ac;
+            return 1;
+        }
+        size = "/" + int2string(nchord[i]) + "x" + int2string(nspan[i]);
+        label = int2string(ac->systemSize()) + " panels";
+
+        ac->setSourceStrengths(true);
+        runner.run("solver/constructSystem_init" + size, [&] () {
+            ac->constructSystem(true);
+        }, label, true);
+        runner.run("solver/constructSystem" + size, [&] () {
+            ac->constructSystem(false);
+        }, label, true);
+        runner.run("solver/factorize" + size, [&] () {
+            ac->factorize();
+        }, label, true);
+        runner.run("solver/solveSystem" + size, [&] () {
+            ac->solveSystem();
+        }, label);
+        ac->setDoubletStrengths();
+        ac->computeSurfaceQuantities();
+
+        runner.run("solver/computeFarfield" + size, [&] () {
+            ac->computeFarfield();
+        }, label, true);
+        if (viscous)
+        {
+            runner.run("solver/computeBL" + size, [&] () {
+                ac->computeBL();
+            }, label, true);
+        }
+        runner.run("solver/moveWake" + size, [&] () {
+            ac->moveWake();
+        }, label, true);
+
+        delete ac;
+
+        if (benchmark_section_update(runner, "bench_naca0012.xml", size) != 0)
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <vector>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include "util.h"
+#include "benchmark.h"
+
+/******************************************************************************/
+//
+// Constructor and settings
+//
+/******************************************************************************/
+BenchmarkRunner::BenchmarkRunner ()
+{
+    _mintime = 0.1;
+    _reps = 5;
+    _filter = "";
+    _results.resize(0);
+}
+
+void BenchmarkRunner::setMinTime ( const double & mintime )
+{
+    _mintime = mintime;
+}
+
+void BenchmarkRunner::setRepetitions ( unsigned int reps )
+{
+    _reps = std::max(reps, 1u);
+}
+
+void BenchmarkRunner::setFilter ( const std::string & filter )
+{
+    _filter = filter;
+}
+
+bool BenchmarkRunner::selected ( const std::string & name ) const
+{
+    return (_filter == "") || (name.find(_filter) != std::string::npos);
+}
+
+/******************************************************************************/
+//
+// Times func and stores and prints the result
+//
+/******************************************************************************/
+void BenchmarkRunner::run ( const std::string & name,
+                            const std::function<void ()> & func,
+                            const std::string & label, bool single )
+{
+    std::chrono::steady_clock::time_point start;
+    std::chrono::duration<double> elapsed;
+    std::vector<double> times;
+    benchmark_result result;
+    unsigned long i, ncalls;
+    unsigned int j;
+    double sum;
+
+    if (! selected(name))
+        return;
+
+    // Find number of calls per repetition. The calls made here also serve as
+    // warm-up.
+
+    ncalls = 1;
+    if (! single)
+    {
+        while (true)
+        {
+            start = std::chrono::steady_clock::now();
+            for ( i = 0; i < ncalls; i++ )
+            {
+                func();
+            }
+            elapsed = std::chrono::steady_clock::now() - start;
+            if ( (elapsed.count() >= _mintime) || (ncalls >= 1000000000) )
+                break;
+            ncalls *= 10;
+        }
+    }
+
+    // Timed repetitions
+
+    times.resize(_reps);
+    for ( j = 0; j < _reps; j++ )
+    {
+        start = std::chrono::steady_clock::now();
+        for ( i = 0; i < ncalls; i++ )
+        {
+            func();
+        }
+        elapsed = std::chrono::steady_clock::now() - start;
+        times[j] = elapsed.count() / double(ncalls);
+    }
+
+    sum = 0.;
+    for ( j = 0; j < _reps; j++ )
+    {
+        sum += times[j];
+    }
+    std::sort(times.begin(), times.end());
+
+    result.name = name;
+    result.calls = ncalls*_reps;
+    result.min = times[0];
+    result.median = times[_reps/2];
+    result.mean = sum / double(_reps);
+    result.label = label;
+    _results.push_back(result);
+
+    std::cout << std::left << std::setw(48) << name << std::right
+              << std::scientific << std::setprecision(3)
+              << std::setw(12) << result.median << " s" << std::setw(12)
+              << result.calls << "  " << label << std::endl;
+}
+
+/******************************************************************************/
+//
+// Writes all results as JSON
+//
+/******************************************************************************/
+int BenchmarkRunner::writeJSON ( const std::string & fname ) const
+{
+    std::ofstream f;
+    unsigned int i, nresults;
+
+    f.open(fname.c_str(), std::fstream::out);
+    if (! f.is_open())
+    {
+        print_warning("BenchmarkRunner::writeJSON",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+
+    nresults = _results.size();
+    f << "{\"benchmarks\": [" << std::endl;
+    f << std::scientific << std::setprecision(6);
+    for ( i = 0; i < nresults; i++ )
+    {
+        f << "  {\"name\": \"" << _results[i].name << "\", "
+          << "\"calls\": " << _results[i].calls << ", "
+          << "\"min\": " << _results[i].min << ", "
+          << "\"median\": " << _results[i].median << ", "
+          << "\"mean\": " << _results[i].mean << ", "
+          << "\"label\": \"" << _results[i].label << "\"}";
+        if (i < nresults-1)
+            f << ",";
+        f << std::endl;
+    }
+    f << "]}" << std::endl;
+    f.close();
+
+    return 0;
+}
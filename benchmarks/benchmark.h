@@ -0,0 +1,75 @@
+// Header for benchmark harness
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <vector>
+#include <string>
+#include <functional>
+
+/** Timing result of one benchmark. Times are per call in seconds. **/
+struct benchmark_result
+{
+    std::string name;
+    unsigned long calls;        // Total timed calls
+    double min, median, mean;   // Per call time over repetitions
+    std::string label;          // Extra information, e.g. problem size
+};
+
+/******************************************************************************/
+//
+// Benchmark runner. Each benchmark is timed in repetitions; the number of
+// calls per repetition is increased until one repetition takes at least the
+// minimum time, so that short kernels are not dominated by timer overhead.
+//
+/******************************************************************************/
+class BenchmarkRunner {
+
+    private:
+
+    double _mintime;                    // Minimum time per repetition
+    unsigned int _reps;                 // Number of repetitions
+    std::string _filter;                // Only run names containing this
+    std::vector<benchmark_result> _results;
+
+    public:
+
+    // Constructor
+
+    BenchmarkRunner ();
+
+    // Settings
+
+    void setMinTime ( const double & mintime );
+    void setRepetitions ( unsigned int reps );
+    void setFilter ( const std::string & filter );
+
+    // Whether a benchmark name passes the filter
+
+    bool selected ( const std::string & name ) const;
+
+    // Times func and stores and prints the result. If single is true, func is
+    // called once per repetition regardless of its run time, for expensive
+    // benchmarks that should not be repeated many times.
+
+    void run ( const std::string & name, const std::function<void ()> & func,
+               const std::string & label="", bool single=false );
+
+    // Writes all results as JSON
+
+    int writeJSON ( const std::string & fname ) const;
+};
+
+// Writes a copy of a geometry file with the given chordwise and spanwise
+// numbers of points
+
+int write_scaled_geometry ( const std::string & template_file,
+                            const std::string & fname, int nchord, int nspan );
+
+// Benchmark groups
+
+void benchmark_kernels ( BenchmarkRunner & runner );
+int benchmark_solver ( BenchmarkRunner & runner,
+                       const std::string & template_dir );
+
+#endif
@@ -0,0 +1,106 @@
+#!/usr/bin/env python
+
+# Runs loraax end-to-end on the sample cases and writes wall time, iteration
+# count, final coefficients, and per-phase times to a JSON file.
+
+import argparse
+import glob
+import json
+import os
+import re
+import shutil
+import subprocess
+import tempfile
+import time
+
+def set_setting(text, name, value):
+  # Replaces a setting in the Main element of an inputs file, or adds it
+
+  pattern = '<{0}>.*?</{0}>'.format(name)
+  setting = '<{0}>{1}</{0}>'.format(name, value)
+  if re.search(pattern, text):
+    return re.sub(pattern, setting, text, count=1)
+  return text.replace('</Main>', '  ' + setting + '\n</Main>', 1)
+
+def last_row(csvfile):
+  # Returns the header and last row of a CSV file as a dict
+
+  with open(csvfile) as f:
+    lines = [line.strip() for line in f if line.strip()]
+  header = [col.strip('"') for col in lines[0].split(',')]
+  values = [float(val) for val in lines[-1].split(',')]
+  return dict(zip(header, values))
+
+def phase_totals(jsonlfile):
+  # Sums per-iteration phase times from a timing report
+
+  totals = {}
+  with open(jsonlfile) as f:
+    for line in f:
+      for phase, data in json.loads(line)['phases'].items():
+        totals[phase] = totals.get(phase, 0.) + data['time']
+  return totals
+
+def run_case(loraax, sampledir, inputs, max_iters):
+  casedir = tempfile.mkdtemp(prefix='loraax_bench_')
+  try:
+    for fname in os.listdir(sampledir):
+      shutil.copy(os.path.join(sampledir, fname), casedir)
+    inputfile = os.path.join(casedir, os.path.basename(inputs))
+    with open(inputfile) as f:
+      text = f.read()
+    casename = re.search('<CaseName>(.*?)</CaseName>', text).group(1).strip()
+    text = set_setting(text, 'TimingReport', 'json')
+    text = set_setting(text, 'VisualizationFrequency', '0')
+    if max_iters is not None:
+      text = set_setting(text, 'MaxIters', str(max_iters))
+    with open(inputfile, 'w') as f:
+      f.write(text)
+
+    start = time.time()
+    proc = subprocess.run([loraax, os.path.basename(inputfile)], cwd=casedir,
+                          stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    walltime = time.time() - start
+
+    result = {'case': casename, 'returncode': proc.returncode,
+              'wall_time': walltime}
+    fmfile = os.path.join(casedir, 'forcemoment',
+                          casename + '_forcemoment.csv')
+    if os.path.isfile(fmfile):
+      row = last_row(fmfile)
+      result['iterations'] = int(row['Iter'])
+      result['CL'] = row['CL']
+      result['CD'] = row['CD']
+      result['Cm'] = row['Cm']
+    timingfile = os.path.join(casedir, 'postprocessing',
+                              casename + '_timing.jsonl')
+    if os.path.isfile(timingfile):
+      result['phases'] = phase_totals(timingfile)
+    return result
+  finally:
+    shutil.rmtree(casedir)
+
+if __name__ == '__main__':
+  parser = argparse.ArgumentParser(
+                  description='Run loraax end-to-end on the sample cases.')
+  parser.add_argument('--loraax', default='loraax',
+                      help='Path to loraax executable')
+  parser.add_argument('--samples', default='sample_cases',
+                      help='Directory with sample cases')
+  parser.add_argument('--max-iters', type=int, default=None,
+                      help='Override MaxIters for every case')
+  parser.add_argument('--json', default='benchmark_cases.json',
+                      help='Output JSON file')
+  args = parser.parse_args()
+
+  loraax = os.path.abspath(args.loraax) if os.path.isfile(args.loraax) \
+           else args.loraax
+  results = []
+  for inputs in sorted(glob.glob(os.path.join(args.samples, '*_inputs.xml'))):
+    result = run_case(loraax, args.samples, inputs, args.max_iters)
+    print('{0:24s} {1:10.3f} s  return code {2}'.format(
+          result['case'], result['wall_time'], result['returncode']))
+    results.append(result)
+
+  with open(args.json, 'w') as f:
+    json.dump({'cases': results}, f, indent=2)
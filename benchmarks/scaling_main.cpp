@@ -0,0 +1,425 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <algorithm>
+#ifdef __linux__
+  #include <unistd.h>
+#endif
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+#include "util.h"
+#include "settings.h"
+#include "aircraft.h"
+#include "benchmark.h"
+
+#ifndef LORAAX_SAMPLE_DIR
+    #define LORAAX_SAMPLE_DIR "sample_cases"
+#endif
+
+/** Measurement of one phase at one problem size and thread count **/
+struct scaling_point
+{
+    std::string phase;
+    std::string sweep;          // strong or weak
+    int nchord, nspan, npanels, threads;
+    double time;                // Minimum over repetitions, seconds
+    double work;                // Work estimate for weak scaling efficiency
+    long hwm;                   // Peak resident memory during phase, kB
+};
+
+/******************************************************************************/
+//
+// Resets the peak resident memory counter, and reads it in kB. Returns -1 if
+// not available.
+//
+/******************************************************************************/
+void reset_memory_hwm ()
+{
+#ifdef __linux__
+    std::ofstream f;
+
+    f.open("/proc/self/clear_refs");
+    if (f.is_open())
+        f << "5";
+#endif
+}
+
+long read_memory_hwm ()
+{
+#ifdef __linux__
+    std::ifstream f;
+    std::string line;
+    long hwm;
+
+    f.open("/proc/self/status");
+    while (std::getline(f, line))
+    {
+        if (line.compare(0, 6, "VmHWM:") == 0)
+        {
+            std::istringstream(line.substr(6)) >> hwm;
+            return hwm;
+        }
+    }
+#endif
+    return -1;
+}
+
+/******************************************************************************/
+//
+// Sets the number of OpenMP threads
+//
+/******************************************************************************/
+void set_threads ( int nthreads )
+{
+#ifdef _OPENMP
+    omp_set_num_threads(nthreads);
+#endif
+}
+
+int max_threads ()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+/******************************************************************************/
+//
+// Times a phase: minimum time over repetitions and peak memory
+//
+/******************************************************************************/
+void time_phase ( const std::function<void ()> & func, unsigned int reps,
+                  double & time, long & hwm )
+{
+    std::chrono::steady_clock::time_point start;
+    std::chrono::duration<double> elapsed;
+    unsigned int i;
+
+    time = 0.;
+    reset_memory_hwm();
+    for ( i = 0; i < reps; i++ )
+    {
+        start = std::chrono::steady_clock::now();
+        func();
+        elapsed = std::chrono::steady_clock::now() - start;
+        if ( (i == 0) || (elapsed.count() < time) )
+            time = elapsed.count();
+    }
+    hwm = read_memory_hwm();
+}
+
+/******************************************************************************/
+//
+// Sets up an aircraft from the naca0012 sample case with the given numbers of
+// points and solves the system once, so that wake convection and BL phases
+// start from a realistic state. Returns NULL on error.
+//
+/******************************************************************************/
+Aircraft * setup_case ( const std::string & sampledir, int nchord, int nspan )
+{
+    Aircraft *ac;
+    std::string geom_file;
+
+    if (read_settings(sampledir + "/naca0012_inputs.xml", geom_file) != 0)
+        return NULL;
+    if (write_scaled_geometry(sampledir + "/naca0012.xml",
+                              "scaling_naca0012.xml", nchord, nspan) != 0)
+        return NULL;
+
+    ac = new Aircraft;
+    if (ac->readXML("scaling_naca0012.xml") != 0)
+    {
+        delete ac;
+        return NULL;
+    }
+    ac->setSourceStrengths(true);
+    ac->constructSystem(true);
+    ac->factorize();
+    ac->solveSystem();
+    ac->setDoubletStrengths();
+    ac->computeSurfaceQuantities();
+
+    return ac;
+}
+
+/******************************************************************************/
+//
+// Runs constructSystem, wake convection, and BL phases with the given number
+// of threads and appends results. Work estimates are the number of influence
+// coefficient evaluations for constructSystem and moveWake, and the number of
+// sections for computeBL.
+//
+/******************************************************************************/
+void run_phases ( Aircraft *ac, const std::string & sweep, int nchord,
+                  int nspan, int nthreads, unsigned int reps,
+                  std::vector<scaling_point> & points )
+{
+    scaling_point point;
+    double npanels, nwake;
+
+    set_threads(nthreads);
+    npanels = double(ac->systemSize());
+    nwake = double(nspan*2);
+
+    point.sweep = sweep;
+    point.nchord = nchord;
+    point.nspan = nspan;
+    point.npanels = ac->systemSize();
+    point.threads = nthreads;
+
+    point.phase = "constructSystem";
+    point.work = npanels*npanels;
+    time_phase([&] () { ac->constructSystem(true); }, reps, point.time,
+               point.hwm);
+    points.push_back(point);
+
+    point.phase = "convectVertices";
+    point.work = nwake*npanels;
+    time_phase([&] () { ac->moveWake(); }, reps, point.time, point.hwm);
+    points.push_back(point);
+
+    if (viscous)
+    {
+        point.phase = "computeBL";
+        point.work = double(nspan);
+        time_phase([&] () { ac->computeBL(); }, reps, point.time, point.hwm);
+        points.push_back(point);
+    }
+
+    std::cout << std::left << std::setw(8) << sweep << std::right
+              << std::setw(6) << nchord << "x" << std::left << std::setw(6)
+              << nspan << std::right << std::setw(4) << nthreads
+              << " threads done" << std::endl;
+}
+
+/******************************************************************************/
+//
+// Writes CSV with speedup and efficiency relative to the 1-thread point of
+// the same phase (and size, for strong scaling). Weak scaling efficiency is
+// throughput (work per second) per thread relative to 1 thread.
+//
+/******************************************************************************/
+int write_csv ( const std::string & fname,
+                const std::vector<scaling_point> & points )
+{
+    std::ofstream f;
+    unsigned int i, j, npoints;
+    int ref;
+    double speedup, efficiency;
+
+    f.open(fname.c_str());
+    if (! f.is_open())
+    {
+        print_warning("write_csv", "Unable to open " + fname +
+                      " for writing.");
+        return 1;
+    }
+    f << "\"Phase\",\"Sweep\",\"NChord\",\"NSpan\",\"Panels\",\"Threads\","
+      << "\"Time\",\"Speedup\",\"Efficiency\",\"Memory_HWM_kB\"" << std::endl;
+
+    npoints = points.size();
+    for ( i = 0; i < npoints; i++ )
+    {
+        ref = -1;
+        for ( j = 0; j < npoints; j++ )
+        {
+            if ( (points[j].threads == 1) &&
+                 (points[j].phase == points[i].phase) &&
+                 (points[j].sweep == points[i].sweep) &&
+                 ( (points[i].sweep == "weak") ||
+                   (points[j].npanels == points[i].npanels) ) )
+            {
+                ref = j;
+                break;
+            }
+        }
+
+        speedup = 0.;
+        efficiency = 0.;
+        if (ref >= 0)
+        {
+            speedup = (points[ref].time/points[ref].work)
+                    / (points[i].time/points[i].work);
+            efficiency = speedup / double(points[i].threads);
+        }
+
+        f << "\"" << points[i].phase << "\",\"" << points[i].sweep << "\","
+          << points[i].nchord << "," << points[i].nspan << ","
+          << points[i].npanels << "," << points[i].threads << ","
+          << std::scientific << std::setprecision(6) << points[i].time << ","
+          << std::fixed << std::setprecision(4) << speedup << ","
+          << efficiency << "," << points[i].hwm << std::endl;
+    }
+    f.close();
+
+    return 0;
+}
+
+void print_usage ()
+{
+    std::cout << "Usage: loraax_scaling [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "  --csv FILE               Output CSV file "
+              << "(default scaling.csv)" << std::endl;
+    std::cout << "  --max-threads N          Largest thread count "
+              << "(default: all)" << std::endl;
+    std::cout << "  --sizes NCxNS,...        Strong scaling sizes "
+              << "(default 21x11,41x21,61x41)" << std::endl;
+    std::cout << "  --weak NCxNS             Weak scaling size per thread; "
+              << "NSpan grows with threads" << std::endl;
+    std::cout << "                           (default 41x11)" << std::endl;
+    std::cout << "  --reps N                 Repetitions per phase "
+              << "(default 3)" << std::endl;
+    std::cout << "  --samples DIR            Directory with sample cases"
+              << std::endl;
+    std::cout << "  -h, --help               Display usage information and exit"
+              << std::endl;
+}
+
+/******************************************************************************/
+//
+// Parses a size like 41x21
+//
+/******************************************************************************/
+bool parse_size ( const std::string & str, int & nchord, int & nspan )
+{
+    std::string::size_type pos;
+
+    pos = str.find('x');
+    if (pos == std::string::npos)
+        return false;
+    nchord = std::atoi(str.substr(0, pos).c_str());
+    nspan = std::atoi(str.substr(pos+1).c_str());
+
+    return (nchord > 1) && (nspan > 1);
+}
+
+int main ( int argc, char* argv[] )
+{
+    std::vector<scaling_point> points;
+    std::vector<int> threads, nchords, nspans;
+    std::string csvfile, sampledir, arg, sizes, item;
+    std::istringstream sizestream;
+    Aircraft *ac;
+    unsigned int reps, i, j;
+    int maxthreads, nchord, nspan, weakchord, weakspan, t;
+
+    // Pin threads to cores unless the user has chosen otherwise. The OpenMP
+    // runtime reads these at startup, so the program restarts itself.
+
+#ifdef __linux__
+    if ( (std::getenv("OMP_PROC_BIND") == NULL) &&
+         (std::getenv("OMP_PLACES") == NULL) )
+    {
+        setenv("OMP_PROC_BIND", "close", 1);
+        setenv("OMP_PLACES", "cores", 1);
+        execv("/proc/self/exe", argv);
+    }
+#endif
+
+    csvfile = "scaling.csv";
+    sampledir = LORAAX_SAMPLE_DIR;
+    sizes = "21x11,41x21,61x41";
+    weakchord = 41;
+    weakspan = 11;
+    reps = 3;
+    maxthreads = max_threads();
+    for ( i = 1; int(i) < argc; i++ )
+    {
+        arg = argv[i];
+        if ( (arg == "--help") || (arg == "-h") )
+        {
+            print_usage();
+            return 0;
+        }
+        else if (int(i)+1 >= argc)
+        {
+            print_usage();
+            return 1;
+        }
+        else if (arg == "--csv")
+            csvfile = argv[++i];
+        else if (arg == "--max-threads")
+            maxthreads = std::atoi(argv[++i]);
+        else if (arg == "--sizes")
+            sizes = argv[++i];
+        else if (arg == "--weak")
+        {
+            if (! parse_size(argv[++i], weakchord, weakspan))
+            {
+                print_usage();
+                return 1;
+            }
+        }
+        else if (arg == "--reps")
+            reps = std::max(std::atoi(argv[++i]), 1);
+        else if (arg == "--samples")
+            sampledir = argv[++i];
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    sizestream.str(sizes);
+    while (std::getline(sizestream, item, ','))
+    {
+        if (! parse_size(item, nchord, nspan))
+        {
+            print_usage();
+            return 1;
+        }
+        nchords.push_back(nchord);
+        nspans.push_back(nspan);
+    }
+
+    // Thread counts: powers of 2 up to the maximum, and the maximum
+
+    for ( t = 1; t < maxthreads; t *= 2 )
+    {
+        threads.push_back(t);
+    }
+    threads.push_back(std::max(maxthreads, 1));
+
+    // Strong scaling: fixed sizes. Cases are always set up with the maximum
+    // number of threads, not the count left over from the last run.
+
+    for ( i = 0; i < nchords.size(); i++ )
+    {
+        set_threads(threads.back());
+        ac = setup_case(sampledir, nchords[i], nspans[i]);
+        if (ac == NULL)
+            return 2;
+        for ( j = 0; j < threads.size(); j++ )
+        {
+            run_phases(ac, "strong", nchords[i], nspans[i], threads[j], reps,
+                       points);
+        }
+        delete ac;
+    }
+
+    // Weak scaling: number of spanwise points grows with threads
+
+    for ( j = 0; j < threads.size(); j++ )
+    {
+        nspan = (weakspan-1)*threads[j] + 1;
+        set_threads(threads.back());
+        ac = setup_case(sampledir, weakchord, nspan);
+        if (ac == NULL)
+            return 2;
+        run_phases(ac, "weak", weakchord, nspan, threads[j], reps, points);
+        delete ac;
+    }
+
+    return write_csv(csvfile, points);
+}
@@ -8,11 +8,53 @@
 #include <Eigen/Dense>
 #include <fstream>
 #include "wing.h"
+#include "vertex_store.h"
+#include "surface_gradient.h"
 #include "farfield.h"
+#include "probes.h"
+#include "streamlines.h"
+#include "vtu_writer.h"
+#include "output_sink.h"
 
 class Vertex;
 class Panel;
 class Wake;
+class WakeStrip;
+
+// Dense matrix with rows stored contiguously. System assembly is parallelized
+// over rows, so each thread's rows occupy their own pages and are placed on
+// that thread's NUMA node when first touched.
+
+typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+        RowMatrixXd;
+typedef Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+        RowMatrixXf;
+
+/** Derivatives of Trefftz plane lift coefficient, induced drag coefficient,
+    and pitching moment coefficient with respect to one design parameter:
+    xle, zle, chord, or twist of a section of a wing, or alpha. Twist and
+    alpha derivatives are per degree. **/
+struct design_sensitivity
+{
+    std::string wing;
+    int section;
+    std::string parameter;
+    double dcl;
+    double dcdi;
+    double dcm;
+};
+
+/** New leading edge position, chord, and twist of section of a wing (both in
+    order of creation), for Aircraft::updateSections **/
+struct section_update
+{
+    unsigned int wing;
+    unsigned int section;
+    double xle;
+    double zle;
+    double chord;
+    double twist;
+};
 
 /******************************************************************************/
 //
@@ -38,21 +80,97 @@ class Aircraft {
     std::vector<Vertex *> _wakeverts;   // Pointers to wake vertices
     std::vector<Panel *> _wakepanels;   // Pointers to wake doublet panels
     std::vector<Wake *> _allwake;       // Pointers to wakes
+    VertexStore _vertstore;             // Contiguous surface vertex data, in
+                                        //   the same order as _verts
+    VertexStore _wakevertstore;         // Contiguous wake vertex data
+    SurfaceGradient _surfgrad;          // Surface velocity operator for all
+                                        //   panels, in the same order as
+                                        //   _panels
 
     Farfield _farfield;                 // Farfield (for post calculations only)
+    Probes _probes;                     // Off-body probes (post calculations)
+    Streamlines _streamlines;           // Streamlines and vortex cores (post)
+    VTUWriter _vizwriter;               // Binary VTU visualization writer
+
+    OutputSink _fmsink;                 // Force and moment output
+    std::vector<OutputSink *> _wingfmsinks, _sectionsinks;
+                                        // Wing force/moment and sectional
+                                        //   output
+    HistoryFile _history;               // Binary history of all output
+    int _histaircraft;                  // History table ids
+    std::vector<int> _histwings, _histsections;
+    std::vector<double> _outputsizes;   // Output file sizes from restart
+                                        //   checkpoint, or -1 if not written
     
-    Eigen::MatrixXd _sourceic, _doubletic;
-                                        // Aero influence coefficients due to
-                                        //   sources and doublets on surface
-    Eigen::MatrixXd _aic;               // Aero influence coefficients matrix
+    RowMatrixXd _sourceic;              // Aero influence coefficients due to
+                                        //   sources on surface
+    RowMatrixXd _aic;                   // Aero influence coefficients matrix
+    std::vector<int> _tecols;           // Panel indices of trailing edge
+                                        //   columns, which have wake terms
+    std::vector<int> _tecolidx;         // Index in _tecols of each panel, or
+                                        //   -1 if not at the trailing edge
+    RowMatrixXd _tedoubletic;           // Surface doublet coefficients of
+                                        //   trailing edge columns
+    RowMatrixXd _tewakeic;              // Wake coefficients of trailing edge
+                                        //   columns (MatrixFree)
+    Eigen::VectorXd _diag;              // AIC matrix diagonal (MatrixFree)
     Eigen::VectorXd _mun;               // Normalized doublet strengths vector
     Eigen::VectorXd _rhs;               // Right hand side vector
-    Eigen::PartialPivLU<Eigen::MatrixXd> _lu;
-                                        // LU factorization of AIC matrix
+    Eigen::VectorXd _rhscheck;          // Right hand side from double
+                                        //   precision source coefficients
+                                        //   (MixedPrecisionCheck)
+    RowMatrixXd _lumat;                 // Storage for LU factors
+    Eigen::PartialPivLU<Eigen::Ref<RowMatrixXd> > * _lu;
+                                        // LU factorization of AIC matrix,
+                                        //   computed in place in _lumat
+
+    RowMatrixXf _sourceicf;             // Single precision source influence
+                                        //   coefficients (MixedPrecision)
+    RowMatrixXf _lumatf;                // Storage for single precision LU
+    Eigen::PartialPivLU<Eigen::Ref<RowMatrixXf> > * _luf;
+                                        // Single precision LU factorization
+    unsigned int _solveiters;           // Iterative solve diagnostics
+    double _solveres, _checkerr;
+    bool _lustale;                      // Whether the AIC matrix has changed
+                                        //   since it was factorized
+    Eigen::MatrixXd _clcoupling;        // Spanwise coupling of sectional
+                                        //   lift coefficients (SpanwiseNewton),
+                                        //   cleared when the wake or surface
+                                        //   geometry changes
+    std::vector<design_sensitivity> _sensitivities;
+                                        // Adjoint design sensitivities
     
-    // Set up pointers to vertices, panels, and wake elements
+    // Set up pointers to vertices, panels, and wake elements, and attach
+    // vertices to the vertex stores
     
     void setGeometryPointers ();
+
+    // Spanwise coupling of sectional lift coefficients, and Newton step for
+    // the lift coefficients to run Xfoil at (SpanwiseNewton)
+
+    int computeLiftCoupling ();
+    int spanwiseNewtonStep ( std::vector<double> & clspec );
+
+    // Trefftz plane location, and Trefftz plane lift and drag coefficients
+    // from the current wake strengths
+
+    void trefftzPlane ( double & xtrefftz, double & ztrefftz ) const;
+    void trefftzCoefficients ( double & cl, double & cdi ) const;
+
+    // Functionals for sensitivities (Trefftz plane lift coefficient, induced
+    // drag coefficient, pitching moment coefficient) at the current doublet
+    // strengths, and their derivatives with respect to the solution vector
+
+    Eigen::Vector3d sensitivityFunctionals ();
+    void functionalDerivatives ( Eigen::MatrixXd & dfdmun );
+
+    // Terms of the residual A*mun + S*sigma/uinf that depend on the given
+    // panels (by position in _panels) and wake strips. Rows of moved panels
+    // are complete.
+
+    void partialResidual ( const std::vector<bool> & moved,
+                           const std::vector<WakeStrip *> & strips,
+                           Eigen::VectorXd & res );
     
     // Write VTK viz
     
@@ -67,11 +185,23 @@ class Aircraft {
     void writeFarfieldScalar ( std::ofstream & f, const std::string & varname,
                                unsigned int varidx );
 
+    // Column names and values of forces and moments for output
+
+    void forceMomentData ( std::vector<std::string> & columns,
+                           std::vector<double> & values ) const;
+
+    // Snapshots of grids and data for VTU viz
+
+    void surfaceGrid ( vtu_grid & grid ) const;
+    void wakeGrid ( vtu_grid & grid ) const;
+    void farfieldGrid ( vtu_grid & grid );
+
     public:
 
-    // Constructor
+    // Constructor and destructor. The destructor closes output files.
     
     Aircraft ();
+    ~Aircraft ();
     
     // Read from XML
     
@@ -87,12 +217,49 @@ class Aircraft {
     void constructSystem ( bool init );
     void factorize ();
     void solveSystem ();
+
+    // Diagnostics of the last solve with MixedPrecision or MatrixFree: number
+    // of refinement steps or GMRES iterations, relative residual, and relative
+    // difference from the double precision solution (MixedPrecisionCheck)
+
+    unsigned int solveIterations () const;
+    double solveResidual () const;
+    double precisionCheckError () const;
+
+    // AIC matrix-vector product computed without storing the matrix, scaled
+    // by the inverse of the diagonal (MatrixFree)
+
+    void aicProduct ( const std::vector<double> & x,
+                      std::vector<double> & y ) const;
+
+    // AIC matrix-vector product preconditioned with the LU factors of the
+    // last factorization, which may be of an earlier AIC matrix
+
+    void preconditionedProduct ( const std::vector<double> & x,
+                                 std::vector<double> & y ) const;
+
+    // Changes leading edge position, chord, and twist of some sections in
+    // place and updates the solution. Only the AIC matrix rows and columns of
+    // panels next to the changed sections are recomputed, and the system is
+    // re-solved iteratively from the previous solution, preconditioned with
+    // the existing factorization. Forces and moments are computed afterwards.
+    // Inviscid only.
+
+    int updateSections ( const std::vector<section_update> & updates );
     
-    // Gives size of system of equations (= number of panels)
+    // Gives size of system of equations (= number of panels), and the
+    // solution vector (normalized doublet strengths)
     
     unsigned int systemSize () const;
+    const Eigen::VectorXd & solution () const;
+
+    // Access to wings
+
+    unsigned int nWings () const;
+    Wing & wing ( unsigned int widx );
     
-    // Computes surface velocities and pressures
+    // Computes surface velocities and pressures and interpolates them to
+    // vertices
     
     void computeSurfaceQuantities ();
     
@@ -108,6 +275,14 @@ class Aircraft {
     
     void computeForceMoment ();
 
+    // Solves for the vortex lattices of all wings and computes forces and
+    // moments from them in place of the panel solution, and sets the vortex
+    // lattice sectional lift coefficients as the first lift coefficients to
+    // run Xfoil at (VortexLattice)
+
+    void solveVortexLattice ();
+    void setVortexLatticeLiftGuesses ();
+
     double lift () const;                       // Trefftz + skin friction
     double trefftzLift () const;                // Calculated in Trefftz plane
     double skinFrictionLift () const;           // Via skin friction integration
@@ -139,13 +314,21 @@ class Aircraft {
     double pressurePitchingMomentCoefficient () const;
     double skinFrictionPitchingMomentCoefficient () const;
     
+    // Open or flush and close force, moment, and sectional output files and
+    // binary history. Output files are kept open and written with buffering.
+    // When appending after readCheckpoint, files are first truncated to their
+    // sizes when the checkpoint was written.
+
+    int openOutput ( bool append );
+    int closeOutput ();
+
     // Write forces and moments to file
     
-    int writeForceMoment ( int iter ) const;
+    int writeForceMoment ( int iter );
     
     // Write section force and moment coefficients to file
     
-    void writeSectionForceMoment ( int iter ) const;
+    void writeSectionForceMoment ( int iter );
     
     // Convects and updates wake panels
     
@@ -157,12 +340,47 @@ class Aircraft {
     
     // Write VTK viz
     
-    int writeViz ( const std::string & prefix, int iter ) const;
+    int writeViz ( const std::string & prefix, int iter );
     int writeFarfieldViz ( const std::string & prefix );
+    int finishViz ();
 
     // Write farfield data
 
     int writeFarfieldData ( const std::string & prefix ) const;
+
+    // Evaluates and writes off-body probes
+
+    void computeProbes ();
+    int writeProbes ( const std::string & prefix ) const;
+
+    // Traces streamlines and vortex cores and writes results
+
+    void computeStreamlines ();
+    int writeStreamlines ( const std::string & prefix ) const;
+
+    // Write or restore solution state for restart. readCheckpoint must be
+    // called after readXML and gives the iteration and lift coefficient at
+    // which the checkpoint was written. writeCheckpoint flushes all output
+    // files first and records their sizes.
+
+    int writeCheckpoint ( const std::string & fname, int iter,
+                          const double & lift );
+    int readCheckpoint ( const std::string & fname, unsigned int & iter,
+                         double & lift );
+
+    // Computes and writes derivatives of lift, induced drag, and pitching
+    // moment coefficients with respect to section geometry and angle of
+    // attack with the adjoint method. Inviscid only; must be called after
+    // the solution has converged.
+
+    int computeSensitivities ();
+    int writeSensitivities ( const std::string & prefix ) const;
+
+    // Checks the sensitivities of the middle section of each wing against
+    // finite differences of full solutions (SensitivitiesCheck). Returns 1 if
+    // they differ by more than the tolerance.
+
+    int checkSensitivities ();
 };
 
 #endif
@@ -21,32 +21,62 @@ class Airfoil: public SectionalObject {
 
 	private:
 
-	// Xfoil data
-	
-	xfoil_data_group _xdg;
+	// Xfoil data. Xfoil work arrays are large, so they are only allocated when
+	// an Xfoil routine is first needed and are freed by releaseXfoil. The
+	// airfoil geometry below is kept independently of Xfoil.
+	
+	xfoil_data_group * _xdg;
+	bool _xfoil_paneled;				// Whether Xfoil has current smoothed
+										//   paneling
+	bool _xfoil_bl;						// Whether Xfoil BL has been run
+	bool _options_set;					// Whether setXfoilOptions was called
+	xfoil_options_type _xfoil_opts;		// Xfoil run and paneling options
+	xfoil_geom_options_type _geom_opts;
+	double _re, _mach;					// Reynolds and Mach number (if > 0)
+	double _cl, _cd, _cm;				// Coefficients from last Xfoil run
 	
 	// Geometric data
 	
 	int _nb, _n;						// Number of points (buffer, smoothed)
+	std::vector<double> _xb, _zb;		// Buffer coordinates
+	std::vector<double> _x, _z;			// Smoothed coordinates
 	std::vector<double> _s, _xs, _zs;	// Spline fit of buffer coordinates
 	std::vector<double> _ssmoothed;		// Spline vector for smoothed airfoil
 	double _sle;						// Leading edge spline parameter
 	
 	bool _unit_transform;				// Transform flag (call unitTransform)
 
-	// Helper function to avoid reusing code between copy constructor and copy
-	// assignment
+	// Helper functions to avoid reusing code between copy and move
+	// constructors and assignments
 	
 	void copyData ( const Airfoil & foil );
+	void moveData ( Airfoil & foil );
+
+	// Sets buffer coordinates
+	
+	void setBuffer ( const double x[], const double z[], int n );
+
+	// Returns Xfoil data, allocating it and setting options if needed
+	
+	xfoil_data_group * xfoilData ();
 	
 	public:
 	
-	// Constructor, copy constructor, copy assignment, destructor
+	// Constructors, assignment, destructor. Copies only include Xfoil state if
+	// Xfoil BL has been run on the original; otherwise, Xfoil data is set up
+	// again when needed. Moves transfer the Xfoil state.
 	
 	Airfoil ();
 	Airfoil ( const Airfoil & foil );
+	Airfoil ( Airfoil && foil ) noexcept;
 	Airfoil & operator = ( const Airfoil & foil );
+	Airfoil & operator = ( Airfoil && foil ) noexcept;
 	virtual ~Airfoil ();
+
+	// Frees Xfoil data, keeping the airfoil geometry. BL data and wake data
+	// are not available afterwards until Xfoil is run again.
+
+	void releaseXfoil ();
 	
 	// Setting airfoil coordinates
 	
@@ -115,6 +145,8 @@ class Airfoil: public SectionalObject {
 	const double & pitchingMomentCoefficient () const;
 	std::vector<double> blData ( const std::string & varname,
 	                             int & stat ) const;
+	int blState ( int nw, std::vector<double> & surfdata,
+	              std::vector<double> & wakedata ) const;
 	void reinitializeBL ();
 
 	// Wake data
@@ -23,6 +23,33 @@ struct conjgrad_options_type
   bool display_progress;
 }; 
 
+struct gmres_options_type
+{
+  double tol;                           // Relative residual tolerance
+  unsigned int maxit, restart;          // Max iterations, Krylov basis size
+};
+
+// Data for the tanh spacing function, set up once for a given number of points,
+// length, and end spacings. Used in place of global data so that spacing
+// routines are reentrant.
+
+struct tanh_spacing_context
+{
+  unsigned int N;                       // Number of points - 2
+  double slen, sp0, sp1;                // Length and end spacings
+  double a1sum, a2sum, a3sum, a4sum, a5sum;
+                                        // Sums of basis functions over [0, N]
+  std::vector<double> phi;              // phi4 at [0, N]; phi5[i] = phi[N-i]
+
+  void setup ( unsigned int n, const double & len, const double & sp0in,
+               const double & sp1in );
+  void coefficients ( const double & a4, const double & a5, double & a1,
+                      double & a2, double & a3 ) const;
+  double spacing ( unsigned int i, const double & a1, const double & a2,
+                   const double & a3, const double & a4,
+                   const double & a5 ) const;
+};
+
 // Public routines
 
 std::vector<double> uniform_spacing ( const double & slen, unsigned int n );
@@ -33,6 +60,15 @@ void opt_tanh_spacing ( unsigned int n, const double & slen, const double & sp0,
 double tanh_spacing ( unsigned int i, const double & a4, const double & a5,
                       unsigned int n, const double & slen, const double & sp0,
                       const double & sp1 );
+std::vector<double> tanh_spacings ( const double & a4, const double & a5,
+                                    unsigned int n, const double & slen,
+                                    const double & sp0, const double & sp1 );
+void simplex_search ( std::vector<double> & xopt, double & fmin,
+                      unsigned int & nsteps, unsigned int & fevals,
+                      double (*objfunc)(const std::vector<double> & x,
+                                        void *data),
+                      void *objdata, const std::vector<double> & x0,
+                      const simplex_options_type & searchopt );
 void simplex_search ( std::vector<double> & xopt, double & fmin,
                       unsigned int & nsteps, unsigned int & fevals,
                       double (*objfunc)(const std::vector<double> & x),
@@ -51,6 +87,11 @@ void conjgrad_search ( std::vector<double> & xopt, double & fmin,
                        double (*objfunc)(const std::vector<double> & x),
                        const std::vector<double> & x0,
                        const conjgrad_options_type & searchopt );
+void gmres ( std::vector<double> & x, const std::vector<double> & b,
+             void (*matvec)(const std::vector<double> & x,
+                            std::vector<double> & y, void *data),
+             void *data, const gmres_options_type & opts,
+             unsigned int & iters, double & resid );
 double centered_difference ( const double & yp1, const double & y0,
 		                     const double & ym1, const double & xp1,
 							 const double & xm1 );
@@ -0,0 +1,65 @@
+// Header for Checkpoint class
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/******************************************************************************/
+//
+// Checkpoint class. Stores named arrays of doubles in a versioned binary file
+// that can be memory-mapped for reading, so that arrays are accessed in place
+// without parsing. Used for solution restart.
+//
+/******************************************************************************/
+class Checkpoint {
+
+    private:
+
+    // Arrays to write
+
+    std::vector<std::string> _names;
+    std::vector< std::vector<double> > _arrays;
+
+    // Mapped or read file
+
+    char *_buf;                         // Start of file contents
+    uint64_t _bufsize;                  // Size of file
+    bool _mapped;                       // Whether _buf is memory-mapped
+    std::vector<char> _readbuf;         // File contents if not mapped
+
+    public:
+
+    const static uint32_t version = 1;  // Checkpoint format version
+
+    // Constructor and destructor
+
+    Checkpoint ();
+    ~Checkpoint ();
+
+    // Adds an array to be written
+
+    void addArray ( const std::string & name,
+                    const std::vector<double> & data );
+
+    // Writes all added arrays. The file is written to a temporary name and
+    // renamed, so an existing checkpoint is not lost if writing fails.
+
+    int write ( const std::string & fname ) const;
+
+    // Opens (memory-maps where supported) and validates a checkpoint file.
+    // Returns 0 on success, 1 if the file cannot be read, 2 if it is not a
+    // valid checkpoint, or 3 if the version or byte order does not match.
+
+    int open ( const std::string & fname );
+    void close ();
+
+    // Pointer to array in the opened file and its length, or NULL if there is
+    // no array with that name
+
+    const double * array ( const std::string & name, uint64_t & count ) const;
+};
+
+#endif
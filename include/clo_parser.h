@@ -17,6 +17,7 @@ class CLOParser {
 
 	std::vector<std::string> _argv_str;
 	std::string _input_file;
+	std::string _restart_file;
 	
 	/* Converts CLOs to vector of strings */
 	
@@ -41,6 +42,7 @@ class CLOParser {
 	
 	bool requestInputFile () const;
 	const std::string & inputFile () const;
+	const std::string & restartFile () const;
 };
 
 #endif
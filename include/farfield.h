@@ -4,12 +4,24 @@
 #define FARFIELD_H
 
 #include <vector>
+#include <map>
 #include <Eigen/Core>
 #include "vertex.h"
 #include "quadpanel.h"
 
 class Panel;
 
+/** Location and size of a farfield quad on the refinement lattice of its face.
+    Lattice units are the finest allowed spacing. **/
+struct facecell
+{
+    unsigned int face;
+    unsigned int i;
+    unsigned int j;
+    unsigned int size;
+    unsigned int level;
+};
+
 /******************************************************************************/
 //
 // Farfield class. Used for calculating rate of change of momentum of air in the
@@ -21,19 +33,73 @@ class Farfield {
     private:
 
     double _rcore;
+    unsigned int _nx, _ny, _nz;
+    double _cenx, _ceny, _cenz, _lenx, _leny, _lenz, _beta;
     std::vector< std::vector< std::vector<Vertex> > > _vertarray;
     std::vector< std::vector< std::vector<QuadPanel> > > _quadarray;
     std::vector<Vertex *> _verts;
-    std::vector<QuadPanel *> _quads;
+    std::vector<QuadPanel *> _quads;            // Active (leaf) quads
+    std::vector<facecell> _quadcells;           // Lattice location of quads
+
+    // Adaptive refinement
+
+    unsigned int _maxlevel, _level;             // Max and current level
+    double _reftol;                             // Integrand variation tol.
+    int _firstvertidx, _nextelemidx;
+    unsigned int _firstnewvert;                 // First unevaluated vertex
+    std::vector< std::vector<Vertex> > _refverts;
+    std::vector< std::vector<QuadPanel> > _refquads;
+                                                // Vertices and quads added
+                                                //   at each level
+    std::map<unsigned long long, Vertex *> _vertmap;
+                                                // Lattice point -> vertex
+
+    std::vector< std::vector<double> > _quadweights;
+                                                // Normalized inverse-distance
+                                                //   weights of quad vertices
+    std::vector<Eigen::Vector3d> _quadmomrate, _quadpforce;
+                                                // Per-quad contributions
+    std::vector<Eigen::Vector3d> _facemomrate, _facepforce;
+                                                // Per-face breakdown
     Eigen::Vector3d _momrate, _pforce, _aeroforce;
     double _lift, _induced_drag, _cl, _cdi;
 
+    // Lattice helpers
+
+    unsigned long long latticeKey ( unsigned int face, unsigned int i,
+                                    unsigned int j ) const;
+    void latticeCoordinates ( unsigned int face, unsigned int i,
+                              unsigned int j, double & x, double & y,
+                              double & z ) const;
+    void latticePosition ( unsigned int face, const double & x,
+                           const double & y, const double & z, double & i,
+                           double & j ) const;
+    void setFaceQuad ( QuadPanel & quad, unsigned int face, Vertex * v00,
+                       Vertex * v01, Vertex * v11, Vertex * v10,
+                       bool ref_element_to_vert=true );
+
+    // Computes inverse-distance weights for interpolating to quad centroids
+
+    void computeQuadWeights ();
+
+    // Points where wake panel edges (and their mirror images) cross each face,
+    // in lattice coordinates
+
+    void wakeCrossings ( const std::vector<Panel *> & allwake,
+                   std::vector< std::vector<Eigen::Vector2d> > & crossings
+                       ) const;
+
     public:
 
     // Constructor
     
     Farfield ();
     
+    // Adaptive refinement settings. Must be called before initialize. maxlevel
+    // = 0 disables refinement.
+
+    void setRefinement ( unsigned int maxlevel, const double & tol );
+
     // Initialize
     
     void initialize ( unsigned int nx, unsigned int ny, unsigned int nz,
@@ -54,9 +120,20 @@ class Farfield {
 
     void computeVelocity ( const Eigen::Vector3d & uinfvec, const double & minf,
                            const std::vector<Panel *> & allsurf,
-                           const std::vector<Panel *> & allwake );
+                           const std::vector<Panel *> & allwake,
+                           bool new_only=false );
     int computePressure ( const double & uinf, const double & rhoinf,
-                          const double & pinf );
+                          const double & pinf, bool new_only=false );
+
+    // Performs one level of refinement, splitting quads crossed by the wake or
+    // where the momentum flux integrand varies by more than the tolerance.
+    // Velocity and pressure must be available at all current vertices.
+    // Returns the number of quads that were split. Vertices added here are
+    // evaluated by calling computeVelocity and computePressure with
+    // new_only=true.
+
+    unsigned int refine ( const std::vector<Panel *> & allwake,
+                          const double & rhoinf, const double & uinf );
 
     // Computes force (rate of change of momentum) on fluid inside control
     // volume. Also computes pressure force on fluid due to outer boundary.
@@ -65,7 +142,8 @@ class Farfield {
     void computeForce ( const double & alpha, const double & rhoinf,
                         const double & uinf, const double & sref );
 
-    // Write data to CSV file
+    // Write data to CSV files. Per-face momentum flux and pressure force are
+    // written to a separate file.
 
     int writeForceAccel ( const std::string & casename ) const;
 };
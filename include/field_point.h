@@ -0,0 +1,44 @@
+// Flow quantities at off-body points, shared by farfield, probes, and
+// streamlines
+
+#ifndef FIELDPOINT_H
+#define FIELDPOINT_H
+
+#include <vector>
+#include <Eigen/Core>
+
+class Vertex;
+class Panel;
+
+// Public routines
+
+Eigen::Vector3d field_point_velocity ( const double &, const double &,
+                                       const double &, const Eigen::Vector3d &,
+                                       const double &,
+                                       const std::vector<Panel *> &,
+                                       const std::vector<Panel *> &,
+                                       const double & );
+                        // Returns velocity due to freestream, surface panels,
+                        //   and wake panels (vortex core radius given) at a
+                        //   point given by its incompressible coordinates.
+                        //   Arguments after the coordinates: freestream
+                        //   vector, beta.
+
+void field_point_velocity ( Vertex &, const Eigen::Vector3d &, const double &,
+                            const std::vector<Panel *> &,
+                            const std::vector<Panel *> &, const double & );
+                        // Computes velocity at a vertex due to freestream,
+                        //   surface panels, and wake panels (vortex core
+                        //   radius given) from its incompressible coordinates
+                        //   and stores it in vertex data 2-4. Arguments after
+                        //   the vertex: freestream vector, beta.
+
+int field_point_pressure ( Vertex &, const double &, const double &,
+                           const double & );
+                        // Computes pressure, pressure coefficient, Mach
+                        //   number, and density at a vertex from its velocity
+                        //   and stores them in vertex data 5-8. Arguments
+                        //   after the vertex: uinf, rhoinf, pinf. Returns 1 if
+                        //   the flow is locally supersonic, 0 otherwise.
+
+#endif
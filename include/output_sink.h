@@ -0,0 +1,141 @@
+// Header for OutputSink and HistoryFile classes
+
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <chrono>
+#include <stdint.h>
+
+/******************************************************************************/
+//
+// OutputSink class. Text output file that is kept open for the whole run.
+// Writes are buffered and flushed to disk when the buffer is large, when the
+// flush interval has elapsed since the last flush, or when the file is
+// closed.
+//
+/******************************************************************************/
+class OutputSink {
+
+    private:
+
+    std::string _fname;
+    std::ofstream _f;
+    std::string _buffer;                // Text not yet written to file
+    bool _newfile;                      // True until first write to an empty
+                                        //   file, for writing headers
+    double _interval;                   // Flush interval in seconds
+    std::chrono::steady_clock::time_point _lastflush;
+
+    // Copying would duplicate the file handle
+
+    OutputSink ( const OutputSink & );
+    OutputSink & operator= ( const OutputSink & );
+
+    public:
+
+    // Constructor and destructor. The destructor flushes and closes the file.
+
+    OutputSink ();
+    ~OutputSink ();
+
+    // Opens file, either truncating it or appending to it
+
+    int open ( const std::string & fname, bool append,
+               const double & flush_interval );
+    bool isOpen () const;
+
+    // Whether nothing has been written to the file yet
+
+    bool newFile () const;
+
+    // Buffered writes. writeHeader writes quoted column names, and writeRow
+    // writes an integer iteration followed by values in scientific notation.
+
+    void write ( const std::string & text );
+    void writeHeader ( const std::vector<std::string> & columns );
+    void writeRow ( int iter, const std::vector<double> & values );
+
+    // Flush buffer to disk, or flush and close
+
+    int flush ();
+    int close ();
+
+    // Flushes buffer and returns size of file on disk
+
+    uint64_t fileSize ();
+};
+
+/******************************************************************************/
+//
+// HistoryFile class. Single self-describing binary file holding the time
+// history of any number of tables, e.g. forces and moments for each iteration
+// and sectional data for each iteration and section. Rows are buffered in
+// memory and written in column-major blocks when flushed, so that each column
+// in a block is contiguous.
+//
+/******************************************************************************/
+class HistoryFile {
+
+    private:
+
+    std::string _fname;
+    std::ofstream _f;
+    std::string _pending;               // Table definitions not yet written
+    std::vector<std::vector<std::string> > _columns;
+                                        // Column names of each table
+    std::vector<std::vector<double> > _rows;
+                                        // Buffered rows of each table, stored
+                                        //   row-major
+    double _interval;                   // Flush interval in seconds
+    std::chrono::steady_clock::time_point _lastflush;
+
+    HistoryFile ( const HistoryFile & );
+    HistoryFile & operator= ( const HistoryFile & );
+
+    public:
+
+    const static uint32_t version = 1;  // History file format version
+
+    // Constructor and destructor. The destructor flushes and closes the file.
+
+    HistoryFile ();
+    ~HistoryFile ();
+
+    // Opens file, either truncating it or appending to it
+
+    int open ( const std::string & fname, bool append,
+               const double & flush_interval );
+    bool isOpen () const;
+
+    // Defines a table and returns its id
+
+    int addTable ( const std::string & name,
+                   const std::vector<std::string> & columns );
+
+    // Adds a row to a table. The row must have one value per column.
+
+    void addRow ( int tableid, const std::vector<double> & row );
+
+    // Flush buffered rows to disk, or flush and close
+
+    int flush ();
+    int close ();
+
+    // Flushes buffered rows and returns size of file on disk
+
+    uint64_t fileSize ();
+};
+
+/******************************************************************************/
+//
+// Truncates an existing output file to the given size, discarding anything
+// written after that point. Files that are missing or already smaller are
+// left as they are.
+//
+/******************************************************************************/
+int truncate_output ( const std::string & fname, uint64_t size );
+
+#endif
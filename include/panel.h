@@ -53,8 +53,7 @@ class Panel: public Element {
     Panel * _right, * _left, * _front, * _back;
                                     // Neighbor panels
     Eigen::Matrix3d _jac;           // Grid metrics jacobian matrix
-    Eigen::PartialPivLU<Eigen::Matrix3d> _lu;
-                                    // Factorization of jacobian matrix 
+    Eigen::Matrix3d _invjac;        // Inverse of jacobian matrix
     
     const static double _farfield_distance_factor;
     
@@ -90,8 +89,10 @@ class Panel: public Element {
     Panel * backNeighbor ();
     
     // Compute grid transformation (must be done after setting neighbors)
+    // and access its inverse
     
     int computeGridTransformation ();
+    const Eigen::Matrix3d & inverseJacobian () const;
     
     // Computing and accessing source strength
 
@@ -164,10 +165,11 @@ class Panel: public Element {
                                              const double & rcore,
                                              bool mirror_y=false ) const = 0;
     
-    // Compute or access surface velocity. Must set neighbors and compute grid
-    // transformation before computing velocity.
+    // Compute, set, or access surface velocity. Must set neighbors and
+    // compute grid transformation before computing velocity.
     
     void computeVelocity ( const Eigen::Vector3d & uinfvec );
+    void setVelocity ( const Eigen::Vector3d & vel );
     const Eigen::Vector3d & velocity () const;
     const Eigen::Vector3d & velocityComp () const;
 
@@ -182,17 +184,27 @@ class Panel: public Element {
     const double & pressure () const;
     const double & density () const;
     const double & pressureCoefficient () const;
+
+    // Derivative of pressure with respect to incompressible velocity, from
+    // the last computePressure call. Zero where pressure was limited.
+
+    Eigen::Vector3d pressureVelocityDerivative ( const double & uinf,
+                                                 const double & rhoinf,
+                                                 const double & pinf ) const;
     
     // Mass defect: uedge*deltastar and derivative d/ds
 
     const double & massDefect() const;
     const double & massDefectDerivative () const;
 
-    // Average viscous quantities from vertices
+    // Average viscous quantities from vertices, or set averages computed
+    // elsewhere
 
     void averageFromVertices ();
+    void setViscousAverages ( const double & cf, const double & mdefect );
 
-    // Compute force and moment contributions
+    // Compute force and moment contributions. For viscous, quantities must
+    // first be averaged from vertices.
     
     void computeForceMoment ( const double & uinf, const double & rhoinf,
                               const double & pinf,
@@ -0,0 +1,73 @@
+// Header for Probes class
+
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <vector>
+#include <string>
+#include <Eigen/Core>
+#include "settings.h"
+#include "vertex.h"
+
+class Panel;
+
+// Computes the points of a probe definition, with n1 varying fastest. Also used
+// to set up streamline seeds and cut planes.
+
+void probe_points ( const probedef & def, unsigned int & n1, unsigned int & n2,
+                    std::vector<Eigen::Vector3d> & pts );
+
+/******************************************************************************/
+//
+// Probes class. Off-body points, line rakes, and planar cuts where velocity and
+// pressure are evaluated from the surface and wake singularities after the
+// solution is converged.
+//
+/******************************************************************************/
+class Probes {
+
+    private:
+
+    double _rcore;                          // Vortex core radius for wake
+    std::vector<Vertex> _verts;             // All probe points, stored in the
+                                            //   order probes are defined
+    std::vector<std::string> _names;        // Probe names
+    std::vector<std::string> _types;        // Probe types
+    std::vector<unsigned int> _start;       // Index of first point of each
+                                            //   probe in _verts
+    std::vector<unsigned int> _n1, _n2;     // Number of points in each probe
+                                            //   direction
+
+    public:
+
+    // Constructor
+
+    Probes ();
+
+    // Creates probe points from definitions
+
+    void initialize ( const std::vector<probedef> & defs, const double & minf,
+                      const double & rcore );
+
+    // Access
+
+    unsigned int nProbes () const;
+    unsigned int nVerts () const;
+    Vertex & vert ( unsigned int vidx );
+
+    // Velocity and pressure (and cp, mach, and density) calculation. All probe
+    // points are evaluated in a single parallel pass.
+
+    void computeVelocity ( const Eigen::Vector3d & uinfvec, const double & minf,
+                           const std::vector<Panel *> & allsurf,
+                           const std::vector<Panel *> & allwake );
+    int computePressure ( const double & uinf, const double & rhoinf,
+                          const double & pinf );
+
+    // Write data to file. Format is "csv" or "binary".
+
+    int write ( const std::string & casename,
+                const std::string & format ) const;
+};
+
+#endif
@@ -0,0 +1,110 @@
+// Header for Profiler and ScopedTimer classes
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <chrono>
+#include <stdint.h>
+
+/******************************************************************************/
+//
+// Profiler class. Accumulates wall time and, optionally, hardware counters
+// (cycles, instructions, cache misses via Linux perf_event) for named phases
+// of the solver. Totals are kept for each iteration and for the whole run.
+// Phases with a "/" in the name are parts of the phase named before it.
+//
+/******************************************************************************/
+class Profiler {
+
+    private:
+
+    std::vector<std::string> _names;    // Phase names
+    std::vector<double> _itertime, _totaltime, _maxtime;
+                                        // Wall time this iteration, total, and
+                                        //   longest single call
+    std::vector<unsigned long> _itercalls, _totalcalls;
+    std::vector<std::chrono::steady_clock::time_point> _starts;
+    std::chrono::steady_clock::time_point _runstart;
+
+    // Hardware counters. Counts are for the thread that starts and stops a
+    // phase, so in OpenMP regions they cover the master thread only.
+
+    int _perffd[3];                     // cycles, instructions, cache misses
+    bool _perf;
+    std::vector<uint64_t> _perfstart, _iterperf, _totalperf;
+                                        // 3 values per phase
+
+    // Per-iteration reports
+
+    std::ofstream _csv, _json;
+
+    // Reads hardware counters
+
+    void readCounters ( uint64_t counts[3] ) const;
+
+    public:
+
+    // Constructor and destructor
+
+    Profiler ();
+    ~Profiler ();
+
+    // Index of a phase, adding it if it does not exist
+
+    int phase ( const std::string & name );
+
+    // Start or stop timing a phase. Must be called outside of parallel
+    // regions.
+
+    void start ( int idx );
+    void stop ( int idx );
+    void start ( const std::string & name );
+    void stop ( const std::string & name );
+
+    // Adds a measured time to a phase. May be called in parallel regions.
+
+    void addTime ( int idx, const double & seconds );
+
+    // Enables hardware counters. Returns nonzero if not available.
+
+    int enableCounters ();
+
+    // Opens per-iteration reports. format is csv, json, or both.
+
+    int openReport ( const std::string & prefix, const std::string & format,
+                     bool append );
+
+    // Writes per-iteration reports and resets iteration totals
+
+    void endIteration ( int iter );
+
+    // Prints summary table of totals for the run
+
+    void printSummary () const;
+};
+
+/******************************************************************************/
+//
+// ScopedTimer class. Times a phase from construction to destruction.
+//
+/******************************************************************************/
+class ScopedTimer {
+
+    private:
+
+    int _idx;
+
+    public:
+
+    ScopedTimer ( const std::string & name );
+    ~ScopedTimer ();
+};
+
+// Profiler for the run
+
+extern Profiler profiler;
+
+#endif
@@ -54,17 +54,31 @@ class Section: public SectionalObject {
 	std::vector<interpdata> _foilinterp;
 						// Airfoil interpolation points & weights for verts
 	
+	std::vector<double> _blbuffer, _wakebuffer;
+						// Surface and wake BL data from Xfoil, reused
+						// between iterations (see Airfoil::blState)
+	
 	// Interpolates BL data from airfoil points to section vertices and sets
 	// vertex data
 	
-	void setVertexBLData ( const std::vector<double> & bldata,
-	                       unsigned int dataidx, double scale=1.0 );
+	void setVertexBLData ( const double & uinf );
+
+	// Transforms vertices from airfoil coordinates to section position,
+	// orientation, and scale
+
+	void placeVertices ( const std::vector<double> & xf,
+	                     const std::vector<double> & zf );
 
 	public:
 
-	// Constructor and destructor
+	// Constructors, assignment, and destructor. Moves transfer the airfoil's
+	// Xfoil data instead of copying it.
 	
 	Section (); 
+	Section ( const Section & sec ) = default;
+	Section ( Section && sec ) = default;
+	Section & operator = ( const Section & sec ) = default;
+	Section & operator = ( Section && sec ) = default;
 	virtual ~Section ();
 	
 	// Set or access position, orientation, and scale
@@ -89,6 +103,12 @@ class Section: public SectionalObject {
 	void setVertices ( unsigned int nchord, const double & lesprat,
 	                   const double & tesprat );
 
+	// Changes position, chord, and twist after setting vertices, moving the
+	// vertices but keeping the airfoil and spacing
+
+	void moveVertices ( const double & xle, const double & zle,
+	                    const double & chord, const double & twist );
+
 	// Prandtl-Glauert geometric transformation (xinc = x/beta)
 
 	void transformPrandtlGlauert ( const double & minf );
@@ -107,11 +127,27 @@ class Section: public SectionalObject {
 	
 	void setMachNumber ( const double & mach );
 	
-	// BL calculations with Xfoil
+	// Sectional lift coefficient of the 3D solution in the section frame,
+	// secant derivative of it with respect to the lift coefficient of the last
+	// Xfoil run (false if not available yet), and that lift coefficient
+	
+	double computeLift2D ( const Eigen::Vector3d & uinfvec,
+	                       const double & rhoinf, const double & pinf,
+	                       const double & alpha );
+	bool liftSlope ( const double & cl2d, double & slope ) const;
+	const double & liftGuess () const;
+
+	// Sets the lift coefficient Xfoil is first run at (e.g. from a vortex
+	// lattice solution)
+
+	void setLiftGuess ( const double & cl );
+	
+	// BL calculations with Xfoil. Xfoil is run at clspec if given, or else at
+	// a secant update of the sectional lift coefficient.
 	
 	void computeBL ( const Eigen::Vector3d & uinfvec, const double & rhoinf,
 		             const double & pinf, const double & alpha,
-		             int reinit_freq );
+		             int reinit_freq, const double * clspec=NULL );
 	bool blConverged () const;
 	bool blReinitialized () const;
 	
@@ -121,6 +157,12 @@ class Section: public SectionalObject {
 	                          const double & rhoinf, const double & pinf,
 	                          bool viscous );
 	
+	// Sets sectional force and moment coefficients computed another way
+	// (e.g. vortex lattice). Viscous parts are set to zero.
+
+	void setForceMoment ( const double & cl, const double & cd,
+	                      const double & cm );
+	
 	// Sectional force and moment coefficients
 	
 	double liftCoefficient () const;
@@ -144,6 +186,13 @@ class Section: public SectionalObject {
 
 	void interpolateBL ( Section & sec1, Section & sec2,
 	                     const double & weight1, const double & weight2 );
+
+	// Gets or sets data needed to restart BL calculations. getRestartData
+	// appends to data. setRestartData returns the number of values read, or 0
+	// if count is too small. The number of wake points is part of the data.
+
+	void getRestartData ( std::vector<double> & data ) const;
+	unsigned int setRestartData ( const double *data, unsigned int count );
 };
 
 #endif
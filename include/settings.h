@@ -4,6 +4,7 @@
 #define SETTINGS_H
 
 #include <string>
+#include <vector>
 #include <Eigen/Core>
 #include <tinyxml2.h>
 extern "C"
@@ -34,6 +35,24 @@ extern double stop_tol;
 extern int maxiters;
 extern int miniters;
 extern int viz_freq;
+extern std::string viz_format;
+extern bool viz_compress;
+extern bool viz_float32;
+extern bool viz_background;
+extern int checkpoint_freq;
+extern double output_flush_interval;
+extern bool write_history;
+extern std::string timing_report;
+extern bool perf_counters;
+extern bool mixed_precision;
+extern bool mixed_precision_check;
+extern bool matrix_free;
+extern double matrix_free_tol;
+extern std::string surface_gradient;
+extern bool spanwise_newton;
+extern bool sensitivities;
+extern bool sensitivities_check;
+extern std::string vortex_lattice;
 
 // Xfoil settings
 
@@ -46,6 +65,38 @@ extern bool enable_farfield;
 extern double farfield_cenx, farfield_ceny, farfield_cenz;
 extern double farfield_lenx, farfield_leny, farfield_lenz;
 extern int farfield_nx, farfield_ny, farfield_nz;
+extern int farfield_maxlevel;
+extern double farfield_reftol;
+
+// Probe settings
+
+/** Off-body probe definition. type is "point", "line", or "plane". A line goes
+    from p0 to p1 with n1 points. A plane is spanned by p1 - p0 and p2 - p0 with
+    n1 x n2 points. **/
+struct probedef
+{
+  std::string name;
+  std::string type;
+  Eigen::Vector3d p0;
+  Eigen::Vector3d p1;
+  Eigen::Vector3d p2;
+  int n1;
+  int n2;
+};
+
+extern std::vector<probedef> probe_defs;
+extern std::string probe_format;
+extern double probe_rcore;
+
+// Streamline and vortex core settings
+
+extern bool enable_streamlines;
+extern std::vector<probedef> streamline_seeds;
+extern std::vector<probedef> streamline_cutplanes;
+extern double streamline_tol, streamline_step, streamline_maxlength;
+extern double streamline_rcore, streamline_corethresh;
+extern int streamline_maxsteps;
+extern bool streamline_tracecores;
 
 // Functions
 
@@ -57,6 +108,8 @@ int read_setting ( const XMLElement *elem, const std::string & setting,
                    int & value, bool required=true );
 int read_setting ( const XMLElement *elem, const std::string & setting,
                    bool & value, bool required=true );
+int read_probe ( const XMLElement *elem, const std::string & type,
+                 unsigned int count, probedef & probe );
 int read_settings ( const std::string & inputfile, std::string & geom_file );
 
 #endif
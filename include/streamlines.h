@@ -0,0 +1,107 @@
+// Header for Streamlines class
+
+#ifndef STREAMLINES_H
+#define STREAMLINES_H
+
+#include <vector>
+#include <string>
+#include <Eigen/Core>
+#include "settings.h"
+
+class Panel;
+
+/******************************************************************************/
+//
+// Streamlines class. Traces streamlines from user seeds through the velocity
+// field induced by the surface and wake singularities, and locates vortex cores
+// on cut planes. Used for postprocessing only.
+//
+/******************************************************************************/
+class Streamlines {
+
+    private:
+
+    double _rcore;                          // Vortex core radius for wake
+    double _tol;                            // Position error tol. per step
+    double _h0;                             // Initial step length
+    double _maxlength;                      // Max streamline length
+    double _corethresh;                     // Min. vorticity for cores, as a
+                                            //   fraction of the plane max.
+    unsigned int _maxsteps;                 // Max steps per streamline
+    bool _tracecores;                       // Trace streamlines from cores
+
+    std::vector<Eigen::Vector3d> _seeds;    // Streamline seed points
+    std::vector<probedef> _cutplanes;       // Planes for vortex core search
+
+    std::vector< std::vector<Eigen::Vector3d> > _lines, _linevels;
+                                            // Streamline points and velocities
+    std::vector< std::vector<Eigen::Vector3d> > _corelines, _corelinevels;
+                                            // Streamlines traced from cores
+    std::vector< std::vector<Eigen::Vector3d> > _cores;
+                                            // Vortex cores on each cut plane
+    std::vector< std::vector<double> > _corevort;
+                                            // Normal vorticity at each core
+
+    // Velocity at a batch of points, evaluated in parallel
+
+    void velocities ( const std::vector<Eigen::Vector3d> & pts,
+                      const Eigen::Vector3d & uinfvec, const double & minf,
+                      const std::vector<Panel *> & allsurf,
+                      const std::vector<Panel *> & allwake,
+                      std::vector<Eigen::Vector3d> & vels ) const;
+
+    // Traces streamlines from seeds with adaptive RK45 (Dormand-Prince). All
+    // active streamlines are advanced together so that each stage needs one
+    // batched velocity evaluation.
+
+    void integrate ( const std::vector<Eigen::Vector3d> & seeds,
+                     const Eigen::Vector3d & uinfvec, const double & minf,
+                     const std::vector<Panel *> & allsurf,
+                     const std::vector<Panel *> & allwake,
+                     std::vector< std::vector<Eigen::Vector3d> > & lines,
+                     std::vector< std::vector<Eigen::Vector3d> > & linevels
+                   ) const;
+
+    // Locates vortex cores as local maxima of plane-normal vorticity
+
+    void findCores ( const Eigen::Vector3d & uinfvec, const double & minf,
+                     const std::vector<Panel *> & allsurf,
+                     const std::vector<Panel *> & allwake );
+
+    // Writes a set of polylines to a legacy VTK file
+
+    int writePolylines ( const std::string & fname,
+                   const std::vector< std::vector<Eigen::Vector3d> > & lines,
+                   const std::vector< std::vector<Eigen::Vector3d> > & linevels
+                       ) const;
+
+    public:
+
+    // Constructor
+
+    Streamlines ();
+
+    // Set up seeds, cut planes, and integration parameters
+
+    void initialize ( const std::vector<probedef> & seeds,
+                      const std::vector<probedef> & cutplanes,
+                      const double & rcore, const double & tol,
+                      const double & h0, const double & maxlength,
+                      unsigned int maxsteps, const double & corethresh,
+                      bool tracecores );
+
+    // Traces streamlines, finds vortex cores, and traces streamlines from the
+    // cores on the first cut plane
+
+    void compute ( const Eigen::Vector3d & uinfvec, const double & minf,
+                   const std::vector<Panel *> & allsurf,
+                   const std::vector<Panel *> & allwake );
+
+    // Write streamlines and core trajectories as VTK polylines, and cores to
+    // CSV
+
+    int writeViz ( const std::string & casename ) const;
+    int writeCores ( const std::string & casename ) const;
+};
+
+#endif
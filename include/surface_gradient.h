@@ -0,0 +1,90 @@
+// Header for SurfaceGradient class
+
+#ifndef SURFACEGRADIENT_H
+#define SURFACEGRADIENT_H
+
+#include <vector>
+#include <map>
+#include <Eigen/Core>
+
+class Panel;
+
+/******************************************************************************/
+//
+// SurfaceGradient class. Precomputed sparse operator giving the surface
+// gradient of doublet strength at each panel centroid as a weighted sum of
+// doublet strengths of the panel and its neighbors, used to compute surface
+// velocities of all panels at once. Coefficients are stored in compressed
+// sparse row form, three (x, y, z) per entry. The default stencil is the
+// central difference in grid coordinates multiplied by the inverse grid
+// jacobian, as in Panel::computeVelocity; optionally, a least-squares fit over
+// the panel's neighbors and their neighbors is used instead.
+//
+/******************************************************************************/
+class SurfaceGradient {
+
+    private:
+
+    std::vector<Panel *> _panels;           // Panels
+    std::vector<unsigned int> _offsets;     // Start of each panel's stencil
+                                            //   in _cols, size npanels+1
+    std::vector<unsigned int> _cols;        // Index in _panels of stencil
+                                            //   entries
+    std::vector<double> _coefs;             // Gradient coefficients, 3 per
+                                            //   stencil entry
+    std::vector<double> _norms;             // Panel normals, 3 per panel
+    std::vector<double> _mu, _sigma;        // Gathered singularity strengths
+    std::map<const Panel *, unsigned int> _index;
+                                            // Position of each panel in
+                                            //   _panels
+    bool _leastsquares;                     // Least-squares stencils
+
+    // Stencil of one panel. Indices in cols, 3 coefficients per entry in
+    // coefs. index maps panels to their positions in _panels. The
+    // least-squares stencil returns 1 if there are too few independent
+    // neighbors.
+
+    void centralStencil ( unsigned int pidx,
+                          const std::map<const Panel *, unsigned int> & index,
+                          std::vector<unsigned int> & cols,
+                          std::vector<double> & coefs ) const;
+    int leastSquaresStencil ( unsigned int pidx,
+                          const std::map<const Panel *, unsigned int> & index,
+                          std::vector<unsigned int> & cols,
+                          std::vector<double> & coefs ) const;
+
+    public:
+
+    // Constructor
+
+    SurfaceGradient ();
+
+    // Builds the operator. Neighbors and grid transformations of the panels
+    // must already be set, and neighbors must be in the list.
+
+    void setup ( const std::vector<Panel *> & panels, bool least_squares );
+
+    // Recomputes the stencils of panels whose geometry changed (flagged by
+    // position in the list) and of panels with them in their stencils, after
+    // grid transformations have been updated. Connectivity must not have
+    // changed. Falls back to a full setup if the stencil entries of a panel
+    // change, e.g. when the least-squares fit switches to central
+    // differences.
+
+    void updateStencils ( const std::vector<bool> & changed );
+
+    // Computes and sets surface velocity of all panels. Work is shared among
+    // the threads of the enclosing OpenMP parallel region; called outside of
+    // one, it runs on one thread.
+
+    void computeVelocity ( const Eigen::Vector3d & uinfvec );
+
+    // Transposed product with the operator: given a vector w (3 per panel)
+    // dotted with the surface gradient at each panel, gives the derivative
+    // of the sum with respect to the doublet strength of each panel
+
+    void transposeProduct ( const std::vector<double> & w,
+                            std::vector<double> & g ) const;
+};
+
+#endif
@@ -11,16 +11,24 @@ class Panel;
 /******************************************************************************/
 //
 // Vertex class. Defines x, y, z coordinates in space and stores references to
-// neighboring panels.
+// neighboring panels. Data and neighboring panels are stored in the vertex
+// until it is attached to a VertexStore, after which it is a view of the
+// store's arrays.
 //
 /******************************************************************************/
 class Vertex {
 
+    public:
+
+    const static int dataSize = 14;     // Total number of data vars
+    const static int firstBLData = 9;   // Index of first data var from BL calcs
+
     private:
 
     int _idx;
     double _x, _y, _z;
-    std::vector<Panel *> _panels;   // Neighboring panels
+    std::vector<Panel *> _ownpanels;// Neighboring panels when not attached
+    Panel ** _panels;               // Neighboring panels
     unsigned int _npanels;
     bool _vizcoords;                // Separate coordinates for
     double _xviz, _yviz, _zviz;     //   visualization. Used for trailing
@@ -30,20 +38,29 @@ class Vertex {
     double _xinc, _yinc, _zinc;
 
     // Vertex data: source strength, doublet strength, Vx, Vy, Vz, pressure, cp,
-    // mach, density, cf, deltastar, ampl, uedge, cp from Xfoil
+    // mach, density, cf, deltastar, ampl, uedge, cp from Xfoil. Variable i is
+    // at _data[i*_stride].
     
-    std::vector<double> _data;
+    double _owndata[dataSize];  // Data when not attached
+    double * _data;
+    unsigned int _stride;
     
     double _waketime;           // Variable to track wake convection
 
     public:
-
-    const static int dataSize = 14;     // Total number of data vars
-    const static int firstBLData = 9;   // Index of first data var from BL calcs
     
-    // Constructor
+    // Constructor. Copies are not attached to a VertexStore and hold their own
+    // data and panel list.
     
     Vertex ();
+    Vertex ( const Vertex & vert );
+    Vertex & operator= ( const Vertex & vert );
+    
+    // Attach to storage in a VertexStore. The vertex's data is at
+    // data[i*stride] for variable i, and its neighboring panels at panels.
+    
+    void attach ( double * data, unsigned int stride, Panel ** panels,
+                  unsigned int npanels );
     
     // Set or access index
     
@@ -0,0 +1,116 @@
+// Header for VertexStore class
+
+#ifndef VERTEXSTORE_H
+#define VERTEXSTORE_H
+
+#include <vector>
+
+class Vertex;
+class Panel;
+
+/** Extrapolation of inviscid vertex data to an edge vertex verts[0] as a
+    weighted sum of data at verts[0..2]. Extrapolations are applied in order of
+    stage, since later stages may use vertices updated by earlier ones. **/
+struct edge_extrapolation
+{
+    Vertex * verts[3];
+    double weights[3];
+    unsigned int stage;
+};
+
+/******************************************************************************/
+//
+// VertexStore class. Contiguous storage of vertex data for a set of vertices,
+// one array per data variable (variable i of vertex j is at i*nverts + j),
+// and vertex to panel adjacency in compressed sparse row form. Vertices
+// attached to the store become views: their data and panel lists point into
+// it. The vertices must not be moved or reallocated while attached.
+//
+// Inverse distance weights for averaging panel quantities to vertices and
+// vertex quantities to panels are stored as sparse matrices with the same
+// layout, so averaging is a sparse matrix product over all variables at once.
+// The weights must be recomputed when vertices or panels move.
+//
+// averageFromPanels and extrapolateToEdges share their work among the
+// threads of the enclosing OpenMP parallel region, so that the whole surface
+// post-processing can run in one region. Called outside of a parallel region,
+// they run on one thread.
+//
+/******************************************************************************/
+class VertexStore {
+
+    private:
+
+    std::vector<Vertex *> _verts;           // Attached vertices
+    std::vector<double> _data;              // Vertex data by variable
+    std::vector<unsigned int> _paneloffsets;// Start of each vertex's panels
+                                            //   in _panels, size nverts+1
+    std::vector<Panel *> _panels;           // Neighboring panels
+    std::vector<unsigned int> _adjcols;     // Index in _cols of each entry
+                                            //   in _panels
+    std::vector<double> _pvweights;         // Panel to vertex weights, for
+                                            //   each entry in _panels
+
+    std::vector<Panel *> _cols;             // Distinct neighboring panels
+    std::vector<unsigned int> _vertoffsets; // Start of each panel's vertices
+                                            //   in _vertidx, size ncols+1
+    std::vector<unsigned int> _vertidx;     // Store index of panel vertices.
+                                            //   Empty for panels with
+                                            //   vertices outside the store.
+    std::vector<double> _vpweights;         // Vertex to panel weights
+    std::vector<double> _paneldata;         // Inviscid panel quantities
+                                            //   gathered by row for averaging
+
+    std::vector<unsigned int> _extoffsets;  // Start of each stage in edge
+                                            //   extrapolations
+    std::vector<unsigned int> _extverts;    // Store indices of vertices in
+                                            //   edge extrapolations, 3 each
+    std::vector<double> _extweights;        // Edge extrapolation weights
+
+    // Copying would leave vertices pointing into the original
+
+    VertexStore ( const VertexStore & );
+    VertexStore & operator= ( const VertexStore & );
+
+    public:
+
+    // Constructor
+
+    VertexStore ();
+
+    // Copies data and neighboring panels of vertices into the store,
+    // attaches the vertices to it, and computes weights
+
+    void attach ( const std::vector<Vertex *> & verts );
+
+    // Recomputes averaging weights after vertices or panels have moved
+
+    void computeWeights ();
+
+    // Number of vertices
+
+    unsigned int nVerts () const;
+
+    // Contiguous array of one data variable for all vertices. See legend in
+    // vertex.h.
+
+    const double * field ( unsigned int idx ) const;
+
+    // Sets extrapolations of inviscid data to edge vertices. All vertices
+    // must be in the store.
+
+    void setEdgeExtrapolations ( const std::vector<edge_extrapolation> &
+                                 extraps );
+
+    // Averages neighboring panel quantities to vertices, and extrapolates
+    // inviscid data to edge vertices
+
+    void averageFromPanels ();
+    void extrapolateToEdges ();
+
+    // Averages viscous quantities from vertices to neighboring panels
+
+    void averageToPanels ();
+};
+
+#endif
@@ -0,0 +1,95 @@
+// Header for VortexLattice class
+
+#ifndef VORTEXLATTICE_H
+#define VORTEXLATTICE_H
+
+#include <vector>
+#include <Eigen/Core>
+#include "vertex.h"
+#include "vortex_ring.h"
+#include "horseshoe_vortex.h"
+
+class Section;
+
+/******************************************************************************/
+//
+// VortexLattice class. Vortex lattice on the camber surface of a wing, built
+// from the same sections and chordwise points as the panel discretization.
+// Each strip between two sections has a row of vortex rings from the leading
+// edge to the trailing edge, with the leading leg of each ring at the quarter
+// chord of its camber panel and the collocation point at the three-quarter
+// chord. A horseshoe vortex with the strength of the last ring in the strip
+// models the wake. Uses incompressible (Prandtl-Glauert transformed)
+// coordinates like the panel method.
+//
+/******************************************************************************/
+class VortexLattice {
+
+    private:
+
+    unsigned int _nspan, _nchord;               // Sections and chordwise rings
+    std::vector<Vertex> _verts;                 // Ring corners, _nchord+1 per
+                                                //   section
+    std::vector<Vertex> _wakeverts;             // Points downstream of the
+                                                //   last ring corners, giving
+                                                //   the trailing leg direction
+    std::vector<VortexRing> _rings;             // Rings, _nchord per strip
+    std::vector<HorseshoeVortex> _horseshoes;   // Wake horseshoes, 1 per strip
+    std::vector<Eigen::Vector3d> _colloc, _norms;
+                                                // Collocation points and
+                                                //   normals of rings
+    std::vector<Eigen::Vector3d> _qc;           // Quarter chord points of
+                                                //   sections (actual coords.)
+    std::vector<double> _chords;                // Section chords
+    double _beta;                               // Prandtl-Glauert factor
+
+    public:
+
+    // Constructor. Copies are empty, because rings would point to the
+    // original vertices; the lattice must be initialized again.
+
+    VortexLattice ();
+    VortexLattice ( const VortexLattice & );
+    VortexLattice & operator= ( const VortexLattice & );
+
+    // Builds the lattice from the wing's sections. nchord is the number of
+    // section vertices on each surface, so there are nchord-1 rings per strip.
+    // Incompressible coordinates of the sections must be set.
+
+    void initialize ( std::vector<Section> & sections, unsigned int nchord );
+
+    // Number of rings, and collocation point and normal of a ring
+
+    unsigned int nRings () const;
+    const Eigen::Vector3d & collocationPoint ( unsigned int ridx ) const;
+    const Eigen::Vector3d & normal ( unsigned int ridx ) const;
+
+    // Velocity at a point induced by a ring with unit circulation, including
+    // the wake horseshoe for rings at the trailing edge and the mirror image
+
+    Eigen::Vector3d VCoeff ( unsigned int ridx, const double & x,
+                             const double & y, const double & z ) const;
+
+    // Sets circulation of a ring (and its wake horseshoe)
+
+    void setCirculation ( unsigned int ridx, const double & gamma );
+
+    // Velocity at a point induced by the whole lattice and its mirror image
+
+    Eigen::Vector3d inducedVelocity ( const double & x, const double & y,
+                                      const double & z ) const;
+
+    // Computes force and moment about momcen on the lattice (this half only)
+    // with the Kutta-Joukowski theorem on the spanwise legs, and sectional
+    // lift, drag, and moment coefficients at the sections. Velocities include
+    // those induced by all lattices.
+
+    void computeForceMoment ( const std::vector<VortexLattice *> & alllattice,
+                              const Eigen::Vector3d & momcen,
+                              Eigen::Vector3d & force, Eigen::Vector3d & moment,
+                              std::vector<double> & cl,
+                              std::vector<double> & cd,
+                              std::vector<double> & cm ) const;
+};
+
+#endif
@@ -0,0 +1,99 @@
+// Header for VTUWriter class
+
+#ifndef VTUWRITER_H
+#define VTUWRITER_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <thread>
+
+/** Point or cell data array for VTU output. Components are interleaved. **/
+struct vtu_array
+{
+  std::string name;
+  unsigned int ncomp;
+  std::vector<double> data;
+};
+
+/** Snapshot of an unstructured grid for VTU output. Cells are given as VTK
+    connectivity, offsets (end of each cell in connectivity), and cell types.
+    **/
+struct vtu_grid
+{
+  std::string name;
+  std::vector<double> points;           // x, y, z of each point
+  std::vector<int> connectivity;
+  std::vector<int> offsets;
+  std::vector<unsigned char> types;
+  std::vector<vtu_array> pointdata;
+  std::vector<vtu_array> celldata;
+};
+
+/******************************************************************************/
+//
+// VTUWriter class. Writes unstructured grids as binary XML VTK files (.vtu)
+// with appended raw data, optionally zlib-compressed and/or in single
+// precision. Grids written together at one iteration are grouped in a
+// multiblock file (.vtm), and iterations are indexed in a .pvd collection.
+// Writes may be done on a background thread from a snapshot of the data.
+//
+/******************************************************************************/
+class VTUWriter {
+
+    private:
+
+    bool _compress;                     // zlib compression of data arrays
+    bool _float32;                      // Write floating point as Float32
+    bool _background;                   // Write on a background thread
+
+    std::thread _thread;                // Background writer thread
+    int _status;                        // Status of the last write
+
+    std::vector<std::pair<int,std::string> > _pvdentries;
+                                        // Iteration and .vtm file for .pvd
+
+    // Data for the current write job. Only accessed by the writer thread while
+    // a job is running.
+
+    std::string _dir;
+    std::string _vtmname;
+    std::string _pvdname;
+    std::string _pvdtext;
+    std::vector<vtu_grid> _grids;
+    std::vector<std::string> _gridfiles;
+
+    // Runs the current write job
+
+    void writeJob ();
+
+    public:
+
+    // Constructor and destructor. The destructor waits for any pending write.
+
+    VTUWriter ();
+    ~VTUWriter ();
+
+    // Set output options
+
+    void setOptions ( bool compress, bool float32, bool background );
+
+    // Writes grids for one iteration to <dir><prefix>_<name>_iter<iter>.vtu
+    // and <dir><prefix>_iter<iter>.vtm and adds the iteration to
+    // <dir><prefix>.pvd. Grids are swapped out of the input vector, which is
+    // left empty. Waits for the previous write to finish first. Returns the
+    // status of the previous write in background mode.
+
+    int write ( const std::string & dir, const std::string & prefix, int iter,
+                std::vector<vtu_grid> & grids );
+
+    // Writes a single grid to a .vtu file immediately
+
+    int writeGrid ( const std::string & fname, const vtu_grid & grid ) const;
+
+    // Waits for a pending background write and returns its status
+
+    int wait ();
+};
+
+#endif
@@ -60,6 +60,11 @@ class Wake {
                            const std::vector<Panel *> & allwake );
     void update ();
 
+    // Translates the wake line starting at spanwise station i so that it
+    // starts at the trailing edge again after the wing geometry has changed
+
+    void followTrailingEdge ( unsigned int i );
+
     // Access vertices and panels
     
     unsigned int nVerts () const;
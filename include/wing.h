@@ -8,12 +8,14 @@
 #include "section.h"
 #include "airfoil.h"
 #include "vertex.h"
+#include "vertex_store.h"
 #include "panel.h"
 #include "quadpanel.h"
 #include "tripanel.h"
 #include "wake.h"
 #include "wake_strip.h"
 #include "viscous_wake.h"
+#include "vortex_lattice.h"
 
 /******************************************************************************/
 //
@@ -54,6 +56,7 @@ class Wing {
 	std::vector<WakeStrip> _wakestrips;	
 									// Wake strips behind TE panels
 	ViscousWake _vwake;				// Viscous wake
+	VortexLattice _vlm;				// Vortex lattice on camber surface
 
 	double _liftp, _liftf;			// Pressure and skin friction, integrated
 	double _lifttr;					// Trefftz plane
@@ -67,6 +70,11 @@ class Wing {
 
 	void computeAreaMAC ( const std::vector<Section> & sorted_user_sections );
 
+	// Computes surface tangents and grid metrics of panels in rows firstrow
+	// to lastrow of _panels, or of all panels by default
+
+	void computeSurfaceMetrics ( unsigned int firstrow=0, int lastrow=-1 );
+
 	public:
 
 	// Constructor
@@ -111,16 +119,26 @@ class Wing {
 	// Creates panels and surface vertex pointers
 	
 	void createPanels ( int & next_global_vertidx, int & next_global_elemid );
+
+	// Changes position, chord, and twist of a section after creating panels
+	// and wake, moving vertices, tip cap, and wake line. Surface panels that
+	// moved are appended to moved.
+
+	void setSectionGeometry ( unsigned int sidx, const double & xle,
+	                          const double & zle, const double & chord,
+	                          const double & twist,
+	                          std::vector<Panel *> & moved );
 	
 	// Set up wake
 	
 	void setupWake ( const double & maxspan, int & next_global_vertidx,
 	                 int & next_global_elemidx, int wakeidx );
 
-	// Computes velocities and pressures on surface panels; interpolate to
-	// vertices
+	// Adds precomputed extrapolations of vertex data to wing edges. Surface
+	// quantities are computed and interpolated to vertices by Aircraft for
+	// all wings together.
 	
-	void computeSurfaceQuantities ();
+	void edgeExtrapolations ( std::vector<edge_extrapolation> & extraps );
 	
 	// Access to verts and panels
 	
@@ -138,21 +156,47 @@ class Wing {
 	WakeStrip * wStrip ( unsigned int wsidx );
 	ViscousWake & viscousWake ();
 
-	// Compute viscous forces (and skin friction, etc.) using Xfoil at sections
+	// Access to sections
+	
+	unsigned int nSections () const;
+	Section & section ( unsigned int sidx );
+
+	// Compute viscous forces (and skin friction, etc.) using Xfoil at sections.
+	// clspec optionally gives the lift coefficient to run Xfoil at for each
+	// section.
 	
-	void computeBL ();
+	void computeBL ( const double * clspec=NULL );
 	
 	// Set up viscous wake (note: only possible after computing BL first time)
 	
 	void setupViscousWake ( int & next_global_vertidx,
 	                        int & next_global_elemidx );
 
+	// Gets or sets BL restart data for all sections. setRestartData returns
+	// the number of values read, or 0 if count is too small.
+
+	void getRestartData ( std::vector<double> & data ) const;
+	unsigned int setRestartData ( const double *data, unsigned int count );
+
+	// Set up and access vortex lattice. Sections and their incompressible
+	// coordinates must be set.
+
+	void setupVortexLattice ();
+	VortexLattice & vortexLattice ();
+
 	// Compute forces and moments, including sectional
 	
 	void computeForceMoment ( const Eigen::Vector3d & momcen,
 	                          const double & xtrefftz, const double & ztrefftz,
 	                          const std::vector<Wake *> & allwake );
 	
+	// Compute forces and moments, including sectional, from the vortex
+	// lattice solution instead of the panels. alllattice contains the
+	// lattices of all wings, with circulations set.
+
+	void computeVortexLatticeForceMoment ( const Eigen::Vector3d & momcen,
+	                         const std::vector<VortexLattice *> & alllattice );
+	
 	double lift () const;						// Trefftz + skin friction
 	const double & trefftzLift () const;		// Calculated in Trefftz plane
 	const double & skinFrictionLift () const;	// Via skin friction integration
@@ -184,13 +228,16 @@ class Wing {
 	double pressurePitchingMomentCoefficient () const;
 	double skinFrictionPitchingMomentCoefficient () const;
 	
-	// Write forces and moments to file
+	// Column names and values of forces and moments for output
 	
-	int writeForceMoment ( int iter ) const;
+	void forceMomentData ( std::vector<std::string> & columns,
+	                       std::vector<double> & values ) const;
 	
-	// Write sectional force and moment coefficients to file
+	// Column names and values of sectional force and moment coefficients for
+	// output, one row per section including the mirror image
 	
-	int writeSectionForceMoment ( int iter ) const;
+	void sectionData ( std::vector<std::string> & columns,
+	                   std::vector<std::vector<double> > & rows ) const;
 };
 
 #endif
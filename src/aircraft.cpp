@@ -1,9 +1,12 @@
 #define USE_MATH_DEFINES
 
+#include <iostream>
 #include <iomanip>
 #include <vector>
 #include <fstream>
 #include <cmath>
+#include <map>
+#include <algorithm>
 #include <tinyxml2.h>
 #include <Eigen/Core>
 #include "util.h"
@@ -14,7 +17,15 @@
 #include "element.h"
 #include "panel.h"
 #include "wing.h"
+#include "vortex_lattice.h"
 #include "farfield.h"
+#include "probes.h"
+#include "streamlines.h"
+#include "vtu_writer.h"
+#include "checkpoint.h"
+#include "output_sink.h"
+#include "profiler.h"
+#include "algorithms.h"
 #include "aircraft.h"
 
 using namespace tinyxml2;
@@ -37,6 +48,7 @@ void Aircraft::setGeometryPointers ()
     unsigned int nverts_wake_total, nverts_wake, vwcounter;
     unsigned int nwaketris_total, nwakequads_total, nwaketris, nwakequads;
     unsigned int wakecounter;
+    std::vector<edge_extrapolation> extraps;
     
     // Get sizes first (don't use push_back, because it invalidates pointers)
     
@@ -114,6 +126,21 @@ void Aircraft::setGeometryPointers ()
         
         _allwake[i] = &_wings[i].wake();
     }
+
+    // Move vertex data and vertex to panel adjacency into contiguous storage
+
+    _vertstore.attach(_verts);
+    _wakevertstore.attach(_wakeverts);
+
+    // Surface geometry is fixed, so the surface gradient operator and edge
+    // extrapolation weights are computed once
+
+    _surfgrad.setup(_panels, surface_gradient == "least_squares");
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wings[i].edgeExtrapolations(extraps);
+    }
+    _vertstore.setEdgeExtrapolations(extraps);
 }
 
 /******************************************************************************/
@@ -480,7 +507,7 @@ void Aircraft::writeWakeData ( std::ofstream & f ) const
 
 /******************************************************************************/
 //
-// Writes legacy VTK farfield viz
+// Writes legacy VTK farfield viz, or binary VTU if VisualizationFormat is vtu
 //
 /******************************************************************************/
 int Aircraft::writeFarfieldViz ( const std::string & prefix )
@@ -489,6 +516,14 @@ int Aircraft::writeFarfieldViz ( const std::string & prefix )
   std::ofstream f;
   int i, j;
   unsigned int nverts, npanels, verts_offset, cellsize, ncellverts;
+  vtu_grid grid;
+
+  if (viz_format == "vtu")
+  {
+    farfieldGrid(grid);
+    return _vizwriter.writeGrid("visualization/" + prefix + "_farfield.vtu",
+                                grid);
+  }
 
   ffname = prefix + "_farfield.vtk";
   fname = "visualization/" + ffname;
@@ -621,6 +656,280 @@ void Aircraft::writeFarfieldScalar ( std::ofstream & f,
   }
 }
 
+/******************************************************************************/
+//
+// Adds vertex data to a VTU grid snapshot, optionally followed by data for
+// mirror vertices. For vectors, varidx is the first component, and the y
+// component is negated for mirror vertices.
+//
+/******************************************************************************/
+void vtu_vertex_data ( const std::vector<Vertex *> & verts,
+                       const std::string & varname, unsigned int varidx,
+                       unsigned int ncomp, bool mirror,
+                       std::vector<vtu_array> & arrays )
+{
+    unsigned int i, j, nverts;
+    vtu_array arr;
+
+    nverts = verts.size();
+    arr.name = varname;
+    arr.ncomp = ncomp;
+    arr.data.resize(0);
+    arr.data.reserve(nverts*ncomp*(mirror ? 2 : 1));
+    for ( i = 0; i < nverts; i++ )
+    {
+        for ( j = 0; j < ncomp; j++ )
+        {
+            arr.data.push_back(verts[i]->data(varidx+j));
+        }
+    }
+    if (mirror)
+    {
+        for ( i = 0; i < nverts; i++ )
+        {
+            for ( j = 0; j < ncomp; j++ )
+            {
+                if (j == 1)
+                    arr.data.push_back(-verts[i]->data(varidx+j));
+                else
+                    arr.data.push_back(verts[i]->data(varidx+j));
+            }
+        }
+    }
+    arrays.push_back(arr);
+}
+
+/******************************************************************************/
+//
+// Same as above, but reads from the contiguous arrays of a vertex store
+//
+/******************************************************************************/
+void vtu_vertex_data ( const VertexStore & store, const std::string & varname,
+                       unsigned int varidx, unsigned int ncomp, bool mirror,
+                       std::vector<vtu_array> & arrays )
+{
+    unsigned int i, j, nverts;
+    const double * field;
+    vtu_array arr;
+
+    nverts = store.nVerts();
+    arr.name = varname;
+    arr.ncomp = ncomp;
+    arr.data.resize(nverts*ncomp*(mirror ? 2 : 1));
+    for ( j = 0; j < ncomp; j++ )
+    {
+        field = store.field(varidx+j);
+        for ( i = 0; i < nverts; i++ )
+        {
+            arr.data[i*ncomp+j] = field[i];
+        }
+        if (mirror)
+        {
+            for ( i = 0; i < nverts; i++ )
+            {
+                if (j == 1)
+                    arr.data[(nverts+i)*ncomp+j] = -field[i];
+                else
+                    arr.data[(nverts+i)*ncomp+j] = field[i];
+            }
+        }
+    }
+    arrays.push_back(arr);
+}
+
+/******************************************************************************/
+//
+// Adds panels to a VTU grid snapshot. Vertex indices are shifted by -offset.
+// If mirror is true, panels are added in reverse order followed by mirror
+// panels with reversed vertex ordering and indices shifted by nverts, as in
+// the legacy VTK output.
+//
+/******************************************************************************/
+void vtu_panel_cells ( const std::vector<Panel *> & panels, int offset,
+                       bool mirror, unsigned int nverts, vtu_grid & grid )
+{
+    int i, j, npanels, ncellverts;
+
+    npanels = panels.size();
+    grid.connectivity.resize(0);
+    grid.offsets.resize(0);
+    grid.types.resize(0);
+    for ( i = 0; i < npanels; i++ )
+    {
+        const Panel *pan = mirror ? panels[npanels-1-i] : panels[i];
+        ncellverts = pan->nVertices();
+        for ( j = 0; j < ncellverts; j++ )
+        {
+            grid.connectivity.push_back(pan->vertex(j).idx()-offset);
+        }
+        grid.offsets.push_back(grid.connectivity.size());
+        grid.types.push_back(ncellverts == 4 ? 9 : 5);
+    }
+    if (mirror)
+    {
+        for ( i = 0; i < npanels; i++ )
+        {
+            ncellverts = panels[i]->nVertices();
+            for ( j = ncellverts-1; j >= 0; j-- )
+            {
+                grid.connectivity.push_back(panels[i]->vertex(j).idx()-offset+
+                                            nverts);
+            }
+            grid.offsets.push_back(grid.connectivity.size());
+            grid.types.push_back(ncellverts == 4 ? 9 : 5);
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Adds vertex coordinates to a VTU grid snapshot, optionally followed by
+// mirror vertices
+//
+/******************************************************************************/
+void vtu_vertex_points ( const std::vector<Vertex *> & verts, bool mirror,
+                         vtu_grid & grid )
+{
+    unsigned int i, nverts;
+
+    nverts = verts.size();
+    grid.points.resize(0);
+    grid.points.reserve(nverts*3*(mirror ? 2 : 1));
+    for ( i = 0; i < nverts; i++ )
+    {
+        grid.points.push_back(verts[i]->xViz());
+        grid.points.push_back(verts[i]->yViz());
+        grid.points.push_back(verts[i]->zViz());
+    }
+    if (mirror)
+    {
+        for ( i = 0; i < nverts; i++ )
+        {
+            grid.points.push_back(verts[i]->xViz());
+            grid.points.push_back(-verts[i]->yViz());
+            grid.points.push_back(verts[i]->zViz());
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Snapshot of surface grid and data for VTU output, including mirror panels
+//
+/******************************************************************************/
+void Aircraft::surfaceGrid ( vtu_grid & grid ) const
+{
+    int j, npanels;
+    vtu_array arr;
+
+    grid.name = "surfs";
+    vtu_vertex_points(_verts, true, grid);
+    vtu_panel_cells(_panels, 0, true, _verts.size(), grid);
+
+    grid.pointdata.resize(0);
+    vtu_vertex_data(_vertstore, "source_strength", 0, 1, true, grid.pointdata);
+    vtu_vertex_data(_vertstore, "doublet_strength", 1, 1, true, grid.pointdata);
+    vtu_vertex_data(_vertstore, "velocity", 2, 3, true, grid.pointdata);
+    vtu_vertex_data(_vertstore, "pressure", 5, 1, true, grid.pointdata);
+    vtu_vertex_data(_vertstore, "pressure_coefficient", 6, 1, true,
+                    grid.pointdata);
+    vtu_vertex_data(_vertstore, "mach", 7, 1, true, grid.pointdata);
+    vtu_vertex_data(_vertstore, "density", 8, 1, true, grid.pointdata);
+    if (viscous)
+    {
+        vtu_vertex_data(_vertstore, "skin_friction_coefficient", 9, 1, true,
+                        grid.pointdata);
+        vtu_vertex_data(_vertstore, "displacement_thickness", 10, 1, true,
+                        grid.pointdata);
+        vtu_vertex_data(_vertstore, "log_amplification_ratio", 11, 1, true,
+                        grid.pointdata);
+        vtu_vertex_data(_vertstore, "uedge", 12, 1, true, grid.pointdata);
+        vtu_vertex_data(_vertstore, "cp2d", 13, 1, true, grid.pointdata);
+    }
+
+    npanels = _panels.size();
+    arr.name = "mass_defect_derivative";
+    arr.ncomp = 1;
+    arr.data.resize(2*npanels);
+    for ( j = 0; j < npanels; j++ )
+    {
+        arr.data[j] = _panels[npanels-1-j]->massDefectDerivative();
+        arr.data[npanels+j] = _panels[j]->massDefectDerivative();
+    }
+    grid.celldata.resize(0);
+    grid.celldata.push_back(arr);
+}
+
+/******************************************************************************/
+//
+// Snapshot of wake grid and data for VTU output, including mirror panels
+//
+/******************************************************************************/
+void Aircraft::wakeGrid ( vtu_grid & grid ) const
+{
+    unsigned int i, nwakeverts;
+    vtu_array arr;
+
+    grid.name = "wake";
+    vtu_vertex_points(_wakeverts, true, grid);
+    vtu_panel_cells(_wakepanels, _verts.size(), true, _wakeverts.size(), grid);
+
+    grid.pointdata.resize(0);
+    vtu_vertex_data(_wakevertstore, "doublet_strength", 1, 1, true,
+                    grid.pointdata);
+
+    nwakeverts = _wakeverts.size();
+    arr.name = "wake_time";
+    arr.ncomp = 1;
+    arr.data.resize(2*nwakeverts);
+    for ( i = 0; i < nwakeverts; i++ )
+    {
+        arr.data[i] = _wakeverts[i]->wakeTime();
+        arr.data[nwakeverts+i] = _wakeverts[i]->wakeTime();
+    }
+    grid.pointdata.push_back(arr);
+    grid.celldata.resize(0);
+}
+
+/******************************************************************************/
+//
+// Snapshot of farfield grid and data for VTU output
+//
+/******************************************************************************/
+void Aircraft::farfieldGrid ( vtu_grid & grid )
+{
+    unsigned int i, nverts, npanels;
+    std::vector<Vertex *> verts;
+    std::vector<Panel *> panels;
+
+    nverts = _farfield.nVerts();
+    npanels = _farfield.nQuads();
+    verts.resize(nverts);
+    panels.resize(npanels);
+    for ( i = 0; i < nverts; i++ )
+    {
+        verts[i] = _farfield.vert(i);
+    }
+    for ( i = 0; i < npanels; i++ )
+    {
+        panels[i] = _farfield.quadPanel(i);
+    }
+
+    grid.name = "farfield";
+    vtu_vertex_points(verts, false, grid);
+    vtu_panel_cells(panels, _verts.size() + _wakeverts.size(), false, nverts,
+                    grid);
+
+    grid.pointdata.resize(0);
+    vtu_vertex_data(verts, "velocity", 2, 3, false, grid.pointdata);
+    vtu_vertex_data(verts, "pressure", 5, 1, false, grid.pointdata);
+    vtu_vertex_data(verts, "pressure_coefficient", 6, 1, false,
+                    grid.pointdata);
+    vtu_vertex_data(verts, "mach", 7, 1, false, grid.pointdata);
+    vtu_vertex_data(verts, "density", 8, 1, false, grid.pointdata);
+    grid.celldata.resize(0);
+}
+
 /******************************************************************************/
 //
 // Default constructor
@@ -641,10 +950,39 @@ Aircraft::Aircraft ()
     _wakepanels.resize(0);
     _allwake.resize(0);
     _sourceic.resize(0,0);
-    _doubletic.resize(0,0);
     _aic.resize(0,0);
+    _tecols.resize(0);
+    _tecolidx.resize(0);
+    _tedoubletic.resize(0,0);
+    _tewakeic.resize(0,0);
+    _diag.resize(0);
+    _lumat.resize(0,0);
+    _lu = NULL;
+    _sourceicf.resize(0,0);
+    _lumatf.resize(0,0);
+    _luf = NULL;
+    _solveiters = 0;
+    _solveres = 0.;
+    _checkerr = 0.;
+    _lustale = false;
     _mun.resize(0);
     _rhs.resize(0);
+    _wingfmsinks.resize(0);
+    _sectionsinks.resize(0);
+    _histaircraft = 0;
+    _histwings.resize(0);
+    _histsections.resize(0);
+    _outputsizes.resize(0);
+    _clcoupling.resize(0,0);
+}
+
+Aircraft::~Aircraft ()
+{
+    closeOutput();
+    if (_lu)
+        delete _lu;
+    if (_luf)
+        delete _luf;
 }
 
 /******************************************************************************/
@@ -655,11 +993,12 @@ Aircraft::Aircraft ()
 int Aircraft::readXML ( const std::string & geom_file )
 {
     XMLDocument doc;
-    unsigned int i, nwings;
+    unsigned int i, j, nwings, nfoils;
     int nchord, nspan, check;
     double lesprat, tesprat, rootsprat, tipsprat;
-    std::vector<Section> user_sections;
-    std::vector<Airfoil> foils;
+    std::vector< std::vector<Section> > user_sections;
+    std::vector< std::vector<Airfoil> > foils;
+    std::vector<Airfoil *> allfoils;
     double xle, y, zle, chord, twist, ymax;
     double camber, xcamber, thick;
     std::string source, des, path;
@@ -721,6 +1060,8 @@ int Aircraft::readXML ( const std::string & geom_file )
         nwings += 1;
     }
     _wings.resize(nwings);
+    user_sections.resize(nwings);
+    foils.resize(nwings);
     
     // Read wing data
     
@@ -760,7 +1101,6 @@ int Aircraft::readXML ( const std::string & geom_file )
         
         // Sections
         
-        user_sections.resize(0);
         ymax = 0.;
         XMLElement *secs = wingelem->FirstChildElement("Sections");
         if (! wingelem)
@@ -809,10 +1149,10 @@ int Aircraft::readXML ( const std::string & geom_file )
                     "Twist must be between greater than -90 and less than 90.");
             
             newsection.setGeometry(xle, y, zle, chord, twist, 0.0);
-            user_sections.push_back(newsection);
+            user_sections[nwings].push_back(newsection);
         }
             
-        if (user_sections.size() < 2)
+        if (user_sections[nwings].size() < 2)
         {
             conditional_stop(1, "Aircraft::readXML",
                              "Wings must have at least two sections.");
@@ -821,7 +1161,6 @@ int Aircraft::readXML ( const std::string & geom_file )
         
         // Airfoils
         
-        foils.resize(0);
         XMLElement *foilselem = wingelem->FirstChildElement("Airfoils");
         if (! foilselem)
         {
@@ -904,29 +1243,50 @@ int Aircraft::readXML ( const std::string & geom_file )
                            "Airfoil source must be 4 digit, 5 digit, or file.");
                 return 2;
             }
-            
-            // Set up airfoil spline data and smooth paneling
-            
-            newfoil.ccwOrderCoordinates();
-            newfoil.splineFit();
-            newfoil.unitTransform();
-            newfoil.setXfoilOptions(xfoil_run_opts, xfoil_geom_opts);
-            newfoil.smoothPaneling();
-            foils.push_back(newfoil);
+            foils[nwings].push_back(newfoil);
         }
-        if (foils.size() < 1)
+        if (foils[nwings].size() < 1)
         {
             conditional_stop(1, "Aircraft::readXML",
                              "Wings must have at least one airfoil.");
             return 2;
         }
-        
-        _wings[nwings].setAirfoils(foils);
-        _wings[nwings].setupSections(user_sections);
-        _wings[nwings].createPanels(next_global_vertidx, next_global_elemidx);
         nwings += 1;
     }
     
+    // Set up airfoil spline data and smooth paneling. Airfoils from all wings
+    // are independent (each has its own Xfoil instance), so they are processed
+    // together in parallel.
+    
+    for ( i = 0; i < nwings; i++ )
+    {
+        for ( j = 0; j < foils[i].size(); j++ )
+        {
+            allfoils.push_back(&foils[i][j]);
+        }
+    }
+    nfoils = allfoils.size();
+#pragma omp parallel for private(i) schedule(dynamic)
+    for ( i = 0; i < nfoils; i++ )
+    {
+        allfoils[i]->ccwOrderCoordinates();
+        allfoils[i]->splineFit();
+        allfoils[i]->unitTransform();
+        allfoils[i]->setXfoilOptions(xfoil_run_opts, xfoil_geom_opts);
+        allfoils[i]->smoothPaneling();
+    }
+    
+    // Discretize wings. Sections within each wing are set up in parallel, while
+    // panels are created in wing order so that global vertex and element
+    // indices do not depend on the number of threads.
+    
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wings[i].setAirfoils(foils[i]);
+        _wings[i].setupSections(user_sections[i]);
+        _wings[i].createPanels(next_global_vertidx, next_global_elemidx);
+    }
+    
     // Determine furthest aft root TE points for Trefftz plane calculation
 
     _xte = -1.E+12;
@@ -966,11 +1326,47 @@ int Aircraft::readXML ( const std::string & geom_file )
     // Farfield box
 
     if (enable_farfield)
+    {
+        _farfield.setRefinement(farfield_maxlevel, farfield_reftol);
         _farfield.initialize(farfield_nx, farfield_ny, farfield_nz,
                              farfield_cenx, farfield_ceny, farfield_cenz,
                              farfield_lenx, farfield_leny, farfield_lenz, minf,
                              next_global_vertidx, next_global_elemidx);
+    }
+
+    // Off-body probes. Default vortex core radius is 1% of reference length.
+
+    if (probe_defs.size() > 0)
+    {
+        if (probe_rcore < 0.)
+            probe_rcore = 0.01*_lref;
+        _probes.initialize(probe_defs, minf, probe_rcore);
+    }
+
+    // Streamlines and vortex cores. Defaults are based on reference length,
+    // and streamlines are traced for the length of the wake by default.
+
+    if (enable_streamlines)
+    {
+        if (streamline_tol < 0.)
+            streamline_tol = 1e-4*_lref;
+        if (streamline_step < 0.)
+            streamline_step = 0.05*_lref;
+        if (streamline_maxlength < 0.)
+            streamline_maxlength = rollupdist;
+        if (streamline_rcore < 0.)
+            streamline_rcore = 0.01*_lref;
+        _streamlines.initialize(streamline_seeds, streamline_cutplanes,
+                                streamline_rcore, streamline_tol,
+                                streamline_step, streamline_maxlength,
+                                streamline_maxsteps, streamline_corethresh,
+                                streamline_tracecores);
+    }
     
+    // Visualization output options
+
+    _vizwriter.setOptions(viz_compress, viz_float32, viz_background);
+
     // Set pointers to vertices, panels, and wake elements
     
     setGeometryPointers();
@@ -1019,7 +1415,7 @@ void Aircraft::setSourceStrengths ( bool init )
 /******************************************************************************/
 void Aircraft::setDoubletStrengths ()
 {
-    unsigned int i, j, k, npanels, nwings, nstrips, nwakepans, nwakeverts;
+    unsigned int i, j, k, npanels, nwings, nstrips, nwakepans;
     double mu;
     WakeStrip *strip;
 
@@ -1060,27 +1456,54 @@ void Aircraft::setDoubletStrengths ()
         }
     }
 
-    nwakeverts = _wakeverts.size();
-#pragma omp parallel for private(i)
-    for ( i = 0; i < nwakeverts; i++ )
+#pragma omp parallel
+    _wakevertstore.averageFromPanels();
+}
+
+/******************************************************************************/
+//
+// Resizes a matrix and zeros it with the same static distribution of
+// rows over threads as the assembly loops. Newly allocated pages are placed on
+// the NUMA node of the first thread to write them, so each thread's rows end
+// up in local memory as long as threads are pinned (OMP_PROC_BIND).
+//
+/******************************************************************************/
+template <typename MatrixType>
+void numa_resize ( MatrixType & mat, unsigned int n, unsigned int m )
+{
+    unsigned int i;
+
+    if ( (mat.rows() == n) && (mat.cols() == m) )
+        return;
+
+    mat.resize(n,m);
+#pragma omp parallel for private(i) schedule(static)
+    for ( i = 0; i < n; i++ )
     {
-        _wakeverts[i]->averageFromPanels();
+        mat.row(i).setZero();
     }
 }
 
 /******************************************************************************/
 //
-// Constructs AIC matrix and RHS vector
+// Constructs AIC matrix and RHS vector. Only trailing edge panel columns of
+// the AIC matrix get wake contributions, so their surface doublet
+// coefficients are kept separately to reset those columns when the wake rolls
+// up, rather than keeping a copy of all surface doublet coefficients. With
+// MatrixFree, no dense matrices are stored: source coefficients are computed
+// on the fly for the RHS, and only the trailing edge columns and the diagonal
+// are stored for aicProduct.
 //
 /******************************************************************************/
 void Aircraft::constructSystem ( bool init )
 {
-    unsigned int i, j, k, l, m, nwings, npanels, nstrips, nwakepans, nvwtris;
-    int toptepan, bottepan;
+    unsigned int i, j, k, l, m, nwings, npanels, nstrips, nwakepans, nvwtris,
+                 nte;
+    int toptepan, bottepan, tecol;
     Eigen::Vector3d col;
     WakeStrip * strip;
     Panel * vwtri;
-    double stripic;
+    double stripic, sic, dic;
     bool onpanel;
 
     npanels = _panels.size();
@@ -1094,56 +1517,168 @@ void Aircraft::constructSystem ( bool init )
 
     if (init)
     {
-        _sourceic.resize(npanels,npanels);
-        _doubletic.resize(npanels,npanels);
-        _aic.resize(npanels,npanels);
+        ScopedTimer timer("constructSystem/influence");
+
+        // Trailing edge panel columns
+
+        _tecolidx.assign(npanels, -1);
+        _tecols.resize(0);
+        for ( k = 0; k < nwings; k++ )
+        {
+            nstrips = _wings[k].nWStrips();
+            for ( l = 0; l < nstrips; l++ )
+            {
+                strip = _wings[k].wStrip(l);
+                toptepan = strip->topTEPan()->idx();
+                bottepan = strip->botTEPan()->idx();
+                if (_tecolidx[toptepan] < 0)
+                {
+                    _tecolidx[toptepan] = _tecols.size();
+                    _tecols.push_back(toptepan);
+                }
+                if (_tecolidx[bottepan] < 0)
+                {
+                    _tecolidx[bottepan] = _tecols.size();
+                    _tecols.push_back(bottepan);
+                }
+            }
+        }
+        nte = _tecols.size();
+        numa_resize(_tedoubletic, npanels, nte);
+
+        // Source coefficients are stored in single precision with
+        // MixedPrecision (and also in double precision with
+        // MixedPrecisionCheck, for the reference solution) and not at all with
+        // MatrixFree
+
+        if (matrix_free)
+        {
+            numa_resize(_tewakeic, npanels, nte);
+            _diag.resize(npanels);
+        }
+        else
+        {
+            if (mixed_precision)
+                numa_resize(_sourceicf, npanels, npanels);
+            if ( (! mixed_precision) || mixed_precision_check )
+                numa_resize(_sourceic, npanels, npanels);
+            numa_resize(_aic, npanels, npanels);
+        }
+        if (mixed_precision && mixed_precision_check)
+            _rhscheck.resize(npanels);
         _rhs.resize(npanels);
 
-#pragma omp parallel for private(i,col,j,onpanel)
+#pragma omp parallel for private(i,col,j,onpanel,sic,dic,tecol) \
+                        schedule(static)
         for ( i = 0; i < npanels; i++ )
         {
             // Collocation point (point of BC application)
-            
+
             col = _panels[i]->collocationPoint();
-            
+
             // Influence coefficients
-            
+
             for ( j = 0; j < npanels; j++ )
             {
                 if (i == j)
                     onpanel = true;
                 else
                     onpanel = false;
-                _sourceic(i,j) = _panels[j]->sourcePhiCoeff(col(0), col(1),
-                                               col(2), onpanel, "bottom", true);
-                _doubletic(i,j) = _panels[j]->doubletPhiCoeff(col(0), col(1),
-                                               col(2), onpanel, "bottom", true);
+                dic = _panels[j]->doubletPhiCoeff(col(0), col(1), col(2),
+                                                  onpanel, "bottom", true);
+                tecol = _tecolidx[j];
+                if (tecol >= 0)
+                    _tedoubletic(i,tecol) = dic;
+                if (matrix_free)
+                {
+                    if (onpanel)
+                        _diag(i) = dic;
+                    continue;
+                }
+
+                sic = _panels[j]->sourcePhiCoeff(col(0), col(1), col(2),
+                                                 onpanel, "bottom", true);
+                if (mixed_precision)
+                    _sourceicf(i,j) = float(sic);
+                if ( (! mixed_precision) || mixed_precision_check )
+                    _sourceic(i,j) = sic;
+                _aic(i,j) = dic;
             }
         }
     }
 
     // Compute AIC and RHS
 
+    ScopedTimer timer("constructSystem/aic_rhs");
+    nte = _tecols.size();
 #pragma omp parallel for private(i,col,j,k,nstrips,l,strip,nwakepans,stripic,\
-                                 m,toptepan,bottepan,nvwtris,vwtri)
+                                 m,toptepan,bottepan,nvwtris,vwtri,onpanel,\
+                                 tecol) schedule(static)
     for ( i = 0; i < npanels; i++ )
     {
         // Collocation point (point of BC application)
-        
+
         col = _panels[i]->collocationPoint();
-        
-        // Surface panel contribution to AIC and RHS
-        
+
+        // Surface panel contribution to RHS
+
         _rhs(i) = 0.;
-        for ( j = 0; j < npanels; j++ )
+        if (matrix_free)
         {
-            _rhs(i) -= _panels[j]->sourceStrength()*_sourceic(i,j);
-            if (init || rollup_wake)
-                _aic(i,j) = _doubletic(i,j);
+            for ( j = 0; j < npanels; j++ )
+            {
+                if (i == j)
+                    onpanel = true;
+                else
+                    onpanel = false;
+                _rhs(i) -= _panels[j]->sourceStrength()
+                         * _panels[j]->sourcePhiCoeff(col(0), col(1), col(2),
+                                                      onpanel, "bottom", true);
+            }
         }
-        
+        else if (mixed_precision)
+        {
+            for ( j = 0; j < npanels; j++ )
+            {
+                _rhs(i) -= _panels[j]->sourceStrength()*_sourceicf(i,j);
+            }
+
+            // Difference of the double precision RHS, for the reference
+            // solution with MixedPrecisionCheck
+
+            if (mixed_precision_check)
+            {
+                _rhscheck(i) = 0.;
+                for ( j = 0; j < npanels; j++ )
+                {
+                    _rhscheck(i) -= _panels[j]->sourceStrength()
+                                  * (_sourceic(i,j) - double(_sourceicf(i,j)));
+                }
+            }
+        }
+        else
+        {
+            for ( j = 0; j < npanels; j++ )
+            {
+                _rhs(i) -= _panels[j]->sourceStrength()*_sourceic(i,j);
+            }
+        }
+
+        // Reset trailing edge columns to surface doublet coefficients
+
+        if (init || rollup_wake)
+        {
+            for ( j = 0; j < nte; j++ )
+            {
+                if (matrix_free)
+                    _tewakeic(i,j) = 0.;
+                else
+                    _aic(i,_tecols[j]) = _tedoubletic(i,j);
+            }
+        }
+
         // Wake contribution to AIC and RHS
-        
+
         for ( k = 0; k < nwings; k++ )
         {
             if (init || rollup_wake)
@@ -1153,10 +1688,10 @@ void Aircraft::constructSystem ( bool init )
                 {
                     strip = _wings[k].wStrip(l);
                     nwakepans = strip->nPanels();
-                    
+
                     // All wake panels in a strip have strength equal to
                     // mu_topte - mu_botte
-                    
+
                     stripic = 0.;
                     for ( m = 0; m < nwakepans; m++ )
                     {
@@ -1165,14 +1700,22 @@ void Aircraft::constructSystem ( bool init )
                     }
                     toptepan = strip->topTEPan()->idx();
                     bottepan = strip->botTEPan()->idx();
-                    _aic(i,toptepan) += stripic;
-                    _aic(i,bottepan) -= stripic;
+                    if (matrix_free)
+                    {
+                        _tewakeic(i,_tecolidx[toptepan]) += stripic;
+                        _tewakeic(i,_tecolidx[bottepan]) -= stripic;
+                    }
+                    else
+                    {
+                        _aic(i,toptepan) += stripic;
+                        _aic(i,bottepan) -= stripic;
+                    }
                 }
             }
 
             // Viscous wake influence
 
-            if ( (viscous) && (! init) )
+            if (viscous)
             {
                 nvwtris = _wings[k].viscousWake().nTris();
                 for ( l = 0; l < nvwtris; l++ )
@@ -1185,543 +1728,2576 @@ void Aircraft::constructSystem ( bool init )
             }
         }
 
+        // Diagonal including wake terms, for preconditioning with MatrixFree
+
+        tecol = _tecolidx[i];
+        if ( matrix_free && (init || rollup_wake) && (tecol >= 0) )
+            _diag(i) = _tedoubletic(i,tecol) + _tewakeic(i,tecol);
+
         // Normalize RHS by uinf to keep magnitudes small in the linear system.
         // The resulting doublet strengths are later scaled back up.
-        
+
         _rhs(i) /= uinf;
+        if (mixed_precision && mixed_precision_check)
+            _rhscheck(i) = _rhs(i) + _rhscheck(i)/uinf;
     }
 }
 
 /******************************************************************************/
 //
-// Factorizes the AIC matrix and solves the system
+// AIC matrix-vector product for MatrixFree. Surface doublet coefficients are
+// computed on the fly, except for trailing edge columns, which are stored
+// with their wake terms. Rows are scaled by the inverse of the diagonal
+// (Jacobi preconditioning) for the GMRES solve.
 //
 /******************************************************************************/
-void Aircraft::factorize () { _lu.compute(_aic); }
-void Aircraft::solveSystem () { _mun = _lu.solve(_rhs); }
+void Aircraft::aicProduct ( const std::vector<double> & x,
+                            std::vector<double> & y ) const
+{
+    unsigned int i, j, npanels;
+    int tecol;
+    Eigen::Vector3d col;
+    double sum;
 
-/******************************************************************************/
-//
-// Gives size of system of equations (= number of panels)
-//
-/******************************************************************************/
-unsigned int Aircraft::systemSize () const { return _panels.size(); }
+    npanels = _panels.size();
 
-/******************************************************************************/
-//
-// Computes surface velocities and pressures
-//
-/******************************************************************************/
-void Aircraft::computeSurfaceQuantities ()
-{
-    unsigned int i, nwings;
-    Eigen::Vector3d wi;
-    
-    nwings = _wings.size();
-    for ( i = 0; i < nwings; i++ )
+#pragma omp parallel for private(i,j,col,sum,tecol) schedule(static)
+    for ( i = 0; i < npanels; i++ )
     {
-        _wings[i].computeSurfaceQuantities();
+        col = _panels[i]->collocationPoint();
+        sum = 0.;
+        for ( j = 0; j < npanels; j++ )
+        {
+            tecol = _tecolidx[j];
+            if (tecol >= 0)
+                sum += (_tedoubletic(i,tecol) + _tewakeic(i,tecol))*x[j];
+            else
+                sum += _panels[j]->doubletPhiCoeff(col(0), col(1), col(2),
+                                                   i == j, "bottom", true)*x[j];
+        }
+        y[i] = sum / _diag(i);
     }
 }
 
-/******************************************************************************/
-//
-// BL calculations with xfoil
-//
-/******************************************************************************/
-void Aircraft::computeBL ()
+void matrix_free_product ( const std::vector<double> & x,
+                           std::vector<double> & y, void *data )
 {
-  unsigned int i, nwings;
-
-  nwings = _wings.size();
-  for ( i = 0; i < nwings; i++ )
-  {
-    _wings[i].computeBL();
-  }
+    static_cast<Aircraft *>(data)->aicProduct(x, y);
 }
 
 /******************************************************************************/
 //
-// Sets up viscous wake for each wing
+// Factorizes the AIC matrix. The factorization is done in place in a copy of
+// the AIC matrix, which is copied row by row with the same thread distribution
+// as system assembly so that the LU factors stay on the same NUMA nodes. With
+// MixedPrecision, the copy and factorization are single precision, and the
+// double precision factorization is only computed for MixedPrecisionCheck.
+// Nothing is done with MatrixFree.
 //
 /******************************************************************************/
-void Aircraft::setupViscousWake ()
+void Aircraft::factorize ()
 {
-    unsigned int i, nwings;
-    int next_global_vertidx, next_global_elemidx;
+    unsigned int i, npanels;
 
-    next_global_vertidx = _verts.size() + _wakeverts.size();
-    next_global_elemidx = _panels.size() + _wakepanels.size();
-    nwings = _wings.size();
-    for ( i = 0; i < nwings; i++ )
-    {
-        _wings[i].setupViscousWake(next_global_vertidx, next_global_elemidx);
-    }
-}
+    if (matrix_free)
+        return;
 
-/******************************************************************************/
-//
-// Computes or access forces and moments
-//
-/******************************************************************************/
-void Aircraft::computeForceMoment ()
-{
-    unsigned int i, nwings;
-    double beta, xteinc, zteinc, xtrefftz, ztrefftz;
+    npanels = _aic.rows();
 
-    // P-G transformation to get aft TE point in incompressible coordinates
+    if (mixed_precision)
+    {
+        if (_lumatf.rows() != npanels)
+        {
+            if (_luf)
+            {
+                delete _luf;
+                _luf = NULL;
+            }
+            numa_resize(_lumatf, npanels, npanels);
+        }
 
-    beta = std::sqrt(1. - std::pow(minf,2.));
-    xteinc = _xte/beta;
-    zteinc = _zte;
+#pragma omp parallel for private(i) schedule(static)
+        for ( i = 0; i < npanels; i++ )
+        {
+            _lumatf.row(i) = _aic.row(i).cast<float>();
+        }
 
-    // Trefftz plane 1000 span lengths downstream from aftmost TE
+        if (_luf)
+            _luf->compute(_lumatf);
+        else
+            _luf = new Eigen::PartialPivLU<Eigen::Ref<RowMatrixXf> >(_lumatf);
+        _lustale = false;
 
-    xtrefftz = xteinc + 1000.*_maxspan*uinfvec(0)/uinf;
-    ztrefftz = zteinc + 1000.*_maxspan*uinfvec(2)/uinf;
-    
-    nwings = _wings.size();
-    for ( i = 0; i < nwings; i++ )
-    {
-        _wings[i].computeForceMoment(_momcen, xtrefftz, ztrefftz, _allwake);
+        if (! mixed_precision_check)
+            return;
     }
-}
 
-double Aircraft::lift () const
-{
-    unsigned int i, nwings;
-    double lift;
+    if (_lumat.rows() != npanels)
+    {
+        if (_lu)
+        {
+            delete _lu;
+            _lu = NULL;
+        }
+        numa_resize(_lumat, npanels, npanels);
+    }
 
-    nwings = _wings.size();
-    lift = 0.;
-    for ( i = 0; i < nwings; i++ )
+#pragma omp parallel for private(i) schedule(static)
+    for ( i = 0; i < npanels; i++ )
     {
-        lift += _wings[i].lift();
+        _lumat.row(i) = _aic.row(i);
     }
 
-    return lift;
+    if (_lu)
+        _lu->compute(_lumat);
+    else
+        _lu = new Eigen::PartialPivLU<Eigen::Ref<RowMatrixXd> >(_lumat);
+    _lustale = false;
 }
-double Aircraft::trefftzLift () const
+
+/******************************************************************************/
+//
+// Solves the system. With MixedPrecision, the single precision solution is
+// improved by iterative refinement against the double precision AIC matrix:
+// the residual is computed in double precision, and the correction is solved
+// with the single precision LU factors. Refinement stops when the relative
+// residual reaches the tolerance or stops decreasing. The RHS comes from the
+// single precision source coefficients, so their rounding error remains in
+// the refined solution. With MatrixFree, the
+// system is solved with GMRES, starting from the previous solution.
+//
+/******************************************************************************/
+void Aircraft::solveSystem ()
 {
-    unsigned int i, nwings;
-    double lifttr;
+    unsigned int i, npanels;
+    Eigen::VectorXd res, mund;
+    std::vector<double> x, b;
+    gmres_options_type opts;
+    double bnorm, prevres;
+    const unsigned int maxiters = 20;
+    const double tol = 1.E-12;
 
-    nwings = _wings.size();
-    lifttr = 0.;
-    for ( i = 0; i < nwings; i++ )
+    npanels = _panels.size();
+    if (matrix_free)
     {
-        lifttr += _wings[i].trefftzLift();
+        x.assign(npanels, 0.);
+        b.resize(npanels);
+        for ( i = 0; i < npanels; i++ )
+        {
+            if (_mun.size() == npanels)
+                x[i] = _mun(i);
+            b[i] = _rhs(i) / _diag(i);
+        }
+        opts.tol = matrix_free_tol;
+        opts.maxit = 500;
+        opts.restart = 50;
+        gmres(x, b, matrix_free_product, this, opts, _solveiters, _solveres);
+        _mun = Eigen::Map<Eigen::VectorXd>(x.data(), npanels);
+        if (_solveres > matrix_free_tol)
+            print_warning("Aircraft::solveSystem",
+                          "GMRES did not converge. Relative residual: "
+                          + double2string(_solveres) + ".");
+        return;
     }
 
-    return lifttr;
-}
-double Aircraft::skinFrictionLift () const
-{
-    unsigned int i, nwings;
-    double liftf;
-
-    nwings = _wings.size();
-    liftf = 0.;
-    for ( i = 0; i < nwings; i++ )
+    if (! mixed_precision)
     {
-        liftf += _wings[i].skinFrictionLift();
+        _mun = _lu->solve(_rhs);
+        return;
     }
 
-    return liftf;
-}
-double Aircraft::integratedLift () const
-{
-    unsigned int i, nwings;
-    double liftp;
+    res.resize(npanels);
+    bnorm = _rhs.norm();
+    if (bnorm == 0.)
+        bnorm = 1.;
 
-    nwings = _wings.size();
-    liftp = 0.;
-    for ( i = 0; i < nwings; i++ )
+    _mun = _luf->solve(_rhs.cast<float>()).cast<double>();
+    _solveiters = 0;
+    prevres = 0.;
+    while (true)
     {
-        liftp += _wings[i].integratedLift();
+#pragma omp parallel for private(i) schedule(static)
+        for ( i = 0; i < npanels; i++ )
+        {
+            res(i) = _rhs(i) - _aic.row(i).dot(_mun);
+        }
+        _solveres = res.norm() / bnorm;
+        if ( (_solveres <= tol) || (_solveiters >= maxiters) ||
+             ( (_solveiters > 0) && (_solveres > 0.5*prevres) ) )
+            break;
+
+        _mun += _luf->solve(res.cast<float>()).cast<double>();
+        prevres = _solveres;
+        _solveiters++;
     }
 
-    return liftp;
-}
+    if (_solveres > 1.E-08)
+        print_warning("Aircraft::solveSystem",
+                      "Iterative refinement did not converge. Relative "
+                      "residual: " + double2string(_solveres) + ".");
 
-double Aircraft::drag () const
-{
-    unsigned int i, nwings;
-    double drag;
+    // Compare with the solution with all influence coefficients in double
+    // precision, so that the difference includes the precision lost in
+    // storing source coefficients in single precision
 
-    nwings = _wings.size();
-    drag = 0.;
-    for ( i = 0; i < nwings; i++ )
+    if (mixed_precision_check)
     {
-        drag += _wings[i].drag();
+        mund = _lu->solve(_rhscheck);
+        _checkerr = (_mun - mund).norm();
+        if (mund.norm() > 0.)
+            _checkerr /= mund.norm();
     }
-
-    return drag;
 }
-double Aircraft::inducedDrag () const
+
+/******************************************************************************/
+//
+// AIC matrix-vector product preconditioned with the LU factors, used by GMRES
+// in updateSections. The factors are of the AIC matrix before the update, so
+// the preconditioned matrix differs from identity by a low-rank term.
+//
+/******************************************************************************/
+void Aircraft::preconditionedProduct ( const std::vector<double> & x,
+                                       std::vector<double> & y ) const
 {
-    unsigned int i, nwings;
-    double dragtr;
+    unsigned int i, npanels;
+    Eigen::VectorXd ax;
+    Eigen::Map<const Eigen::VectorXd> xvec(x.data(), x.size());
 
-    nwings = _wings.size();
-    dragtr = 0.;
-    for ( i = 0; i < nwings; i++ )
+    npanels = _panels.size();
+    ax.resize(npanels);
+
+#pragma omp parallel for private(i) schedule(static)
+    for ( i = 0; i < npanels; i++ )
     {
-        dragtr += _wings[i].inducedDrag();
+        ax(i) = _aic.row(i).dot(xvec);
     }
 
-    return dragtr;
+    if (mixed_precision)
+        ax = _luf->solve(ax.cast<float>()).cast<double>();
+    else
+        ax = _lu->solve(ax);
+    Eigen::Map<Eigen::VectorXd>(y.data(), npanels) = ax;
 }
-double Aircraft::parasiticDrag () const
-{
-    unsigned int i, nwings;
-    double dragv;
-
-    nwings = _wings.size();
-    dragv = 0.;
-    for ( i = 0; i < nwings; i++ )
-    {
-        dragv += _wings[i].parasiticDrag();
-    }
 
-    return dragv;
+void preconditioned_product ( const std::vector<double> & x,
+                              std::vector<double> & y, void *data )
+{
+    static_cast<Aircraft *>(data)->preconditionedProduct(x, y);
 }
-double Aircraft::skinFrictionDrag () const
+
+/******************************************************************************/
+//
+// Changes leading edge position, chord, and twist of some sections in place
+// and updates the solution. Rows of the AIC and source influence coefficient
+// matrices are recomputed for panels next to the changed sections, and
+// columns for those panels and for trailing edge columns of wake strips
+// behind them. The RHS is recomputed from the updated source coefficients.
+// The system is then solved with GMRES from the previous solution,
+// preconditioned with the LU factors of the AIC matrix before the update; if
+// that does not converge, the matrix is factorized again. With MatrixFree,
+// the stored trailing edge columns and diagonal are updated and the system is
+// solved as usual. Returns 1 for viscous cases, which are not supported, and
+// 2 if a wing or section index is out of range.
+//
+/******************************************************************************/
+int Aircraft::updateSections ( const std::vector<section_update> & updates )
 {
-    unsigned int i, nwings;
-    double dragf;
+    unsigned int i, j, k, l, m, npanels, nwings, nstrips, nupdates, nte,
+                 nmoved, nwakepans;
+    int tecol, toptecol, bottecol;
+    std::map<const Panel *, unsigned int> panidx;
+    std::vector<Panel *> movedpans;
+    std::vector<bool> moved, teaffected;
+    std::vector<unsigned int> movedidx;
+    std::vector<WakeStrip *> allstrips, adjstrips;
+    std::vector<edge_extrapolation> extraps;
+    const std::vector<WakeStrip *> * rowstrips;
+    std::vector<double> x, b;
+    gmres_options_type opts;
+    Eigen::VectorXd bvec;
+    Eigen::Vector3d col;
+    WakeStrip * strip;
+    double dic, sic, stripic;
+    bool onpanel;
 
-    nwings = _wings.size();
-    dragf = 0.;
-    for ( i = 0; i < nwings; i++ )
+    if (viscous)
     {
-        dragf += _wings[i].skinFrictionDrag();
+        print_warning("Aircraft::updateSections",
+                      "Section updates are only available for inviscid cases.");
+        return 1;
     }
 
-    return dragf;
-}
-double Aircraft::integratedDrag () const
-{
-    unsigned int i, nwings;
-    double dragp;
-
     nwings = _wings.size();
-    dragp = 0.;
-    for ( i = 0; i < nwings; i++ )
+    nupdates = updates.size();
+    for ( k = 0; k < nupdates; k++ )
     {
-        dragp += _wings[i].integratedDrag();
+        if ( (updates[k].wing >= nwings) ||
+             (updates[k].section >= _wings[updates[k].wing].nSections()) )
+        {
+            print_warning("Aircraft::updateSections",
+                          "Wing or section index out of range.");
+            return 2;
+        }
     }
 
-    return dragp;
-}
+    // Move sections and find moved panels
 
-double Aircraft::pitchingMoment () const
-{
-    unsigned int i, nwings;
-    double moment;
+    for ( k = 0; k < nupdates; k++ )
+    {
+        _wings[updates[k].wing].setSectionGeometry(updates[k].section,
+                                 updates[k].xle, updates[k].zle,
+                                 updates[k].chord, updates[k].twist, movedpans);
+    }
 
-    nwings = _wings.size();
-    moment = 0.;
-    for ( i = 0; i < nwings; i++ )
+    npanels = _panels.size();
+    for ( i = 0; i < npanels; i++ )
     {
-        moment += _wings[i].pitchingMoment();
+        panidx[_panels[i]] = i;
+    }
+    moved.assign(npanels, false);
+    nmoved = movedpans.size();
+    for ( k = 0; k < nmoved; k++ )
+    {
+        moved[panidx[movedpans[k]]] = true;
+    }
+    for ( j = 0; j < npanels; j++ )
+    {
+        if (moved[j])
+            movedidx.push_back(j);
     }
+    nmoved = movedidx.size();
 
-    return moment;
-}
-double Aircraft::pressurePitchingMoment () const
-{
-    unsigned int i, nwings;
-    double momentp;
+    // Trailing edge columns that change: those of moved panels and of wake
+    // strips behind them. All wake strips at these columns contribute to them.
 
-    nwings = _wings.size();
-    momentp = 0.;
-    for ( i = 0; i < nwings; i++ )
+    nte = _tecols.size();
+    teaffected.assign(nte, false);
+    for ( k = 0; k < nwings; k++ )
     {
-        momentp += _wings[i].pressurePitchingMoment();
+        nstrips = _wings[k].nWStrips();
+        for ( l = 0; l < nstrips; l++ )
+        {
+            strip = _wings[k].wStrip(l);
+            allstrips.push_back(strip);
+            if (moved[strip->topTEPan()->idx()] ||
+                moved[strip->botTEPan()->idx()])
+            {
+                teaffected[_tecolidx[strip->topTEPan()->idx()]] = true;
+                teaffected[_tecolidx[strip->botTEPan()->idx()]] = true;
+            }
+        }
+    }
+    for ( j = 0; j < nte; j++ )
+    {
+        if (moved[_tecols[j]])
+            teaffected[j] = true;
+    }
+    nstrips = allstrips.size();
+    for ( l = 0; l < nstrips; l++ )
+    {
+        if (teaffected[_tecolidx[allstrips[l]->topTEPan()->idx()]] ||
+            teaffected[_tecolidx[allstrips[l]->botTEPan()->idx()]])
+            adjstrips.push_back(allstrips[l]);
     }
 
-    return momentp;
-}
-double Aircraft::skinFrictionPitchingMoment () const
-{
-    unsigned int i, nwings;
-    double momentf;
+    // Source strengths of moved panels
 
-    nwings = _wings.size();
-    momentf = 0.;
-    for ( i = 0; i < nwings; i++ )
+    for ( k = 0; k < nmoved; k++ )
     {
-        momentf += _wings[i].skinFrictionPitchingMoment();
+        _panels[movedidx[k]]->computeSourceStrength(uinfvec, false);
     }
 
-    return momentf;
-}
+    // Update influence coefficients and RHS
 
-double Aircraft::liftCoefficient () const
-{
-    double qinf;
+    {
+        ScopedTimer timer("updateSections/influence");
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return lift() / (qinf*_sref);
-}
-double Aircraft::trefftzLiftCoefficient () const
-{
-    double qinf;
+#pragma omp parallel for private(i,col,k,j,onpanel,dic,sic,tecol,rowstrips,\
+                                 nstrips,l,strip,nwakepans,stripic,m,\
+                                 toptecol,bottecol) schedule(dynamic)
+        for ( i = 0; i < npanels; i++ )
+        {
+            col = _panels[i]->collocationPoint();
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return trefftzLift() / (qinf*_sref);
-}
-double Aircraft::skinFrictionLiftCoefficient () const
-{
-    double qinf;
+            // Surface doublet and source coefficients. The whole row changes
+            // for moved panels.
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return skinFrictionLift() / (qinf*_sref);
-}
-double Aircraft::integratedLiftCoefficient () const
-{
-    double qinf;
+            for ( k = 0; k < (moved[i] ? npanels : nmoved); k++ )
+            {
+                j = moved[i] ? k : movedidx[k];
+                onpanel = (i == j);
+                dic = _panels[j]->doubletPhiCoeff(col(0), col(1), col(2),
+                                                  onpanel, "bottom", true);
+                tecol = _tecolidx[j];
+                if (tecol >= 0)
+                    _tedoubletic(i,tecol) = dic;
+                if (matrix_free)
+                {
+                    if (onpanel)
+                        _diag(i) = dic;
+                    continue;
+                }
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return integratedLift() / (qinf*_sref);
-}
+                sic = _panels[j]->sourcePhiCoeff(col(0), col(1), col(2),
+                                                 onpanel, "bottom", true);
+                if (mixed_precision)
+                    _sourceicf(i,j) = float(sic);
+                if ( (! mixed_precision) || mixed_precision_check )
+                    _sourceic(i,j) = sic;
+                _aic(i,j) = dic;
+            }
 
-double Aircraft::dragCoefficient () const
-{
-    double qinf;
+            // Reset changed trailing edge columns and add wake strips
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return drag() / (qinf*_sref);
-}
-double Aircraft::inducedDragCoefficient () const
-{
-    double qinf;
+            for ( k = 0; k < nte; k++ )
+            {
+                if (! (moved[i] || teaffected[k]))
+                    continue;
+                if (matrix_free)
+                    _tewakeic(i,k) = 0.;
+                else
+                    _aic(i,_tecols[k]) = _tedoubletic(i,k);
+            }
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return inducedDrag() / (qinf*_sref);
-}
-double Aircraft::parasiticDragCoefficient () const
-{
-    double qinf;
+            rowstrips = moved[i] ? &allstrips : &adjstrips;
+            nstrips = rowstrips->size();
+            for ( l = 0; l < nstrips; l++ )
+            {
+                strip = (*rowstrips)[l];
+                nwakepans = strip->nPanels();
+                stripic = 0.;
+                for ( m = 0; m < nwakepans; m++ )
+                {
+                    stripic += strip->panel(m)->doubletPhiCoeff(col(0),
+                                         col(1), col(2), false, "bottom", true);
+                }
+                toptecol = _tecolidx[strip->topTEPan()->idx()];
+                bottecol = _tecolidx[strip->botTEPan()->idx()];
+                if (moved[i] || teaffected[toptecol])
+                {
+                    if (matrix_free)
+                        _tewakeic(i,toptecol) += stripic;
+                    else
+                        _aic(i,_tecols[toptecol]) += stripic;
+                }
+                if (moved[i] || teaffected[bottecol])
+                {
+                    if (matrix_free)
+                        _tewakeic(i,bottecol) -= stripic;
+                    else
+                        _aic(i,_tecols[bottecol]) -= stripic;
+                }
+            }
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return parasiticDrag() / (qinf*_sref);
-}
-double Aircraft::skinFrictionDragCoefficient () const
-{
-    double qinf;
+            tecol = _tecolidx[i];
+            if ( matrix_free && (tecol >= 0) )
+                _diag(i) = _tedoubletic(i,tecol) + _tewakeic(i,tecol);
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return skinFrictionDrag() / (qinf*_sref);
-}
-double Aircraft::integratedDragCoefficient () const
-{
-    double qinf;
+            // RHS
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return integratedDrag() / (qinf*_sref);
-}
+            _rhs(i) = 0.;
+            for ( j = 0; j < npanels; j++ )
+            {
+                if (matrix_free)
+                    sic = _panels[j]->sourcePhiCoeff(col(0), col(1), col(2),
+                                                     i == j, "bottom", true);
+                else if (mixed_precision)
+                    sic = _sourceicf(i,j);
+                else
+                    sic = _sourceic(i,j);
+                _rhs(i) -= _panels[j]->sourceStrength()*sic;
+            }
+            _rhs(i) /= uinf;
+            if (mixed_precision && mixed_precision_check)
+            {
+                _rhscheck(i) = 0.;
+                for ( j = 0; j < npanels; j++ )
+                {
+                    _rhscheck(i) -= _panels[j]->sourceStrength()
+                                  * _sourceic(i,j);
+                }
+                _rhscheck(i) /= uinf;
+            }
+        }
+    }
 
-double Aircraft::pitchingMomentCoefficient () const
-{
-    double qinf;
+    // Surface operators and the spanwise lift coupling depend on the geometry
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return pitchingMoment() / (qinf*_sref*_lref);
-}
-double Aircraft::pressurePitchingMomentCoefficient () const
-{
-    double qinf;
+    _clcoupling.resize(0,0);
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return pressurePitchingMoment() / (qinf*_sref*_lref);
+    _surfgrad.updateStencils(moved);
+    _vertstore.computeWeights();
+    _wakevertstore.computeWeights();
+    for ( k = 0; k < nwings; k++ )
+    {
+        _wings[k].edgeExtrapolations(extraps);
+    }
+    _vertstore.setEdgeExtrapolations(extraps);
+
+    // Solve
+
+    if (matrix_free)
+        solveSystem();
+    else
+    {
+        ScopedTimer timer("updateSections/solve");
+
+        x.resize(npanels);
+        b.resize(npanels);
+        if (mixed_precision)
+            bvec = _luf->solve(_rhs.cast<float>()).cast<double>();
+        else
+            bvec = _lu->solve(_rhs);
+        for ( i = 0; i < npanels; i++ )
+        {
+            x[i] = _mun(i);
+            b[i] = bvec(i);
+        }
+        opts.tol = 1.E-10;
+        opts.maxit = 100;
+        opts.restart = 50;
+        gmres(x, b, preconditioned_product, this, opts, _solveiters,
+              _solveres);
+        _lustale = true;
+        if (_solveres <= opts.tol)
+            _mun = Eigen::Map<Eigen::VectorXd>(x.data(), npanels);
+        else
+        {
+            factorize();
+            solveSystem();
+        }
+    }
+
+    setDoubletStrengths();
+    computeSurfaceQuantities();
+    computeForceMoment();
+
+    return 0;
 }
-double Aircraft::skinFrictionPitchingMomentCoefficient () const
+
+unsigned int Aircraft::solveIterations () const { return _solveiters; }
+double Aircraft::solveResidual () const { return _solveres; }
+double Aircraft::precisionCheckError () const { return _checkerr; }
+
+/******************************************************************************/
+//
+// Gives size of system of equations (= number of panels) and solution vector
+//
+/******************************************************************************/
+unsigned int Aircraft::systemSize () const { return _panels.size(); }
+const Eigen::VectorXd & Aircraft::solution () const { return _mun; }
+
+/******************************************************************************/
+//
+// Access to wings
+//
+/******************************************************************************/
+unsigned int Aircraft::nWings () const { return _wings.size(); }
+Wing & Aircraft::wing ( unsigned int widx )
 {
-    double qinf;
+#ifdef DEBUG
+    if (widx >= _wings.size())
+        conditional_stop(1, "Aircraft::wing", "Index out of range.");
+#endif
 
-    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
-    return skinFrictionPitchingMoment() / (qinf*_sref*_lref);
+    return _wings[widx];
 }
 
 /******************************************************************************/
 //
-// Writes forces and moments for aircraft and each wing to CSV formatted files
+// Computes surface velocities and pressures, interpolates them to vertices,
+// and extrapolates to vertices at edges
 //
 /******************************************************************************/
-int Aircraft::writeForceMoment ( int iter ) const
+void Aircraft::computeSurfaceQuantities ()
 {
-    std::ofstream f;
-    std::string fname;
-    unsigned int i, nwings;
-    
-    fname = "forcemoment/" + casename + "_forcemoment.csv";
-    
-    // Write header during first iteration
+    unsigned int i, npanels;
     
-    if (iter == 1)
+    // All wings are processed together in one parallel region, with
+    // barriers only between the steps
+
+    npanels = _panels.size();
+#pragma omp parallel private(i)
     {
-        f.open(fname.c_str(), std::fstream::out);
-        if (! f.is_open())
+        _surfgrad.computeVelocity(uinfvec);
+#pragma omp for
+        for ( i = 0; i < npanels; i++ )
         {
-            print_warning("Aircraft::writeForceMoment",
-                          "Unable to open " + fname + " for writing.");
-            return 1;
+            _panels[i]->computePressure(uinf, rhoinf, pinf);
         }
-        if (viscous)
+        _vertstore.averageFromPanels();
+        _vertstore.extrapolateToEdges();
+    }
+}
+
+/******************************************************************************/
+//
+// Computes the spanwise coupling of sectional lift coefficients for
+// SpanwiseNewton. Each section's share of the viscous part of the source
+// strengths (mass defect derivative) on its neighboring panels is perturbed in
+// turn, and the change in 3D sectional lift coefficient of all sections is
+// recorded. Only the RHS changes, so the perturbed RHS is formed from the
+// source influence coefficients of the perturbed panels and solved with the
+// existing factorization; the AIC matrix is not reassembled. Column j is normalized by the response of section j itself, so
+// that element (i,j) is the change in lift coefficient of section i per unit
+// change of that of section j due to its BL. The solution is restored
+// afterwards. The coupling is recomputed after it is cleared by a change of
+// wake or surface geometry. Returns 1 if there are no viscous source strengths
+// yet.
+//
+/******************************************************************************/
+int Aircraft::computeLiftCoupling ()
+{
+    unsigned int i, j, k, l, nwings, nsecs, npanels, nverts, nsecverts,
+                 solveiters0;
+    std::vector<Section *> sections;
+    std::map<const Vertex *, unsigned int> secidx;
+    std::map<const Vertex *, unsigned int>::const_iterator it;
+    std::vector<std::vector<unsigned int> > strippans;
+    std::vector<std::vector<double> > stripsigma;
+    std::vector<unsigned int> panelsecs;
+    std::vector<double> sigma0, cl0;
+    Eigen::VectorXd rhs0, mun0, drhs;
+    Eigen::MatrixXd sens;
+    Eigen::Vector3d col;
+    double dsigma, dsigmamax, sic, solveres0, checkerr0;
+    const double eps = 0.1;
+
+    // Sections of all wings and the section of each section vertex
+
+    nwings = _wings.size();
+    for ( i = 0; i < nwings; i++ )
+    {
+        for ( j = 0; j < _wings[i].nSections(); j++ )
         {
-        f << "\"Iter\",\"Lift\",\"Lift_trefftz\",\"Lift_skinfric\","
-          <<            "\"Drag\",\"Drag_induced\",\"Drag_parasitic\","
-          <<"\"Moment\",\"Moment_pressure\",\"Moment_skinfric\","
-          <<"\"CL\",\"CL_trefftz\",\"CL_skinfric\","
-          <<"\"CD\",\"CD_induced\",\"CD_parasitic\","
-          <<"\"Cm\",\"Cm_pressure\",\"Cm_skinfric\"" << std::endl;
+            sections.push_back(&_wings[i].section(j));
         }
-        else
+    }
+    nsecs = sections.size();
+    for ( i = 0; i < nsecs; i++ )
+    {
+        nsecverts = sections[i]->nVerts();
+        for ( j = 0; j < nsecverts; j++ )
         {
-            f << "\"Iter\",\"Lift\",\"Lift_integrated\","
-              <<          "\"Drag\",\"Drag_integrated\","
-              << "\"Moment\","
-              << "\"CL\",\"CL_integrated\","
-              << "\"CD\",\"CD_integrated\","
-              << "\"Cm\"" << std::endl;
+            secidx[&sections[i]->vert(j)] = i;
         }
     }
-    else
+
+    // Perturbation of source strengths for each section. A panel between two
+    // sections is shared according to its number of vertices in each.
+
+    npanels = _panels.size();
+    strippans.resize(nsecs);
+    stripsigma.resize(nsecs);
+    dsigmamax = 0.;
+    for ( i = 0; i < npanels; i++ )
     {
-        f.open(fname.c_str(), std::fstream::app);
-        if (! f.is_open())
+        dsigma = _panels[i]->massDefectDerivative();
+        dsigmamax = std::max(dsigmamax, std::abs(dsigma));
+        nverts = _panels[i]->nVertices();
+        panelsecs.resize(0);
+        for ( j = 0; j < nverts; j++ )
+        {
+            it = secidx.find(&_panels[i]->vertex(j));
+            if (it != secidx.end())
+                panelsecs.push_back(it->second);
+        }
+        for ( j = 0; j < panelsecs.size(); j++ )
         {
-          print_warning("Aircraft::writeForceMoment",
-                        "Unable to open " + fname + " for writing.");
-          return 1;
+            k = panelsecs[j];
+            if ( (strippans[k].size() > 0) && (strippans[k].back() == i) )
+                stripsigma[k].back() += dsigma/double(nverts);
+            else
+            {
+                strippans[k].push_back(i);
+                stripsigma[k].push_back(dsigma/double(nverts));
+            }
         }
     }
-    f << iter << ",";
-    f.setf(std::ios_base::scientific);
-    f << std::setprecision(7);
-    if (viscous)
+    if (dsigmamax == 0.)
+        return 1;
+
+    std::cout << "  Computing spanwise lift coupling ..." << std::endl;
+
+    // Unperturbed solution
+
+    sigma0.resize(npanels);
+    for ( i = 0; i < npanels; i++ )
     {
-        f << lift() << ",";
-        f << trefftzLift() << ",";
-        f << skinFrictionLift() << ",";
-        f << drag() << ",";
-        f << inducedDrag() << ",";
-        f << parasiticDrag() << ",";
-        f << pitchingMoment() << ",";
-        f << pressurePitchingMoment() << ",";
-        f << skinFrictionPitchingMoment() << ",";
-        f << liftCoefficient() << ",";
-        f << trefftzLiftCoefficient() << ",";
-        f << skinFrictionLiftCoefficient() << ",";
-        f << dragCoefficient() << ",";
-        f << inducedDragCoefficient() << ",";
-        f << parasiticDragCoefficient() << ",";
-        f << pitchingMomentCoefficient() << ",";
-        f << pressurePitchingMomentCoefficient() << ",";
-        f << skinFrictionPitchingMomentCoefficient() << std::endl;
+        sigma0[i] = _panels[i]->sourceStrength();
     }
-    else
+    rhs0 = _rhs;
+    mun0 = _mun;
+    solveiters0 = _solveiters;
+    solveres0 = _solveres;
+    checkerr0 = _checkerr;
+    cl0.resize(nsecs);
+    for ( i = 0; i < nsecs; i++ )
     {
-        f << lift() << ",";
-        f << integratedLift() << ",";
-        f << drag() << ",";
-        f << integratedDrag() << ",";
-        f << pitchingMoment() << ",";
-        f << liftCoefficient() << ",";
-        f << integratedLiftCoefficient() << ",";
-        f << dragCoefficient() << ",";
-        f << integratedDragCoefficient() << ",";
-        f << pitchingMomentCoefficient() << std::endl;
+        cl0[i] = sections[i]->computeLift2D(uinfvec, rhoinf, pinf, alpha);
     }
-    f.close();
-    
-    nwings = _wings.size();
-    for ( i = 0; i < nwings; i++ )
+
+    // Response to the perturbation of each section. The RHS change is
+    // -S(:,strip)*dsigma/uinf, using the same source coefficients as
+    // constructSystem (computed on the fly with MatrixFree).
+
+    if (_lustale)
+        factorize();
+    sens.resize(nsecs, nsecs);
+    drhs.resize(npanels);
+    for ( j = 0; j < nsecs; j++ )
     {
-        if (_wings[i].writeForceMoment(iter) != 0)
-            return 1;
+        for ( k = 0; k < strippans[j].size(); k++ )
+        {
+            i = strippans[j][k];
+            _panels[i]->setSourceStrength(sigma0[i] + eps*stripsigma[j][k]);
+        }
+#pragma omp parallel for private(i,k,l,col,sic) schedule(static)
+        for ( i = 0; i < npanels; i++ )
+        {
+            col = _panels[i]->collocationPoint();
+            drhs(i) = 0.;
+            for ( k = 0; k < strippans[j].size(); k++ )
+            {
+                l = strippans[j][k];
+                if (matrix_free)
+                    sic = _panels[l]->sourcePhiCoeff(col(0), col(1), col(2),
+                                                     i == l, "bottom", true);
+                else if (mixed_precision)
+                    sic = double(_sourceicf(i,l));
+                else
+                    sic = _sourceic(i,l);
+                drhs(i) -= eps*stripsigma[j][k]*sic;
+            }
+        }
+        _rhs = rhs0 + drhs/uinf;
+        solveSystem();
+        setDoubletStrengths();
+        computeSurfaceQuantities();
+        for ( i = 0; i < nsecs; i++ )
+        {
+            sens(i,j) = (sections[i]->computeLift2D(uinfvec, rhoinf, pinf,
+                                                    alpha) - cl0[i]) / eps;
+        }
+        for ( k = 0; k < strippans[j].size(); k++ )
+        {
+            i = strippans[j][k];
+            _panels[i]->setSourceStrength(sigma0[i]);
+        }
     }
-    
+
+    // Restore solution and solve diagnostics
+
+    _rhs = rhs0;
+    _mun = mun0;
+    _solveiters = solveiters0;
+    _solveres = solveres0;
+    _checkerr = checkerr0;
+    setDoubletStrengths();
+    computeSurfaceQuantities();
+
+    // Normalize by the response of each section to its own perturbation.
+    // Sections without a response are left uncoupled.
+
+    _clcoupling.resize(nsecs, nsecs);
+    for ( j = 0; j < nsecs; j++ )
+    {
+        if (std::abs(sens(j,j)) > 1.E-12)
+            _clcoupling.col(j) = sens.col(j) / sens(j,j);
+        else
+        {
+            _clcoupling.col(j).setZero();
+            _clcoupling(j,j) = 1.;
+        }
+    }
+
     return 0;
 }
 
 /******************************************************************************/
 //
-// Writes sectional force and moment coefficients to file
+// Lift coefficients to run Xfoil at for all sections from a Newton step on
+// the spanwise coupled residual cl3d(clspec) - clspec. The Jacobian of cl3d is
+// the lift coupling matrix with each column scaled by the secant derivative
+// of the section's own lift coefficient, so it reduces to the per-section
+// secant update if sections are uncoupled. Returns 1 if the step is not
+// available yet, in which case sections are updated independently.
 //
 /******************************************************************************/
-void Aircraft::writeSectionForceMoment ( int iter ) const
+int Aircraft::spanwiseNewtonStep ( std::vector<double> & clspec )
 {
-  unsigned int i, nwings;
+    unsigned int i, j, k, nwings, nsecs;
+    Eigen::MatrixXd jac;
+    Eigen::VectorXd res, dcl, slopes, clguess;
+    double cl2d, slope;
+    Section * sec;
 
-  nwings = _wings.size();
-  for ( i = 0; i < nwings; i++ )
-  {
-    _wings[i].writeSectionForceMoment(iter);
-  }
+    if ( (_clcoupling.rows() == 0) && (computeLiftCoupling() != 0) )
+        return 1;
+
+    nsecs = _clcoupling.rows();
+    res.resize(nsecs);
+    slopes.resize(nsecs);
+    clguess.resize(nsecs);
+    nwings = _wings.size();
+    k = 0;
+    for ( i = 0; i < nwings; i++ )
+    {
+        for ( j = 0; j < _wings[i].nSections(); j++ )
+        {
+            sec = &_wings[i].section(j);
+            cl2d = sec->computeLift2D(uinfvec, rhoinf, pinf, alpha);
+            if (! sec->liftSlope(cl2d, slope))
+                return 1;
+            clguess(k) = sec->liftGuess();
+            res(k) = cl2d - clguess(k);
+            slopes(k) = slope;
+            k++;
+        }
+    }
+
+    jac = Eigen::MatrixXd::Identity(nsecs, nsecs)
+        - _clcoupling*slopes.asDiagonal();
+    dcl = jac.partialPivLu().solve(res);
+    if (! dcl.allFinite())
+        return 1;
+
+    clspec.resize(nsecs);
+    for ( k = 0; k < nsecs; k++ )
+    {
+        clspec[k] = clguess(k) + dcl(k);
+    }
+
+    return 0;
 }
 
 /******************************************************************************/
 //
-// Convects and updates wake panels
+// BL calculations with xfoil
 //
 /******************************************************************************/
-void Aircraft::moveWake ()
+void Aircraft::computeBL ()
 {
-    unsigned int i, nwings;
-    
+    unsigned int i, k, nwings;
+    std::vector<double> clspec;
+
     nwings = _wings.size();
-    for ( i = 0; i < nwings; i++ )
+    if (spanwise_newton && (spanwiseNewtonStep(clspec) == 0))
     {
-        _wings[i].wake().convectVertices(dt, _panels, _wakepanels);
+        k = 0;
+        for ( i = 0; i < nwings; i++ )
+        {
+            _wings[i].computeBL(&clspec[k]);
+            k += _wings[i].nSections();
+        }
     }
-    for ( i = 0; i < nwings; i++ )
+    else
     {
-        _wings[i].wake().update();
+        for ( i = 0; i < nwings; i++ )
+        {
+            _wings[i].computeBL();
+        }
     }
 }
 
-/*******************************************************************************
-
-Computes farfield data
-
-*******************************************************************************/
-void Aircraft::computeFarfield ()
-{
-  _farfield.computeVelocity(uinfvec, minf, _panels, _wakepanels);
-  _farfield.computePressure(uinf, rhoinf, pinf);
-  _farfield.computeForce(alpha, rhoinf, uinf, _sref);
-}
-
 /******************************************************************************/
 //
-// Writes legacy VTK viz files
+// Sets up viscous wake for each wing
 //
 /******************************************************************************/
-int Aircraft::writeViz ( const std::string & prefix, int iter ) const
+void Aircraft::setupViscousWake ()
+{
+    unsigned int i, nwings;
+    int next_global_vertidx, next_global_elemidx;
+
+    next_global_vertidx = _verts.size() + _wakeverts.size();
+    next_global_elemidx = _panels.size() + _wakepanels.size();
+    nwings = _wings.size();
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wings[i].setupViscousWake(next_global_vertidx, next_global_elemidx);
+    }
+}
+
+/******************************************************************************/
+//
+// Trefftz plane location
+//
+/******************************************************************************/
+void Aircraft::trefftzPlane ( double & xtrefftz, double & ztrefftz ) const
+{
+    double beta, xteinc, zteinc;
+
+    // P-G transformation to get aft TE point in incompressible coordinates
+
+    beta = std::sqrt(1. - std::pow(minf,2.));
+    xteinc = _xte/beta;
+    zteinc = _zte;
+
+    // Trefftz plane 1000 span lengths downstream from aftmost TE
+
+    xtrefftz = xteinc + 1000.*_maxspan*uinfvec(0)/uinf;
+    ztrefftz = zteinc + 1000.*_maxspan*uinfvec(2)/uinf;
+}
+
+/******************************************************************************/
+//
+// Trefftz plane lift and induced drag coefficients from the current wake
+// strengths, without computing other forces
+//
+/******************************************************************************/
+void Aircraft::trefftzCoefficients ( double & cl, double & cdi ) const
+{
+    unsigned int i, nwings;
+    double xtrefftz, ztrefftz, lift, drag, qinf;
+
+    trefftzPlane(xtrefftz, ztrefftz);
+    cl = 0.;
+    cdi = 0.;
+    nwings = _allwake.size();
+    for ( i = 0; i < nwings; i++ )
+    {
+        _allwake[i]->farfieldForces(xtrefftz, ztrefftz, _allwake, lift, drag);
+        cl += lift;
+        cdi += drag;
+    }
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    cl /= qinf*_sref;
+    cdi /= qinf*_sref;
+}
+
+/******************************************************************************/
+//
+// Computes or access forces and moments
+//
+/******************************************************************************/
+void Aircraft::computeForceMoment ()
+{
+    unsigned int i, nwings;
+    double xtrefftz, ztrefftz;
+
+    trefftzPlane(xtrefftz, ztrefftz);
+
+    // Average viscous quantities from surface vertices to panels
+
+    if (viscous)
+        _vertstore.averageToPanels();
+    
+    nwings = _wings.size();
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wings[i].computeForceMoment(_momcen, xtrefftz, ztrefftz, _allwake);
+    }
+}
+
+/******************************************************************************/
+//
+// Vortex lattice solution on the camber surfaces of all wings. The influence
+// of each ring is evaluated at each collocation point, and the system for
+// zero normal velocity is solved directly.
+//
+/******************************************************************************/
+void Aircraft::solveVortexLattice ()
+{
+    unsigned int i, j, nwings, nrings;
+    std::vector<VortexLattice *> alllattice;
+    std::vector<unsigned int> lattice, local;
+    Eigen::MatrixXd aic;
+    Eigen::VectorXd rhs, gamma;
+    Eigen::Vector3d col, norm;
+
+    // Set up lattices and global ring indices
+
+    nwings = _wings.size();
+    alllattice.resize(nwings);
+    nrings = 0;
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wings[i].setupVortexLattice();
+        alllattice[i] = &_wings[i].vortexLattice();
+        for ( j = 0; j < alllattice[i]->nRings(); j++ )
+        {
+            lattice.push_back(i);
+            local.push_back(j);
+        }
+        nrings += alllattice[i]->nRings();
+    }
+
+    // Influence coefficients and RHS
+
+    aic.resize(nrings, nrings);
+    rhs.resize(nrings);
+#pragma omp parallel for private(i,j,col,norm) schedule(static)
+    for ( i = 0; i < nrings; i++ )
+    {
+        col = alllattice[lattice[i]]->collocationPoint(local[i]);
+        norm = alllattice[lattice[i]]->normal(local[i]);
+        for ( j = 0; j < nrings; j++ )
+        {
+            aic(i,j) = alllattice[lattice[j]]->VCoeff(local[j], col(0), col(1),
+                                                      col(2)).dot(norm);
+        }
+        rhs(i) = -uinfvec.dot(norm);
+    }
+
+    // Solve and set circulations
+
+    gamma = aic.partialPivLu().solve(rhs);
+    for ( i = 0; i < nrings; i++ )
+    {
+        alllattice[lattice[i]]->setCirculation(local[i], gamma(i));
+    }
+
+    // Forces and moments
+
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wings[i].computeVortexLatticeForceMoment(_momcen, alllattice);
+    }
+}
+
+/******************************************************************************/
+//
+// Sets vortex lattice sectional lift coefficients as the first lift
+// coefficients to run Xfoil at
+//
+/******************************************************************************/
+void Aircraft::setVortexLatticeLiftGuesses ()
+{
+    unsigned int i, j, nwings, nsecs;
+
+    nwings = _wings.size();
+    for ( i = 0; i < nwings; i++ )
+    {
+        nsecs = _wings[i].nSections();
+        for ( j = 0; j < nsecs; j++ )
+        {
+            _wings[i].section(j).setLiftGuess(
+                                    _wings[i].section(j).liftCoefficient());
+        }
+    }
+}
+
+double Aircraft::lift () const
+{
+    unsigned int i, nwings;
+    double lift;
+
+    nwings = _wings.size();
+    lift = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        lift += _wings[i].lift();
+    }
+
+    return lift;
+}
+double Aircraft::trefftzLift () const
+{
+    unsigned int i, nwings;
+    double lifttr;
+
+    nwings = _wings.size();
+    lifttr = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        lifttr += _wings[i].trefftzLift();
+    }
+
+    return lifttr;
+}
+double Aircraft::skinFrictionLift () const
+{
+    unsigned int i, nwings;
+    double liftf;
+
+    nwings = _wings.size();
+    liftf = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        liftf += _wings[i].skinFrictionLift();
+    }
+
+    return liftf;
+}
+double Aircraft::integratedLift () const
+{
+    unsigned int i, nwings;
+    double liftp;
+
+    nwings = _wings.size();
+    liftp = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        liftp += _wings[i].integratedLift();
+    }
+
+    return liftp;
+}
+
+double Aircraft::drag () const
+{
+    unsigned int i, nwings;
+    double drag;
+
+    nwings = _wings.size();
+    drag = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        drag += _wings[i].drag();
+    }
+
+    return drag;
+}
+double Aircraft::inducedDrag () const
+{
+    unsigned int i, nwings;
+    double dragtr;
+
+    nwings = _wings.size();
+    dragtr = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        dragtr += _wings[i].inducedDrag();
+    }
+
+    return dragtr;
+}
+double Aircraft::parasiticDrag () const
+{
+    unsigned int i, nwings;
+    double dragv;
+
+    nwings = _wings.size();
+    dragv = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        dragv += _wings[i].parasiticDrag();
+    }
+
+    return dragv;
+}
+double Aircraft::skinFrictionDrag () const
+{
+    unsigned int i, nwings;
+    double dragf;
+
+    nwings = _wings.size();
+    dragf = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        dragf += _wings[i].skinFrictionDrag();
+    }
+
+    return dragf;
+}
+double Aircraft::integratedDrag () const
+{
+    unsigned int i, nwings;
+    double dragp;
+
+    nwings = _wings.size();
+    dragp = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        dragp += _wings[i].integratedDrag();
+    }
+
+    return dragp;
+}
+
+double Aircraft::pitchingMoment () const
+{
+    unsigned int i, nwings;
+    double moment;
+
+    nwings = _wings.size();
+    moment = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        moment += _wings[i].pitchingMoment();
+    }
+
+    return moment;
+}
+double Aircraft::pressurePitchingMoment () const
+{
+    unsigned int i, nwings;
+    double momentp;
+
+    nwings = _wings.size();
+    momentp = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        momentp += _wings[i].pressurePitchingMoment();
+    }
+
+    return momentp;
+}
+double Aircraft::skinFrictionPitchingMoment () const
+{
+    unsigned int i, nwings;
+    double momentf;
+
+    nwings = _wings.size();
+    momentf = 0.;
+    for ( i = 0; i < nwings; i++ )
+    {
+        momentf += _wings[i].skinFrictionPitchingMoment();
+    }
+
+    return momentf;
+}
+
+double Aircraft::liftCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return lift() / (qinf*_sref);
+}
+double Aircraft::trefftzLiftCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return trefftzLift() / (qinf*_sref);
+}
+double Aircraft::skinFrictionLiftCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return skinFrictionLift() / (qinf*_sref);
+}
+double Aircraft::integratedLiftCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return integratedLift() / (qinf*_sref);
+}
+
+double Aircraft::dragCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return drag() / (qinf*_sref);
+}
+double Aircraft::inducedDragCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return inducedDrag() / (qinf*_sref);
+}
+double Aircraft::parasiticDragCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return parasiticDrag() / (qinf*_sref);
+}
+double Aircraft::skinFrictionDragCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return skinFrictionDrag() / (qinf*_sref);
+}
+double Aircraft::integratedDragCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return integratedDrag() / (qinf*_sref);
+}
+
+double Aircraft::pitchingMomentCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return pitchingMoment() / (qinf*_sref*_lref);
+}
+double Aircraft::pressurePitchingMomentCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return pressurePitchingMoment() / (qinf*_sref*_lref);
+}
+double Aircraft::skinFrictionPitchingMomentCoefficient () const
+{
+    double qinf;
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    return skinFrictionPitchingMoment() / (qinf*_sref*_lref);
+}
+
+/******************************************************************************/
+//
+// Opens force and moment and sectional output files, and the binary history
+// file if requested. If append is true, existing files are appended to. Rows
+// written after the restart checkpoint, if any, are discarded first so that
+// they are not duplicated.
+//
+/******************************************************************************/
+int Aircraft::openOutput ( bool append )
+{
+    unsigned int i, nwings;
+    int stat;
+    bool truncate;
+    std::string fname;
+    std::vector<std::string> columns, histcols;
+    std::vector<double> values;
+    std::vector<std::vector<double> > rows;
+
+    closeOutput();
+
+    // Output file sizes are stored in the order: aircraft force and moment,
+    // wing force and moment and sectional for each wing, history
+
+    nwings = _wings.size();
+    truncate = append && (_outputsizes.size() == 2*nwings+2);
+
+    stat = 0;
+    fname = "forcemoment/" + casename + "_forcemoment.csv";
+    if ( truncate && (_outputsizes[0] >= 0.) )
+        truncate_output(fname, uint64_t(_outputsizes[0]));
+    if (_fmsink.open(fname, append, output_flush_interval) != 0)
+        stat = 1;
+
+    _wingfmsinks.resize(nwings);
+    _sectionsinks.resize(nwings);
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wingfmsinks[i] = new OutputSink;
+        fname = "forcemoment/" + _wings[i].name() + "_forcemoment.csv";
+        if ( truncate && (_outputsizes[2*i+1] >= 0.) )
+            truncate_output(fname, uint64_t(_outputsizes[2*i+1]));
+        if (_wingfmsinks[i]->open(fname, append, output_flush_interval) != 0)
+            stat = 1;
+
+        _sectionsinks[i] = new OutputSink;
+        fname = "sectional/" + _wings[i].name() + "_sectional.csv";
+        if ( truncate && (_outputsizes[2*i+2] >= 0.) )
+            truncate_output(fname, uint64_t(_outputsizes[2*i+2]));
+        if (_sectionsinks[i]->open(fname, append, output_flush_interval) != 0)
+            stat = 1;
+    }
+
+    // Binary history with tables for the aircraft and each wing and its
+    // sections
+
+    if (write_history)
+    {
+        fname = "forcemoment/" + casename + "_history.bin";
+        if ( truncate && (_outputsizes[2*nwings+1] >= 0.) )
+            truncate_output(fname, uint64_t(_outputsizes[2*nwings+1]));
+        if (_history.open(fname, append, output_flush_interval) != 0)
+            return 1;
+
+        forceMomentData(columns, values);
+        histcols.assign(1, "Iter");
+        histcols.insert(histcols.end(), columns.begin(), columns.end());
+        _histaircraft = _history.addTable(casename, histcols);
+
+        _histwings.resize(nwings);
+        _histsections.resize(nwings);
+        for ( i = 0; i < nwings; i++ )
+        {
+            _wings[i].forceMomentData(columns, values);
+            histcols.assign(1, "Iter");
+            histcols.insert(histcols.end(), columns.begin(), columns.end());
+            _histwings[i] = _history.addTable(_wings[i].name(), histcols);
+
+            _wings[i].sectionData(columns, rows);
+            histcols.assign(1, "Iter");
+            histcols.insert(histcols.end(), columns.begin(), columns.end());
+            _histsections[i] = _history.addTable(_wings[i].name()
+                                                 + "_sectional", histcols);
+        }
+    }
+    _outputsizes.resize(0);
+
+    return stat;
+}
+
+/******************************************************************************/
+//
+// Flushes and closes all output files
+//
+/******************************************************************************/
+int Aircraft::closeOutput ()
+{
+    unsigned int i, nsinks;
+    int stat;
+
+    stat = _fmsink.close();
+    nsinks = _wingfmsinks.size();
+    for ( i = 0; i < nsinks; i++ )
+    {
+        if (_wingfmsinks[i]->close() != 0)
+            stat = 1;
+        delete _wingfmsinks[i];
+    }
+    _wingfmsinks.resize(0);
+    nsinks = _sectionsinks.size();
+    for ( i = 0; i < nsinks; i++ )
+    {
+        if (_sectionsinks[i]->close() != 0)
+            stat = 1;
+        delete _sectionsinks[i];
+    }
+    _sectionsinks.resize(0);
+    if (_history.close() != 0)
+        stat = 1;
+
+    return stat;
+}
+
+/******************************************************************************/
+//
+// Column names and values of aircraft forces and moments for output
+//
+/******************************************************************************/
+void Aircraft::forceMomentData ( std::vector<std::string> & columns,
+                                 std::vector<double> & values ) const
+{
+    if (viscous)
+    {
+        const char *names[] = {"Lift", "Lift_trefftz", "Lift_skinfric",
+                               "Drag", "Drag_induced", "Drag_parasitic",
+                               "Moment", "Moment_pressure", "Moment_skinfric",
+                               "CL", "CL_trefftz", "CL_skinfric",
+                               "CD", "CD_induced", "CD_parasitic",
+                               "Cm", "Cm_pressure", "Cm_skinfric"};
+        columns.assign(names, names+18);
+
+        values.resize(18);
+        values[0] = lift();
+        values[1] = trefftzLift();
+        values[2] = skinFrictionLift();
+        values[3] = drag();
+        values[4] = inducedDrag();
+        values[5] = parasiticDrag();
+        values[6] = pitchingMoment();
+        values[7] = pressurePitchingMoment();
+        values[8] = skinFrictionPitchingMoment();
+        values[9] = liftCoefficient();
+        values[10] = trefftzLiftCoefficient();
+        values[11] = skinFrictionLiftCoefficient();
+        values[12] = dragCoefficient();
+        values[13] = inducedDragCoefficient();
+        values[14] = parasiticDragCoefficient();
+        values[15] = pitchingMomentCoefficient();
+        values[16] = pressurePitchingMomentCoefficient();
+        values[17] = skinFrictionPitchingMomentCoefficient();
+    }
+    else
+    {
+        const char *names[] = {"Lift", "Lift_integrated",
+                               "Drag", "Drag_integrated",
+                               "Moment",
+                               "CL", "CL_integrated",
+                               "CD", "CD_integrated",
+                               "Cm"};
+        columns.assign(names, names+10);
+
+        values.resize(10);
+        values[0] = lift();
+        values[1] = integratedLift();
+        values[2] = drag();
+        values[3] = integratedDrag();
+        values[4] = pitchingMoment();
+        values[5] = liftCoefficient();
+        values[6] = integratedLiftCoefficient();
+        values[7] = dragCoefficient();
+        values[8] = integratedDragCoefficient();
+        values[9] = pitchingMomentCoefficient();
+    }
+}
+
+/******************************************************************************/
+//
+// Writes forces and moments for aircraft and each wing to CSV formatted files,
+// and sectional data to the binary history
+//
+/******************************************************************************/
+int Aircraft::writeForceMoment ( int iter )
+{
+    unsigned int i, j, nwings, nrows;
+    std::vector<std::string> columns;
+    std::vector<double> values, histrow;
+    std::vector<std::vector<double> > rows;
+
+    if (! _fmsink.isOpen())
+    {
+        print_warning("Aircraft::writeForceMoment",
+                      "Force and moment output is not open.");
+        return 1;
+    }
+
+    forceMomentData(columns, values);
+    if (_fmsink.newFile())
+    {
+        columns.insert(columns.begin(), "Iter");
+        _fmsink.writeHeader(columns);
+    }
+    _fmsink.writeRow(iter, values);
+    if (_history.isOpen())
+    {
+        histrow.assign(1, double(iter));
+        histrow.insert(histrow.end(), values.begin(), values.end());
+        _history.addRow(_histaircraft, histrow);
+    }
+
+    nwings = _wings.size();
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wings[i].forceMomentData(columns, values);
+        if (_wingfmsinks[i]->newFile())
+        {
+            columns.insert(columns.begin(), "Iter");
+            _wingfmsinks[i]->writeHeader(columns);
+        }
+        _wingfmsinks[i]->writeRow(iter, values);
+
+        if (_history.isOpen())
+        {
+            histrow.assign(1, double(iter));
+            histrow.insert(histrow.end(), values.begin(), values.end());
+            _history.addRow(_histwings[i], histrow);
+
+            _wings[i].sectionData(columns, rows);
+            nrows = rows.size();
+            for ( j = 0; j < nrows; j++ )
+            {
+                histrow.assign(1, double(iter));
+                histrow.insert(histrow.end(), rows[j].begin(), rows[j].end());
+                _history.addRow(_histsections[i], histrow);
+            }
+        }
+    }
+    
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Writes sectional force and moment coefficients to file
+//
+/******************************************************************************/
+void Aircraft::writeSectionForceMoment ( int iter )
+{
+  unsigned int i, j, nwings, nrows;
+  std::vector<std::string> columns;
+  std::vector<std::vector<double> > rows;
+
+  nwings = _wings.size();
+  if (_sectionsinks.size() != nwings)
+    return;
+  for ( i = 0; i < nwings; i++ )
+  {
+    _wings[i].sectionData(columns, rows);
+    if (_sectionsinks[i]->newFile())
+    {
+      columns.insert(columns.begin(), "Iter");
+      _sectionsinks[i]->writeHeader(columns);
+    }
+    nrows = rows.size();
+    for ( j = 0; j < nrows; j++ )
+    {
+      _sectionsinks[i]->writeRow(iter, rows[j]);
+    }
+  }
+}
+
+/******************************************************************************/
+//
+// Convects and updates wake panels
+//
+/******************************************************************************/
+void Aircraft::moveWake ()
+{
+    unsigned int i, nwings;
+    
+    nwings = _wings.size();
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wings[i].wake().convectVertices(dt, _panels, _wakepanels);
+    }
+    for ( i = 0; i < nwings; i++ )
+    {
+        _wings[i].wake().update();
+    }
+
+    // Wake vertices and panels have moved, so averaging weights and the
+    // spanwise lift coupling change
+
+    _wakevertstore.computeWeights();
+    _clcoupling.resize(0,0);
+}
+
+/*******************************************************************************
+
+Computes farfield data
+
+*******************************************************************************/
+void Aircraft::computeFarfield ()
+{
+  _farfield.computeVelocity(uinfvec, minf, _panels, _wakepanels);
+  _farfield.computePressure(uinf, rhoinf, pinf);
+
+  // Adaptive refinement of farfield faces. Only new vertices are evaluated
+  // after each level.
+
+  while (_farfield.refine(_wakepanels, rhoinf, uinf) > 0)
+  {
+    _farfield.computeVelocity(uinfvec, minf, _panels, _wakepanels, true);
+    _farfield.computePressure(uinf, rhoinf, pinf, true);
+  }
+
+  _farfield.computeForce(alpha, rhoinf, uinf, _sref);
+}
+
+/******************************************************************************/
+//
+// Writes legacy VTK viz files, or binary VTU files if VisualizationFormat is
+// vtu. VTU files are written from a snapshot of the data, on a background
+// thread if VisualizationBackground is set.
+//
+/******************************************************************************/
+int Aircraft::writeViz ( const std::string & prefix, int iter )
 {
   std::string surfname, wakename;
+  std::vector<vtu_grid> grids;
+
+  if (viz_format == "vtu")
+  {
+    grids.resize(2);
+    surfaceGrid(grids[0]);
+    wakeGrid(grids[1]);
+    return _vizwriter.write("visualization/", prefix, iter, grids);
+  }
+
+  surfname = prefix + "_surfs_iter" + int2string(iter) + ".vtk";
+  wakename = prefix + "_wake_iter" + int2string(iter) + ".vtk";
+
+  if (writeSurfaceViz("visualization/" + surfname) != 0)
+    return 1;
+
+  if (writeWakeViz("visualization/" + wakename) != 0)
+    return 1;
+
+  return 0;
+}
+
+/******************************************************************************/
+//
+// Waits for any pending background visualization output
+//
+/******************************************************************************/
+int Aircraft::finishViz () { return _vizwriter.wait(); }
+
+/*******************************************************************************
+
+Writes farfield data
+
+*******************************************************************************/
+int Aircraft::writeFarfieldData ( const std::string & prefix ) const
+{
+    return _farfield.writeForceAccel(prefix);
+}
+
+/*******************************************************************************
+
+Evaluates velocity and pressure at off-body probes
+
+*******************************************************************************/
+void Aircraft::computeProbes ()
+{
+    _probes.computeVelocity(uinfvec, minf, _panels, _wakepanels);
+    _probes.computePressure(uinf, rhoinf, pinf);
+}
+
+/*******************************************************************************
+
+Writes probe data
+
+*******************************************************************************/
+int Aircraft::writeProbes ( const std::string & prefix ) const
+{
+    return _probes.write(prefix, probe_format);
+}
+
+/*******************************************************************************
+
+Traces streamlines and vortex cores
+
+*******************************************************************************/
+void Aircraft::computeStreamlines ()
+{
+    _streamlines.compute(uinfvec, minf, _panels, _wakepanels);
+}
+
+/*******************************************************************************
+
+Writes streamlines and vortex cores
+
+*******************************************************************************/
+int Aircraft::writeStreamlines ( const std::string & prefix ) const
+{
+    if (_streamlines.writeViz(prefix) != 0)
+        return 1;
+
+    return _streamlines.writeCores(prefix);
+}
+
+/******************************************************************************/
+//
+// Writes solution state to a checkpoint file. The LU factorization is not
+// stored; it is recomputed in the first iteration after restart. Buffered
+// output is flushed first, and the size of each output file is stored so
+// that a restart can discard rows written after the checkpoint.
+//
+/******************************************************************************/
+int Aircraft::writeCheckpoint ( const std::string & fname, int iter,
+                                const double & lift )
+{
+    Checkpoint chk;
+    std::vector<double> data;
+    unsigned int i, j, npanels, nverts, nwakeverts, nwings;
+
+    npanels = _panels.size();
+    nverts = _verts.size();
+    nwakeverts = _wakeverts.size();
+    nwings = _wings.size();
+
+    // Output file sizes, in the order used by openOutput. Files not open are
+    // marked with -1 and left alone on restart.
+
+    data.assign(2*nwings+2, -1.);
+    if (_fmsink.isOpen())
+        data[0] = double(_fmsink.fileSize());
+    for ( i = 0; i < _wingfmsinks.size(); i++ )
+    {
+        if (_wingfmsinks[i]->isOpen())
+            data[2*i+1] = double(_wingfmsinks[i]->fileSize());
+        if (_sectionsinks[i]->isOpen())
+            data[2*i+2] = double(_sectionsinks[i]->fileSize());
+    }
+    if (_history.isOpen())
+        data[2*nwings+1] = double(_history.fileSize());
+    chk.addArray("output_sizes", data);
+
+    data.resize(7);
+    data[0] = double(iter);
+    data[1] = lift;
+    data[2] = double(npanels);
+    data[3] = double(nverts);
+    data[4] = double(nwakeverts);
+    data[5] = viscous ? 1. : 0.;
+    data[6] = double(nwings);
+    chk.addArray("info", data);
+
+    data.resize(npanels);
+    for ( i = 0; i < npanels; i++ )
+    {
+        data[i] = _mun(i);
+    }
+    chk.addArray("mun", data);
+
+    data.resize(nverts*Vertex::dataSize);
+    for ( i = 0; i < nverts; i++ )
+    {
+        for ( j = 0; int(j) < Vertex::dataSize; j++ )
+        {
+            data[i*Vertex::dataSize+j] = _verts[i]->data(j);
+        }
+    }
+    chk.addArray("surface_data", data);
+
+    // Wake vertex positions (actual, incompressible, and visualization) and
+    // wake time
+
+    data.resize(nwakeverts*9);
+    for ( i = 0; i < nwakeverts; i++ )
+    {
+        data[i*9+0] = _wakeverts[i]->x();
+        data[i*9+1] = _wakeverts[i]->y();
+        data[i*9+2] = _wakeverts[i]->z();
+        data[i*9+3] = _wakeverts[i]->xInc();
+        data[i*9+4] = _wakeverts[i]->yInc();
+        data[i*9+5] = _wakeverts[i]->zInc();
+        data[i*9+6] = _wakeverts[i]->xViz();
+        data[i*9+7] = _wakeverts[i]->yViz();
+        data[i*9+8] = _wakeverts[i]->zViz();
+    }
+    chk.addArray("wake_coordinates", data);
+
+    data.resize(nwakeverts);
+    for ( i = 0; i < nwakeverts; i++ )
+    {
+        data[i] = _wakeverts[i]->wakeTime();
+    }
+    chk.addArray("wake_time", data);
+
+    // Section BL state, including viscous wake points
+
+    if (viscous)
+    {
+        for ( i = 0; i < nwings; i++ )
+        {
+            data.resize(0);
+            _wings[i].getRestartData(data);
+            chk.addArray("wing" + int2string(i) + "_bl", data);
+        }
+    }
+
+    return chk.write(fname);
+}
+
+/******************************************************************************/
+//
+// Gets an array from a checkpoint and checks its size, unless size is 0
+//
+/******************************************************************************/
+const double * checkpoint_array ( const Checkpoint & chk,
+                                  const std::string & name, uint64_t size,
+                                  uint64_t & count )
+{
+    const double *data;
+
+    data = chk.array(name, count);
+    if ( (data == NULL) || ((size > 0) && (count != size)) )
+    {
+        print_warning("Aircraft::readCheckpoint",
+                      "Missing or mismatched array " + name + ".");
+        return NULL;
+    }
+
+    return data;
+}
+
+/******************************************************************************/
+//
+// Restores solution state from a checkpoint file. Must be called after
+// readXML with the same inputs used to write the checkpoint. Returns the
+// iteration and lift coefficient at which the checkpoint was written.
+//
+/******************************************************************************/
+int Aircraft::readCheckpoint ( const std::string & fname, unsigned int & iter,
+                               double & lift )
+{
+    Checkpoint chk;
+    const double *info, *mun, *surfdata, *wakecoords, *waketime, *bldata;
+    const double *outsizes;
+    uint64_t count;
+    unsigned int i, j, npanels, nverts, nwakeverts, nwings, nwakepans;
+    int stat;
+
+    stat = chk.open(fname);
+    if (stat == 1)
+    {
+        print_warning("Aircraft::readCheckpoint",
+                      "Unable to read " + fname + ".");
+        return 1;
+    }
+    else if (stat == 2)
+    {
+        print_warning("Aircraft::readCheckpoint",
+                      fname + " is not a valid checkpoint file.");
+        return 2;
+    }
+    else if (stat == 3)
+    {
+        print_warning("Aircraft::readCheckpoint",
+                      fname + " has an incompatible version or byte order.");
+        return 2;
+    }
+
+    // Check that the checkpoint matches the current case
+
+    npanels = _panels.size();
+    nverts = _verts.size();
+    nwakeverts = _wakeverts.size();
+    nwings = _wings.size();
+    info = checkpoint_array(chk, "info", 7, count);
+    if (info == NULL)
+        return 2;
+    if ( (int(info[2]) != int(npanels)) || (int(info[3]) != int(nverts)) ||
+         (int(info[4]) != int(nwakeverts)) || (int(info[6]) != int(nwings)) )
+    {
+        print_warning("Aircraft::readCheckpoint",
+                      "Checkpoint geometry does not match the current case.");
+        return 2;
+    }
+    if ((info[5] != 0.) != viscous)
+    {
+        print_warning("Aircraft::readCheckpoint",
+                      "Checkpoint Viscous setting does not match.");
+        return 2;
+    }
+    iter = (unsigned int)(info[0]);
+    lift = info[1];
 
-  surfname = prefix + "_surfs_iter" + int2string(iter) + ".vtk";
-  wakename = prefix + "_wake_iter" + int2string(iter) + ".vtk";
+    // Output file sizes, applied when output is reopened for appending
 
-  if (writeSurfaceViz("visualization/" + surfname) != 0)
-    return 1;
+    outsizes = chk.array("output_sizes", count);
+    if ( (outsizes != NULL) && (count == 2*nwings+2) )
+        _outputsizes.assign(outsizes, outsizes+count);
+    else
+        _outputsizes.resize(0);
+
+    mun = checkpoint_array(chk, "mun", npanels, count);
+    surfdata = checkpoint_array(chk, "surface_data",
+                                nverts*Vertex::dataSize, count);
+    wakecoords = checkpoint_array(chk, "wake_coordinates", nwakeverts*9,
+                                  count);
+    waketime = checkpoint_array(chk, "wake_time", nwakeverts, count);
+    if ( (mun == NULL) || (surfdata == NULL) || (wakecoords == NULL) ||
+         (waketime == NULL) )
+        return 2;
 
-  if (writeWakeViz("visualization/" + wakename) != 0)
-    return 1;
+    // Section BL state and viscous wake
 
-  return 0;
+    if (viscous)
+    {
+        for ( i = 0; i < nwings; i++ )
+        {
+            bldata = checkpoint_array(chk, "wing" + int2string(i) + "_bl", 0,
+                                      count);
+            if (bldata == NULL)
+                return 2;
+            if (_wings[i].setRestartData(bldata, count) != count)
+            {
+                print_warning("Aircraft::readCheckpoint",
+                              "Mismatched BL data for wing "
+                              + int2string(i) + ".");
+                return 2;
+            }
+        }
+        setupViscousWake();
+    }
+
+    // Surface vertex data
+
+    for ( i = 0; i < nverts; i++ )
+    {
+        for ( j = 0; int(j) < Vertex::dataSize; j++ )
+        {
+            _verts[i]->setData(j, surfdata[i*Vertex::dataSize+j]);
+        }
+    }
+
+    // Wake positions. Visualization coordinates are only set where they
+    // differ, since setting them overrides the actual coordinates for viz.
+
+    for ( i = 0; i < nwakeverts; i++ )
+    {
+        _wakeverts[i]->setCoordinates(wakecoords[i*9+0], wakecoords[i*9+1],
+                                      wakecoords[i*9+2]);
+        _wakeverts[i]->setIncompressibleCoordinates(wakecoords[i*9+3],
+                                      wakecoords[i*9+4], wakecoords[i*9+5]);
+        if ( (wakecoords[i*9+6] != wakecoords[i*9+0]) ||
+             (wakecoords[i*9+7] != wakecoords[i*9+1]) ||
+             (wakecoords[i*9+8] != wakecoords[i*9+2]) )
+            _wakeverts[i]->setVizCoordinates(wakecoords[i*9+6],
+                                      wakecoords[i*9+7], wakecoords[i*9+8]);
+        _wakeverts[i]->setWakeTime(waketime[i]);
+    }
+    nwakepans = _wakepanels.size();
+#pragma omp parallel for private(i)
+    for ( i = 0; i < nwakepans; i++ )
+    {
+        _wakepanels[i]->recomputeGeometry();
+    }
+    _wakevertstore.computeWeights();
+
+    // Doublet strengths on surface and wake
+
+    _mun.resize(npanels);
+    for ( i = 0; i < npanels; i++ )
+    {
+        _mun(i) = mun[i];
+    }
+    setDoubletStrengths();
+
+    return 0;
 }
 
-/*******************************************************************************
+/******************************************************************************/
+//
+// Functionals for design sensitivities at the current doublet strengths:
+// Trefftz plane lift coefficient, induced drag coefficient, and pitching
+// moment coefficient
+//
+/******************************************************************************/
+Eigen::Vector3d Aircraft::sensitivityFunctionals ()
+{
+    Eigen::Vector3d f;
 
-Writes farfield data
+    computeSurfaceQuantities();
+    computeForceMoment();
+    f << trefftzLiftCoefficient(), inducedDragCoefficient(),
+         pitchingMomentCoefficient();
 
-*******************************************************************************/
-int Aircraft::writeFarfieldData ( const std::string & prefix ) const
+    return f;
+}
+
+/******************************************************************************/
+//
+// Derivatives of the sensitivity functionals with respect to the solution
+// vector, one column per functional. The Trefftz plane forces depend only on
+// the trailing edge columns, through the wake strengths, and are linear (lift)
+// or quadratic (drag) in them, so central differences are exact. The pitching
+// moment derivative is analytic: the derivative of the pressure moment with
+// respect to the surface velocity of each panel is multiplied by the
+// transposed surface gradient operator.
+//
+/******************************************************************************/
+void Aircraft::functionalDerivatives ( Eigen::MatrixXd & dfdmun )
 {
-    return _farfield.writeForceAccel(prefix);
+    unsigned int i, j, k, npanels, nte;
+    double mun0, clp, clm, cdip, cdim, qinf, dmdp;
+    std::vector<double> w, g;
+    Eigen::Vector3d r, dpdv;
+    const double dmun = 1.;
+
+    npanels = _panels.size();
+    dfdmun.setZero(npanels, 3);
+
+    // Trefftz plane lift and induced drag
+
+    nte = _tecols.size();
+    for ( k = 0; k < nte; k++ )
+    {
+        j = _tecols[k];
+        mun0 = _mun(j);
+        _mun(j) = mun0 + dmun;
+        setDoubletStrengths();
+        trefftzCoefficients(clp, cdip);
+        _mun(j) = mun0 - dmun;
+        setDoubletStrengths();
+        trefftzCoefficients(clm, cdim);
+        _mun(j) = mun0;
+        dfdmun(j,0) = (clp - clm) / (2.*dmun);
+        dfdmun(j,1) = (cdip - cdim) / (2.*dmun);
+    }
+    setDoubletStrengths();
+
+    // Pitching moment. Doublet strengths are _mun*uinf, and the factor of 2
+    // accounts for the mirror image.
+
+    qinf = 0.5*rhoinf*std::pow(uinf, 2.);
+    w.resize(3*npanels);
+    for ( i = 0; i < npanels; i++ )
+    {
+        r = _panels[i]->centroidComp() - _momcen;
+        dmdp = -r.cross(_panels[i]->normalComp())(1)*_panels[i]->areaComp();
+        dpdv = _panels[i]->pressureVelocityDerivative(uinf, rhoinf, pinf);
+        for ( k = 0; k < 3; k++ )
+        {
+            w[3*i+k] = 2.*dmdp*dpdv(k)*uinf / (qinf*_sref*_lref);
+        }
+    }
+    _surfgrad.transposeProduct(w, g);
+    for ( i = 0; i < npanels; i++ )
+    {
+        dfdmun(i,2) = g[i];
+    }
+}
+
+/******************************************************************************/
+//
+// Terms of the residual A*mun + S*sigma/uinf of the linear system that depend
+// on the moved panels and wake strips. Rows of moved panels are computed in
+// full, since their collocation points moved. In other rows, only the
+// coefficients of the moved panels and wake strips changed, so the difference
+// of this between two geometries is the difference of the full residual.
+//
+/******************************************************************************/
+void Aircraft::partialResidual ( const std::vector<bool> & moved,
+                                 const std::vector<WakeStrip *> & strips,
+                                 Eigen::VectorXd & res )
+{
+    unsigned int i, j, k, l, m, nwings, npanels, nstrips, nwakepans, nmoved;
+    std::vector<unsigned int> movedidx;
+    std::vector<WakeStrip *> allstrips;
+    const std::vector<WakeStrip *> * rowstrips;
+    Eigen::Vector3d col;
+    WakeStrip * strip;
+    double sum, stripic;
+    bool onpanel;
+
+    npanels = _panels.size();
+    for ( j = 0; j < npanels; j++ )
+    {
+        if (moved[j])
+            movedidx.push_back(j);
+    }
+    nmoved = movedidx.size();
+
+    nwings = _wings.size();
+    for ( k = 0; k < nwings; k++ )
+    {
+        nstrips = _wings[k].nWStrips();
+        for ( l = 0; l < nstrips; l++ )
+        {
+            allstrips.push_back(_wings[k].wStrip(l));
+        }
+    }
+
+    res.resize(npanels);
+#pragma omp parallel for private(i,col,sum,j,k,l,m,onpanel,rowstrips,\
+                                 nstrips,strip,nwakepans,stripic) \
+                        schedule(dynamic)
+    for ( i = 0; i < npanels; i++ )
+    {
+        col = _panels[i]->collocationPoint();
+        sum = 0.;
+
+        // Surface panels
+
+        for ( k = 0; k < (moved[i] ? npanels : nmoved); k++ )
+        {
+            j = moved[i] ? k : movedidx[k];
+            onpanel = (i == j);
+            sum += _panels[j]->doubletPhiCoeff(col(0), col(1), col(2),
+                                               onpanel, "bottom", true)*_mun(j)
+                 + _panels[j]->sourcePhiCoeff(col(0), col(1), col(2),
+                                              onpanel, "bottom", true)
+                 * _panels[j]->sourceStrength() / uinf;
+        }
+
+        // Wake strips, with strength mu_topte - mu_botte
+
+        rowstrips = moved[i] ? &allstrips : &strips;
+        nstrips = rowstrips->size();
+        for ( l = 0; l < nstrips; l++ )
+        {
+            strip = (*rowstrips)[l];
+            nwakepans = strip->nPanels();
+            stripic = 0.;
+            for ( m = 0; m < nwakepans; m++ )
+            {
+                stripic += strip->panel(m)->doubletPhiCoeff(col(0), col(1),
+                                               col(2), false, "bottom", true);
+            }
+            sum += stripic*(_mun(strip->topTEPan()->idx())
+                          - _mun(strip->botTEPan()->idx()));
+        }
+
+        res(i) = sum;
+    }
+}
+
+/******************************************************************************/
+//
+// Computes derivatives of the Trefftz plane lift coefficient, induced drag
+// coefficient, and pitching moment coefficient with respect to the leading
+// edge position, chord, and twist of each section and the angle of attack,
+// using the adjoint method: dJ/dx = pJ/px - adj^T pR/px, where
+// A^T adj = pJ/pmun. The adjoint system is solved with the existing LU
+// factorization, for all three functionals at once. Partial derivatives are
+// central differences with the solution vector held fixed, for which only the
+// residual terms that depend on the moved panels have to be recomputed. That
+// is still the dominant cost: each panel moves with the two sections next to
+// it, and each of the 8 perturbations of a section recomputes full rows and
+// columns of its moved panels, about 32*npanels^2 influence coefficient pairs
+// in all. The wake is held fixed, except that wake lines follow the trailing
+// edge of the changed section. The solution is restored afterwards.
+//
+/******************************************************************************/
+int Aircraft::computeSensitivities ()
+{
+    unsigned int i, j, k, l, m, n, npanels, nwings, nsecs, nstrips, nmoved;
+    std::map<const Panel *, unsigned int> panidx;
+    std::vector<Panel *> movedpans;
+    std::vector<bool> moved;
+    std::vector<WakeStrip *> strips;
+    std::vector<double> sigma0;
+    Eigen::MatrixXd dfdmun, adj, res;
+    Eigen::MatrixXf adjf;
+    Eigen::VectorXd rhs0, r[2];
+    Eigen::Vector3d f[2], dfdx;
+    double params0[4], params[4], h, alpha0, bnorm;
+    Section * sec;
+    WakeStrip * strip;
+    design_sensitivity sens;
+    const std::string paramnames[4] = {"xle", "zle", "chord", "twist"};
+    const double dlength = 1.E-04;      // Relative to section chord
+    const double dangle = 1.E-02;       // Degrees
+    const unsigned int maxiters = 20;
+    const double tol = 1.E-12;
+
+    if (viscous || matrix_free)
+    {
+        print_warning("Aircraft::computeSensitivities",
+                      "Sensitivities are only available for inviscid cases "
+                      "without MatrixFree.");
+        return 1;
+    }
+
+    npanels = _panels.size();
+    for ( i = 0; i < npanels; i++ )
+    {
+        panidx[_panels[i]] = i;
+    }
+    _sensitivities.resize(0);
+
+    // Adjoint solution. With MixedPrecision, the single precision solution is
+    // improved by iterative refinement as in solveSystem. The factorization
+    // must be of the current AIC matrix.
+
+    if (_lustale)
+        factorize();
+    functionalDerivatives(dfdmun);
+    if (mixed_precision)
+    {
+        bnorm = dfdmun.norm();
+        if (bnorm == 0.)
+            bnorm = 1.;
+        adjf = _luf->transpose().solve(dfdmun.cast<float>());
+        adj = adjf.cast<double>();
+        for ( n = 0; n < maxiters; n++ )
+        {
+            res = dfdmun - _aic.transpose()*adj;
+            if (res.norm() <= tol*bnorm)
+                break;
+            adjf = _luf->transpose().solve(res.cast<float>());
+            adj += adjf.cast<double>();
+        }
+    }
+    else
+        adj = _lu->transpose().solve(dfdmun);
+
+    sigma0.resize(npanels);
+    for ( i = 0; i < npanels; i++ )
+    {
+        sigma0[i] = _panels[i]->sourceStrength();
+    }
+
+    // Section geometry parameters
+
+    nwings = _wings.size();
+    for ( i = 0; i < nwings; i++ )
+    {
+        nsecs = _wings[i].nSections();
+        for ( j = 0; j < nsecs; j++ )
+        {
+            sec = &_wings[i].section(j);
+            params0[0] = sec->xle();
+            params0[1] = sec->zle();
+            params0[2] = sec->chord();
+            params0[3] = sec->twist();
+            for ( k = 0; k < 4; k++ )
+            {
+                if (k == 3)
+                    h = dangle;
+                else
+                    h = dlength*params0[2];
+
+                for ( m = 0; m < 2; m++ )
+                {
+                    for ( l = 0; l < 4; l++ )
+                    {
+                        params[l] = params0[l];
+                    }
+                    params[k] += (m == 0) ? h : -h;
+                    movedpans.resize(0);
+                    _wings[i].setSectionGeometry(j, params[0], params[1],
+                                           params[2], params[3], movedpans);
+                    nmoved = movedpans.size();
+                    for ( l = 0; l < nmoved; l++ )
+                    {
+                        movedpans[l]->computeSourceStrength(uinfvec, false);
+                    }
+
+                    // Moved panels and wake strips are the same for both
+                    // perturbations
+
+                    if (m == 0)
+                    {
+                        moved.assign(npanels, false);
+                        for ( l = 0; l < nmoved; l++ )
+                        {
+                            moved[panidx[movedpans[l]]] = true;
+                        }
+                        strips.resize(0);
+                        nstrips = _wings[i].nWStrips();
+                        for ( l = 0; l < nstrips; l++ )
+                        {
+                            strip = _wings[i].wStrip(l);
+                            if (moved[panidx[strip->topTEPan()]] ||
+                                moved[panidx[strip->botTEPan()]])
+                                strips.push_back(strip);
+                        }
+                    }
+                    _surfgrad.updateStencils(moved);
+
+                    partialResidual(moved, strips, r[m]);
+                    f[m] = sensitivityFunctionals();
+                }
+
+                // Restore geometry
+
+                movedpans.resize(0);
+                _wings[i].setSectionGeometry(j, params0[0], params0[1],
+                                             params0[2], params0[3], movedpans);
+                nmoved = movedpans.size();
+                for ( l = 0; l < nmoved; l++ )
+                {
+                    movedpans[l]->setSourceStrength(
+                                               sigma0[panidx[movedpans[l]]]);
+                }
+                _surfgrad.updateStencils(moved);
+
+                dfdx = (f[0] - f[1] - adj.transpose()*(r[0] - r[1])) / (2.*h);
+                sens.wing = _wings[i].name();
+                sens.section = j;
+                sens.parameter = paramnames[k];
+                sens.dcl = dfdx(0);
+                sens.dcdi = dfdx(1);
+                sens.dcm = dfdx(2);
+                _sensitivities.push_back(sens);
+            }
+        }
+    }
+
+    // Angle of attack. Only source strengths depend on it in the residual.
+
+    alpha0 = alpha;
+    rhs0 = _rhs;
+    for ( m = 0; m < 2; m++ )
+    {
+        alpha = (m == 0) ? alpha0 + dangle : alpha0 - dangle;
+        uinfvec(0) = uinf*cos(alpha*M_PI/180.);
+        uinfvec(2) = uinf*sin(alpha*M_PI/180.);
+        setSourceStrengths(false);
+        constructSystem(false);
+        r[m] = -_rhs;
+        f[m] = sensitivityFunctionals();
+    }
+    alpha = alpha0;
+    uinfvec(0) = uinf*cos(alpha*M_PI/180.);
+    uinfvec(2) = uinf*sin(alpha*M_PI/180.);
+    _rhs = rhs0;
+    for ( i = 0; i < npanels; i++ )
+    {
+        _panels[i]->setSourceStrength(sigma0[i]);
+    }
+
+    dfdx = (f[0] - f[1] - adj.transpose()*(r[0] - r[1])) / (2.*dangle);
+    sens.wing = "";
+    sens.section = -1;
+    sens.parameter = "alpha";
+    sens.dcl = dfdx(0);
+    sens.dcdi = dfdx(1);
+    sens.dcm = dfdx(2);
+    _sensitivities.push_back(sens);
+
+    // Restore solution
+
+    setDoubletStrengths();
+    computeSurfaceQuantities();
+    computeForceMoment();
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Checks adjoint design sensitivities against central finite differences
+// with a full solution of the perturbed geometry: the influence coefficients
+// are recomputed, and the system is factorized and solved again. All
+// parameters of the middle section of each wing are checked. Returns 1 if the
+// relative difference for any functional exceeds the tolerance. The solution
+// is restored afterwards.
+//
+/******************************************************************************/
+int Aircraft::checkSensitivities ()
+{
+    unsigned int i, j, k, l, m, n, npanels, nwings, nsens, nmoved;
+    int retval;
+    std::map<const Panel *, unsigned int> panidx;
+    std::vector<Panel *> movedpans;
+    std::vector<bool> moved;
+    std::vector<double> sigma0;
+    Eigen::VectorXd mun0;
+    Eigen::Vector3d f[2], fd, adj, maxerr, maxfd;
+    double params0[4], params[4], h;
+    Section * sec;
+    const std::string paramnames[4] = {"xle", "zle", "chord", "twist"};
+    const std::string funcnames[3] = {"CL", "CDi", "Cm"};
+    const double dlength = 1.E-03;      // Relative to section chord
+    const double dangle = 1.E-01;       // Degrees
+    const double tol = 1.E-03;
+
+    if (_sensitivities.size() == 0)
+    {
+        print_warning("Aircraft::checkSensitivities",
+                      "Sensitivities have not been computed.");
+        return 1;
+    }
+
+    npanels = _panels.size();
+    for ( i = 0; i < npanels; i++ )
+    {
+        panidx[_panels[i]] = i;
+    }
+    mun0 = _mun;
+    sigma0.resize(npanels);
+    for ( i = 0; i < npanels; i++ )
+    {
+        sigma0[i] = _panels[i]->sourceStrength();
+    }
+
+    retval = 0;
+    nsens = _sensitivities.size();
+    nwings = _wings.size();
+    for ( i = 0; i < nwings; i++ )
+    {
+        j = _wings[i].nSections()/2;
+        sec = &_wings[i].section(j);
+        params0[0] = sec->xle();
+        params0[1] = sec->zle();
+        params0[2] = sec->chord();
+        params0[3] = sec->twist();
+        maxerr.setZero();
+        maxfd.setZero();
+        for ( k = 0; k < 4; k++ )
+        {
+            if (k == 3)
+                h = dangle;
+            else
+                h = dlength*params0[2];
+
+            for ( m = 0; m < 3; m++ )
+            {
+                for ( l = 0; l < 4; l++ )
+                {
+                    params[l] = params0[l];
+                }
+                if (m == 0)
+                    params[k] += h;
+                else if (m == 1)
+                    params[k] -= h;
+                movedpans.resize(0);
+                _wings[i].setSectionGeometry(j, params[0], params[1],
+                                             params[2], params[3], movedpans);
+                nmoved = movedpans.size();
+                moved.assign(npanels, false);
+                for ( l = 0; l < nmoved; l++ )
+                {
+                    if (m < 2)
+                        movedpans[l]->computeSourceStrength(uinfvec, false);
+                    else
+                        movedpans[l]->setSourceStrength(
+                                               sigma0[panidx[movedpans[l]]]);
+                    moved[panidx[movedpans[l]]] = true;
+                }
+                _surfgrad.updateStencils(moved);
+                constructSystem(true);
+                factorize();
+
+                // Last pass only restores the geometry and system
+
+                if (m == 2)
+                    break;
+
+                solveSystem();
+                setDoubletStrengths();
+                f[m] = sensitivityFunctionals();
+            }
+            fd = (f[0] - f[1]) / (2.*h);
+
+            for ( n = 0; n < nsens; n++ )
+            {
+                if ( (_sensitivities[n].wing == _wings[i].name()) &&
+                     (_sensitivities[n].section == int(j)) &&
+                     (_sensitivities[n].parameter == paramnames[k]) )
+                    break;
+            }
+            if (n == nsens)
+                continue;
+            adj << _sensitivities[n].dcl, _sensitivities[n].dcdi,
+                   _sensitivities[n].dcm;
+            for ( l = 0; l < 3; l++ )
+            {
+                maxerr(l) = std::max(maxerr(l), std::abs(adj(l) - fd(l)));
+                maxfd(l) = std::max(maxfd(l), std::abs(fd(l)));
+                std::cout << "  " << _wings[i].name() << " section " << j
+                          << " d" << funcnames[l] << "/d" << paramnames[k]
+                          << ": adjoint " << std::setprecision(7)
+                          << adj(l) << ", finite difference " << fd(l)
+                          << std::endl;
+            }
+        }
+
+        for ( l = 0; l < 3; l++ )
+        {
+            if ( (maxfd(l) > 0.) && (maxerr(l) > tol*maxfd(l)) )
+            {
+                print_warning("Aircraft::checkSensitivities",
+                              "Adjoint and finite difference derivatives of "
+                              + funcnames[l] + " differ for wing "
+                              + _wings[i].name() + ". Relative difference: "
+                              + double2string(maxerr(l)/maxfd(l)) + ".");
+                retval = 1;
+            }
+        }
+    }
+
+    // Restore solution
+
+    _mun = mun0;
+    setDoubletStrengths();
+    computeSurfaceQuantities();
+    computeForceMoment();
+
+    return retval;
+}
+
+/******************************************************************************/
+//
+// Writes design sensitivities to csv file
+//
+/******************************************************************************/
+int Aircraft::writeSensitivities ( const std::string & prefix ) const
+{
+    unsigned int i, nsens;
+    std::ofstream f;
+    std::string fname;
+
+    fname = "postprocessing/" + prefix + "_sensitivities.csv";
+    f.open(fname.c_str(), std::fstream::out);
+    if (! f.is_open())
+    {
+        print_warning("Aircraft::writeSensitivities",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+    f << "\"Wing\",\"Section\",\"Parameter\",\"dCL\",\"dCDi\",\"dCm\""
+      << std::endl;
+
+    f.setf(std::ios_base::scientific);
+    f << std::setprecision(7);
+    nsens = _sensitivities.size();
+    for ( i = 0; i < nsens; i++ )
+    {
+        f << "\"" << _sensitivities[i].wing << "\",";
+        f << _sensitivities[i].section << ",";
+        f << "\"" << _sensitivities[i].parameter << "\",";
+        f << _sensitivities[i].dcl << ",";
+        f << _sensitivities[i].dcdi << ",";
+        f << _sensitivities[i].dcm << std::endl;
+    }
+    f.close();
+
+    return 0;
 }
@@ -2,6 +2,7 @@
 #include <vector>
 #include <cstdlib>
 #include <cmath>
+#include <algorithm>
 #include "sectional_object.h"
 extern "C"
 {
@@ -20,15 +21,40 @@ extern "C"
 
 /******************************************************************************/
 //
-// Helper function to avoid reusing code between copy constructor and copy
-// assignment
+// Helper functions to avoid reusing code between copy and move constructors
+// and assignments. Xfoil data is only copied if Xfoil BL has been run, since
+// otherwise it can be set up again from the geometry when needed.
 //
 /******************************************************************************/
 void Airfoil::copyData ( const Airfoil & foil )
 {
-  xfoil_copy(&foil._xdg, &_xdg);
+  if (foil._xdg && foil._xfoil_bl)
+  {
+    if (! _xdg)
+    {
+      _xdg = new xfoil_data_group;
+      xfoil_init(_xdg);
+    }
+    xfoil_copy(foil._xdg, _xdg);
+    _xfoil_paneled = foil._xfoil_paneled;
+    _xfoil_bl = true;
+  }
+  else
+    releaseXfoil();
+  _options_set = foil._options_set;
+  _xfoil_opts = foil._xfoil_opts;
+  _geom_opts = foil._geom_opts;
+  _re = foil._re;
+  _mach = foil._mach;
+  _cl = foil._cl;
+  _cd = foil._cd;
+  _cm = foil._cm;
   _nb = foil._nb;
   _n = foil._n;
+  _xb = foil._xb;
+  _zb = foil._zb;
+  _x = foil._x;
+  _z = foil._z;
   _s = foil._s;
   _xs = foil._xs;
   _zs = foil._zs;
@@ -38,47 +64,147 @@ void Airfoil::copyData ( const Airfoil & foil )
   _unit_transform = foil._unit_transform;
 }
 
+void Airfoil::moveData ( Airfoil & foil )
+{
+  releaseXfoil();
+  _xdg = foil._xdg;
+  foil._xdg = NULL;
+  _xfoil_paneled = foil._xfoil_paneled;
+  _xfoil_bl = foil._xfoil_bl;
+  foil._xfoil_paneled = false;
+  foil._xfoil_bl = false;
+  _options_set = foil._options_set;
+  _xfoil_opts = foil._xfoil_opts;
+  _geom_opts = foil._geom_opts;
+  _re = foil._re;
+  _mach = foil._mach;
+  _cl = foil._cl;
+  _cd = foil._cd;
+  _cm = foil._cm;
+  _nb = foil._nb;
+  _n = foil._n;
+  _xb.swap(foil._xb);
+  _zb.swap(foil._zb);
+  _x.swap(foil._x);
+  _z.swap(foil._z);
+  _s.swap(foil._s);
+  _xs.swap(foil._xs);
+  _zs.swap(foil._zs);
+  _ssmoothed.swap(foil._ssmoothed);
+  _sle = foil._sle;
+  _y = foil._y;
+  _unit_transform = foil._unit_transform;
+}
+
 /******************************************************************************/
 //
-// Constructor, copy constructor, copy assignment, destructor
+// Constructors, assignment, destructor
 //
 /******************************************************************************/
 Airfoil::Airfoil ()
 {
-  xfoil_init(&_xdg);
+  _xdg = NULL;
+  _xfoil_paneled = false;
+  _xfoil_bl = false;
+  _options_set = false;
+  _re = 0.;
+  _mach = 0.;
+  _cl = 0.;
+  _cd = 0.;
+  _cm = 0.;
   _nb = 0;
   _n = 0;
+  _xb.resize(0);
+  _zb.resize(0);
+  _x.resize(0);
+  _z.resize(0);
   _s.resize(0);
   _xs.resize(0);
   _zs.resize(0);
   _ssmoothed.resize(0);
+  _sle = 0.;
   _y = 0.;
   _unit_transform = false;
 }
 
 Airfoil::Airfoil ( const Airfoil & foil )
 {
-  xfoil_init(&_xdg);
+  _xdg = NULL;
   copyData(foil);
 }
 
+Airfoil::Airfoil ( Airfoil && foil ) noexcept
+{
+  _xdg = NULL;
+  moveData(foil);
+}
+
 Airfoil & Airfoil::operator = ( const Airfoil & foil )
 {
-  copyData(foil);
+  if (this != &foil)
+    copyData(foil);
   return *this;
 }
 
-Airfoil::~Airfoil()
+Airfoil & Airfoil::operator = ( Airfoil && foil ) noexcept
 {
-  xfoil_cleanup(&_xdg);
-  _nb = 0;
-  _n = 0;
-  _s.resize(0);
-  _xs.resize(0);
-  _zs.resize(0);
-  _ssmoothed.resize(0);
-  _y = 0.;
-  _unit_transform = false;
+  if (this != &foil)
+    moveData(foil);
+  return *this;
+}
+
+Airfoil::~Airfoil() { releaseXfoil(); }
+
+/******************************************************************************/
+//
+// Allocates and frees Xfoil data
+//
+/******************************************************************************/
+xfoil_data_group * Airfoil::xfoilData ()
+{
+  if (_xdg)
+    return _xdg;
+
+  _xdg = new xfoil_data_group;
+  xfoil_init(_xdg);
+  if (_options_set)
+  {
+    xfoil_defaults(_xdg, &_xfoil_opts);
+    xfoil_set_paneling(_xdg, &_geom_opts);
+  }
+  if (_re > 0.)
+    xfoil_set_reynolds_number(_xdg, &_re);
+  if (_mach > 0.)
+    xfoil_set_mach_number(_xdg, &_mach);
+  _xfoil_paneled = false;
+  _xfoil_bl = false;
+
+  return _xdg;
+}
+
+void Airfoil::releaseXfoil ()
+{
+  if (_xdg)
+  {
+    xfoil_cleanup(_xdg);
+    delete _xdg;
+    _xdg = NULL;
+  }
+  _xfoil_paneled = false;
+  _xfoil_bl = false;
+}
+
+/******************************************************************************/
+//
+// Sets buffer coordinates
+//
+/******************************************************************************/
+void Airfoil::setBuffer ( const double x[], const double z[], int n )
+{
+  _nb = n;
+  _xb.assign(x, x+n);
+  _zb.assign(z, z+n);
+  _xfoil_paneled = false;
 }
 
 /******************************************************************************/
@@ -148,7 +274,7 @@ int Airfoil::readCoordinates ( const std::string & fname )
       xba[i] = xb[i];
       zba[i] = zb[i];
     }
-    xfoil_set_buffer_airfoil(&_xdg, xba, zba, &_nb);
+    setBuffer(xba, zba, _nb);
   }
 
   _unit_transform = false;
@@ -174,7 +300,7 @@ int Airfoil::naca4Coordinates ( const double & camber, const double & xcamber,
     xba[i] = x[i];
     zba[i] = z[i];
   }
-  xfoil_set_buffer_airfoil(&_xdg, xba, zba, &_nb);
+  setBuffer(xba, zba, _nb);
 
   _unit_transform = false;
 
@@ -205,7 +331,7 @@ int Airfoil::naca5Coordinates ( const std::string & des,
     xba[i] = x[i];
     zba[i] = z[i];
   }
-  xfoil_set_buffer_airfoil(&_xdg, xba, zba, &_nb);
+  setBuffer(xba, zba, _nb);
 
   _unit_transform = false;
 
@@ -232,7 +358,7 @@ int Airfoil::setCoordinates ( const std::vector<double> & x,
     xba[i] = x[i];
     zba[i] = z[i];
   }
-  xfoil_set_buffer_airfoil(&_xdg, xba, zba, &_nb);
+  setBuffer(xba, zba, _nb);
 
   _unit_transform = false;
 
@@ -283,7 +409,7 @@ int Airfoil::interpCoordinates ( const Airfoil & foil1, const Airfoil & foil2,
     xba[i] = (1.-interpfrac)*x1[i] + interpfrac*x2[i];
     zba[i] = (1.-interpfrac)*z1[i] + interpfrac*z2[i];
   }
-  xfoil_set_buffer_airfoil(&_xdg, xba, zba, &_nb);
+  setBuffer(xba, zba, _nb);
 
   _unit_transform = false;
 
@@ -316,10 +442,10 @@ void Airfoil::ccwOrderCoordinates ()
   cross = 0.;
   for ( i = 1; i < _nb-1; i++ )
   {
-    dx1 = _xdg.xfd.XB[i-1] - _xdg.xfd.XB[i];
-    dx2 = _xdg.xfd.XB[i+1] - _xdg.xfd.XB[i];
-    dz1 = _xdg.xfd.YB[i-1] - _xdg.xfd.YB[i];
-    dz2 = _xdg.xfd.YB[i+1] - _xdg.xfd.YB[i];
+    dx1 = _xb[i-1] - _xb[i];
+    dx2 = _xb[i+1] - _xb[i];
+    dz1 = _zb[i-1] - _zb[i];
+    dz2 = _zb[i+1] - _zb[i];
     cross += (dz2*dx1 - dx2*dz1);
   }
   if (cross < 0.) { return; }
@@ -328,10 +454,10 @@ void Airfoil::ccwOrderCoordinates ()
 
   for ( i = 0; i < _nb; i++ )
   {
-    xrev[i] = _xdg.xfd.XB[_nb-i-1];
-    zrev[i] = _xdg.xfd.YB[_nb-i-1];
+    xrev[i] = _xb[_nb-i-1];
+    zrev[i] = _zb[_nb-i-1];
   }
-  xfoil_set_buffer_airfoil(&_xdg, xrev, zrev, &_nb);
+  setBuffer(xrev, zrev, _nb);
 }
 
 /******************************************************************************/
@@ -355,7 +481,7 @@ int Airfoil::splineFit ()
   _s.resize(_nb);
   _xs.resize(_nb);
   _zs.resize(_nb);
-  xfoil_spline_coordinates(_xdg.xfd.XB, _xdg.xfd.YB, &_nb, s, xs, zs);
+  xfoil_spline_coordinates(_xb.data(), _zb.data(), &_nb, s, xs, zs);
 
   for ( i = 0; i < _nb; i++ )
   {
@@ -389,7 +515,7 @@ bool Airfoil::splined () const
 /******************************************************************************/
 int Airfoil::splineInterp ( const double & sc, double & xc, double & zc ) const
 {
-  double s[_nb], xs[_nb], zs[_nb];
+  double xb[_nb], zb[_nb], s[_nb], xs[_nb], zs[_nb];
   int i;
 
   if (! splined())
@@ -402,11 +528,13 @@ int Airfoil::splineInterp ( const double & sc, double & xc, double & zc ) const
 
   for ( i = 0; i < _nb; i++ )
   {
+    xb[i] = _xb[i];
+    zb[i] = _zb[i];
     s[i] = _s[i];
     xs[i] = _xs[i];
     zs[i] = _zs[i];
   }
-  xfoil_eval_spline(_xdg.xfd.XB, _xdg.xfd.YB, s, xs, zs, &_nb, &sc, &xc, &zc);
+  xfoil_eval_spline(xb, zb, s, xs, zs, &_nb, &sc, &xc, &zc);
 
   return 0;
 }
@@ -444,12 +572,12 @@ int Airfoil::unitTransform ()
     xs[i] = _xs[i];
     zs[i] = _zs[i];
   }
-  xfoil_lefind(_xdg.xfd.XB, _xdg.xfd.YB, s, xs, zs, &_nb, &_sle, &xle, &zle);
+  xfoil_lefind(_xb.data(), _zb.data(), s, xs, zs, &_nb, &_sle, &xle, &zle);
 
   xte = -1E+06;
   for ( i = 0; i < _nb; i++ )
   {
-    if (_xdg.xfd.XB[i] > xte) { xte = _xdg.xfd.XB[i]; }
+    if (_xb[i] > xte) { xte = _xb[i]; }
   }
   chord = xte - xle;
   if (chord <= 0.)
@@ -464,11 +592,12 @@ int Airfoil::unitTransform ()
 
   for ( i = 0; i < _nb; i++ )
   {
-    _xdg.xfd.XB[i] -= xle;
-    _xdg.xfd.YB[i] -= zle;
-    _xdg.xfd.XB[i] /= chord;
-    _xdg.xfd.YB[i] /= chord;
+    _xb[i] -= xle;
+    _zb[i] -= zle;
+    _xb[i] /= chord;
+    _zb[i] /= chord;
   }
+  _xfoil_paneled = false;
 
   // Refit spline to transformed coordinates
 
@@ -479,7 +608,7 @@ int Airfoil::unitTransform ()
     xs[i] = _xs[i];
     zs[i] = _zs[i];
   }
-  xfoil_lefind(_xdg.xfd.XB, _xdg.xfd.YB, s, xs, zs, &_nb, &_sle, &xle, &zle);
+  xfoil_lefind(_xb.data(), _zb.data(), s, xs, zs, &_nb, &_sle, &xle, &zle);
 
   _unit_transform = true;
 
@@ -488,15 +617,27 @@ int Airfoil::unitTransform ()
 
 /******************************************************************************/
 //
-// Sets Xfoil paneling and run options
+// Sets Xfoil paneling and run options. They are stored and applied to the
+// Xfoil data when it is allocated.
 //
 /******************************************************************************/
 void Airfoil::setXfoilOptions ( const xfoil_options_type & xfoil_opts,
                                 const xfoil_geom_options_type & geom_opts )
 {
-  xfoil_defaults(&_xdg, &xfoil_opts);
-  xfoil_set_paneling(&_xdg, &geom_opts);
+  _xfoil_opts = xfoil_opts;
+  _geom_opts = geom_opts;
+  _options_set = true;
   _n = geom_opts.npan;
+  if (_xdg)
+  {
+    xfoil_defaults(_xdg, &_xfoil_opts);
+    xfoil_set_paneling(_xdg, &_geom_opts);
+    if (_re > 0.)
+      xfoil_set_reynolds_number(_xdg, &_re);
+    if (_mach > 0.)
+      xfoil_set_mach_number(_xdg, &_mach);
+    _xfoil_paneled = false;
+  }
 }
 
 /******************************************************************************/
@@ -508,6 +649,7 @@ void Airfoil::setXfoilOptions ( const xfoil_options_type & xfoil_opts,
 /******************************************************************************/
 int Airfoil::smoothPaneling ()
 {
+  xfoil_data_group *xdg;
   int stat, i;
   double dx, dz;
 
@@ -527,21 +669,31 @@ int Airfoil::smoothPaneling ()
     return 2;
   }
 
-  xfoil_smooth_paneling(&_xdg, &stat);
+  xdg = xfoilData();
+  xfoil_set_buffer_airfoil(xdg, _xb.data(), _zb.data(), &_nb);
+  xfoil_smooth_paneling(xdg, &stat);
   if (stat != 0)
   {
     conditional_stop(1, "Airfoil::smoothPaneling", "Airfoil smoothing failed.");
     return 3;
   }
+  _xfoil_paneled = true;
 
-  // Compute smoothed spline vector
+  // Store smoothed coordinates and compute smoothed spline vector
 
+  _x.resize(_n);
+  _z.resize(_n);
+  for ( i = 0; i < _n; i++ )
+  {
+    _x[i] = xdg->xfd.X[i];
+    _z[i] = xdg->xfd.Y[i];
+  }
   _ssmoothed.resize(_n);
   _ssmoothed[0] = 0.;
   for ( i = 1; i < _n; i++ )
   {
-    dx = _xdg.xfd.X[i] - _xdg.xfd.X[i-1];
-    dz = _xdg.xfd.Y[i] - _xdg.xfd.Y[i-1];
+    dx = _x[i] - _x[i-1];
+    dz = _z[i] - _z[i-1];
     _ssmoothed[i] = _ssmoothed[i-1]
                   + std::sqrt(std::pow(dx,2.) + std::pow(dz,2.));
   }
@@ -576,8 +728,8 @@ double Airfoil::teGap () const
 {
   double dx, dz, gap;
 
-  dx = _xdg.xfd.XB[0] - _xdg.xfd.XB[_nb-1];
-  dz = _xdg.xfd.YB[0] - _xdg.xfd.YB[_nb-1];
+  dx = _xb[0] - _xb[_nb-1];
+  dz = _zb[0] - _zb[_nb-1];
   gap = std::sqrt(std::pow(dx,2.) + std::pow(dz,2.));
 
   return gap;
@@ -595,7 +747,8 @@ double Airfoil::teGap () const
 /******************************************************************************/
 int Airfoil::modifyTEGap ( const double & newgap, const double & blendloc )
 {
-  int stat;
+  xfoil_data_group *xdg;
+  int stat, i;
 
   if (_nb == 0)
   {
@@ -613,12 +766,22 @@ int Airfoil::modifyTEGap ( const double & newgap, const double & blendloc )
     return 2;
   }
 
-  xfoil_modify_tegap(&_xdg, &newgap, &blendloc, &_nb, &stat);
+  xdg = xfoilData();
+  xfoil_set_buffer_airfoil(xdg, _xb.data(), _zb.data(), &_nb);
+  xfoil_modify_tegap(xdg, &newgap, &blendloc, &_nb, &stat);
   if (stat != 0)
   {
     conditional_stop(1, "Airfoil::modifyTEGap", "TE gap modification failed.");
     return 3;
   }
+  _xb.resize(_nb);
+  _zb.resize(_nb);
+  for ( i = 0; i < _nb; i++ )
+  {
+    _xb[i] = xdg->xfd.XB[i];
+    _zb[i] = xdg->xfd.YB[i];
+  }
+  _xfoil_paneled = false;
 
   return 0;
 }
@@ -647,8 +810,8 @@ void Airfoil::bufferCoordinates ( std::vector<double> & xb,
   zb.resize(_nb);
   for ( i = 0; i < _nb; i++ )
   {
-    xb[i] = _xdg.xfd.XB[i];
-    zb[i] = _xdg.xfd.YB[i];
+    xb[i] = _xb[i];
+    zb[i] = _zb[i];
   }
 }
 
@@ -665,12 +828,12 @@ void Airfoil::smoothedCoordinates ( std::vector<double> & x,
   }
 #endif
 
-  x.resize(_n);
-  z.resize(_n);
-  for ( i = 0; i < _n; i++ )
+  x.resize(_x.size());
+  z.resize(_z.size());
+  for ( i = 0; i < int(_x.size()); i++ )
   {
-    x[i] = _xdg.xfd.X[i];
-    z[i] = _xdg.xfd.Y[i];
+    x[i] = _x[i];
+    z[i] = _z[i];
   }
 }
 
@@ -681,7 +844,9 @@ void Airfoil::smoothedCoordinates ( std::vector<double> & x,
 /******************************************************************************/
 void Airfoil::setReynoldsNumber ( const double & re )
 {
-  xfoil_set_reynolds_number(&_xdg, &re);
+  _re = re;
+  if (_xdg)
+    xfoil_set_reynolds_number(_xdg, &_re);
 }
 
 /******************************************************************************/
@@ -691,22 +856,32 @@ void Airfoil::setReynoldsNumber ( const double & re )
 /******************************************************************************/
 void Airfoil::setMachNumber ( const double & mach )
 {
-  xfoil_set_mach_number(&_xdg, &mach);
+  _mach = mach;
+  if (_xdg)
+    xfoil_set_mach_number(_xdg, &_mach);
 }
 
 /******************************************************************************/
 //
-// Run Xfoil at specified lift coefficient
+// Run Xfoil at specified lift coefficient. Sets up Xfoil paneling first if
+// needed.
 // stat: 0 for success, 1 if convergence failed
 //
 /******************************************************************************/
 int Airfoil::runXfoil ( const double & clspec )
 {
-  double alpha, cl, cd, cm;
+  double alpha;
   bool converged;
   int stat;
   
-  xfoil_speccl(&_xdg, &clspec, &alpha, &cl, &cd, &cm, &converged, &stat);
+  xfoilData();
+  if (! _xfoil_paneled)
+  {
+    if (smoothPaneling() != 0)
+      return 1;
+  }
+  xfoil_speccl(_xdg, &clspec, &alpha, &_cl, &_cd, &_cm, &converged, &stat);
+  _xfoil_bl = true;
   if (converged)
     return 0;
   else
@@ -718,19 +893,17 @@ int Airfoil::runXfoil ( const double & clspec )
 // Aerodynamic coefficients from Xfoil
 //
 /******************************************************************************/
-const double & Airfoil::liftCoefficient () const { return _xdg.xfd.CL; }
-const double & Airfoil::dragCoefficient () const { return _xdg.xfd.CD; }
-const double & Airfoil::pitchingMomentCoefficient () const
-{
-	return _xdg.xfd.CM;
-}
+const double & Airfoil::liftCoefficient () const { return _cl; }
+const double & Airfoil::dragCoefficient () const { return _cd; }
+const double & Airfoil::pitchingMomentCoefficient () const { return _cm; }
 
 /******************************************************************************/
 //
 // Returns BL data from Xfoil at current airfoil coordinates. Possible values
 // of varname include: cp, cf, uedge, deltastar, ampl. Output vector has
 // dimension nSmoothed.
-// stat: 0 on success, 1 for unrecognized varname
+// stat: 0 on success, 1 for unrecognized varname, 2 if Xfoil data has not
+//       been set up or was released
 //
 /******************************************************************************/
 std::vector<double> Airfoil::blData ( const std::string & varname,
@@ -741,18 +914,23 @@ std::vector<double> Airfoil::blData ( const std::string & varname,
 	int i;
 	
 	stat = 0;
+	if (! _xdg)
+	{
+		stat = 2;
+		return outvec;
+	}
 	if (varname == "cp")
-		xfoil_get_cp(&_xdg, &_n, buffer);
+		xfoil_get_cp(_xdg, &_n, buffer);
 	else if (varname == "cf")
-		xfoil_get_cf(&_xdg, &_n, buffer);
+		xfoil_get_cf(_xdg, &_n, buffer);
 	else if (varname == "deltastar")
-		xfoil_get_deltastar(&_xdg, &_n, buffer);
+		xfoil_get_deltastar(_xdg, &_n, buffer);
 	else if (varname == "ampl")
-		xfoil_get_ampl(&_xdg, &_n, buffer);
+		xfoil_get_ampl(_xdg, &_n, buffer);
 	else if (varname == "uedge")
-		xfoil_get_uedge(&_xdg, &_n, buffer);
+		xfoil_get_uedge(_xdg, &_n, buffer);
 	else if (varname == "cp2d")
-		xfoil_get_cp(&_xdg, &_n, buffer);
+		xfoil_get_cp(_xdg, &_n, buffer);
 	else
 	{
 #ifdef DEBUG
@@ -772,12 +950,51 @@ std::vector<double> Airfoil::blData ( const std::string & varname,
 	return outvec;
 }
 
+/******************************************************************************/
+//
+// Returns all BL data from Xfoil needed for viscous coupling at once, written
+// directly into the output buffers. surfdata holds cf, deltastar, ampl, uedge,
+// and cp at the nSmoothed airfoil points, one variable after the other.
+// wakedata holds x, z, deltastar, and uedge at nw wake points, in the same
+// layout. Buffers are only reallocated if their size changes.
+// Returns 0 on success or 2 if Xfoil data has not been set up or was
+// released, in which case the buffers are zeroed.
+//
+/******************************************************************************/
+int Airfoil::blState ( int nw, std::vector<double> & surfdata,
+                       std::vector<double> & wakedata ) const
+{
+	surfdata.resize(5*_n);
+	wakedata.resize(4*nw);
+	if (! _xdg)
+	{
+		std::fill(surfdata.begin(), surfdata.end(), 0.);
+		std::fill(wakedata.begin(), wakedata.end(), 0.);
+		return 2;
+	}
+
+	xfoil_get_cf(_xdg, &_n, &surfdata[0]);
+	xfoil_get_deltastar(_xdg, &_n, &surfdata[_n]);
+	xfoil_get_ampl(_xdg, &_n, &surfdata[2*_n]);
+	xfoil_get_uedge(_xdg, &_n, &surfdata[3*_n]);
+	xfoil_get_cp(_xdg, &_n, &surfdata[4*_n]);
+
+	if (nw > 0)
+	{
+		xfoil_get_wake_geometry(_xdg, &nw, &wakedata[0], &wakedata[nw]);
+		xfoil_get_wake_deltastar(_xdg, &nw, &wakedata[2*nw]);
+		xfoil_get_wake_uedge(_xdg, &nw, &wakedata[3*nw]);
+	}
+
+	return 0;
+}
+
 /******************************************************************************/
 //
 // Reinitializes Xfoil BL
 //
 /******************************************************************************/
-void Airfoil::reinitializeBL () { xfoil_reinitialize_bl(&_xdg); }
+void Airfoil::reinitializeBL () { xfoil_reinitialize_bl(xfoilData()); }
 
 /******************************************************************************/
 //
@@ -788,7 +1005,9 @@ int Airfoil::nWake () const
 {
 	int nwake;
 
-	xfoil_get_wakepoints(&_xdg, &nwake);
+	if (! _xdg)
+		return 0;
+	xfoil_get_wakepoints(_xdg, &nwake);
 	return nwake;
 }
 
@@ -798,7 +1017,7 @@ void Airfoil::wakeCoordinates ( int nw, std::vector<double> & xw,
 	int i;
 	double xwbuff[nw], zwbuff[nw];
 
-	xfoil_get_wake_geometry(&_xdg, &nw, xwbuff, zwbuff);
+	xfoil_get_wake_geometry(_xdg, &nw, xwbuff, zwbuff);
 	xw.resize(nw);
 	zw.resize(nw);
 	for ( i = 0; i < nw; i++ )
@@ -815,7 +1034,7 @@ std::vector<double> Airfoil::wakeSVector ( int nw ) const
 	double dx, dz;
 	std::vector<double> sw;
 
-	xfoil_get_wake_geometry(&_xdg, &nw, xwbuff, zwbuff);
+	xfoil_get_wake_geometry(_xdg, &nw, xwbuff, zwbuff);
 	sw.clear();
 	sw.resize(nw);
 	sw[0] = 0.;
@@ -835,7 +1054,7 @@ std::vector<double> Airfoil::wakeDeltastar ( int nw ) const
 	double dstar[nw];
 	std::vector<double> deltastar;
 
-	xfoil_get_wake_deltastar(&_xdg, &nw, dstar);
+	xfoil_get_wake_deltastar(_xdg, &nw, dstar);
 	deltastar.clear();
 	deltastar.resize(nw);
 	for ( i = 0; i < nw; i++ )
@@ -852,7 +1071,7 @@ std::vector<double> Airfoil::wakeUedge ( int nw ) const
 	double ue[nw];
 	std::vector<double> uedge;
 
-	xfoil_get_wake_uedge(&_xdg, &nw, ue);
+	xfoil_get_wake_uedge(_xdg, &nw, ue);
 	uedge.clear();
 	uedge.resize(nw);
 	for ( i = 0; i < nw; i++ )
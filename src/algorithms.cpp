@@ -6,14 +6,30 @@
 #include <cmath>
 #include <vector>
 #include <algorithm>	// min_element, max
+#include <map>
+#include <utility>	// pair
 #include "util.h"
 #include "sectional_object.h"
 #include "algorithms.h"
 
-// Global parameters for tanh spacing objective function
+// Memoized tanh spacing coefficients, shared by all threads
 
-unsigned int tanh_N;
-double tanh_slen, tanh_sp0, tanh_sp1;
+struct tanh_memo_key
+{
+  unsigned int n;
+  double lsp0, lsp1;    // Rounded log of normalized spacings
+
+  bool operator < ( const tanh_memo_key & key ) const
+  {
+    if (n != key.n)
+      return n < key.n;
+    else if (lsp0 != key.lsp0)
+      return lsp0 < key.lsp0;
+    else
+      return lsp1 < key.lsp1;
+  }
+};
+std::map<tanh_memo_key, std::pair<double,double> > tanh_memo;
 
 // Global parameters for conjugate gradient method
 
@@ -96,61 +112,99 @@ double phi5 ( unsigned int i, unsigned int N )
 
 /******************************************************************************/
 //
-// Computes stretching for tanh spacing function. Adds penatly for any panels
-// with length <= 0.
+// Sets up tanh spacing context. Sums of the polynomial basis functions are in
+// closed form, and since phi5(i,N) = phi4(N-i,N), a5sum = a4sum.
 //
 /******************************************************************************/
-double tanh_stretching ( const std::vector<double> & coef )
+void tanh_spacing_context::setup ( unsigned int n, const double & len,
+                                   const double & sp0in, const double & sp1in )
 {
-  unsigned int N, i;
-  double sp0, sp1, slen;
-  double a1, a2, a3, a4, a5;
-  double a1sum, a2sum, a3sum, a4sum, a5sum;
-  double dbleN, maxstretch, stretch, penaltyval, dm, dp;
-  std::vector<double> rhs(2, 0.);
-
-  // Set coefficients and other parameters
-
-  a4 = coef[0];
-  a5 = coef[1];
-  N = tanh_N;
-  sp0 = tanh_sp0;
-  sp1 = tanh_sp1;
-  slen = tanh_slen;
+  unsigned int i;
+  double dbleN;
 
-  // Solve for a1, a2, and a3 to satisfy constraints on slen, sp0, and sp1
+  N = n - 2;
+  slen = len;
+  sp0 = sp0in;
+  sp1 = sp1in;
 
-  a1 = sp0 - a4*phi4(0,N) - a5*phi5(0,N);
-  a1sum = 0.;
-  a2sum = 0.;
-  a3sum = 0.;
+  phi.resize(N+1);
   a4sum = 0.;
-  a5sum = 0.;
   for ( i = 0; i <= N; i++ )
   {
-    a1sum += 1.;
-    a2sum += double(i);
-    a3sum += std::pow(double(i),2.);
-    a4sum += phi4(i,N);
-    a5sum += phi5(i,N);
+    phi[i] = phi4(i,N);
+    a4sum += phi[i];
   }
+  a5sum = a4sum;
 
-  rhs[0] = sp1 - a1 - a4*phi4(N,N) - a5*phi5(N,N);
-  rhs[1] = slen - a1*a1sum - a4*a4sum - a5*a5sum;
   dbleN = double(N);
-  a3 = (rhs[1] - a2sum*rhs[0]/dbleN ) / (a3sum - a2sum*dbleN);
-  a2 = (rhs[0] - a3*std::pow(dbleN,2.)) / dbleN;
+  a1sum = dbleN + 1.;
+  a2sum = dbleN*(dbleN + 1.)/2.;
+  a3sum = dbleN*(dbleN + 1.)*(2.*dbleN + 1.)/6.;
+}
+
+/******************************************************************************/
+//
+// Solves for a1, a2, and a3 to satisfy constraints on slen, sp0, and sp1
+//
+/******************************************************************************/
+void tanh_spacing_context::coefficients ( const double & a4, const double & a5,
+                                          double & a1, double & a2,
+                                          double & a3 ) const
+{
+  double dbleN, rhs0, rhs1;
+
+  a1 = sp0 - a4*phi[0] - a5*phi[N];
+  rhs0 = sp1 - a1 - a4*phi[N] - a5*phi[0];
+  rhs1 = slen - a1*a1sum - a4*a4sum - a5*a5sum;
+  dbleN = double(N);
+  a3 = (rhs1 - a2sum*rhs0/dbleN ) / (a3sum - a2sum*dbleN);
+  a2 = (rhs0 - a3*dbleN*dbleN) / dbleN;
+}
+
+/******************************************************************************/
+//
+// Spacing at index i in [0, N] for given coefficients
+//
+/******************************************************************************/
+double tanh_spacing_context::spacing ( unsigned int i, const double & a1,
+                                       const double & a2, const double & a3,
+                                       const double & a4,
+                                       const double & a5 ) const
+{
+  double dblei;
+
+  dblei = double(i);
+  return a1 + a2*dblei + a3*dblei*dblei + a4*phi[i] + a5*phi[N-i];
+}
+
+/******************************************************************************/
+//
+// Computes stretching for tanh spacing function. Adds penatly for any panels
+// with length <= 0. data points to a tanh_spacing_context.
+//
+/******************************************************************************/
+double tanh_stretching ( const std::vector<double> & coef, void *data )
+{
+  const tanh_spacing_context *ctx;
+  unsigned int N, i;
+  double a1, a2, a3, a4, a5;
+  double maxstretch, stretch, penaltyval, dm, dp;
+
+  ctx = static_cast<const tanh_spacing_context *>(data);
+  N = ctx->N;
+  a4 = coef[0];
+  a5 = coef[1];
+  ctx->coefficients(a4, a5, a1, a2, a3);
 
   // Compute max stretching and add penalty for any panels with length <= 0
 
   maxstretch = 0.;
   penaltyval = 0.;
+  dp = ctx->spacing(0, a1, a2, a3, a4, a5);
   for ( i = 1; i <= N; i++ )
   {
-    dm = a1 + a2*double(i-1) + a3*std::pow(double(i-1),2.) + a4*phi4(i-1,N)
-       + a5*phi5(i-1,N);
-    dp = a1 + a2*double(i) + a3*std::pow(double(i),2.) + a4*phi4(i,N) +
-         a5*phi5(i,N);
+    dm = dp;
+    dp = ctx->spacing(i, a1, a2, a3, a4, a5);
     if (dm > dp)
       stretch = (dm - dp)/dp;
     else
@@ -172,40 +226,67 @@ double tanh_stretching ( const std::vector<double> & coef )
 // Computes tanh spacing coefficients a4 and a5 to minimize stretchting. See
 // tanh_spacing for description of inputs and outputs.
 //
+// The stretching is invariant to scaling, so the optimization is done for unit
+// length and a4 and a5 are scaled by slen afterwards. Results are memoized on
+// n and the normalized spacings sp0/slen and sp1/slen, rounded to a relative
+// tolerance, since most sections have nearly identical spacing parameters.
+// This routine is reentrant and may be called from parallel regions.
+//
 /******************************************************************************/
 void opt_tanh_spacing ( unsigned int n, const double & slen, const double & sp0,
                         const double & sp1, double & a4, double & a5 )
 {
   std::vector<double> optcoef, coef0;
-  double maxstretch;
+  double maxstretch, sp0n, sp1n;
   unsigned int steps, fevals;
   simplex_options_type searchopt;
-  double (*objfunc)(const std::vector<double> & x);
+  tanh_spacing_context ctx;
+  tanh_memo_key key;
+  std::map<tanh_memo_key, std::pair<double,double> >::const_iterator it;
+  bool found;
+  const double memotol = 1.E-06;
+
+  // Check for previously computed coefficients
+
+  sp0n = sp0 / slen;
+  sp1n = sp1 / slen;
+  key.n = n;
+  key.lsp0 = std::floor(std::log(sp0n)/memotol + 0.5);
+  key.lsp1 = std::floor(std::log(sp1n)/memotol + 0.5);
+  found = false;
+#pragma omp critical (tanh_memo)
+  {
+    it = tanh_memo.find(key);
+    if (it != tanh_memo.end())
+    {
+      a4 = it->second.first * slen;
+      a5 = it->second.second * slen;
+      found = true;
+    }
+  }
+  if (found)
+    return;
 
-  // Conjugate gradient search options
+  // Simplex search options
 
   searchopt.tol = 1.E-12;
   searchopt.maxit = 2000;
   searchopt.display_progress = false;
 
-  // Global parameters for tanh spacing
-
-  tanh_N = n - 2;
-  tanh_slen = slen;
-  tanh_sp0 = sp0;
-  tanh_sp1 = sp1;
-
-  // Compute optimal tanh spacing coefficients
+  // Compute optimal tanh spacing coefficients for unit length
 
+  ctx.setup(n, 1., sp0n, sp1n);
   optcoef.resize(2);
   coef0.resize(2);
   coef0[0] = 0.;
   coef0[1] = 0.;
-  objfunc = &tanh_stretching;
-  simplex_search(optcoef, maxstretch, steps, fevals, objfunc, coef0,
-                  searchopt);
-  a4 = optcoef[0];
-  a5 = optcoef[1];
+  simplex_search(optcoef, maxstretch, steps, fevals, &tanh_stretching,
+                 static_cast<void *>(&ctx), coef0, searchopt);
+  a4 = optcoef[0] * slen;
+  a5 = optcoef[1] * slen;
+
+#pragma omp critical (tanh_memo)
+  tanh_memo[key] = std::make_pair(optcoef[0], optcoef[1]);
 }  
 
 /******************************************************************************/
@@ -220,44 +301,46 @@ void opt_tanh_spacing ( unsigned int n, const double & slen, const double & sp0,
 //   slen: curve length
 //   s0, s1: initial and final spacings
 //
+// Use tanh_spacings to get all spacings at once, which avoids setting up the
+// basis functions for each index.
+//
 /******************************************************************************/
 double tanh_spacing ( unsigned int i, const double & a4, const double & a5,
                       unsigned int n, const double & slen, const double & sp0,
                       const double & sp1 )
 {
-  unsigned int N, j;
+  tanh_spacing_context ctx;
   double a1, a2, a3;
-  double a1sum, a2sum, a3sum, a4sum, a5sum;
-  double dbleN;
-  double rhs[2];
 
-  N = n - 2;
-  
-  // Solve for a1, a2, and a3 to satisfy constraints on slen, sp0, and sp1
+  ctx.setup(n, slen, sp0, sp1);
+  ctx.coefficients(a4, a5, a1, a2, a3);
 
-  a1 = sp0 - a4*phi4(0,N) - a5*phi5(0,N);
-  a1sum = 0.;
-  a2sum = 0.;
-  a3sum = 0.;
-  a4sum = 0.;
-  a5sum = 0.;
-  for ( j = 0; j <= N; j++ )
+  return ctx.spacing(i, a1, a2, a3, a4, a5);
+}
+
+/******************************************************************************/
+//
+// Computes all n-1 spacings of the tanh spacing function. Inputs are the same
+// as for tanh_spacing.
+//
+/******************************************************************************/
+std::vector<double> tanh_spacings ( const double & a4, const double & a5,
+                                    unsigned int n, const double & slen,
+                                    const double & sp0, const double & sp1 )
+{
+  tanh_spacing_context ctx;
+  double a1, a2, a3;
+  unsigned int i;
+  std::vector<double> space(n-1);
+
+  ctx.setup(n, slen, sp0, sp1);
+  ctx.coefficients(a4, a5, a1, a2, a3);
+  for ( i = 0; i < n-1; i++ )
   {
-    a1sum += 1.;
-    a2sum += double(j);
-    a3sum += std::pow(double(j),2.);
-    a4sum += phi4(j,N);
-    a5sum += phi5(j,N);
+    space[i] = ctx.spacing(i, a1, a2, a3, a4, a5);
   }
 
-  rhs[0] = sp1 - a1 - a4*phi4(N,N) - a5*phi5(N,N);
-  rhs[1] = slen - a1*a1sum - a4*a4sum - a5*a5sum;
-  dbleN = double(N);
-  a3 = (rhs[1] - a2sum*rhs[0]/dbleN ) / (a3sum - a2sum*dbleN);
-  a2 = (rhs[0] - a3*std::pow(dbleN,2.)) / dbleN;
-
-  return a1 + a2*double(i) + a3*std::pow(double(i),2.) + a4*phi4(i,N) +
-         a5*phi5(i,N);
+  return space;
 }
 
 /******************************************************************************/
@@ -340,13 +423,15 @@ void sort_designs ( std::vector<std::vector<double> > & dv,
 
 /******************************************************************************/
 //
-// Nelder-Mead simplex search algorithm
+// Nelder-Mead simplex search algorithm. objdata is passed through to the
+// objective function, so that it does not need to rely on global data.
 //
 /******************************************************************************/
 void simplex_search ( std::vector<double> & xopt, double & fmin,
                       unsigned int & nsteps, unsigned int & fevals,
-                      double (*objfunc)(const std::vector<double> & x),
-                      const std::vector<double> & x0,
+                      double (*objfunc)(const std::vector<double> & x,
+                                        void *data),
+                      void *objdata, const std::vector<double> & x0,
                       const simplex_options_type & searchopt )
 {
   std::vector<std::vector<double> > dv;
@@ -395,11 +480,11 @@ void simplex_search ( std::vector<double> & xopt, double & fmin,
       else
         dv[j][i] = x0[i];
     }
-    objvals[j] = objfunc(dv[j]);
+    objvals[j] = objfunc(dv[j], objdata);
     fevals += 1;
   } 
   dv[nvars] = x0;
-  objvals[nvars] = objfunc(x0);
+  objvals[nvars] = objfunc(x0, objdata);
   fevals += 1;
   fmin = vector_min(objvals);
 
@@ -464,7 +549,7 @@ void simplex_search ( std::vector<double> & xopt, double & fmin,
     {
       xr[i] = (1.+rho)*xcen[i] - rho*dv[nvars][i];
     }
-    fr = objfunc(xr);
+    fr = objfunc(xr, objdata);
     fevals += 1;
 
     if ( (objvals[0] <= fr) && (fr < objvals[nvars-1]) )
@@ -483,7 +568,7 @@ void simplex_search ( std::vector<double> & xopt, double & fmin,
       {
         xe[i] = (1.+rho*xi)*xcen[i] - rho*xi*dv[nvars][i];
       }
-      fe = objfunc(xe);
+      fe = objfunc(xe, objdata);
       fevals += 1;
       if (fe < fr)
       {
@@ -507,7 +592,7 @@ void simplex_search ( std::vector<double> & xopt, double & fmin,
         {
           xc[i] = (1.+rho*gam)*xcen[i] - rho*gam*dv[nvars][i];
         }
-        fc = objfunc(xc);
+        fc = objfunc(xc, objdata);
         fevals += 1;
 
         if (fc < objvals[nvars])
@@ -527,7 +612,7 @@ void simplex_search ( std::vector<double> & xopt, double & fmin,
         {
           xc[i] = (1.-gam)*xcen[i] + gam*dv[nvars][i];
         }
-        fc = objfunc(xc);
+        fc = objfunc(xc, objdata);
         fevals += 1;
 
         if (fc < objvals[nvars])
@@ -550,7 +635,7 @@ void simplex_search ( std::vector<double> & xopt, double & fmin,
           {
             dv[j][i] = dv[j][0] + sigma*(dv[j][i] - dv[j][0]);
           }
-          objvals[j] = objfunc(dv[j]);
+          objvals[j] = objfunc(dv[j], objdata);
           fevals += 1;
         }
         continue;
@@ -585,6 +670,29 @@ void simplex_search ( std::vector<double> & xopt, double & fmin,
     print_warning("simplex_search", "Max number of iterations was reached.");
 }
 
+/******************************************************************************/
+//
+// Nelder-Mead simplex search for objective functions without extra data
+//
+/******************************************************************************/
+double call_objfunc ( const std::vector<double> & x, void *data )
+{
+  double (**objfunc)(const std::vector<double> & x);
+
+  objfunc = static_cast<double (**)(const std::vector<double> & x)>(data);
+  return (*objfunc)(x);
+}
+
+void simplex_search ( std::vector<double> & xopt, double & fmin,
+                      unsigned int & nsteps, unsigned int & fevals,
+                      double (*objfunc)(const std::vector<double> & x),
+                      const std::vector<double> & x0,
+                      const simplex_options_type & searchopt )
+{
+  simplex_search(xopt, fmin, nsteps, fevals, &call_objfunc,
+                 static_cast<void *>(&objfunc), x0, searchopt);
+}
+
 /******************************************************************************/
 //
 // Sorts sections based on y
@@ -898,3 +1006,154 @@ double centered_difference ( const double & yp1, const double & y0,
 
   return b;
 }
+
+/******************************************************************************/
+//
+// Restarted GMRES for a linear system given only by matrix-vector products.
+// x is the initial guess on input and the solution on output. Returns the
+// number of matrix-vector products (not counting restarts) and the final
+// relative residual.
+//
+/******************************************************************************/
+void gmres ( std::vector<double> & x, const std::vector<double> & b,
+             void (*matvec)(const std::vector<double> & x,
+                            std::vector<double> & y, void *data),
+             void *data, const gmres_options_type & opts,
+             unsigned int & iters, double & resid )
+{
+  unsigned int i, j, k, n, m, nk;
+  double bnorm, beta, wnorm, temp, denom;
+  std::vector<std::vector<double> > v, h;
+  std::vector<double> w, g, c, s, y;
+
+  n = b.size();
+  m = opts.restart;
+  iters = 0;
+
+#ifdef DEBUG
+  if (x.size() != n)
+    conditional_stop(1, "gmres", "Mismatch in size of x and b.");
+#endif
+
+  bnorm = 0.;
+  for ( i = 0; i < n; i++ )
+  {
+    bnorm += b[i]*b[i];
+  }
+  bnorm = std::sqrt(bnorm);
+  if (bnorm == 0.)
+  {
+    std::fill(x.begin(), x.end(), 0.);
+    resid = 0.;
+    return;
+  }
+
+  v.resize(m+1, std::vector<double>(n));
+  h.resize(m+1, std::vector<double>(m));
+  w.resize(n);
+  g.resize(m+1);
+  c.resize(m);
+  s.resize(m);
+  y.resize(m);
+
+  while (true)
+  {
+    // Residual of the current solution
+
+    matvec(x, w, data);
+    beta = 0.;
+    for ( i = 0; i < n; i++ )
+    {
+      w[i] = b[i] - w[i];
+      beta += w[i]*w[i];
+    }
+    beta = std::sqrt(beta);
+    resid = beta / bnorm;
+    if ( (resid <= opts.tol) || (iters >= opts.maxit) )
+      return;
+
+    for ( i = 0; i < n; i++ )
+    {
+      v[0][i] = w[i] / beta;
+    }
+    std::fill(g.begin(), g.end(), 0.);
+    g[0] = beta;
+
+    // Arnoldi iterations with modified Gram-Schmidt, using Givens rotations
+    // to keep the Hessenberg matrix upper triangular
+
+    nk = 0;
+    for ( k = 0; k < m; k++ )
+    {
+      matvec(v[k], w, data);
+      iters++;
+      for ( j = 0; j <= k; j++ )
+      {
+        h[j][k] = 0.;
+        for ( i = 0; i < n; i++ )
+        {
+          h[j][k] += w[i]*v[j][i];
+        }
+        for ( i = 0; i < n; i++ )
+        {
+          w[i] -= h[j][k]*v[j][i];
+        }
+      }
+      wnorm = 0.;
+      for ( i = 0; i < n; i++ )
+      {
+        wnorm += w[i]*w[i];
+      }
+      wnorm = std::sqrt(wnorm);
+      h[k+1][k] = wnorm;
+      if (wnorm > 0.)
+      {
+        for ( i = 0; i < n; i++ )
+        {
+          v[k+1][i] = w[i] / wnorm;
+        }
+      }
+
+      for ( j = 0; j < k; j++ )
+      {
+        temp = c[j]*h[j][k] + s[j]*h[j+1][k];
+        h[j+1][k] = -s[j]*h[j][k] + c[j]*h[j+1][k];
+        h[j][k] = temp;
+      }
+      denom = std::sqrt(h[k][k]*h[k][k] + h[k+1][k]*h[k+1][k]);
+      c[k] = h[k][k] / denom;
+      s[k] = h[k+1][k] / denom;
+      h[k][k] = denom;
+      h[k+1][k] = 0.;
+      g[k+1] = -s[k]*g[k];
+      g[k] = c[k]*g[k];
+
+      nk = k+1;
+      resid = std::abs(g[k+1]) / bnorm;
+      if ( (resid <= opts.tol) || (iters >= opts.maxit) || (wnorm == 0.) )
+        break;
+    }
+
+    // Update solution with least squares solution in the Krylov basis
+
+    for ( j = nk; j-- > 0; )
+    {
+      y[j] = g[j];
+      for ( k = j+1; k < nk; k++ )
+      {
+        y[j] -= h[j][k]*y[k];
+      }
+      y[j] /= h[j][j];
+    }
+    for ( j = 0; j < nk; j++ )
+    {
+      for ( i = 0; i < n; i++ )
+      {
+        x[i] += y[j]*v[j][i];
+      }
+    }
+
+    if ( (resid <= opts.tol) || (iters >= opts.maxit) )
+      return;
+  }
+}
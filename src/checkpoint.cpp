@@ -0,0 +1,276 @@
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <stdint.h>
+#ifndef ISMINGW
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+#include "util.h"
+#include "checkpoint.h"
+
+/******************************************************************************/
+//
+// Checkpoint class. Stores named arrays of doubles in a versioned binary file
+// that can be memory-mapped for reading. The layout (native byte order) is:
+//
+//   char[8]   "LXCHKPT"
+//   uint32    format version
+//   uint32    byte order check (0x01020304)
+//   uint64    number of arrays
+//   for each array:
+//     char[48] name (null-terminated)
+//     uint64   offset of data from start of file
+//     uint64   number of values
+//   float64   data of each array, 8-byte aligned
+//
+/******************************************************************************/
+
+const uint32_t Checkpoint::version;
+const uint32_t checkpoint_order = 0x01020304;
+const unsigned int checkpoint_namelen = 48;
+
+/******************************************************************************/
+//
+// Default constructor and destructor
+//
+/******************************************************************************/
+Checkpoint::Checkpoint ()
+{
+    _names.resize(0);
+    _arrays.resize(0);
+    _buf = NULL;
+    _bufsize = 0;
+    _mapped = false;
+    _readbuf.resize(0);
+}
+
+Checkpoint::~Checkpoint () { close(); }
+
+/******************************************************************************/
+//
+// Adds an array to be written
+//
+/******************************************************************************/
+void Checkpoint::addArray ( const std::string & name,
+                            const std::vector<double> & data )
+{
+    if (name.size() >= checkpoint_namelen)
+        conditional_stop(1, "Checkpoint::addArray",
+                         "Array name " + name + " is too long.");
+
+    _names.push_back(name);
+    _arrays.push_back(data);
+}
+
+/******************************************************************************/
+//
+// Writes all added arrays
+//
+/******************************************************************************/
+int Checkpoint::write ( const std::string & fname ) const
+{
+    std::ofstream f;
+    std::string tmpname;
+    unsigned int i, narrays;
+    uint64_t offset, count, nval;
+    char name[checkpoint_namelen];
+
+    tmpname = fname + ".tmp";
+    f.open(tmpname.c_str(), std::fstream::out | std::fstream::binary);
+    if (! f.is_open())
+    {
+        print_warning("Checkpoint::write",
+                      "Unable to open " + tmpname + " for writing.");
+        return 1;
+    }
+
+    // Header and array table. The header is 24 bytes and each table entry is
+    // 64 bytes, so data starts 8-byte aligned.
+
+    narrays = _names.size();
+    nval = narrays;
+    f.write("LXCHKPT", 8);
+    f.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    f.write(reinterpret_cast<const char *>(&checkpoint_order),
+            sizeof(checkpoint_order));
+    f.write(reinterpret_cast<const char *>(&nval), sizeof(nval));
+
+    offset = 24 + uint64_t(narrays)*(checkpoint_namelen + 16);
+    for ( i = 0; i < narrays; i++ )
+    {
+        std::memset(name, 0, checkpoint_namelen);
+        std::strncpy(name, _names[i].c_str(), checkpoint_namelen-1);
+        count = _arrays[i].size();
+        f.write(name, checkpoint_namelen);
+        f.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+        f.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        offset += count*sizeof(double);
+    }
+
+    // Data
+
+    for ( i = 0; i < narrays; i++ )
+    {
+        if (_arrays[i].size() > 0)
+            f.write(reinterpret_cast<const char *>(&_arrays[i][0]),
+                    _arrays[i].size()*sizeof(double));
+    }
+    f.close();
+    if (! f)
+    {
+        print_warning("Checkpoint::write", "Error writing " + tmpname + ".");
+        return 1;
+    }
+
+    if (std::rename(tmpname.c_str(), fname.c_str()) != 0)
+    {
+        print_warning("Checkpoint::write",
+                      "Unable to rename " + tmpname + " to " + fname + ".");
+        return 1;
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Opens and validates a checkpoint file
+//
+/******************************************************************************/
+int Checkpoint::open ( const std::string & fname )
+{
+    uint32_t fileversion, order;
+    uint64_t narrays, i, offset, count;
+
+    close();
+
+#ifndef ISMINGW
+    int fd;
+    struct stat st;
+    void *addr;
+
+    fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+        return 1;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return 1;
+    }
+    _bufsize = st.st_size;
+    addr = MAP_FAILED;
+    if (_bufsize > 0)
+        addr = mmap(NULL, _bufsize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        _bufsize = 0;
+        return 1;
+    }
+    _buf = static_cast<char *>(addr);
+    _mapped = true;
+#else
+    std::ifstream f;
+
+    f.open(fname.c_str(), std::fstream::in | std::fstream::binary);
+    if (! f.is_open())
+        return 1;
+    f.seekg(0, std::ios::end);
+    _bufsize = f.tellg();
+    f.seekg(0, std::ios::beg);
+    _readbuf.resize(_bufsize);
+    if (_bufsize > 0)
+        f.read(&_readbuf[0], _bufsize);
+    f.close();
+    if (_bufsize == 0)
+        return 1;
+    _buf = &_readbuf[0];
+    _mapped = false;
+#endif
+
+    // Check header
+
+    if ( (_bufsize < 24) || (std::strncmp(_buf, "LXCHKPT", 8) != 0) )
+    {
+        close();
+        return 2;
+    }
+    std::memcpy(&fileversion, _buf+8, sizeof(fileversion));
+    std::memcpy(&order, _buf+12, sizeof(order));
+    if ( (fileversion != version) || (order != checkpoint_order) )
+    {
+        close();
+        return 3;
+    }
+
+    // Check that the table and all arrays are within the file
+
+    std::memcpy(&narrays, _buf+16, sizeof(narrays));
+    if (24 + narrays*(checkpoint_namelen + 16) > _bufsize)
+    {
+        close();
+        return 2;
+    }
+    for ( i = 0; i < narrays; i++ )
+    {
+        std::memcpy(&offset, _buf+24+i*(checkpoint_namelen+16)+
+                    checkpoint_namelen, sizeof(offset));
+        std::memcpy(&count, _buf+24+i*(checkpoint_namelen+16)+
+                    checkpoint_namelen+8, sizeof(count));
+        if ( (offset % sizeof(double) != 0) ||
+             (offset + count*sizeof(double) > _bufsize) )
+        {
+            close();
+            return 2;
+        }
+    }
+
+    return 0;
+}
+
+void Checkpoint::close ()
+{
+#ifndef ISMINGW
+    if (_mapped)
+        munmap(_buf, _bufsize);
+#endif
+    _buf = NULL;
+    _bufsize = 0;
+    _mapped = false;
+    _readbuf.resize(0);
+}
+
+/******************************************************************************/
+//
+// Pointer to array in the opened file and its length
+//
+/******************************************************************************/
+const double * Checkpoint::array ( const std::string & name,
+                                   uint64_t & count ) const
+{
+    uint64_t narrays, i, offset;
+    const char *entry;
+
+    count = 0;
+    if (_buf == NULL)
+        return NULL;
+
+    std::memcpy(&narrays, _buf+16, sizeof(narrays));
+    for ( i = 0; i < narrays; i++ )
+    {
+        entry = _buf + 24 + i*(checkpoint_namelen+16);
+        if (name == std::string(entry, strnlen(entry, checkpoint_namelen)))
+        {
+            std::memcpy(&offset, entry+checkpoint_namelen, sizeof(offset));
+            std::memcpy(&count, entry+checkpoint_namelen+8, sizeof(count));
+            return reinterpret_cast<const double *>(_buf + offset);
+        }
+    }
+
+    return NULL;
+}
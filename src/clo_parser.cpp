@@ -29,6 +29,7 @@ CLOParser::CLOParser ()
 {
 	_argv_str.resize(0);
 	_input_file = "";
+	_restart_file = "";
 }
 
 /*******************************************************************************
@@ -53,7 +54,7 @@ int CLOParser::checkCLOs ( int argc, char *argv[], const std::string & version )
 		return 1;
 	}
 
-	// Check for --help or --version
+	// Check for --help, --version, or --restart, and read input file
 
 	i = 1;
 	while (i < argc)
@@ -68,12 +69,33 @@ int CLOParser::checkCLOs ( int argc, char *argv[], const std::string & version )
 			printVersion(version);
 			return -1;
 		}
+		else if ( (_argv_str[i] == "--restart") || (_argv_str[i] == "-r") )
+		{
+			if (i+1 >= argc)
+			{
+				print_warning("CLOParser::checkCLOs",
+				              "--restart requires a checkpoint file.");
+				return 1;
+			}
+			_restart_file = _argv_str[i+1];
+			i += 1;
+		}
+		else if (_input_file == "")
+			_input_file = _argv_str[i];
+		else
+		{
+			print_warning("CLOParser::checkCLOs",
+			              "Unrecognized argument " + _argv_str[i] + ".");
+			return 1;
+		}
 		i += 1;
 	}
 
-	// Read input file
-
-	_input_file = _argv_str[1];
+	if (_input_file == "")
+	{
+		printHelp();
+		return 1;
+	}
 
 	return 0;
 }
@@ -99,7 +121,8 @@ void CLOParser::printVersion ( const std::string & version ) const
 
 void CLOParser::printHelp () const
 {
-	std::cout << "Usage: loraax [-h] [-v] INPUTFILE" << std::endl;
+	std::cout << "Usage: loraax [-h] [-v] [-r CHECKPOINT] INPUTFILE"
+	          << std::endl;
 	std::cout << std::endl;
 	std::cout << "Required inputs:" << std::endl;
 	std::cout << "INPUTFILE                Perform analysis defined in XML "
@@ -108,6 +131,9 @@ void CLOParser::printHelp () const
 	          << std::endl;
 	std::cout << "  -v, --version          Display version number and exit"
 	          << std::endl;
+	std::cout << "  -r, --restart CHECKPOINT" << std::endl;
+	std::cout << "                         Resume analysis from checkpoint file"
+	          << std::endl;
 	std::cout << std::endl;
 	std::cout << "loraax home page: https://github.com/montagdude/loraax"
 	          << std::endl;
@@ -125,3 +151,4 @@ bool CLOParser::requestInputFile () const
 }
 
 const std::string & CLOParser::inputFile () const { return _input_file; }
+const std::string & CLOParser::restartFile () const { return _restart_file; }
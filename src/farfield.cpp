@@ -1,14 +1,17 @@
 #define _USE_MATH_DEFINES
 
 #include <vector>
+#include <string>
 #include <cmath>
 #include <Eigen/Core>
 #include <fstream>
 #include <iomanip>
 #include <algorithm>    // std::min
+#include <map>
 #include "util.h"
 #include "vertex.h"
 #include "quadpanel.h"
+#include "field_point.h"
 #include "farfield.h"
 
 /******************************************************************************/
@@ -25,14 +28,50 @@
 Farfield::Farfield ()
 {
     _rcore = 1e-8;
+    _nx = 0;
+    _ny = 0;
+    _nz = 0;
+    _cenx = 0.;
+    _ceny = 0.;
+    _cenz = 0.;
+    _lenx = 0.;
+    _leny = 0.;
+    _lenz = 0.;
+    _beta = 1.;
     _vertarray.resize(0);
     _quadarray.resize(0);
     _verts.resize(0);
     _quads.resize(0);
+    _quadcells.resize(0);
+    _maxlevel = 0;
+    _level = 0;
+    _reftol = 0.05;
+    _firstvertidx = 0;
+    _nextelemidx = 0;
+    _firstnewvert = 0;
+    _refverts.resize(0);
+    _refquads.resize(0);
+    _vertmap.clear();
+    _quadweights.resize(0);
+    _quadmomrate.resize(0);
+    _quadpforce.resize(0);
+    _facemomrate.resize(0);
+    _facepforce.resize(0);
     _momrate << 0., 0., 0.;
     _pforce << 0., 0., 0.;
 }
 
+/******************************************************************************/
+//
+// Adaptive refinement settings. Must be called before initialize.
+//
+/******************************************************************************/
+void Farfield::setRefinement ( unsigned int maxlevel, const double & tol )
+{
+    _maxlevel = maxlevel;
+    _reftol = tol;
+}
+
 /******************************************************************************/
 //
 // Create farfield box
@@ -45,14 +84,30 @@ void Farfield::initialize ( unsigned int nx, unsigned int ny, unsigned int nz,
                             const double & minf, int & next_global_vertidx,
                             int & next_global_elemidx )
 {
-    unsigned int i, j, k;
+    unsigned int i, j, k, nquads, scale;
     double beta, x, y, z, dx, dy, dz;
-
+    facecell cell;
+
+    _nx = nx;
+    _ny = ny;
+    _nz = nz;
+    _cenx = cenx;
+    _ceny = ceny;
+    _cenz = cenz;
+    _lenx = lenx;
+    _leny = leny;
+    _lenz = lenz;
+
+    // Vortex core size is based on the finest spacing that refinement can
+    // produce
+
+    scale = 1u << _maxlevel;
     dx = lenx / double(nx-1);
     dy = leny / double(ny-1);
     dz = lenz / double(nz-1);
-    _rcore = 0.2*std::min(dy, dz);
+    _rcore = 0.2*std::min(dy, dz)/double(scale);
     beta = std::sqrt(1. - std::pow(minf, 2.));
+    _beta = beta;
 
     // Set up arrays. Each array has indices face, i, j. There are 6 faces, and
     // i and j go from 0 to nx, ny, or nz.
@@ -253,8 +308,9 @@ void Farfield::initialize ( unsigned int nx, unsigned int ny, unsigned int nz,
         }
     }
 
-    // Store pointers to vertices and quads
+    // Store pointers to vertices and quads, and lattice locations
 
+    _firstvertidx = _vertarray[0][0][0].idx();
     for ( k = 0; k < 6; k++ )
     {
         for ( i = 0; i < _vertarray[k].size(); i++ )
@@ -262,6 +318,8 @@ void Farfield::initialize ( unsigned int nx, unsigned int ny, unsigned int nz,
             for ( j = 0; j < _vertarray[k][i].size(); j++ )
             {
                 _verts.push_back(&_vertarray[k][i][j]);
+                _vertmap[latticeKey(k, i*scale, j*scale)] =
+                                                        &_vertarray[k][i][j];
             }
         }
     }
@@ -272,9 +330,177 @@ void Farfield::initialize ( unsigned int nx, unsigned int ny, unsigned int nz,
             for ( j = 0; j < _quadarray[k][i].size(); j++ )
             {
                 _quads.push_back(&_quadarray[k][i][j]);
+                cell.face = k;
+                cell.i = i*scale;
+                cell.j = j*scale;
+                cell.size = scale;
+                cell.level = 0;
+                _quadcells.push_back(cell);
             }
         }
     }
+    _nextelemidx = next_global_elemidx;
+
+    // Storage for refinement levels. Sized once so that pointers to refined
+    // vertices and quads stay valid.
+
+    _level = 0;
+    _firstnewvert = 0;
+    _refverts.resize(_maxlevel);
+    _refquads.resize(_maxlevel);
+
+    computeQuadWeights();
+
+    nquads = _quads.size();
+    _quadmomrate.resize(nquads);
+    _quadpforce.resize(nquads);
+    _facemomrate.resize(6);
+    _facepforce.resize(6);
+    for ( k = 0; k < 6; k++ )
+    {
+        _facemomrate[k] << 0., 0., 0.;
+        _facepforce[k] << 0., 0., 0.;
+    }
+}
+
+/******************************************************************************/
+//
+// Lattice helpers. Each face has a structured lattice at the finest spacing
+// that refinement can produce; i and j follow the same directions as the
+// indices of _vertarray for that face.
+//
+/******************************************************************************/
+unsigned long long Farfield::latticeKey ( unsigned int face, unsigned int i,
+                                          unsigned int j ) const
+{
+    unsigned long long npts;
+
+    npts = (unsigned long long)(std::max(std::max(_nx, _ny), _nz)-1)
+         * (1ull << _maxlevel) + 1;
+
+    return (face*npts + i)*npts + j;
+}
+
+void Farfield::latticeCoordinates ( unsigned int face, unsigned int i,
+                                    unsigned int j, double & x, double & y,
+                                    double & z ) const
+{
+    double scale, dx, dy, dz;
+
+    scale = double(1u << _maxlevel);
+    dx = _lenx / double(_nx-1) / scale;
+    dy = _leny / double(_ny-1) / scale;
+    dz = _lenz / double(_nz-1) / scale;
+
+    if (face < 2)
+    {
+        x = _cenx - _lenx/2. + double(i)*dx;
+        y = face == 0 ? _ceny - _leny/2. : _ceny + _leny/2.;
+        z = _cenz + _lenz/2. - double(j)*dz;
+    }
+    else if (face < 4)
+    {
+        x = face == 2 ? _cenx - _lenx/2. : _cenx + _lenx/2.;
+        y = _ceny - _leny/2. + double(i)*dy;
+        z = _cenz + _lenz/2. - double(j)*dz;
+    }
+    else
+    {
+        x = _cenx - _lenx/2. + double(i)*dx;
+        y = _ceny - _leny/2. + double(j)*dy;
+        z = face == 4 ? _cenz + _lenz/2. : _cenz - _lenz/2.;
+    }
+}
+
+void Farfield::latticePosition ( unsigned int face, const double & x,
+                                 const double & y, const double & z, double & i,
+                                 double & j ) const
+{
+    double scale, dx, dy, dz;
+
+    scale = double(1u << _maxlevel);
+    dx = _lenx / double(_nx-1) / scale;
+    dy = _leny / double(_ny-1) / scale;
+    dz = _lenz / double(_nz-1) / scale;
+
+    if (face < 2)
+    {
+        i = (x - (_cenx - _lenx/2.)) / dx;
+        j = (_cenz + _lenz/2. - z) / dz;
+    }
+    else if (face < 4)
+    {
+        i = (y - (_ceny - _leny/2.)) / dy;
+        j = (_cenz + _lenz/2. - z) / dz;
+    }
+    else
+    {
+        i = (x - (_cenx - _lenx/2.)) / dx;
+        j = (y - (_ceny - _leny/2.)) / dy;
+    }
+}
+
+/******************************************************************************/
+//
+// Sets vertices of a quad from its lattice corners (i,j), (i,j+1), (i+1,j+1),
+// (i+1,j), ordered so that the normal points out of the volume
+//
+/******************************************************************************/
+void Farfield::setFaceQuad ( QuadPanel & quad, unsigned int face, Vertex * v00,
+                             Vertex * v01, Vertex * v11, Vertex * v10,
+                             bool ref_element_to_vert )
+{
+    if ( (face == 0) || (face == 3) || (face == 5) )
+    {
+        quad.addVertex(v00, ref_element_to_vert);
+        quad.addVertex(v01, ref_element_to_vert);
+        quad.addVertex(v11, ref_element_to_vert);
+        quad.addVertex(v10, ref_element_to_vert);
+    }
+    else
+    {
+        quad.addVertex(v00, ref_element_to_vert);
+        quad.addVertex(v10, ref_element_to_vert);
+        quad.addVertex(v11, ref_element_to_vert);
+        quad.addVertex(v01, ref_element_to_vert);
+    }
+}
+
+/******************************************************************************/
+//
+// Inverse-distance weights used to interpolate vertex data to quad centroids.
+// The farfield box does not move, so these only change when quads are refined.
+//
+/******************************************************************************/
+void Farfield::computeQuadWeights ()
+{
+    unsigned int i, j, nquads, nverts;
+    double dx, dy, dz, dist, weightsum;
+    Eigen::Vector3d cen;
+
+    nquads = _quads.size();
+    _quadweights.resize(nquads);
+    for ( i = 0; i < nquads; i++ )
+    {
+        cen = _quads[i]->centroid();
+        nverts = _quads[i]->nVertices();
+        _quadweights[i].resize(nverts);
+        weightsum = 0.;
+        for ( j = 0; j < nverts; j++ )
+        {
+            dx = _quads[i]->vertex(j).xInc() - cen(0);
+            dy = _quads[i]->vertex(j).yInc() - cen(1);
+            dz = _quads[i]->vertex(j).zInc() - cen(2);
+            dist = std::sqrt(std::pow(dx,2.) + std::pow(dy,2.)
+                 +           std::pow(dz,2.));
+            _quadweights[i][j] = 1./dist;
+            weightsum += 1./dist;
+        }
+        for ( j = 0; j < nverts; j++ )
+        {
+            _quadweights[i][j] /= weightsum;
+        }
+    }
 }
 
 /*******************************************************************************
@@ -313,156 +539,389 @@ incompressible coordinates. Compressible velocity is: V_c = (U_i/beta, V_i, W_i)
 void Farfield::computeVelocity ( const Eigen::Vector3d & uinfvec,
                                  const double & minf,
                                  const std::vector<Panel *> & allsurf,
-                                 const std::vector<Panel *> & allwake )
+                                 const std::vector<Panel *> & allwake,
+                                 bool new_only )
 {
-    unsigned int i, k, nverts, nsurfpan, nwakepan;
-    double beta, xinc, yinc, zinc;
-    Eigen::Vector3d vel, dvel, dvelcomp;
+    unsigned int i, nverts, start;
+    double beta;
 
     beta = std::sqrt(1. - std::pow(minf, 2.));
-    nsurfpan = allsurf.size();
-    nwakepan = allwake.size();
 
     nverts = nVerts();
-#pragma omp parallel for private(i,xinc,yinc,zinc,vel,k,dvel,dvelcomp)
-    for ( i = 0; i < nverts; i++ )
-    {
-        xinc = _verts[i]->xInc();
-        yinc = _verts[i]->yInc();
-        zinc = _verts[i]->zInc();
-        vel = uinfvec;
-        for ( k = 0; k < nsurfpan; k++ )
-        {
-            dvel = allsurf[k]->inducedVelocity(xinc, yinc, zinc, false, "top",
-                                               true);
-            dvelcomp << dvel(0)/beta, dvel(1), dvel(2);
-            vel += dvelcomp;
-        }
-        for ( k = 0; k < nwakepan; k++ )
-        {
-            dvel = allwake[k]->vortexVelocity(xinc, yinc, zinc, _rcore, true);
-            dvelcomp << dvel(0)/beta, dvel(1), dvel(2);
-            vel += dvelcomp;
-        }
-        _verts[i]->setData(2, vel(0));
-        _verts[i]->setData(3, vel(1));
-        _verts[i]->setData(4, vel(2));
+    start = new_only ? _firstnewvert : 0;
+#pragma omp parallel for private(i)
+    for ( i = start; i < nverts; i++ )
+    {
+        field_point_velocity(*_verts[i], uinfvec, beta, allsurf, allwake,
+                             _rcore);
     }
 }
 
 int Farfield::computePressure ( const double & uinf, const double & rhoinf,
-                                const double & pinf )
+                                const double & pinf, bool new_only )
 {
     int retval;
-    unsigned int i, nverts;
-    double uinf2, vel2, ainf2, qinf, cpinc, minf2, beta, p0, cp, p, m2, gamm1,
-           gamma, mach, rho0, rho;
-    Eigen::Vector3d vel;
-
-    uinf2 = std::pow(uinf, 2.);
-    qinf = 0.5*rhoinf*uinf2;
-    ainf2 = 1.4*pinf/rhoinf;
-    minf2 = uinf2/ainf2;
-    beta = std::sqrt(1. - minf2);
-    gamma = 1.4;
-    gamm1 = gamma - 1.;
+    unsigned int i, nverts, start;
+
     retval = 0;
 
     nverts = nVerts();
-#pragma omp parallel for private(i,vel,vel2,cpinc,cp,p,p0,m2,mach)
-    for ( i = 0; i < nverts; i++ )
+    start = new_only ? _firstnewvert : 0;
+#pragma omp parallel for private(i)
+    for ( i = start; i < nverts; i++ )
     {
-        vel << _verts[i]->data(2), _verts[i]->data(3), _verts[i]->data(4);
-        vel2 = vel.squaredNorm();
-        cpinc = 1. - vel2 / uinf2;
-
-        // Prandtl-Glauert compressibility correction for pressure
-  
-        cp = cpinc / beta;
-        p = cp*qinf + pinf;
-  
-        // Physical limits on pressure
-  
-        p0 = pinf * std::pow(1. + 0.5*gamm1*minf2, gamma/gamm1);
-        if (p > p0)
-        {
-            p = p0;
-            cp = (p - pinf) / qinf;
-        }
-  
-        // Use isentropic relations to get local Mach number
-  
-        m2 = 2./gamm1 * (std::pow(p0/p, gamm1/gamma) - 1.);
-        if (m2 > 1.0)
+        if (field_point_pressure(*_verts[i], uinf, rhoinf, pinf) != 0)
         {
             conditional_stop(1, "Farfield::computePressure",
                              "Locally supersonic flow detected.");
+#pragma omp atomic write
             retval = 1;
         }
-        mach = std::sqrt(m2);
-        rho0 = rhoinf * std::pow(1. + 0.5*gamm1*minf2, 1./gamm1);
-        rho = rho0 / std::pow(1. + 0.5*gamm1*m2, 1./gamm1);
-
-        _verts[i]->setData(5, p);
-        _verts[i]->setData(6, cp);
-        _verts[i]->setData(7, mach);
-        _verts[i]->setData(8, rho);
     }
   
     return retval;
 }
 
+/******************************************************************************/
+//
+// Points where wake panel edges cross each face of the box, in lattice
+// coordinates. Mirror images are included since the box spans both sides of
+// the symmetry plane.
+//
+/******************************************************************************/
+void Farfield::wakeCrossings ( const std::vector<Panel *> & allwake,
+                     std::vector< std::vector<Eigen::Vector2d> > & crossings
+                             ) const
+{
+    unsigned int i, j, k, m, nwakepan, nverts, axis;
+    double planeval, c1, c2, t, li, lj;
+    double planes[6];
+    Eigen::Vector3d p1, p2, pt;
+    Eigen::Vector2d latpt;
+
+    planes[0] = _ceny - _leny/2.;
+    planes[1] = _ceny + _leny/2.;
+    planes[2] = _cenx - _lenx/2.;
+    planes[3] = _cenx + _lenx/2.;
+    planes[4] = _cenz + _lenz/2.;
+    planes[5] = _cenz - _lenz/2.;
+
+    crossings.resize(6);
+    for ( k = 0; k < 6; k++ )
+    {
+        crossings[k].resize(0);
+    }
+
+    nwakepan = allwake.size();
+    for ( i = 0; i < nwakepan; i++ )
+    {
+        nverts = allwake[i]->nVertices();
+        for ( j = 0; j < nverts; j++ )
+        {
+            for ( m = 0; m < 2; m++ )
+            {
+                p1 << allwake[i]->vertex(j).x(), allwake[i]->vertex(j).y(),
+                      allwake[i]->vertex(j).z();
+                p2 << allwake[i]->vertex((j+1) % nverts).x(),
+                      allwake[i]->vertex((j+1) % nverts).y(),
+                      allwake[i]->vertex((j+1) % nverts).z();
+                if (m == 1)
+                {
+                    p1(1) = -p1(1);
+                    p2(1) = -p2(1);
+                }
+
+                for ( k = 0; k < 6; k++ )
+                {
+                    if (k < 2)
+                        axis = 1;
+                    else if (k < 4)
+                        axis = 0;
+                    else
+                        axis = 2;
+                    planeval = planes[k];
+                    c1 = p1(axis) - planeval;
+                    c2 = p2(axis) - planeval;
+                    if ( (c1*c2 > 0.) || (c1 == c2) )
+                        continue;
+
+                    t = c1 / (c1 - c2);
+                    pt = p1 + t*(p2 - p1);
+                    latticePosition(k, pt(0), pt(1), pt(2), li, lj);
+                    latpt << li, lj;
+                    crossings[k].push_back(latpt);
+                }
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Performs one level of adaptive refinement. A quad at the current level is
+// split into four if a wake panel edge crosses the face within half a quad
+// width of it, or if the momentum flux integrand rho*(V.n)*V + p*n varies
+// across its vertices by more than _reftol*rhoinf*uinf^2. Quads that are not
+// split keep their vertices, so only new vertices need velocity evaluations.
+// Returns the number of quads split.
+//
+/******************************************************************************/
+unsigned int Farfield::refine ( const std::vector<Panel *> & allwake,
+                                const double & rhoinf, const double & uinf )
+{
+    unsigned int i, j, k, a, b, nquads, nrefine, nnew, half, counter, nverts;
+    int flag;
+    unsigned long long key;
+    double fref, maxdev, x, y, z;
+    facecell cell, child;
+    Eigen::Vector3d vel, norm, fmean;
+    std::vector<Eigen::Vector3d> flux;
+    std::vector< std::vector<Eigen::Vector2d> > crossings;
+    std::vector<int> flags;
+    std::map<unsigned long long, unsigned int> newkeys;
+    std::vector<facecell> newpts, newcells;
+    std::vector<QuadPanel *> newquads;
+    std::map<unsigned long long, Vertex *>::const_iterator it;
+    Vertex *cverts[3][3];
+
+    if (_level >= _maxlevel)
+        return 0;
+
+    wakeCrossings(allwake, crossings);
+
+    // Flag quads at the current level for refinement
+
+    nquads = _quads.size();
+    flags.resize(nquads);
+    fref = rhoinf*std::pow(uinf, 2.);
+#pragma omp parallel for private(i,cell,flag,k,nverts,j,vel,norm,flux,fmean,\
+                                 maxdev)
+    for ( i = 0; i < nquads; i++ )
+    {
+        flags[i] = 0;
+        cell = _quadcells[i];
+        if (cell.level != _level)
+            continue;
+
+        // Wake crossing
+
+        flag = 0;
+        for ( k = 0; k < crossings[cell.face].size(); k++ )
+        {
+            if ( (crossings[cell.face][k](0) >= double(cell.i) -
+                                                0.5*double(cell.size)) &&
+                 (crossings[cell.face][k](0) <= double(cell.i) +
+                                                1.5*double(cell.size)) &&
+                 (crossings[cell.face][k](1) >= double(cell.j) -
+                                                0.5*double(cell.size)) &&
+                 (crossings[cell.face][k](1) <= double(cell.j) +
+                                                1.5*double(cell.size)) )
+            {
+                flag = 1;
+                break;
+            }
+        }
+
+        // Variation of momentum flux integrand across the quad
+
+        if (flag == 0)
+        {
+            nverts = _quads[i]->nVertices();
+            norm = _quads[i]->normalComp();
+            flux.resize(nverts);
+            fmean << 0., 0., 0.;
+            for ( j = 0; j < nverts; j++ )
+            {
+                vel << _quads[i]->vertex(j).data(2),
+                       _quads[i]->vertex(j).data(3),
+                       _quads[i]->vertex(j).data(4);
+                flux[j] = _quads[i]->vertex(j).data(8)*vel.dot(norm)*vel
+                        + _quads[i]->vertex(j).data(5)*norm;
+                fmean += flux[j] / double(nverts);
+            }
+            maxdev = 0.;
+            for ( j = 0; j < nverts; j++ )
+            {
+                maxdev = std::max(maxdev, (flux[j] - fmean).norm());
+            }
+            if (maxdev > _reftol*fref)
+                flag = 1;
+        }
+
+        flags[i] = flag;
+    }
+
+    nrefine = 0;
+    for ( i = 0; i < nquads; i++ )
+    {
+        nrefine += flags[i];
+    }
+    if (nrefine == 0)
+        return 0;
+
+    // Find lattice points that do not have a vertex yet, in a fixed order
+
+    for ( i = 0; i < nquads; i++ )
+    {
+        if (flags[i] == 0)
+            continue;
+
+        cell = _quadcells[i];
+        half = cell.size/2;
+        for ( a = 0; a < 3; a++ )
+        {
+            for ( b = 0; b < 3; b++ )
+            {
+                key = latticeKey(cell.face, cell.i+a*half, cell.j+b*half);
+                if ( (_vertmap.find(key) == _vertmap.end()) &&
+                     (newkeys.find(key) == newkeys.end()) )
+                {
+                    newkeys[key] = newpts.size();
+                    child.face = cell.face;
+                    child.i = cell.i+a*half;
+                    child.j = cell.j+b*half;
+                    newpts.push_back(child);
+                }
+            }
+        }
+    }
+
+    // Create new vertices. Indices continue from the base box so that they
+    // remain offsets into _verts.
+
+    nnew = newpts.size();
+    _firstnewvert = _verts.size();
+    _refverts[_level].resize(nnew);
+    for ( i = 0; i < nnew; i++ )
+    {
+        latticeCoordinates(newpts[i].face, newpts[i].i, newpts[i].j, x, y, z);
+        _refverts[_level][i].setIdx(_firstvertidx + int(_verts.size()));
+        _refverts[_level][i].setCoordinates(x, y, z);
+        _refverts[_level][i].setIncompressibleCoordinates(x/_beta, y, z);
+        _verts.push_back(&_refverts[_level][i]);
+        _vertmap[latticeKey(newpts[i].face, newpts[i].i, newpts[i].j)] =
+                                                        &_refverts[_level][i];
+    }
+
+    // Replace split quads by their children, in place, so that the ordering of
+    // quads is independent of the number of threads
+
+    _refquads[_level].resize(4*nrefine);
+    counter = 0;
+    for ( i = 0; i < nquads; i++ )
+    {
+        if (flags[i] == 0)
+        {
+            newquads.push_back(_quads[i]);
+            newcells.push_back(_quadcells[i]);
+            continue;
+        }
+
+        cell = _quadcells[i];
+        half = cell.size/2;
+        for ( a = 0; a < 3; a++ )
+        {
+            for ( b = 0; b < 3; b++ )
+            {
+                it = _vertmap.find(latticeKey(cell.face, cell.i+a*half,
+                                              cell.j+b*half));
+                cverts[a][b] = it->second;
+            }
+        }
+        for ( a = 0; a < 2; a++ )
+        {
+            for ( b = 0; b < 2; b++ )
+            {
+                _refquads[_level][counter].setIdx(_nextelemidx);
+                setFaceQuad(_refquads[_level][counter], cell.face,
+                            cverts[a][b], cverts[a][b+1], cverts[a+1][b+1],
+                            cverts[a+1][b], false);
+                _nextelemidx += 1;
+
+                child.face = cell.face;
+                child.i = cell.i+a*half;
+                child.j = cell.j+b*half;
+                child.size = half;
+                child.level = cell.level+1;
+                newquads.push_back(&_refquads[_level][counter]);
+                newcells.push_back(child);
+                counter += 1;
+            }
+        }
+    }
+    _quads = newquads;
+    _quadcells = newcells;
+    _level += 1;
+
+    computeQuadWeights();
+    nquads = _quads.size();
+    _quadmomrate.resize(nquads);
+    _quadpforce.resize(nquads);
+
+    return nrefine;
+}
+
 /*******************************************************************************
 
 Computes force on fluid inside control volume (rate of change of momentum).
 Also computes pressure force on fluid due to outer boundary. Inviscid aero force
 acting on aircraft is _pforce - _momrate.
 
+Contributions are first stored per quad and then summed serially, face by face,
+in a fixed order. This avoids a critical section in the parallel loop and makes
+the result independent of the number of threads.
+
 *******************************************************************************/
 void Farfield::computeForce ( const double & alpha, const double & rhoinf,
                               const double & uinf, const double & sref )
 {
-    unsigned int i, j, nquads, nverts;
-    Eigen::Vector3d vel, cen, liftdir, dragdir;
-    double dx, dy, dz, dist, p, rho, weightsum, qinf;
+    unsigned int i, j, k, nquads, nverts;
+    Eigen::Vector3d vel, liftdir, dragdir;
+    double p, rho, weight, qinf;
 
-    _momrate << 0., 0., 0.;
-    _pforce << 0., 0., 0.;
+    // Per-quad contributions
 
     nquads = _quads.size();
-#pragma omp parallel for private(i,cen,vel,p,rho,weightsum,nverts,j,dx,dy,dz,\
-                                 dist)
+#pragma omp parallel for private(i,vel,p,rho,nverts,j,weight)
     for ( i = 0; i < nquads; i++ )
     {
-        cen = _quads[i]->centroid();
         vel << 0., 0., 0.;
         p = 0.;
         rho = 0.;
-        weightsum = 0.;
         nverts = _quads[i]->nVertices();
         for ( j = 0; j < nverts; j++ )
         {
-            dx = _quads[i]->vertex(j).xInc() - cen(0);
-            dy = _quads[i]->vertex(j).yInc() - cen(1);
-            dz = _quads[i]->vertex(j).zInc() - cen(2);
-            dist = std::sqrt(std::pow(dx,2.) + std::pow(dy,2.)
-                 +           std::pow(dz,2.));
-            vel(0) += _quads[i]->vertex(j).data(2)/dist;
-            vel(1) += _quads[i]->vertex(j).data(3)/dist;
-            vel(2) += _quads[i]->vertex(j).data(4)/dist;
-            p += _quads[i]->vertex(j).data(5)/dist;
-            rho += _quads[i]->vertex(j).data(8)/dist;
-            weightsum += 1./dist;
-        }
-        vel /= weightsum;
-        p /= weightsum;
-        rho /= weightsum;
-#pragma omp critical
-        {
-            _momrate += rho*vel.dot(_quads[i]->normalComp())*vel
-                     *  _quads[i]->areaComp();
-            _pforce -= p*_quads[i]->normalComp()*_quads[i]->areaComp();
+            weight = _quadweights[i][j];
+            vel(0) += _quads[i]->vertex(j).data(2)*weight;
+            vel(1) += _quads[i]->vertex(j).data(3)*weight;
+            vel(2) += _quads[i]->vertex(j).data(4)*weight;
+            p += _quads[i]->vertex(j).data(5)*weight;
+            rho += _quads[i]->vertex(j).data(8)*weight;
         }
+        _quadmomrate[i] = rho*vel.dot(_quads[i]->normalComp())*vel
+                        * _quads[i]->areaComp();
+        _quadpforce[i] = -p*_quads[i]->normalComp()*_quads[i]->areaComp();
+    }
+
+    // Deterministic reduction in the order quads are stored
+
+    for ( k = 0; k < 6; k++ )
+    {
+        _facemomrate[k] << 0., 0., 0.;
+        _facepforce[k] << 0., 0., 0.;
+    }
+    for ( i = 0; i < nquads; i++ )
+    {
+        _facemomrate[_quadcells[i].face] += _quadmomrate[i];
+        _facepforce[_quadcells[i].face] += _quadpforce[i];
+    }
+
+    _momrate << 0., 0., 0.;
+    _pforce << 0., 0., 0.;
+    for ( k = 0; k < 6; k++ )
+    {
+        _momrate += _facemomrate[k];
+        _pforce += _facepforce[k];
     }
 
     // Compute aero forces
@@ -485,8 +944,11 @@ void Farfield::computeForce ( const double & alpha, const double & rhoinf,
 /******************************************************************************/
 int Farfield::writeForceAccel ( const std::string & casename ) const
 {
+    unsigned int k;
     std::ofstream f;
     std::string fname;
+    const std::string facenames[6] = {"Left", "Right", "Front", "Back", "Top",
+                                      "Bottom"};
     
     fname = "postprocessing/" + casename + "_farfield.csv";
     
@@ -519,6 +981,34 @@ int Farfield::writeForceAccel ( const std::string & casename ) const
     f << _cdi << std::endl;
 
     f.close();
+
+    // Per-face breakdown of momentum flux and pressure force
+
+    fname = "postprocessing/" + casename + "_farfield_faces.csv";
+    f.open(fname.c_str(), std::fstream::out);
+    if (! f.is_open())
+    {
+        print_warning("Farfield::writeForceAccel",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+    f << "\"Face\",\"MomRateOfChangeX\",\"MomRateOfChangeY\","
+      << "\"MomRateOfChangeZ\",\"PressureForceX\",\"PressureForceY\","
+      << "\"PressureForceZ\"" << std::endl;
+
+    f.setf(std::ios_base::scientific);
+    f << std::setprecision(7);
+    for ( k = 0; k < _facemomrate.size(); k++ )
+    {
+        f << "\"" << facenames[k] << "\",";
+        f << _facemomrate[k](0) << ",";
+        f << _facemomrate[k](1) << ",";
+        f << _facemomrate[k](2) << ",";
+        f << _facepforce[k](0) << ",";
+        f << _facepforce[k](1) << ",";
+        f << _facepforce[k](2) << std::endl;
+    }
+    f.close();
     
     return 0;
 }
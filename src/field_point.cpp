@@ -0,0 +1,125 @@
+// Flow quantities at off-body points, shared by farfield, probes, and
+// streamlines
+
+#include <vector>
+#include <cmath>
+#include <Eigen/Core>
+#include "vertex.h"
+#include "panel.h"
+#include "field_point.h"
+
+/******************************************************************************
+
+Velocity at a point. Induced velocities are computed in incompressible
+coordinates. Compressible velocity is: V_c = (U_i/beta, V_i, W_i)
+
+*******************************************************************************/
+Eigen::Vector3d field_point_velocity ( const double & xinc,
+                                       const double & yinc,
+                                       const double & zinc,
+                                       const Eigen::Vector3d & uinfvec,
+                                       const double & beta,
+                                       const std::vector<Panel *> & allsurf,
+                                       const std::vector<Panel *> & allwake,
+                                       const double & rcore )
+{
+    unsigned int k, nsurfpan, nwakepan;
+    Eigen::Vector3d vel, dvel, dvelcomp;
+
+    nsurfpan = allsurf.size();
+    nwakepan = allwake.size();
+
+    vel = uinfvec;
+    for ( k = 0; k < nsurfpan; k++ )
+    {
+        dvel = allsurf[k]->inducedVelocity(xinc, yinc, zinc, false, "top",
+                                           true);
+        dvelcomp << dvel(0)/beta, dvel(1), dvel(2);
+        vel += dvelcomp;
+    }
+    for ( k = 0; k < nwakepan; k++ )
+    {
+        dvel = allwake[k]->vortexVelocity(xinc, yinc, zinc, rcore, true);
+        dvelcomp << dvel(0)/beta, dvel(1), dvel(2);
+        vel += dvelcomp;
+    }
+
+    return vel;
+}
+
+/******************************************************************************/
+//
+// Velocity at a vertex, stored in its data
+//
+/******************************************************************************/
+void field_point_velocity ( Vertex & vert, const Eigen::Vector3d & uinfvec,
+                            const double & beta,
+                            const std::vector<Panel *> & allsurf,
+                            const std::vector<Panel *> & allwake,
+                            const double & rcore )
+{
+    Eigen::Vector3d vel;
+
+    vel = field_point_velocity(vert.xInc(), vert.yInc(), vert.zInc(), uinfvec,
+                               beta, allsurf, allwake, rcore);
+    vert.setData(2, vel(0));
+    vert.setData(3, vel(1));
+    vert.setData(4, vel(2));
+}
+
+/******************************************************************************/
+//
+// Pressure, Mach number, and density at a point from its velocity
+//
+/******************************************************************************/
+int field_point_pressure ( Vertex & vert, const double & uinf,
+                           const double & rhoinf, const double & pinf )
+{
+    int retval;
+    double uinf2, vel2, ainf2, qinf, cpinc, minf2, beta, p0, cp, p, m2, gamm1,
+           gamma, mach, rho0, rho;
+    Eigen::Vector3d vel;
+
+    uinf2 = std::pow(uinf, 2.);
+    qinf = 0.5*rhoinf*uinf2;
+    ainf2 = 1.4*pinf/rhoinf;
+    minf2 = uinf2/ainf2;
+    beta = std::sqrt(1. - minf2);
+    gamma = 1.4;
+    gamm1 = gamma - 1.;
+    retval = 0;
+
+    vel << vert.data(2), vert.data(3), vert.data(4);
+    vel2 = vel.squaredNorm();
+    cpinc = 1. - vel2 / uinf2;
+
+    // Prandtl-Glauert compressibility correction for pressure
+
+    cp = cpinc / beta;
+    p = cp*qinf + pinf;
+
+    // Physical limits on pressure
+
+    p0 = pinf * std::pow(1. + 0.5*gamm1*minf2, gamma/gamm1);
+    if (p > p0)
+    {
+        p = p0;
+        cp = (p - pinf) / qinf;
+    }
+
+    // Use isentropic relations to get local Mach number
+
+    m2 = 2./gamm1 * (std::pow(p0/p, gamm1/gamma) - 1.);
+    if (m2 > 1.0)
+        retval = 1;
+    mach = std::sqrt(m2);
+    rho0 = rhoinf * std::pow(1. + 0.5*gamm1*minf2, 1./gamm1);
+    rho = rho0 / std::pow(1. + 0.5*gamm1*m2, 1./gamm1);
+
+    vert.setData(5, p);
+    vert.setData(6, cp);
+    vert.setData(7, mach);
+    vert.setData(8, rho);
+
+    return retval;
+}
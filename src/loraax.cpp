@@ -8,13 +8,14 @@
 #include "clo_parser.h"
 #include "settings.h"
 #include "aircraft.h"
+#include "profiler.h"
 #include "util.h"
 
 #ifndef LORAAX_VERSION
     #define LORAAX_VERSION ""
 #endif
 
-void create_or_backup_dir ( const std::string & dirname )
+void create_or_backup_dir ( const std::string & dirname, bool backup=true )
 {
     DIR *pdir = NULL;
     time_t now;
@@ -22,7 +23,12 @@ void create_or_backup_dir ( const std::string & dirname )
     std::string newpath;
     
     pdir = opendir(dirname.c_str());
-    if (pdir != NULL)
+    if ( (pdir != NULL) && (! backup) )
+    {
+        closedir(pdir);
+        return;
+    }
+    else if (pdir != NULL)
     {
         pdir = opendir("backup");
         if (pdir == NULL)
@@ -56,7 +62,7 @@ int main (int argc, char* argv[])
     std::string geom_file;
     int check;
     Aircraft ac;
-    unsigned int iter, viz_iter;
+    unsigned int iter, viz_iter, restart_iter;
     double lift, oldlift;
     bool converged;
     
@@ -84,17 +90,81 @@ int main (int argc, char* argv[])
     std::cout << "Reading and discretizing geometry ..." << std::endl;
     if (ac.readXML(geom_file) != 0)
         return 3;
+
+    // Restore solution from checkpoint
+
+    restart_iter = 0;
+    oldlift = 0.;
+    if (parser.restartFile() != "")
+    {
+        std::cout << "Reading checkpoint ..." << std::endl;
+        if (ac.readCheckpoint(parser.restartFile(), restart_iter, oldlift)
+            != 0)
+            return 4;
+        std::cout << "Resuming after iteration " << restart_iter
+                  << std::endl;
+    }
     
-    // Set up output directories or back up existing
+    // Set up output directories or back up existing. When restarting, output
+    // is appended to the existing directories.
     
-    create_or_backup_dir("visualization");
-    create_or_backup_dir("sectional");
-    create_or_backup_dir("forcemoment");
-    create_or_backup_dir("postprocessing");
+    create_or_backup_dir("visualization", restart_iter == 0);
+    create_or_backup_dir("sectional", restart_iter == 0);
+    create_or_backup_dir("forcemoment", restart_iter == 0);
+    create_or_backup_dir("postprocessing", restart_iter == 0);
+
+    // Open force, moment, and sectional output and timing reports
+
+    ac.openOutput(restart_iter > 0);
+    if (perf_counters)
+        profiler.enableCounters();
+    if (timing_report != "none")
+        profiler.openReport("postprocessing/" + casename, timing_report,
+                            restart_iter > 0);
+
+    // Vortex lattice analysis replaces the panel solution
+
+    if (vortex_lattice == "analysis")
+    {
+        std::cout << "Solving vortex lattice ..." << std::endl;
+        profiler.start("vortexLattice");
+        ac.solveVortexLattice();
+        profiler.stop("vortexLattice");
+        ac.writeForceMoment(1);
+        ac.writeSectionForceMoment(1);
+        std::cout << "  CL: " << std::setprecision(5) << std::setw(8)
+                  << std::left << ac.liftCoefficient();
+        std::cout << "  CD: " << std::setprecision(5) << std::setw(8)
+                  << std::left << ac.inducedDragCoefficient();
+        std::cout << "  (Vortex lattice)" << std::endl;
+        std::cout << "  Cm: " << std::setprecision(5) << std::setw(8)
+                  << std::left << ac.pitchingMomentCoefficient() << std::endl;
+
+        profiler.start("writeViz");
+        ac.finishViz();
+        profiler.stop("writeViz");
+        ac.closeOutput();
+        profiler.printSummary();
+
+        return 0;
+    }
+
+    // Vortex lattice sectional lift coefficients as the first lift
+    // coefficients to run Xfoil at
+
+    if ( (vortex_lattice == "guess") && viscous && (restart_iter == 0) )
+    {
+        std::cout << "Computing vortex lattice lift guesses ..." << std::endl;
+        profiler.start("vortexLattice");
+        ac.solveVortexLattice();
+        ac.setVortexLatticeLiftGuesses();
+        profiler.stop("vortexLattice");
+    }
     
-    // Iterate
+    // Iterate. The AIC matrix is computed and factorized in the first
+    // iteration, including after restart.
     
-    iter = 0;
+    iter = restart_iter;
     viz_iter = 0;
     converged = false;
     while (int(iter) < maxiters)
@@ -109,44 +179,75 @@ int main (int argc, char* argv[])
         if ( (iter > 1) && rollup_wake )
         {
             std::cout << "  Convecting wake ..." << std::endl;
+            profiler.start("moveWake");
             ac.moveWake();
+            profiler.stop("moveWake");
         }
         
         // Set source strengths
         
         std::cout << "  Setting source strengths ..." << std::endl;
+        profiler.start("setSourceStrengths");
         ac.setSourceStrengths(iter==1);
+        profiler.stop("setSourceStrengths");
         
         // Construct, factorize, and solve the system
         
         std::cout << "  Constructing the linear system ..." << std::endl;
-        ac.constructSystem(iter==1);
-        if ( (iter == 1) || rollup_wake )
+        profiler.start("constructSystem");
+        ac.constructSystem(iter == restart_iter+1);
+        profiler.stop("constructSystem");
+        if ( ( (iter == restart_iter+1) || rollup_wake ) && (! matrix_free) )
         {
             std::cout << "  Factorizing the AIC matrix ..." << std::endl;
+            profiler.start("factorize");
             ac.factorize();
+            profiler.stop("factorize");
         }
         std::cout << "  Solving the linear system with " << ac.systemSize()
                   << " unknowns ..." << std::endl;
+        profiler.start("solveSystem");
         ac.solveSystem();
+        profiler.stop("solveSystem");
+        if (matrix_free)
+            std::cout << "  GMRES iterations: " << ac.solveIterations()
+                      << ", relative residual: " << std::setprecision(3)
+                      << ac.solveResidual() << std::endl;
+        else if (mixed_precision)
+        {
+            std::cout << "  Iterative refinement steps: "
+                      << ac.solveIterations() << ", relative residual: "
+                      << std::setprecision(3) << ac.solveResidual()
+                      << std::endl;
+            if (mixed_precision_check)
+                std::cout << "  Relative difference from double precision "
+                          << "solution: " << std::setprecision(3)
+                          << ac.precisionCheckError() << std::endl;
+        }
         
         // Set doublet strengths on surface and wake
         
         std::cout << "  Setting doublet strengths ..." << std::endl;
+        profiler.start("setDoubletStrengths");
         ac.setDoubletStrengths();
+        profiler.stop("setDoubletStrengths");
         
         // Compute surface velocities and pressures
         
         std::cout << "  Computing surface velocity and pressure ..."
                   << std::endl;
+        profiler.start("computeSurfaceQuantities");
         ac.computeSurfaceQuantities();
+        profiler.stop("computeSurfaceQuantities");
         
         // Viscous BL computations with Xfoil
         
         if (viscous)
         {
             std::cout << "  Computing viscous BL with Xfoil ..." << std::endl;
+            profiler.start("computeBL");
             ac.computeBL();
+            profiler.stop("computeBL");
             if (iter == 1)
                 ac.setupViscousWake();
         }
@@ -154,8 +255,12 @@ int main (int argc, char* argv[])
         // Compute forces and moments
         
         std::cout << "  Computing forces and moments ..." << std::endl;
+        profiler.start("computeForceMoment");
         ac.computeForceMoment();
+        profiler.stop("computeForceMoment");
+        profiler.start("writeForceMoment");
         ac.writeForceMoment(iter);
+        profiler.stop("writeForceMoment");
         lift = ac.liftCoefficient();
         if (viscous)
         {
@@ -195,11 +300,24 @@ int main (int argc, char* argv[])
         if ( (int(viz_iter) == viz_freq) && (int(iter) < maxiters) )
         {
             std::cout << "  Writing VTK visualization ..." << std::endl;
+            profiler.start("writeViz");
             ac.writeViz(casename, iter);
             ac.writeSectionForceMoment(iter);
+            profiler.stop("writeViz");
             viz_iter = 0;
         }
 
+        // Write checkpoint
+
+        if ( (checkpoint_freq > 0) && (int(iter) % checkpoint_freq == 0) )
+        {
+            std::cout << "  Writing checkpoint ..." << std::endl;
+            profiler.start("writeCheckpoint");
+            ac.writeCheckpoint(casename + ".chk", iter, lift);
+            profiler.stop("writeCheckpoint");
+        }
+        profiler.endIteration(iter);
+
         // Stop iterating if converged
 
         if ( (iter > 1) && (int(iter) >= miniters) )
@@ -229,8 +347,28 @@ int main (int argc, char* argv[])
     if (int(viz_iter) != viz_freq)
     {
         std::cout << "Writing final VTK visualization ..." << std::endl;
+        profiler.start("writeViz");
         ac.writeViz(casename, iter);
         ac.writeSectionForceMoment(iter);
+        profiler.stop("writeViz");
+    }
+
+    // Compute design sensitivities
+
+    if (sensitivities)
+    {
+        std::cout << "Computing design sensitivities ..." << std::endl;
+        profiler.start("sensitivities");
+        if (ac.computeSensitivities() == 0)
+        {
+            ac.writeSensitivities(casename);
+            if (sensitivities_check)
+            {
+                std::cout << "Checking design sensitivities ..." << std::endl;
+                ac.checkSensitivities();
+            }
+        }
+        profiler.stop("sensitivities");
     }
 
     // Compute farfield data
@@ -238,10 +376,46 @@ int main (int argc, char* argv[])
     if (enable_farfield)
     {
         std::cout << "Computing farfield data ..." << std::endl;
+        profiler.start("farfield");
         ac.computeFarfield();
         ac.writeFarfieldViz(casename);
         ac.writeFarfieldData(casename);
+        profiler.stop("farfield");
     }
+
+    // Evaluate off-body probes
+
+    if (probe_defs.size() > 0)
+    {
+        std::cout << "Computing probe data ..." << std::endl;
+        profiler.start("probes");
+        ac.computeProbes();
+        ac.writeProbes(casename);
+        profiler.stop("probes");
+    }
+
+    // Trace streamlines and vortex cores
+
+    if (enable_streamlines)
+    {
+        std::cout << "Tracing streamlines ..." << std::endl;
+        profiler.start("streamlines");
+        ac.computeStreamlines();
+        ac.writeStreamlines(casename);
+        profiler.stop("streamlines");
+    }
+
+    // Finish any visualization output still being written and close output
+    // files
+
+    profiler.start("writeViz");
+    ac.finishViz();
+    profiler.stop("writeViz");
+    ac.closeOutput();
+
+    // Timing summary
+
+    profiler.printSummary();
     
     return 0;
 }
@@ -0,0 +1,464 @@
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <stdint.h>
+#include "util.h"
+#include "output_sink.h"
+
+// Buffered text is written once it reaches this size regardless of the flush
+// interval
+
+const std::string::size_type sink_maxbuffer = 65536;
+
+/******************************************************************************/
+//
+// Seconds elapsed since a time point
+//
+/******************************************************************************/
+double sink_elapsed ( const std::chrono::steady_clock::time_point & since )
+{
+    std::chrono::duration<double> elapsed;
+
+    elapsed = std::chrono::steady_clock::now() - since;
+    return elapsed.count();
+}
+
+/******************************************************************************/
+//
+// OutputSink class. Text output file that is kept open for the whole run,
+// with buffered writes.
+//
+/******************************************************************************/
+OutputSink::OutputSink ()
+{
+    _fname = "";
+    _buffer = "";
+    _newfile = false;
+    _interval = 0.;
+    _lastflush = std::chrono::steady_clock::now();
+}
+
+OutputSink::~OutputSink () { close(); }
+
+/******************************************************************************/
+//
+// Opens file, either truncating it or appending to it
+//
+/******************************************************************************/
+int OutputSink::open ( const std::string & fname, bool append,
+                       const double & flush_interval )
+{
+    close();
+
+    _fname = fname;
+    _interval = flush_interval;
+    if (append)
+        _f.open(fname.c_str(), std::fstream::app);
+    else
+        _f.open(fname.c_str(), std::fstream::out);
+    if (! _f.is_open())
+    {
+        print_warning("OutputSink::open",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+
+    // A file opened for appending may still be empty
+
+    _f.seekp(0, std::ios::end);
+    _newfile = (_f.tellp() == std::streampos(0));
+    _lastflush = std::chrono::steady_clock::now();
+
+    return 0;
+}
+
+bool OutputSink::isOpen () const { return _f.is_open(); }
+bool OutputSink::newFile () const { return _newfile; }
+
+/******************************************************************************/
+//
+// Buffered writes
+//
+/******************************************************************************/
+void OutputSink::write ( const std::string & text )
+{
+    if (! _f.is_open())
+        return;
+
+    _buffer += text;
+    _newfile = false;
+    if ( (_buffer.size() >= sink_maxbuffer) ||
+         (sink_elapsed(_lastflush) >= _interval) )
+        flush();
+}
+
+void OutputSink::writeHeader ( const std::vector<std::string> & columns )
+{
+    unsigned int i, ncols;
+    std::string text;
+
+    ncols = columns.size();
+    for ( i = 0; i < ncols; i++ )
+    {
+        text += "\"" + columns[i] + "\"";
+        if (i < ncols-1)
+            text += ",";
+    }
+    write(text + "\n");
+}
+
+void OutputSink::writeRow ( int iter, const std::vector<double> & values )
+{
+    std::ostringstream row;
+    unsigned int i, nvals;
+
+    row << iter;
+    row.setf(std::ios_base::scientific);
+    row << std::setprecision(7);
+    nvals = values.size();
+    for ( i = 0; i < nvals; i++ )
+    {
+        row << "," << values[i];
+    }
+    row << "\n";
+    write(row.str());
+}
+
+/******************************************************************************/
+//
+// Flush buffer to disk, or flush and close
+//
+/******************************************************************************/
+int OutputSink::flush ()
+{
+    if (! _f.is_open())
+        return 0;
+
+    _f << _buffer;
+    _f.flush();
+    _buffer.clear();
+    _lastflush = std::chrono::steady_clock::now();
+    if (! _f)
+    {
+        print_warning("OutputSink::flush", "Error writing " + _fname + ".");
+        return 1;
+    }
+
+    return 0;
+}
+
+int OutputSink::close ()
+{
+    int stat;
+
+    if (! _f.is_open())
+        return 0;
+
+    stat = flush();
+    _f.close();
+
+    return stat;
+}
+
+/******************************************************************************/
+//
+// Flushes buffer and returns size of file on disk
+//
+/******************************************************************************/
+uint64_t OutputSink::fileSize ()
+{
+    if (! _f.is_open())
+        return 0;
+
+    flush();
+    _f.seekp(0, std::ios::end);
+
+    return uint64_t(_f.tellp());
+}
+
+/******************************************************************************/
+//
+// HistoryFile class. The layout (native byte order) is:
+//
+//   char[8]   "LXHIST"
+//   uint32    format version
+//   uint32    byte order check (0x01020304)
+//   records, each starting with a uint32 record type:
+//     1: table definition
+//        uint32   table id
+//        uint32   length of table name, followed by name characters
+//        uint32   number of columns
+//        for each column: uint32 length of name, followed by name characters
+//     2: data block
+//        uint32   table id
+//        uint32   number of rows
+//        float64  values of each column in turn (column-major)
+//
+// Table definitions always precede data blocks for that table. Table ids are
+// only unique within one run, so when a restarted run appends to a file, the
+// same table is defined again with a new id; readers should combine tables by
+// name.
+//
+/******************************************************************************/
+
+const uint32_t history_order = 0x01020304;
+
+/******************************************************************************/
+//
+// Appends binary values to a string buffer
+//
+/******************************************************************************/
+void history_append ( std::string & buf, uint32_t val )
+{
+    buf.append(reinterpret_cast<const char *>(&val), sizeof(val));
+}
+
+void history_append ( std::string & buf, const std::string & str )
+{
+    history_append(buf, uint32_t(str.size()));
+    buf.append(str);
+}
+
+/******************************************************************************/
+//
+// Constructor and destructor
+//
+/******************************************************************************/
+const uint32_t HistoryFile::version;
+
+HistoryFile::HistoryFile ()
+{
+    _fname = "";
+    _pending = "";
+    _columns.resize(0);
+    _rows.resize(0);
+    _interval = 0.;
+    _lastflush = std::chrono::steady_clock::now();
+}
+
+HistoryFile::~HistoryFile () { close(); }
+
+/******************************************************************************/
+//
+// Opens file, either truncating it or appending to it
+//
+/******************************************************************************/
+int HistoryFile::open ( const std::string & fname, bool append,
+                        const double & flush_interval )
+{
+    bool newfile;
+
+    close();
+
+    _fname = fname;
+    _interval = flush_interval;
+    _columns.resize(0);
+    _rows.resize(0);
+    if (append)
+        _f.open(fname.c_str(), std::fstream::app | std::fstream::binary);
+    else
+        _f.open(fname.c_str(), std::fstream::out | std::fstream::binary);
+    if (! _f.is_open())
+    {
+        print_warning("HistoryFile::open",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+
+    _f.seekp(0, std::ios::end);
+    newfile = (_f.tellp() == std::streampos(0));
+    _pending = "";
+    if (newfile)
+    {
+        _pending.append("LXHIST\0\0", 8);
+        history_append(_pending, version);
+        history_append(_pending, history_order);
+    }
+    _lastflush = std::chrono::steady_clock::now();
+
+    return 0;
+}
+
+bool HistoryFile::isOpen () const { return _f.is_open(); }
+
+/******************************************************************************/
+//
+// Defines a table and returns its id
+//
+/******************************************************************************/
+int HistoryFile::addTable ( const std::string & name,
+                            const std::vector<std::string> & columns )
+{
+    unsigned int i, ncols;
+    uint32_t tableid;
+
+    tableid = _columns.size();
+    _columns.push_back(columns);
+    _rows.push_back(std::vector<double>());
+
+    ncols = columns.size();
+    history_append(_pending, uint32_t(1));
+    history_append(_pending, tableid);
+    history_append(_pending, name);
+    history_append(_pending, uint32_t(ncols));
+    for ( i = 0; i < ncols; i++ )
+    {
+        history_append(_pending, columns[i]);
+    }
+
+    return int(tableid);
+}
+
+/******************************************************************************/
+//
+// Adds a row to a table
+//
+/******************************************************************************/
+void HistoryFile::addRow ( int tableid, const std::vector<double> & row )
+{
+    if (! _f.is_open())
+        return;
+
+#ifdef DEBUG
+    if ( (tableid < 0) || (tableid >= int(_columns.size())) )
+        conditional_stop(1, "HistoryFile::addRow", "Invalid table id.");
+    if (row.size() != _columns[tableid].size())
+        conditional_stop(1, "HistoryFile::addRow",
+                         "Row size does not match number of columns.");
+#endif
+
+    _rows[tableid].insert(_rows[tableid].end(), row.begin(), row.end());
+    if (sink_elapsed(_lastflush) >= _interval)
+        flush();
+}
+
+/******************************************************************************/
+//
+// Flush buffered rows to disk, or flush and close
+//
+/******************************************************************************/
+int HistoryFile::flush ()
+{
+    unsigned int i, j, k, ntables, ncols, nrows;
+    std::vector<double> block;
+
+    if (! _f.is_open())
+        return 0;
+
+    _f.write(_pending.data(), _pending.size());
+    _pending.clear();
+
+    // Transpose buffered rows to column-major blocks
+
+    ntables = _columns.size();
+    for ( i = 0; i < ntables; i++ )
+    {
+        ncols = _columns[i].size();
+        if ( (ncols == 0) || (_rows[i].size() == 0) )
+            continue;
+        nrows = _rows[i].size() / ncols;
+        block.resize(nrows*ncols);
+        for ( j = 0; j < nrows; j++ )
+        {
+            for ( k = 0; k < ncols; k++ )
+            {
+                block[k*nrows+j] = _rows[i][j*ncols+k];
+            }
+        }
+
+        history_append(_pending, uint32_t(2));
+        history_append(_pending, uint32_t(i));
+        history_append(_pending, uint32_t(nrows));
+        _f.write(_pending.data(), _pending.size());
+        _pending.clear();
+        _f.write(reinterpret_cast<const char *>(&block[0]),
+                 block.size()*sizeof(double));
+        _rows[i].resize(0);
+    }
+    _f.flush();
+    _lastflush = std::chrono::steady_clock::now();
+    if (! _f)
+    {
+        print_warning("HistoryFile::flush", "Error writing " + _fname + ".");
+        return 1;
+    }
+
+    return 0;
+}
+
+int HistoryFile::close ()
+{
+    int stat;
+
+    if (! _f.is_open())
+        return 0;
+
+    stat = flush();
+    _f.close();
+
+    return stat;
+}
+
+/******************************************************************************/
+//
+// Flushes buffered rows and returns size of file on disk
+//
+/******************************************************************************/
+uint64_t HistoryFile::fileSize ()
+{
+    if (! _f.is_open())
+        return 0;
+
+    flush();
+    _f.seekp(0, std::ios::end);
+
+    return uint64_t(_f.tellp());
+}
+
+/******************************************************************************/
+//
+// Truncates an existing output file to the given size. The retained part is
+// read and the file rewritten, which needs no platform-specific calls; output
+// files are small enough that this is cheap.
+//
+/******************************************************************************/
+int truncate_output ( const std::string & fname, uint64_t size )
+{
+    std::ifstream in;
+    std::ofstream out;
+    std::string data;
+    uint64_t cursize;
+
+    in.open(fname.c_str(), std::fstream::in | std::fstream::binary);
+    if (! in.is_open())
+        return 0;
+    in.seekg(0, std::ios::end);
+    cursize = uint64_t(in.tellg());
+    if (cursize <= size)
+        return 0;
+
+    data.resize(size);
+    in.seekg(0, std::ios::beg);
+    if (size > 0)
+        in.read(&data[0], size);
+    if (! in)
+    {
+        print_warning("truncate_output", "Error reading " + fname + ".");
+        return 1;
+    }
+    in.close();
+
+    out.open(fname.c_str(), std::fstream::out | std::fstream::binary);
+    out.write(data.data(), data.size());
+    if (! out)
+    {
+        print_warning("truncate_output", "Error writing " + fname + ".");
+        return 1;
+    }
+
+    return 0;
+}
@@ -102,8 +102,9 @@ Panel * Panel::backNeighbor () { return _back; }
 
 /******************************************************************************/
 //
-// Computes and performs LU factorization of grid transformation. These are in
-// incompressible coordinates.
+// Computes grid transformation and its inverse. These are in incompressible
+// coordinates. The geometry of surface panels does not change, so the inverse
+// is computed once rather than solving with the jacobian every iteration.
 //
 /******************************************************************************/
 int Panel::computeGridTransformation ()
@@ -169,11 +170,13 @@ int Panel::computeGridTransformation ()
     _jac << dxdxi,  dydxi,  dzdxi,
             dxdeta, dydeta, dzdeta,
             dxdchi, dydchi, dzdchi;
-    _lu.compute(_jac);
+    _invjac = _jac.inverse();
     
     return 0;
 }
 
+const Eigen::Matrix3d & Panel::inverseJacobian () const { return _invjac; }
+
 /******************************************************************************/
 //
 // Sets source strength to provided value
@@ -317,8 +320,8 @@ bool Panel::collocationPointIsCentroid () const { return _colloc_is_centroid; }
 
 /******************************************************************************/
 //
-// Compute / access flow velocity at centroid. Note: this is the incompressible
-// velocity. Compressible version is computed in computePressure.
+// Compute / set / access flow velocity at centroid. Note: this is the
+// incompressible velocity. Compressible version is computed in computePressure.
 //
 /******************************************************************************/
 void Panel::computeVelocity ( const Eigen::Vector3d & uinfvec )
@@ -345,11 +348,12 @@ void Panel::computeVelocity ( const Eigen::Vector3d & uinfvec )
     dmudchi = 0.;
     
     gradmu_grid << dmudxi, dmudeta, dmudchi;
-    gradmu = _lu.solve(gradmu_grid);
+    gradmu = _invjac*gradmu_grid;
 
     _vel = gradmu + _sigma*_norm + uinfvec;
 }
 
+void Panel::setVelocity ( const Eigen::Vector3d & vel ) { _vel = vel; }
 const Eigen::Vector3d & Panel::velocity () const { return _vel; }
 const Eigen::Vector3d & Panel::velocityComp () const { return _velcomp; }
 
@@ -415,6 +419,30 @@ const double & Panel::pressure () const { return _p; }
 const double & Panel::density () const { return _rho; }
 const double & Panel::pressureCoefficient () const { return _cp; }
 
+/******************************************************************************/
+//
+// Derivative of pressure with respect to incompressible velocity, for adjoint
+// sensitivities. Pressure is qinf*(1 - |v|^2/uinf^2)/beta + pinf unless it was
+// limited to stagnation pressure.
+//
+/******************************************************************************/
+Eigen::Vector3d Panel::pressureVelocityDerivative ( const double & uinf,
+                                                    const double & rhoinf,
+                                                    const double & pinf ) const
+{
+    double minf2, beta, p0, gamma, gamm1;
+
+    gamma = 1.4;
+    gamm1 = gamma - 1.;
+    minf2 = std::pow(uinf, 2.)*rhoinf/(gamma*pinf);
+    beta = std::sqrt(1. - minf2);
+    p0 = pinf * std::pow(1. + 0.5*gamm1*minf2, gamma/gamm1);
+    if (_p >= p0)
+        return Eigen::Vector3d::Zero();
+    else
+        return -rhoinf*_vel/beta;
+}
+
 /******************************************************************************/
 //
 // Mach number
@@ -432,7 +460,8 @@ const double & Panel::massDefectDerivative () const { return _dmdefect; }
 
 /******************************************************************************/
 //
-// Averages viscous quantities from vertices
+// Averages viscous quantities from vertices, or sets averages computed
+// elsewhere
 //
 /******************************************************************************/
 void Panel::averageFromVertices ()
@@ -459,6 +488,12 @@ void Panel::averageFromVertices ()
     _mdefect /= weightsum;
 }
 
+void Panel::setViscousAverages ( const double & cf, const double & mdefect )
+{
+    _cf = cf;
+    _mdefect = mdefect;
+}
+
 /******************************************************************************/
 //
 // Compute force and moment contributions
@@ -481,10 +516,6 @@ void Panel::computeForceMoment ( const double & uinf, const double & rhoinf,
 
     if (viscous)
     {
-        // Average viscous quantities from vertices
-
-        averageFromVertices();
-
         // Determine sign on _tan vector corresponding with flow direction
 
         if (_velcomp.transpose()*_tancomp < 0.)
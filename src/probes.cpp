@@ -0,0 +1,315 @@
+#include <vector>
+#include <string>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <stdint.h>
+#include <Eigen/Core>
+#include "util.h"
+#include "settings.h"
+#include "vertex.h"
+#include "panel.h"
+#include "field_point.h"
+#include "probes.h"
+
+/******************************************************************************/
+//
+// Probes class. Off-body points, line rakes, and planar cuts where velocity and
+// pressure are evaluated from the surface and wake singularities after the
+// solution is converged.
+//
+/******************************************************************************/
+
+/******************************************************************************/
+//
+// Default constructor
+//
+/******************************************************************************/
+Probes::Probes ()
+{
+    _rcore = 1e-8;
+    _verts.resize(0);
+    _names.resize(0);
+    _types.resize(0);
+    _start.resize(0);
+    _n1.resize(0);
+    _n2.resize(0);
+}
+
+/******************************************************************************/
+//
+// Computes the points of a probe definition, with n1 varying fastest. Points on
+// a line go from p0 to p1. Points on a plane are p0 + s*(p1 - p0) +
+// t*(p2 - p0), with s and t uniformly spaced from 0 to 1.
+//
+/******************************************************************************/
+void probe_points ( const probedef & def, unsigned int & n1, unsigned int & n2,
+                    std::vector<Eigen::Vector3d> & pts )
+{
+    unsigned int j, k;
+    double s, t;
+
+    if (def.type == "point")
+    {
+        n1 = 1;
+        n2 = 1;
+    }
+    else if (def.type == "line")
+    {
+        n1 = def.n1;
+        n2 = 1;
+    }
+    else
+    {
+        n1 = def.n1;
+        n2 = def.n2;
+    }
+
+    pts.resize(n1*n2);
+    for ( j = 0; j < n2; j++ )
+    {
+        t = 0.;
+        if (n2 > 1)
+            t = double(j) / double(n2-1);
+        for ( k = 0; k < n1; k++ )
+        {
+            s = 0.;
+            if (n1 > 1)
+                s = double(k) / double(n1-1);
+            pts[j*n1+k] = def.p0 + s*(def.p1 - def.p0) + t*(def.p2 - def.p0);
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Creates probe points from definitions
+//
+/******************************************************************************/
+void Probes::initialize ( const std::vector<probedef> & defs,
+                          const double & minf, const double & rcore )
+{
+    unsigned int i, j, nprobes, npts, n1, n2;
+    double beta;
+    std::vector<Eigen::Vector3d> pts;
+
+    _rcore = rcore;
+    beta = std::sqrt(1. - std::pow(minf, 2.));
+
+    nprobes = defs.size();
+    _names.resize(nprobes);
+    _types.resize(nprobes);
+    _start.resize(nprobes);
+    _n1.resize(nprobes);
+    _n2.resize(nprobes);
+    _verts.resize(0);
+    npts = 0;
+    for ( i = 0; i < nprobes; i++ )
+    {
+        probe_points(defs[i], n1, n2, pts);
+        _names[i] = defs[i].name;
+        _types[i] = defs[i].type;
+        _start[i] = npts;
+        _n1[i] = n1;
+        _n2[i] = n2;
+        npts += n1*n2;
+
+        _verts.resize(npts);
+        for ( j = 0; j < pts.size(); j++ )
+        {
+            _verts[_start[i]+j].setIdx(_start[i]+j);
+            _verts[_start[i]+j].setCoordinates(pts[j](0), pts[j](1), pts[j](2));
+            _verts[_start[i]+j].setIncompressibleCoordinates(pts[j](0)/beta,
+                                                         pts[j](1), pts[j](2));
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Access
+//
+/******************************************************************************/
+unsigned int Probes::nProbes () const { return _names.size(); }
+unsigned int Probes::nVerts () const { return _verts.size(); }
+Vertex & Probes::vert ( unsigned int vidx )
+{
+#ifdef DEBUG
+    if (vidx >= _verts.size())
+        conditional_stop(1, "Probes::vert", "Index out of range.");
+#endif
+
+    return _verts[vidx];
+}
+
+/******************************************************************************
+
+Velocity and pressure computation. Induced velocities are computed in
+incompressible coordinates. Compressible velocity is: V_c = (U_i/beta, V_i, W_i)
+
+*******************************************************************************/
+void Probes::computeVelocity ( const Eigen::Vector3d & uinfvec,
+                               const double & minf,
+                               const std::vector<Panel *> & allsurf,
+                               const std::vector<Panel *> & allwake )
+{
+    unsigned int i, nverts;
+    double beta;
+
+    beta = std::sqrt(1. - std::pow(minf, 2.));
+
+    nverts = _verts.size();
+#pragma omp parallel for private(i) schedule(dynamic)
+    for ( i = 0; i < nverts; i++ )
+    {
+        field_point_velocity(_verts[i], uinfvec, beta, allsurf, allwake,
+                             _rcore);
+    }
+}
+
+int Probes::computePressure ( const double & uinf, const double & rhoinf,
+                              const double & pinf )
+{
+    int retval;
+    unsigned int i, nverts;
+
+    retval = 0;
+
+    // Probes may be placed close to the surface, so supersonic points are
+    // flagged rather than stopping the code.
+
+    nverts = _verts.size();
+#pragma omp parallel for private(i)
+    for ( i = 0; i < nverts; i++ )
+    {
+        if (field_point_pressure(_verts[i], uinf, rhoinf, pinf) != 0)
+        {
+#pragma omp atomic write
+            retval = 1;
+        }
+    }
+
+    if (retval != 0)
+        print_warning("Probes::computePressure",
+                      "Locally supersonic flow detected at one or more probe " +
+                      std::string("points."));
+
+    return retval;
+}
+
+/******************************************************************************/
+//
+// Writes probe data to postprocessing/<casename>_probes.csv or, for the binary
+// format, postprocessing/<casename>_probes.bin. The binary layout (native
+// endianness) is:
+//
+//   char[8]   "LXPROBES"
+//   uint32    number of probes
+//   for each probe:
+//     uint32  type (0 = point, 1 = line, 2 = plane)
+//     uint32  n1, n2 (points are stored with n1 varying fastest)
+//     uint32  name length, followed by that many chars
+//   uint32    number of points, number of fields (10)
+//   float64   x, y, z, vx, vy, vz, p, cp, mach, rho for each point
+//
+/******************************************************************************/
+int Probes::write ( const std::string & casename,
+                    const std::string & format ) const
+{
+    unsigned int i, j, k, nprobes, idx;
+    uint32_t ival;
+    double row[10];
+    std::ofstream f;
+    std::string fname;
+
+    nprobes = _names.size();
+
+    if (format == "binary")
+    {
+        fname = "postprocessing/" + casename + "_probes.bin";
+        f.open(fname.c_str(), std::fstream::out | std::fstream::binary);
+        if (! f.is_open())
+        {
+            print_warning("Probes::write",
+                          "Unable to open " + fname + " for writing.");
+            return 1;
+        }
+
+        f.write("LXPROBES", 8);
+        ival = nprobes;
+        f.write(reinterpret_cast<const char *>(&ival), sizeof(ival));
+        for ( i = 0; i < nprobes; i++ )
+        {
+            if (_types[i] == "point")
+                ival = 0;
+            else if (_types[i] == "line")
+                ival = 1;
+            else
+                ival = 2;
+            f.write(reinterpret_cast<const char *>(&ival), sizeof(ival));
+            ival = _n1[i];
+            f.write(reinterpret_cast<const char *>(&ival), sizeof(ival));
+            ival = _n2[i];
+            f.write(reinterpret_cast<const char *>(&ival), sizeof(ival));
+            ival = _names[i].size();
+            f.write(reinterpret_cast<const char *>(&ival), sizeof(ival));
+            f.write(_names[i].c_str(), _names[i].size());
+        }
+        ival = _verts.size();
+        f.write(reinterpret_cast<const char *>(&ival), sizeof(ival));
+        ival = 10;
+        f.write(reinterpret_cast<const char *>(&ival), sizeof(ival));
+        for ( i = 0; i < _verts.size(); i++ )
+        {
+            row[0] = _verts[i].x();
+            row[1] = _verts[i].y();
+            row[2] = _verts[i].z();
+            for ( j = 2; j <= 8; j++ )
+            {
+                row[j+1] = _verts[i].data(j);
+            }
+            f.write(reinterpret_cast<const char *>(row), sizeof(row));
+        }
+        f.close();
+
+        return 0;
+    }
+
+    fname = "postprocessing/" + casename + "_probes.csv";
+    f.open(fname.c_str(), std::fstream::out);
+    if (! f.is_open())
+    {
+        print_warning("Probes::write",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+    f << "\"Probe\",\"I\",\"J\",\"X\",\"Y\",\"Z\",\"Vx\",\"Vy\",\"Vz\","
+      << "\"p\",\"cp\",\"mach\",\"rho\"" << std::endl;
+
+    f.setf(std::ios_base::scientific);
+    f << std::setprecision(7);
+    for ( i = 0; i < nprobes; i++ )
+    {
+        for ( j = 0; j < _n2[i]; j++ )
+        {
+            for ( k = 0; k < _n1[i]; k++ )
+            {
+                idx = _start[i] + j*_n1[i] + k;
+                f << "\"" << _names[i] << "\"," << k << "," << j << ",";
+                f << _verts[idx].x() << ",";
+                f << _verts[idx].y() << ",";
+                f << _verts[idx].z() << ",";
+                f << _verts[idx].data(2) << ",";
+                f << _verts[idx].data(3) << ",";
+                f << _verts[idx].data(4) << ",";
+                f << _verts[idx].data(5) << ",";
+                f << _verts[idx].data(6) << ",";
+                f << _verts[idx].data(7) << ",";
+                f << _verts[idx].data(8) << std::endl;
+            }
+        }
+    }
+    f.close();
+
+    return 0;
+}
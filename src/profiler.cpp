@@ -0,0 +1,413 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <stdint.h>
+#ifdef __linux__
+  #include <linux/perf_event.h>
+  #include <sys/syscall.h>
+  #include <sys/ioctl.h>
+  #include <unistd.h>
+#endif
+#include "util.h"
+#include "profiler.h"
+
+Profiler profiler;
+
+/******************************************************************************/
+//
+// Opens a hardware counter for the calling thread. Returns the file
+// descriptor, or -1 if not available.
+//
+/******************************************************************************/
+int perf_open_counter ( uint64_t config )
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+    long fd;
+
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0)
+        return -1;
+    ioctl(int(fd), PERF_EVENT_IOC_RESET, 0);
+    ioctl(int(fd), PERF_EVENT_IOC_ENABLE, 0);
+
+    return int(fd);
+#else
+    return -1;
+#endif
+}
+
+/******************************************************************************/
+//
+// Constructor and destructor
+//
+/******************************************************************************/
+Profiler::Profiler ()
+{
+    unsigned int i;
+
+    _names.resize(0);
+    _itertime.resize(0);
+    _totaltime.resize(0);
+    _maxtime.resize(0);
+    _itercalls.resize(0);
+    _totalcalls.resize(0);
+    _starts.resize(0);
+    _runstart = std::chrono::steady_clock::now();
+    for ( i = 0; i < 3; i++ )
+    {
+        _perffd[i] = -1;
+    }
+    _perf = false;
+    _perfstart.resize(0);
+    _iterperf.resize(0);
+    _totalperf.resize(0);
+}
+
+Profiler::~Profiler ()
+{
+#ifdef __linux__
+    unsigned int i;
+
+    for ( i = 0; i < 3; i++ )
+    {
+        if (_perffd[i] >= 0)
+            close(_perffd[i]);
+    }
+#endif
+}
+
+/******************************************************************************/
+//
+// Reads hardware counters. Unavailable counters read as 0.
+//
+/******************************************************************************/
+void Profiler::readCounters ( uint64_t counts[3] ) const
+{
+    unsigned int i;
+
+    for ( i = 0; i < 3; i++ )
+    {
+        counts[i] = 0;
+#ifdef __linux__
+        if (_perffd[i] >= 0)
+        {
+            if (read(_perffd[i], &counts[i], sizeof(uint64_t)) !=
+                sizeof(uint64_t))
+                counts[i] = 0;
+        }
+#endif
+    }
+}
+
+/******************************************************************************/
+//
+// Index of a phase, adding it if it does not exist. Phases must be added
+// outside of parallel regions.
+//
+/******************************************************************************/
+int Profiler::phase ( const std::string & name )
+{
+    unsigned int i, nphases;
+
+    nphases = _names.size();
+    for ( i = 0; i < nphases; i++ )
+    {
+        if (_names[i] == name)
+            return int(i);
+    }
+
+    _names.push_back(name);
+    _itertime.push_back(0.);
+    _totaltime.push_back(0.);
+    _maxtime.push_back(0.);
+    _itercalls.push_back(0);
+    _totalcalls.push_back(0);
+    _starts.push_back(std::chrono::steady_clock::now());
+    for ( i = 0; i < 3; i++ )
+    {
+        _perfstart.push_back(0);
+        _iterperf.push_back(0);
+        _totalperf.push_back(0);
+    }
+
+    return int(nphases);
+}
+
+/******************************************************************************/
+//
+// Start or stop timing a phase
+//
+/******************************************************************************/
+void Profiler::start ( int idx )
+{
+    uint64_t counts[3];
+    unsigned int i;
+
+    if (_perf)
+    {
+        readCounters(counts);
+        for ( i = 0; i < 3; i++ )
+        {
+            _perfstart[3*idx+i] = counts[i];
+        }
+    }
+    _starts[idx] = std::chrono::steady_clock::now();
+}
+
+void Profiler::stop ( int idx )
+{
+    std::chrono::duration<double> elapsed;
+    uint64_t counts[3];
+    unsigned int i;
+
+    elapsed = std::chrono::steady_clock::now() - _starts[idx];
+    if (_perf)
+    {
+        readCounters(counts);
+        for ( i = 0; i < 3; i++ )
+        {
+            _iterperf[3*idx+i] += counts[i] - _perfstart[3*idx+i];
+        }
+    }
+    addTime(idx, elapsed.count());
+}
+
+void Profiler::start ( const std::string & name ) { start(phase(name)); }
+void Profiler::stop ( const std::string & name ) { stop(phase(name)); }
+
+/******************************************************************************/
+//
+// Adds a measured time to a phase
+//
+/******************************************************************************/
+void Profiler::addTime ( int idx, const double & seconds )
+{
+#pragma omp critical (profiler)
+    {
+        _itertime[idx] += seconds;
+        _itercalls[idx] += 1;
+        if (seconds > _maxtime[idx])
+            _maxtime[idx] = seconds;
+    }
+}
+
+/******************************************************************************/
+//
+// Enables hardware counters
+//
+/******************************************************************************/
+int Profiler::enableCounters ()
+{
+#ifdef __linux__
+    _perffd[0] = perf_open_counter(PERF_COUNT_HW_CPU_CYCLES);
+    _perffd[1] = perf_open_counter(PERF_COUNT_HW_INSTRUCTIONS);
+    _perffd[2] = perf_open_counter(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    if (_perffd[0] < 0)
+    {
+        print_warning("Profiler::enableCounters",
+                      "Hardware counters are not available. Check "
+                      "/proc/sys/kernel/perf_event_paranoid.");
+        return 1;
+    }
+    _perf = true;
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Opens per-iteration reports. The CSV report has one row per phase per
+// iteration, and the JSON report has one object per iteration per line.
+//
+/******************************************************************************/
+int Profiler::openReport ( const std::string & prefix,
+                           const std::string & format, bool append )
+{
+    std::string fname;
+    bool newfile;
+
+    if ( (format == "csv") || (format == "both") )
+    {
+        fname = prefix + "_timing.csv";
+        if (append)
+            _csv.open(fname.c_str(), std::fstream::app);
+        else
+            _csv.open(fname.c_str(), std::fstream::out);
+        if (! _csv.is_open())
+        {
+            print_warning("Profiler::openReport",
+                          "Unable to open " + fname + " for writing.");
+            return 1;
+        }
+        _csv.seekp(0, std::ios::end);
+        newfile = (_csv.tellp() == std::streampos(0));
+        if (newfile)
+        {
+            _csv << "\"Iter\",\"Phase\",\"Calls\",\"Time\",\"Cycles\","
+                 << "\"Instructions\",\"Cache_misses\"" << std::endl;
+        }
+    }
+
+    if ( (format == "json") || (format == "both") )
+    {
+        fname = prefix + "_timing.jsonl";
+        if (append)
+            _json.open(fname.c_str(), std::fstream::app);
+        else
+            _json.open(fname.c_str(), std::fstream::out);
+        if (! _json.is_open())
+        {
+            print_warning("Profiler::openReport",
+                          "Unable to open " + fname + " for writing.");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Writes per-iteration reports and resets iteration totals
+//
+/******************************************************************************/
+void Profiler::endIteration ( int iter )
+{
+    unsigned int i, j, nphases;
+    bool first;
+
+    nphases = _names.size();
+    if (_csv.is_open())
+    {
+        for ( i = 0; i < nphases; i++ )
+        {
+            if (_itercalls[i] == 0)
+                continue;
+            _csv << iter << ",\"" << _names[i] << "\"," << _itercalls[i]
+                 << "," << std::scientific << std::setprecision(6)
+                 << _itertime[i];
+            for ( j = 0; j < 3; j++ )
+            {
+                _csv << "," << _iterperf[3*i+j];
+            }
+            _csv << std::endl;
+        }
+    }
+
+    if (_json.is_open())
+    {
+        _json << "{\"iter\": " << iter << ", \"phases\": {";
+        first = true;
+        for ( i = 0; i < nphases; i++ )
+        {
+            if (_itercalls[i] == 0)
+                continue;
+            if (! first)
+                _json << ", ";
+            first = false;
+            _json << "\"" << _names[i] << "\": {\"calls\": " << _itercalls[i]
+                  << ", \"time\": " << std::scientific << std::setprecision(6)
+                  << _itertime[i];
+            if (_perf)
+            {
+                _json << ", \"cycles\": " << _iterperf[3*i]
+                      << ", \"instructions\": " << _iterperf[3*i+1]
+                      << ", \"cache_misses\": " << _iterperf[3*i+2];
+            }
+            _json << "}";
+        }
+        _json << "}}" << std::endl;
+    }
+
+    for ( i = 0; i < nphases; i++ )
+    {
+        _totaltime[i] += _itertime[i];
+        _totalcalls[i] += _itercalls[i];
+        _itertime[i] = 0.;
+        _itercalls[i] = 0;
+        for ( j = 0; j < 3; j++ )
+        {
+            _totalperf[3*i+j] += _iterperf[3*i+j];
+            _iterperf[3*i+j] = 0;
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Prints summary table of totals for the run. Times not yet added to totals
+// by endIteration are included.
+//
+/******************************************************************************/
+void Profiler::printSummary () const
+{
+    std::chrono::duration<double> elapsed;
+    unsigned int i, nphases;
+    unsigned long calls;
+    double total, runtime, ipc;
+
+    elapsed = std::chrono::steady_clock::now() - _runstart;
+    runtime = elapsed.count();
+    nphases = _names.size();
+
+    std::cout << "Timing summary:" << std::endl;
+    std::cout << "  " << std::left << std::setw(32) << "Phase"
+              << std::right << std::setw(8) << "Calls"
+              << std::setw(12) << "Time (s)" << std::setw(12) << "Max (s)"
+              << std::setw(8) << "%";
+    if (_perf)
+        std::cout << std::setw(8) << "IPC";
+    std::cout << std::endl;
+    for ( i = 0; i < nphases; i++ )
+    {
+        calls = _totalcalls[i] + _itercalls[i];
+        total = _totaltime[i] + _itertime[i];
+        std::cout << "  " << std::left << std::setw(32) << _names[i]
+                  << std::right << std::setw(8) << calls
+                  << std::fixed << std::setprecision(3)
+                  << std::setw(12) << total << std::setw(12) << _maxtime[i]
+                  << std::setprecision(1) << std::setw(8)
+                  << 100.*total/runtime;
+        if (_perf)
+        {
+            ipc = 0.;
+            if (_totalperf[3*i] + _iterperf[3*i] > 0)
+                ipc = double(_totalperf[3*i+1] + _iterperf[3*i+1])
+                    / double(_totalperf[3*i] + _iterperf[3*i]);
+            std::cout << std::setprecision(2) << std::setw(8) << ipc;
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "  " << std::left << std::setw(32) << "Total run time"
+              << std::right << std::setw(8) << "" << std::fixed
+              << std::setprecision(3) << std::setw(12) << runtime
+              << std::endl;
+    std::cout.unsetf(std::ios_base::floatfield);
+    std::cout << std::setprecision(6);
+}
+
+/******************************************************************************/
+//
+// ScopedTimer class
+//
+/******************************************************************************/
+ScopedTimer::ScopedTimer ( const std::string & name )
+{
+    _idx = profiler.phase(name);
+    profiler.start(_idx);
+}
+
+ScopedTimer::~ScopedTimer () { profiler.stop(_idx); }
@@ -18,29 +18,45 @@
 
 /******************************************************************************/
 //
-// Interpolates BL data from airfoil points to section vertices and sets in
-// vertex data. scale is optional and defaults to 1.
+// Interpolates BL data in _blbuffer from airfoil points to section vertices
+// and sets it in vertex data, using the interpolation points and weights found
+// in setVertices. deltastar is scaled by chord and uedge by uinf.
 //
 /******************************************************************************/
-void Section::setVertexBLData ( const std::vector<double> & bldata,
-                                unsigned int dataidx, double scale )
+void Section::setVertexBLData ( const double & uinf )
 {
-    unsigned int i, j1, j2;
-    double interpval;
+    unsigned int i, k, j1, j2, nsmoothed, nbldata;
+    double w1, w2;
+    double scale[5];
+    const double * bldata;
+
+    nsmoothed = _foil.nSmoothed();
+    nbldata = Vertex::dataSize - Vertex::firstBLData;
 
 #ifdef DEBUG
-    if ( int(bldata.size()) != _foil.nSmoothed() )
+    if (_blbuffer.size() != nbldata*nsmoothed)
         conditional_stop(1, "Section::setVertexBLData",
-                         "Wrong size input vector.");
+                         "Wrong size BL data buffer.");
 #endif
 
+    scale[0] = 1.;
+    scale[1] = _chord;
+    scale[2] = 1.;
+    scale[3] = uinf;
+    scale[4] = 1.;
+
     for ( i = 0; i < _nverts; i++ )
     {
         j1 = _foilinterp[i].point1;
         j2 = _foilinterp[i].point2;
-        interpval = bldata[j1]*_foilinterp[i].weight1
-                  + bldata[j2]*_foilinterp[i].weight2;
-        _verts[i].setData(dataidx, interpval*scale);
+        w1 = _foilinterp[i].weight1;
+        w2 = _foilinterp[i].weight2;
+        for ( k = 0; k < nbldata; k++ )
+        {
+            bldata = &_blbuffer[k*nsmoothed];
+            _verts[i].setData(Vertex::firstBLData+k,
+                              (bldata[j1]*w1 + bldata[j2]*w2)*scale[k]);
+        }
     }
 }
 
@@ -63,12 +79,14 @@ Section::Section ()
     _wverts.resize(0);
     _re = 0.;
     _cl2dprev = -1.E+06;
-    _cl2dguessprev = -1.E+06;
+    _cl2dguess = -1.E+06;
     _cl2dguessprev = -1.E+06;
     _converged = false;
     _unconverged_count = 0;
     _reinitialized = false;
     _foilinterp.resize(0);
+    _blbuffer.resize(0);
+    _wakebuffer.resize(0);
 }
 Section::~Section () {};
 
@@ -125,13 +143,13 @@ void Section::setVertices ( unsigned int nchord, const double & lesprat,
                             const double & tesprat )
 {
     Airfoil foil;
+    const Airfoil * gfoil;
     double slen, sle, unisp, lesp, tesp;
     double a4top, a5top, a4bot, a5bot;
     double sscale, svs;
-    std::vector<double> sv;
+    std::vector<double> sv, sptop, spbot;
     std::vector<double> xf, zf;         // Vertices in foil coordinates
     unsigned int i, j, nsmoothed;
-    Eigen::Matrix3d rotation;
 
 #ifdef DEBUG
     if (_foil.nBuffer() == 0)
@@ -146,22 +164,25 @@ void Section::setVertices ( unsigned int nchord, const double & lesprat,
     }
 #endif
 
-    // Save a copy of the section's airfoil and remove TE gap if necessary. By
+    // Remove TE gap from a copy of the section's airfoil if necessary. By
     // working with a copy, the gap is only removed for 3D panel calculations, but
-    // it is preserved for Xfoil BL calculations.
+    // it is preserved for Xfoil BL calculations. Without a gap, the section's
+    // airfoil is used directly.
 
-    foil = _foil;
-    if (foil.teGap() > 1.E-14)
+    gfoil = &_foil;
+    if (_foil.teGap() > 1.E-14)
     {
+        foil = _foil;
         foil.modifyTEGap(0.0, 0.9);
         foil.smoothPaneling();
         foil.splineFit();
+        gfoil = &foil;
     }
 
     // Get spacings 
     
-    slen = foil.sLen();
-    sle = foil.sLE();
+    slen = gfoil->sLen();
+    sle = gfoil->sLE();
     unisp = slen / float(2*nchord-2);   // Uniform spacing
     lesp = unisp * lesprat;             // LE spacing
     tesp = unisp * tesprat;             // TE spacing
@@ -177,16 +198,16 @@ void Section::setVertices ( unsigned int nchord, const double & lesprat,
     _verts.resize(_nverts);
     _uverts.resize(_nverts);
     sv.resize(_nverts);
+    sptop = tanh_spacings(a4top, a5top, nchord, sle, tesp, lesp);
+    spbot = tanh_spacings(a4bot, a5bot, nchord, slen-sle, lesp, tesp);
     sv[0] = 0.;
     for ( i = 1; i < nchord; i++ )
     {
-        sv[i] = sv[i-1] +
-                tanh_spacing(i-1, a4top, a5top, nchord, sle, tesp, lesp);
+        sv[i] = sv[i-1] + sptop[i-1];
     }
     for ( i = 1; i < nchord; i++ )
     {
-        sv[i+nchord-1] = sv[i+nchord-2] +
-                  tanh_spacing(i-1, a4bot, a5bot, nchord, slen-sle, lesp, tesp);
+        sv[i+nchord-1] = sv[i+nchord-2] + spbot[i-1];
     }
 
     // Get vertices in foil coordinate system (unit chord, 0 <= x <= 1)
@@ -195,25 +216,12 @@ void Section::setVertices ( unsigned int nchord, const double & lesprat,
     zf.resize(_nverts);
     for ( i = 0; i < _nverts; i++ )
     {
-        foil.splineInterp(sv[i], xf[i], zf[i]);
+        gfoil->splineInterp(sv[i], xf[i], zf[i]);
     }
 
-    // Transform to section coordinates. Also store non-rotated, non-translated
-    // version for calculating sectional loads.
-    
-    rotation = inverse_euler_rotation(_roll, _twist, 0.0, "123");
-    for ( i = 0; i < _nverts; i++ )
-    {
-        _verts[i].setCoordinates(xf[i], 0.0, zf[i]);
-        _verts[i].translate(-0.25, 0., 0.);
-        _verts[i].rotate(rotation);
-        _verts[i].translate(0.25, 0., 0.);
-        _verts[i].scale(_chord);
-        _verts[i].translate(_xle, _y, _zle);
+    // Transform to section coordinates
 
-        _uverts[i].setCoordinates(xf[i], 0.0, zf[i]);
-        _uverts[i].scale(_chord);
-    }
+    placeVertices(xf, zf);
 
     // Finds interpolation points on airfoil for section vertices
 
@@ -248,6 +256,61 @@ void Section::setVertices ( unsigned int nchord, const double & lesprat,
     }
 } 
 
+/******************************************************************************/
+//
+// Transforms vertices from airfoil coordinates to section position,
+// orientation, and scale. Also stores non-rotated, non-translated version for
+// calculating sectional loads.
+//
+/******************************************************************************/
+void Section::placeVertices ( const std::vector<double> & xf,
+                              const std::vector<double> & zf )
+{
+    unsigned int i;
+    Eigen::Matrix3d rotation;
+
+    rotation = inverse_euler_rotation(_roll, _twist, 0.0, "123");
+    for ( i = 0; i < _nverts; i++ )
+    {
+        _verts[i].setCoordinates(xf[i], 0.0, zf[i]);
+        _verts[i].translate(-0.25, 0., 0.);
+        _verts[i].rotate(rotation);
+        _verts[i].translate(0.25, 0., 0.);
+        _verts[i].scale(_chord);
+        _verts[i].translate(_xle, _y, _zle);
+
+        _uverts[i].setCoordinates(xf[i], 0.0, zf[i]);
+        _uverts[i].scale(_chord);
+    }
+}
+
+/******************************************************************************/
+//
+// Changes leading edge position, chord, and twist after vertices have been
+// set, moving the vertices accordingly. Airfoil coordinates of the vertices
+// are recovered from the scaled, non-rotated copies, so the airfoil and
+// spacing are unchanged. Incompressible coordinates must be updated
+// afterwards with transformPrandtlGlauert.
+//
+/******************************************************************************/
+void Section::moveVertices ( const double & xle, const double & zle,
+                             const double & chord, const double & twist )
+{
+    unsigned int i;
+    std::vector<double> xf, zf;
+
+    xf.resize(_nverts);
+    zf.resize(_nverts);
+    for ( i = 0; i < _nverts; i++ )
+    {
+        xf[i] = _uverts[i].x() / _chord;
+        zf[i] = _uverts[i].z() / _chord;
+    }
+
+    setGeometry(xle, _y, zle, chord, twist, _roll);
+    placeVertices(xf, zf);
+}
+
 /******************************************************************************/
 //
 // Prandtl-Glauert geometric transformation (xinc = x/beta)
@@ -301,28 +364,20 @@ void Section::setMachNumber ( const double & minf )
 
 /******************************************************************************/
 //
-// Boundary layer calculations with Xfoil
+// Sectional lift coefficient of the 3D solution in the section frame, which
+// is the lift coefficient Xfoil is run at. Also computes sectional forces and
+// moments.
 //
 /******************************************************************************/
-void Section::computeBL ( const Eigen::Vector3d & uinfvec,
-                          const double & rhoinf, const double & pinf,
-                          const double & alpha, int reinit_freq )
+double Section::computeLift2D ( const Eigen::Vector3d & uinfvec,
+                                const double & rhoinf, const double & pinf,
+                                const double & alpha )
 {
     Eigen::Vector3d uinfvec_p;
-    double qinfp, uinf, uinfp, cl2d, dcl2d, cl2dguessnew;
-    double minf, beta, x, y, z;
-    Eigen::Matrix3d inertial2section, section2inertial;
-    std::vector<double> bldata;
-    std::vector<double> xw, zw, dstarw, uedgew;
-    int stat;
-    unsigned int i;
+    Eigen::Matrix3d inertial2section;
+    double uinf, uinfp, qinfp, cl2d;
 
     uinf = uinfvec.norm();
-
-    // Sectional lift must be computed as an input to Xfoil. Sectional forces
-    // and moments will be recomputed after running Xfoil for the purpose of
-    // writing data to the sectional output files.
-
     computeForceMoment(alpha, uinf, rhoinf, pinf, true);
 
     /** To get 2D Cl:
@@ -338,6 +393,67 @@ void Section::computeBL ( const Eigen::Vector3d & uinfvec,
     cl2d = -_fa*uinfvec_p[2]/uinfp + _fn*uinfvec_p[0]/uinfp;
     cl2d /= qinfp*_chord;
 
+    return cl2d;
+}
+
+/******************************************************************************/
+//
+// Secant approximation of the derivative of the 3D sectional lift
+// coefficient with respect to the lift coefficient Xfoil was last run at,
+// given the current 3D sectional lift coefficient. Returns false if Xfoil has
+// not been run at two different lift coefficients yet.
+//
+/******************************************************************************/
+bool Section::liftSlope ( const double & cl2d, double & slope ) const
+{
+    if (_cl2dprev <= -1.E+06)
+        return false;
+    if (std::abs(_cl2dguess - _cl2dguessprev) < 1.E-12)
+        return false;
+    slope = (cl2d - _cl2dprev) / (_cl2dguess - _cl2dguessprev);
+    return true;
+}
+
+const double & Section::liftGuess () const { return _cl2dguess; }
+
+/******************************************************************************/
+//
+// Sets the lift coefficient Xfoil is first run at, e.g. from a vortex lattice
+// solution. Has no effect after Xfoil has been run.
+//
+/******************************************************************************/
+void Section::setLiftGuess ( const double & cl )
+{
+    if (_cl2dprev <= -1.E+06)
+        _cl2dguess = cl;
+}
+
+/******************************************************************************/
+//
+// Boundary layer calculations with Xfoil. Xfoil is run at clspec if given,
+// and otherwise at a lift coefficient from a secant update of this section
+// alone.
+//
+/******************************************************************************/
+void Section::computeBL ( const Eigen::Vector3d & uinfvec,
+                          const double & rhoinf, const double & pinf,
+                          const double & alpha, int reinit_freq,
+                          const double * clspec )
+{
+    double uinf, cl2d, dcl2d, cl2dguessnew;
+    double minf, beta, x, y, z;
+    Eigen::Matrix3d section2inertial;
+    const double *xw, *zw, *dstarw, *uedgew;
+    unsigned int i;
+
+    uinf = uinfvec.norm();
+
+    // Sectional lift must be computed as an input to Xfoil. Sectional forces
+    // and moments will be recomputed after running Xfoil for the purpose of
+    // writing data to the sectional output files.
+
+    cl2d = computeLift2D(uinfvec, rhoinf, pinf, alpha);
+
     // Approximation of Cl for next iteration
     // Uses 1st order Taylor series approximation for the nonlinear equation
     //  cl = f(x, cl) about clguess. A 0th-order approximation would result
@@ -345,11 +461,12 @@ void Section::computeBL ( const Eigen::Vector3d & uinfvec,
     //  the first derivative of f and has lower error and better convergence
     //  properties.
 
-    if (_cl2dprev > -1.E+06)
-    {
-        dcl2d = (cl2d - _cl2dprev) / (_cl2dguess - _cl2dguessprev);
+    if (clspec)
+        cl2dguessnew = *clspec;
+    else if (liftSlope(cl2d, dcl2d))
         cl2dguessnew = (cl2d - _cl2dguess*dcl2d) / (1. - dcl2d);
-    }
+    else if ( (_cl2dprev <= -1.E+06) && (_cl2dguess > -1.E+06) )
+        cl2dguessnew = _cl2dguess;
     else
         cl2dguessnew = cl2d;
     _cl2dprev = cl2d;
@@ -377,31 +494,23 @@ void Section::computeBL ( const Eigen::Vector3d & uinfvec,
         _reinitialized = false;
     }
 
-    // Interpolate BL quantities to vertices. These will be overwritten for
-    // unconverged sections if interpolation/extrapolation is possible. Perform
-    // scaling as needed.
-
-    bldata = _foil.blData("cf", stat);
-    setVertexBLData(bldata, 9);
-    bldata = _foil.blData("deltastar", stat);
-    setVertexBLData(bldata, 10, _chord);
-    bldata = _foil.blData("ampl", stat);
-    setVertexBLData(bldata, 11);
-    bldata = _foil.blData("uedge", stat);
-    setVertexBLData(bldata, 12, uinf);
-    bldata = _foil.blData("cp2d", stat);
-    setVertexBLData(bldata, 13);
-
-    // Get BL wake data
+    // Get surface and wake BL data in one call
 
     if (_nwake == 0)
     {
         _nwake = _foil.nWake();
         _wverts.resize(_nwake);
     }
-    _foil.wakeCoordinates(_nwake, xw, zw);
-    dstarw = _foil.wakeDeltastar(_nwake);
-    uedgew = _foil.wakeUedge(_nwake);
+    _foil.blState(_nwake, _blbuffer, _wakebuffer);
+    xw = _wakebuffer.data();
+    zw = _wakebuffer.data() + _nwake;
+    dstarw = _wakebuffer.data() + 2*_nwake;
+    uedgew = _wakebuffer.data() + 3*_nwake;
+
+    // Interpolate BL quantities to vertices. These will be overwritten for
+    // unconverged sections if interpolation/extrapolation is possible.
+
+    setVertexBLData(uinf);
 
     // Set wake vertex positions and scaled data
 
@@ -544,6 +653,23 @@ void Section::computeForceMoment ( const double & alpha, const double & uinf,
     _cmv = momentv(1)/(qinf*_chord*_chord);
 }
 
+/******************************************************************************/
+//
+// Sets sectional force and moment coefficients from another method, such as
+// the vortex lattice. Viscous parts are zero.
+//
+/******************************************************************************/
+void Section::setForceMoment ( const double & cl, const double & cd,
+                               const double & cm )
+{
+    _clp = cl;
+    _clv = 0.;
+    _cdp = cd;
+    _cdv = 0.;
+    _cmp = cm;
+    _cmv = 0.;
+}
+
 /******************************************************************************/
 //
 // Sectional force and moment coefficients
@@ -629,3 +755,84 @@ void Section::interpolateBL ( Section & sec1, Section & sec2,
         _wverts[i].setData(12, uedge);
     }
 }
+
+/******************************************************************************/
+//
+// Gets or sets data needed to restart BL calculations: previous Cl guesses,
+// convergence state, and 2D wake and BL data
+//
+/******************************************************************************/
+void Section::getRestartData ( std::vector<double> & data ) const
+{
+    unsigned int i, j;
+
+    data.push_back(_cl2dprev);
+    data.push_back(_cl2dguess);
+    data.push_back(_cl2dguessprev);
+    data.push_back(double(_unconverged_count));
+    data.push_back(_converged ? 1. : 0.);
+    data.push_back(_reinitialized ? 1. : 0.);
+    data.push_back(double(_nwake));
+    for ( i = 0; i < _nwake; i++ )
+    {
+        data.push_back(_wverts[i].x());
+        data.push_back(_wverts[i].y());
+        data.push_back(_wverts[i].z());
+        data.push_back(_wverts[i].xInc());
+        data.push_back(_wverts[i].yInc());
+        data.push_back(_wverts[i].zInc());
+        data.push_back(_wverts[i].data(10));
+        data.push_back(_wverts[i].data(12));
+    }
+    for ( i = 0; i < _nverts; i++ )
+    {
+        for ( j = Vertex::firstBLData; int(j) < Vertex::dataSize; j++ )
+        {
+            data.push_back(_verts[i].data(j));
+        }
+    }
+}
+
+unsigned int Section::setRestartData ( const double *data,
+                                      unsigned int count )
+{
+    unsigned int i, j, pos, nwake, nbldata;
+
+    // Check that enough data is available
+
+    nbldata = Vertex::dataSize - Vertex::firstBLData;
+    if (count < 7)
+        return 0;
+    nwake = (unsigned int)(data[6]);
+    if (count < 7 + 8*nwake + nbldata*_nverts)
+        return 0;
+
+    _cl2dprev = data[0];
+    _cl2dguess = data[1];
+    _cl2dguessprev = data[2];
+    _unconverged_count = (unsigned int)(data[3]);
+    _converged = (data[4] != 0.);
+    _reinitialized = (data[5] != 0.);
+    _nwake = nwake;
+    _wverts.resize(_nwake);
+    pos = 7;
+    for ( i = 0; i < _nwake; i++ )
+    {
+        _wverts[i].setCoordinates(data[pos], data[pos+1], data[pos+2]);
+        _wverts[i].setIncompressibleCoordinates(data[pos+3], data[pos+4],
+                                                data[pos+5]);
+        _wverts[i].setData(10, data[pos+6]);
+        _wverts[i].setData(12, data[pos+7]);
+        pos += 8;
+    }
+    for ( i = 0; i < _nverts; i++ )
+    {
+        for ( j = Vertex::firstBLData; int(j) < Vertex::dataSize; j++ )
+        {
+            _verts[i].setData(j, data[pos]);
+            pos += 1;
+        }
+    }
+
+    return pos;
+}
@@ -3,8 +3,10 @@
 #define _USE_MATH_DEFINES
 
 #include <string>
+#include <vector>
 #include <Eigen/Core>
 #include <cmath>
+#include <algorithm>
 #include <tinyxml2.h>
 extern "C"
 {
@@ -36,6 +38,24 @@ double stop_tol;
 int maxiters;
 int miniters;
 int viz_freq;
+std::string viz_format;
+bool viz_compress;
+bool viz_float32;
+bool viz_background;
+int checkpoint_freq;
+double output_flush_interval;
+bool write_history;
+std::string timing_report;
+bool perf_counters;
+bool mixed_precision;
+bool mixed_precision_check;
+bool matrix_free;
+double matrix_free_tol;
+std::string surface_gradient;
+bool spanwise_newton;
+bool sensitivities;
+bool sensitivities_check;
+std::string vortex_lattice;
 
 xfoil_geom_options_type xfoil_geom_opts;
 xfoil_options_type xfoil_run_opts;
@@ -44,6 +64,20 @@ bool enable_farfield;
 double farfield_cenx, farfield_ceny, farfield_cenz;
 double farfield_lenx, farfield_leny, farfield_lenz;
 int farfield_nx, farfield_ny, farfield_nz;
+int farfield_maxlevel;
+double farfield_reftol;
+
+std::vector<probedef> probe_defs;
+std::string probe_format;
+double probe_rcore;
+
+bool enable_streamlines;
+std::vector<probedef> streamline_seeds;
+std::vector<probedef> streamline_cutplanes;
+double streamline_tol, streamline_step, streamline_maxlength;
+double streamline_rcore, streamline_corethresh;
+int streamline_maxsteps;
+bool streamline_tracecores;
 
 /******************************************************************************/
 //
@@ -118,6 +152,103 @@ int read_setting ( const XMLElement *elem, const std::string & setting,
     return 0;
 }
 
+/******************************************************************************/
+//
+// Reads a probe definition (Point, Line, or Plane element). Points are given
+// as X1, Y1, Z1, X2, ... Returns 0 on success, 2 if a required entry is
+// missing.
+//
+/******************************************************************************/
+int read_probe ( const XMLElement *elem, const std::string & type,
+                 unsigned int count, probedef & probe )
+{
+    unsigned int i, npts;
+    std::string num;
+    Eigen::Vector3d pt[3];
+
+    probe.type = type;
+    if (elem->Attribute("name"))
+        probe.name = elem->Attribute("name");
+    else
+        probe.name = type + int2string(count);
+
+    if (type == "point")
+        npts = 1;
+    else if (type == "line")
+        npts = 2;
+    else
+        npts = 3;
+
+    for ( i = 0; i < 3; i++ )
+    {
+        pt[i] << 0., 0., 0.;
+    }
+    for ( i = 0; i < npts; i++ )
+    {
+        num = int2string(i+1);
+        if (read_setting(elem, "X" + num, pt[i](0)) != 0)
+            return 2;
+        if (read_setting(elem, "Y" + num, pt[i](1)) != 0)
+            return 2;
+        if (read_setting(elem, "Z" + num, pt[i](2)) != 0)
+            return 2;
+    }
+    probe.p0 = pt[0];
+    probe.p1 = pt[1];
+    probe.p2 = pt[2];
+
+    probe.n1 = 1;
+    probe.n2 = 1;
+    if (type == "line")
+    {
+        if (read_setting(elem, "NPoints", probe.n1) != 0)
+            return 2;
+    }
+    else if (type == "plane")
+    {
+        if (read_setting(elem, "NPoints1", probe.n1) != 0)
+            return 2;
+        if (read_setting(elem, "NPoints2", probe.n2) != 0)
+            return 2;
+    }
+    if ( (probe.n1 < 1) || (probe.n2 < 1) )
+    {
+        conditional_stop(1, "read_probe",
+                         "Number of probe points must be at least 1.");
+        return 2;
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Largest farfield refinement level for a grid size. Farfield lattice keys
+// pack face, i, and j into 64 bits, with (n-1)*2^level+1 lattice points per
+// direction for the largest n, so 6*npts^2 must fit. This also keeps lattice
+// indices and 2^level within 32 bits.
+//
+/******************************************************************************/
+int farfield_level_limit ( int nx, int ny, int nz )
+{
+    unsigned long long ncells, npts, maxsq;
+    int level;
+
+    ncells = (unsigned long long)(std::max(std::max(nx, ny), std::max(nz, 2))
+           - 1);
+    maxsq = (~0ull) / 6ull;
+    level = 0;
+    while (level < 31)
+    {
+        npts = (ncells << (level+1)) + 1;
+        if (npts > maxsq / npts)
+            break;
+        level++;
+    }
+
+    return level;
+}
+
 /******************************************************************************/
 //
 // Read settings from input file
@@ -190,6 +321,99 @@ int read_settings ( const std::string & inputfile, std::string & geom_file )
         miniters = 0;
     if (read_setting(main, "VisualizationFrequency", viz_freq, false) != 0)
         viz_freq = 1;
+    if (read_setting(main, "VisualizationFormat", viz_format, false) != 0)
+        viz_format = "legacy";
+    if ( (viz_format != "legacy") && (viz_format != "vtu") )
+    {
+        conditional_stop(1, "read_settings",
+                         "VisualizationFormat must be legacy or vtu.");
+        return 2;
+    }
+    if (read_setting(main, "VisualizationCompression", viz_compress, false)
+        != 0)
+        viz_compress = false;
+    if (read_setting(main, "VisualizationSinglePrecision", viz_float32,
+                     false) != 0)
+        viz_float32 = false;
+    if (read_setting(main, "VisualizationBackground", viz_background, false)
+        != 0)
+        viz_background = true;
+    if (read_setting(main, "CheckpointFrequency", checkpoint_freq, false) != 0)
+        checkpoint_freq = 0;
+    if (read_setting(main, "OutputFlushInterval", output_flush_interval,
+                     false) != 0)
+        output_flush_interval = 5.;
+    if (read_setting(main, "BinaryHistory", write_history, false) != 0)
+        write_history = false;
+    if (read_setting(main, "TimingReport", timing_report, false) != 0)
+        timing_report = "none";
+    if ( (timing_report != "none") && (timing_report != "csv") &&
+         (timing_report != "json") && (timing_report != "both") )
+    {
+        conditional_stop(1, "read_settings",
+                         "TimingReport must be none, csv, json, or both.");
+        return 2;
+    }
+    if (read_setting(main, "PerfCounters", perf_counters, false) != 0)
+        perf_counters = false;
+    if (read_setting(main, "MixedPrecision", mixed_precision, false) != 0)
+        mixed_precision = false;
+    if (read_setting(main, "MixedPrecisionCheck", mixed_precision_check,
+                     false) != 0)
+        mixed_precision_check = false;
+    if (read_setting(main, "MatrixFree", matrix_free, false) != 0)
+        matrix_free = false;
+    if (read_setting(main, "MatrixFreeTolerance", matrix_free_tol, false) != 0)
+        matrix_free_tol = 1.E-10;
+    if (matrix_free && mixed_precision)
+    {
+        conditional_stop(1, "read_settings",
+                         "MatrixFree and MixedPrecision cannot both be used.");
+        return 2;
+    }
+    if (matrix_free_tol <= 0.)
+    {
+        conditional_stop(1, "read_settings",
+                         "MatrixFreeTolerance must be positive.");
+        return 2;
+    }
+    if (read_setting(main, "SurfaceGradient", surface_gradient, false) != 0)
+        surface_gradient = "central";
+    if ( (surface_gradient != "central") &&
+         (surface_gradient != "least_squares") )
+    {
+        conditional_stop(1, "read_settings",
+                         "SurfaceGradient must be central or least_squares.");
+        return 2;
+    }
+    if (read_setting(main, "SpanwiseNewton", spanwise_newton, false) != 0)
+        spanwise_newton = false;
+    if (read_setting(main, "Sensitivities", sensitivities, false) != 0)
+        sensitivities = false;
+    if (sensitivities && (viscous || matrix_free))
+    {
+        conditional_stop(1, "read_settings",
+                    "Sensitivities cannot be used with Viscous or MatrixFree.");
+        return 2;
+    }
+    if (read_setting(main, "SensitivitiesCheck", sensitivities_check, false)
+        != 0)
+        sensitivities_check = false;
+    if (read_setting(main, "VortexLattice", vortex_lattice, false) != 0)
+        vortex_lattice = "none";
+    if ( (vortex_lattice != "none") && (vortex_lattice != "analysis") &&
+         (vortex_lattice != "guess") )
+    {
+        conditional_stop(1, "read_settings",
+                         "VortexLattice must be none, analysis, or guess.");
+        return 2;
+    }
+    if ( (vortex_lattice == "analysis") && viscous )
+    {
+        conditional_stop(1, "read_settings",
+                    "VortexLattice analysis cannot be used with Viscous.");
+        return 2;
+    }
     
     xfoil_run_opts.ncrit = 9.;
     xfoil_run_opts.xtript = 1.0;
@@ -229,6 +453,21 @@ int read_settings ( const std::string & inputfile, std::string & geom_file )
     // Postprocessing settings
 
     enable_farfield = false;
+    farfield_maxlevel = 0;
+    farfield_reftol = 0.05;
+    probe_defs.resize(0);
+    probe_format = "csv";
+    probe_rcore = -1.;      // Will get set based on reference length later
+    enable_streamlines = false;
+    streamline_seeds.resize(0);
+    streamline_cutplanes.resize(0);
+    streamline_tol = -1.;   // Negative values get set based on reference
+    streamline_step = -1.;  //   length and wake length later
+    streamline_maxlength = -1.;
+    streamline_rcore = -1.;
+    streamline_corethresh = 0.1;
+    streamline_maxsteps = 5000;
+    streamline_tracecores = true;
     XMLElement *post = main->FirstChildElement("Postprocessing");
     if (post)
     {
@@ -257,6 +496,121 @@ int read_settings ( const std::string & inputfile, std::string & geom_file )
                   return 2;
               if (read_setting(farfield, "NPointsZ", farfield_nz) != 0)
                   return 2;
+              read_setting(farfield, "MaxRefinementLevel", farfield_maxlevel,
+                           false);
+              read_setting(farfield, "RefinementTolerance", farfield_reftol,
+                           false);
+              if (farfield_maxlevel < 0)
+                  conditional_stop(1, "read_settings",
+                                   "MaxRefinementLevel must be >= 0.");
+              int maxlevel = farfield_level_limit(farfield_nx, farfield_ny,
+                                                  farfield_nz);
+              if (farfield_maxlevel > maxlevel)
+              {
+                  conditional_stop(1, "read_settings",
+                                   "MaxRefinementLevel must be <= "
+                                   + int2string(maxlevel)
+                                   + " for this farfield grid size.");
+                  return 2;
+              }
+            }
+        }
+
+        // Off-body probes
+
+        XMLElement *probes = post->FirstChildElement("Probes");
+        if (probes)
+        {
+            read_setting(probes, "Format", probe_format, false);
+            if (probe_format == "CSV")
+                probe_format = "csv";
+            else if (probe_format == "Binary")
+                probe_format = "binary";
+            if ( (probe_format != "csv") && (probe_format != "binary") )
+            {
+                conditional_stop(1, "read_settings",
+                                 "Probe Format must be CSV or Binary.");
+                return 2;
+            }
+            read_setting(probes, "CoreRadius", probe_rcore, false);
+
+            for ( XMLElement *elem = probes->FirstChildElement(); elem != NULL;
+                  elem = elem->NextSiblingElement() )
+            {
+                probedef probe;
+                std::string elemname = elem->Name();
+                if (elemname == "Point")
+                {
+                    if (read_probe(elem, "point", probe_defs.size(), probe)
+                        != 0)
+                        return 2;
+                }
+                else if (elemname == "Line")
+                {
+                    if (read_probe(elem, "line", probe_defs.size(), probe) != 0)
+                        return 2;
+                }
+                else if (elemname == "Plane")
+                {
+                    if (read_probe(elem, "plane", probe_defs.size(), probe)
+                        != 0)
+                        return 2;
+                }
+                else
+                    continue;
+                probe_defs.push_back(probe);
+            }
+        }
+
+        // Streamlines and vortex cores. Seeds are given as Point, Line, or
+        // Plane elements, and cut planes for vortex core detection as
+        // CutPlane elements with the same entries as Plane.
+
+        XMLElement *stream = post->FirstChildElement("Streamlines");
+        if (stream)
+        {
+            enable_streamlines = true;
+            read_setting(stream, "Tolerance", streamline_tol, false);
+            read_setting(stream, "InitialStep", streamline_step, false);
+            read_setting(stream, "MaxLength", streamline_maxlength, false);
+            read_setting(stream, "MaxSteps", streamline_maxsteps, false);
+            read_setting(stream, "CoreRadius", streamline_rcore, false);
+            read_setting(stream, "CoreThreshold", streamline_corethresh, false);
+            read_setting(stream, "TraceCores", streamline_tracecores, false);
+
+            for ( XMLElement *elem = stream->FirstChildElement(); elem != NULL;
+                  elem = elem->NextSiblingElement() )
+            {
+                probedef seed;
+                std::string elemname = elem->Name();
+                if (elemname == "Point")
+                {
+                    if (read_probe(elem, "point", streamline_seeds.size(), seed)
+                        != 0)
+                        return 2;
+                    streamline_seeds.push_back(seed);
+                }
+                else if (elemname == "Line")
+                {
+                    if (read_probe(elem, "line", streamline_seeds.size(), seed)
+                        != 0)
+                        return 2;
+                    streamline_seeds.push_back(seed);
+                }
+                else if (elemname == "Plane")
+                {
+                    if (read_probe(elem, "plane", streamline_seeds.size(), seed)
+                        != 0)
+                        return 2;
+                    streamline_seeds.push_back(seed);
+                }
+                else if (elemname == "CutPlane")
+                {
+                    if (read_probe(elem, "plane", streamline_cutplanes.size(),
+                                   seed) != 0)
+                        return 2;
+                    streamline_cutplanes.push_back(seed);
+                }
             }
         }
     }
@@ -0,0 +1,580 @@
+#include <vector>
+#include <string>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <Eigen/Core>
+#include "util.h"
+#include "settings.h"
+#include "panel.h"
+#include "probes.h"
+#include "field_point.h"
+#include "streamlines.h"
+
+/******************************************************************************/
+//
+// Streamlines class. Traces streamlines from user seeds through the velocity
+// field induced by the surface and wake singularities, and locates vortex cores
+// on cut planes. Used for postprocessing only.
+//
+/******************************************************************************/
+
+/******************************************************************************/
+//
+// Default constructor
+//
+/******************************************************************************/
+Streamlines::Streamlines ()
+{
+    _rcore = 1e-8;
+    _tol = 1e-4;
+    _h0 = 1e-2;
+    _maxlength = 1.;
+    _corethresh = 0.1;
+    _maxsteps = 5000;
+    _tracecores = true;
+    _seeds.resize(0);
+    _cutplanes.resize(0);
+    _lines.resize(0);
+    _linevels.resize(0);
+    _corelines.resize(0);
+    _corelinevels.resize(0);
+    _cores.resize(0);
+    _corevort.resize(0);
+}
+
+/******************************************************************************/
+//
+// Set up seeds, cut planes, and integration parameters
+//
+/******************************************************************************/
+void Streamlines::initialize ( const std::vector<probedef> & seeds,
+                               const std::vector<probedef> & cutplanes,
+                               const double & rcore, const double & tol,
+                               const double & h0, const double & maxlength,
+                               unsigned int maxsteps, const double & corethresh,
+                               bool tracecores )
+{
+    unsigned int i, j, n1, n2;
+    std::vector<Eigen::Vector3d> pts;
+
+    _rcore = rcore;
+    _tol = tol;
+    _h0 = h0;
+    _maxlength = maxlength;
+    _maxsteps = maxsteps;
+    _corethresh = corethresh;
+    _tracecores = tracecores;
+    _cutplanes = cutplanes;
+
+    _seeds.resize(0);
+    for ( i = 0; i < seeds.size(); i++ )
+    {
+        probe_points(seeds[i], n1, n2, pts);
+        for ( j = 0; j < pts.size(); j++ )
+        {
+            _seeds.push_back(pts[j]);
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Velocity at a batch of points, evaluated in parallel with the same routine
+// as farfield and probe points
+//
+/******************************************************************************/
+void Streamlines::velocities ( const std::vector<Eigen::Vector3d> & pts,
+                               const Eigen::Vector3d & uinfvec,
+                               const double & minf,
+                               const std::vector<Panel *> & allsurf,
+                               const std::vector<Panel *> & allwake,
+                               std::vector<Eigen::Vector3d> & vels ) const
+{
+    unsigned int i, npts;
+    double beta;
+
+    beta = std::sqrt(1. - std::pow(minf, 2.));
+
+    npts = pts.size();
+    vels.resize(npts);
+#pragma omp parallel for private(i) schedule(dynamic)
+    for ( i = 0; i < npts; i++ )
+    {
+        vels[i] = field_point_velocity(pts[i](0)/beta, pts[i](1), pts[i](2),
+                                       uinfvec, beta, allsurf, allwake,
+                                       _rcore);
+    }
+}
+
+/******************************************************************************/
+//
+// Traces streamlines from seeds with adaptive RK45 (Dormand-Prince 5(4)),
+// integrating dx/ds = V/|V| so that step sizes are arc lengths. All active
+// streamlines are advanced together so each stage is one batched velocity
+// evaluation. The last stage is evaluated at the new point and is reused as the
+// first stage of the next step.
+//
+/******************************************************************************/
+void Streamlines::integrate ( const std::vector<Eigen::Vector3d> & seeds,
+                              const Eigen::Vector3d & uinfvec,
+                              const double & minf,
+                              const std::vector<Panel *> & allsurf,
+                              const std::vector<Panel *> & allwake,
+                      std::vector< std::vector<Eigen::Vector3d> > & lines,
+                      std::vector< std::vector<Eigen::Vector3d> > & linevels
+                            ) const
+{
+    unsigned int i, j, m, s, nlines, nactive;
+    double vmag, vmin, err, hmin, factor;
+    Eigen::Vector3d ynew, errvec;
+    std::vector<unsigned int> active, nsteps;
+    std::vector<double> h, len;
+    std::vector<Eigen::Vector3d> pos, pts, vels;
+    std::vector< std::vector<Eigen::Vector3d> > k;
+    std::vector<int> stagnated;
+
+    // Dormand-Prince coefficients
+
+    const double a[7][6] = {
+        {0., 0., 0., 0., 0., 0.},
+        {1./5., 0., 0., 0., 0., 0.},
+        {3./40., 9./40., 0., 0., 0., 0.},
+        {44./45., -56./15., 32./9., 0., 0., 0.},
+        {19372./6561., -25360./2187., 64448./6561., -212./729., 0., 0.},
+        {9017./3168., -355./33., 46732./5247., 49./176., -5103./18656., 0.},
+        {35./384., 0., 500./1113., 125./192., -2187./6784., 11./84.}};
+    const double e[7] = {35./384. - 5179./57600., 0.,
+                         500./1113. - 7571./16695., 125./192. - 393./640.,
+                         -2187./6784. + 92097./339200., 11./84. - 187./2100.,
+                         -1./40.};
+
+    nlines = seeds.size();
+    lines.resize(nlines);
+    linevels.resize(nlines);
+    if (nlines == 0)
+        return;
+
+    vmin = 1e-12*uinfvec.norm();
+    hmin = 1e-6*_h0;
+    pos = seeds;
+    h.assign(nlines, _h0);
+    len.assign(nlines, 0.);
+    nsteps.assign(nlines, 0);
+    stagnated.assign(nlines, 0);
+    k.resize(7);
+    for ( s = 0; s < 7; s++ )
+    {
+        k[s].resize(nlines);
+    }
+
+    // First stage at the seeds
+
+    velocities(seeds, uinfvec, minf, allsurf, allwake, vels);
+    active.resize(0);
+    for ( i = 0; i < nlines; i++ )
+    {
+        lines[i].resize(1);
+        linevels[i].resize(1);
+        lines[i][0] = seeds[i];
+        linevels[i][0] = vels[i];
+        vmag = vels[i].norm();
+        if (vmag > vmin)
+        {
+            k[0][i] = vels[i] / vmag;
+            active.push_back(i);
+        }
+    }
+
+    while (active.size() > 0)
+    {
+        nactive = active.size();
+        pts.resize(nactive);
+
+        // Remaining stages, one batched evaluation each
+
+        for ( s = 1; s < 7; s++ )
+        {
+            for ( m = 0; m < nactive; m++ )
+            {
+                i = active[m];
+                pts[m] = pos[i];
+                for ( j = 0; j < s; j++ )
+                {
+                    pts[m] += h[i]*a[s][j]*k[j][i];
+                }
+            }
+            velocities(pts, uinfvec, minf, allsurf, allwake, vels);
+            for ( m = 0; m < nactive; m++ )
+            {
+                i = active[m];
+                vmag = vels[m].norm();
+                if (vmag > vmin)
+                    k[s][i] = vels[m] / vmag;
+                else
+                {
+                    k[s][i] << 0., 0., 0.;
+                    stagnated[i] = 1;
+                }
+            }
+        }
+
+        // Error control. The last stage point is the 5th order solution, so
+        // vels holds the velocity there.
+
+        for ( m = 0; m < nactive; m++ )
+        {
+            i = active[m];
+            errvec << 0., 0., 0.;
+            for ( s = 0; s < 7; s++ )
+            {
+                errvec += e[s]*k[s][i];
+            }
+            err = h[i]*errvec.norm();
+
+            if ( (err <= _tol) || (h[i] <= hmin) )
+            {
+                ynew = pts[m];
+                pos[i] = ynew;
+                len[i] += h[i];
+                nsteps[i] += 1;
+                lines[i].push_back(ynew);
+                linevels[i].push_back(vels[m]);
+                k[0][i] = k[6][i];
+            }
+
+            if (err > 0.)
+                factor = 0.9*std::pow(_tol/err, 0.2);
+            else
+                factor = 5.;
+            factor = std::min(std::max(factor, 0.2), 5.);
+            h[i] = std::max(std::min(h[i]*factor, _maxlength - len[i]), hmin);
+        }
+
+        // Remove finished streamlines
+
+        pts.resize(0);
+        j = 0;
+        for ( m = 0; m < nactive; m++ )
+        {
+            i = active[m];
+            if ( (len[i] < _maxlength*(1. - 1e-12)) &&
+                 (nsteps[i] < _maxsteps) && (stagnated[i] == 0) )
+            {
+                active[j] = i;
+                j += 1;
+            }
+        }
+        active.resize(j);
+    }
+}
+
+/******************************************************************************/
+//
+// Locates vortex cores on each cut plane. The plane-normal vorticity is
+// computed with central differences from velocities evaluated on the plane
+// grid, and cores are local maxima of its magnitude above _corethresh times
+// the plane maximum. Core positions are refined with a parabolic fit in each
+// direction. Plane edges must be perpendicular.
+//
+/******************************************************************************/
+void Streamlines::findCores ( const Eigen::Vector3d & uinfvec,
+                              const double & minf,
+                              const std::vector<Panel *> & allsurf,
+                              const std::vector<Panel *> & allwake )
+{
+    unsigned int i, j, l, p, nplanes, n1, n2, start, idx;
+    int di, dj;
+    bool ismax;
+    double da, db, wmax, wc, wm, wp, da_off, db_off;
+    Eigen::Vector3d u1, u2, core;
+    std::vector<Eigen::Vector3d> pts, allpts, vels;
+    std::vector<unsigned int> starts, n1s, n2s;
+    std::vector<double> w;
+
+    nplanes = _cutplanes.size();
+    _cores.resize(nplanes);
+    _corevort.resize(nplanes);
+    if (nplanes == 0)
+        return;
+
+    // Evaluate velocities on all planes in one batch
+
+    allpts.resize(0);
+    starts.resize(nplanes);
+    n1s.resize(nplanes);
+    n2s.resize(nplanes);
+    for ( p = 0; p < nplanes; p++ )
+    {
+        probe_points(_cutplanes[p], n1, n2, pts);
+        starts[p] = allpts.size();
+        n1s[p] = n1;
+        n2s[p] = n2;
+        allpts.insert(allpts.end(), pts.begin(), pts.end());
+    }
+    velocities(allpts, uinfvec, minf, allsurf, allwake, vels);
+
+    for ( p = 0; p < nplanes; p++ )
+    {
+        _cores[p].resize(0);
+        _corevort[p].resize(0);
+        n1 = n1s[p];
+        n2 = n2s[p];
+        start = starts[p];
+        if ( (n1 < 3) || (n2 < 3) )
+        {
+            print_warning("Streamlines::findCores",
+                          "Cut plane " + _cutplanes[p].name +
+                          " needs at least 3 points in each direction.");
+            continue;
+        }
+        u1 = _cutplanes[p].p1 - _cutplanes[p].p0;
+        u2 = _cutplanes[p].p2 - _cutplanes[p].p0;
+        da = u1.norm() / double(n1-1);
+        db = u2.norm() / double(n2-1);
+        u1.normalize();
+        u2.normalize();
+        if (std::abs(u1.dot(u2)) > 1e-6)
+        {
+            print_warning("Streamlines::findCores",
+                          "Edges of cut plane " + _cutplanes[p].name +
+                          " are not perpendicular.");
+            continue;
+        }
+
+        // Plane-normal vorticity at interior points
+
+        w.assign(n1*n2, 0.);
+        wmax = 0.;
+        for ( j = 1; j < n2-1; j++ )
+        {
+            for ( i = 1; i < n1-1; i++ )
+            {
+                idx = start + j*n1 + i;
+                w[j*n1+i] = (vels[idx+1].dot(u2) - vels[idx-1].dot(u2))
+                          / (2.*da)
+                          - (vels[idx+n1].dot(u1) - vels[idx-n1].dot(u1))
+                          / (2.*db);
+                wmax = std::max(wmax, std::abs(w[j*n1+i]));
+            }
+        }
+        if (wmax == 0.)
+            continue;
+
+        // Local maxima of |w|. Ties go to the point with the lowest index.
+
+        for ( j = 1; j < n2-1; j++ )
+        {
+            for ( i = 1; i < n1-1; i++ )
+            {
+                wc = std::abs(w[j*n1+i]);
+                if (wc < _corethresh*wmax)
+                    continue;
+                ismax = true;
+                for ( dj = -1; dj <= 1; dj++ )
+                {
+                    for ( di = -1; di <= 1; di++ )
+                    {
+                        if ( (di == 0) && (dj == 0) )
+                            continue;
+                        l = (j+dj)*n1 + i+di;
+                        if ( (std::abs(w[l]) > wc) ||
+                             ( (std::abs(w[l]) == wc) && (l < j*n1+i) ) )
+                            ismax = false;
+                    }
+                }
+                if (! ismax)
+                    continue;
+
+                wm = std::abs(w[j*n1+i-1]);
+                wp = std::abs(w[j*n1+i+1]);
+                da_off = 0.;
+                if (wm - 2.*wc + wp != 0.)
+                    da_off = 0.5*(wm - wp) / (wm - 2.*wc + wp);
+                wm = std::abs(w[(j-1)*n1+i]);
+                wp = std::abs(w[(j+1)*n1+i]);
+                db_off = 0.;
+                if (wm - 2.*wc + wp != 0.)
+                    db_off = 0.5*(wm - wp) / (wm - 2.*wc + wp);
+                da_off = std::min(std::max(da_off, -0.5), 0.5);
+                db_off = std::min(std::max(db_off, -0.5), 0.5);
+
+                core = allpts[start+j*n1+i] + da_off*da*u1 + db_off*db*u2;
+                _cores[p].push_back(core);
+                _corevort[p].push_back(w[j*n1+i]);
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Traces streamlines, finds vortex cores, and traces streamlines from the cores
+// on the first cut plane
+//
+/******************************************************************************/
+void Streamlines::compute ( const Eigen::Vector3d & uinfvec,
+                            const double & minf,
+                            const std::vector<Panel *> & allsurf,
+                            const std::vector<Panel *> & allwake )
+{
+    integrate(_seeds, uinfvec, minf, allsurf, allwake, _lines, _linevels);
+
+    findCores(uinfvec, minf, allsurf, allwake);
+    _corelines.resize(0);
+    _corelinevels.resize(0);
+    if ( _tracecores && (_cores.size() > 0) )
+        integrate(_cores[0], uinfvec, minf, allsurf, allwake, _corelines,
+                  _corelinevels);
+}
+
+/******************************************************************************/
+//
+// Writes a set of polylines to a legacy VTK file
+//
+/******************************************************************************/
+int Streamlines::writePolylines ( const std::string & fname,
+                   const std::vector< std::vector<Eigen::Vector3d> > & lines,
+                   const std::vector< std::vector<Eigen::Vector3d> > & linevels
+                                ) const
+{
+    unsigned int i, j, nlines, npts, counter;
+    std::ofstream f;
+
+    f.open(fname.c_str());
+    if (! f.is_open())
+    {
+        print_warning("Streamlines::writePolylines",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+
+    // Header
+
+    f << "# vtk DataFile Version 3.0" << std::endl;
+    f << casename << std::endl;
+    f << "ASCII" << std::endl;
+    f << "DATASET POLYDATA" << std::endl;
+
+    // Points
+
+    nlines = lines.size();
+    npts = 0;
+    for ( i = 0; i < nlines; i++ )
+    {
+        npts += lines[i].size();
+    }
+    f << "POINTS " << npts << " double" << std::endl;
+    f.setf(std::ios_base::scientific);
+    for ( i = 0; i < nlines; i++ )
+    {
+        for ( j = 0; j < lines[i].size(); j++ )
+        {
+            f << std::setprecision(7) << std::setw(16) << std::left
+              << lines[i][j](0);
+            f << std::setprecision(7) << std::setw(16) << std::left
+              << lines[i][j](1);
+            f << std::setprecision(7) << std::setw(16) << std::left
+              << lines[i][j](2) << std::endl;
+        }
+    }
+
+    // Polylines
+
+    f << "LINES " << nlines << " " << npts + nlines << std::endl;
+    counter = 0;
+    for ( i = 0; i < nlines; i++ )
+    {
+        f << lines[i].size();
+        for ( j = 0; j < lines[i].size(); j++ )
+        {
+            f << " " << counter;
+            counter += 1;
+        }
+        f << std::endl;
+    }
+
+    // Velocity
+
+    f << "POINT_DATA " << npts << std::endl;
+    f << "Vectors velocity double" << std::endl;
+    for ( i = 0; i < nlines; i++ )
+    {
+        for ( j = 0; j < linevels[i].size(); j++ )
+        {
+            f << std::setprecision(7) << std::setw(16) << std::left
+              << linevels[i][j](0);
+            f << std::setprecision(7) << std::setw(16) << std::left
+              << linevels[i][j](1);
+            f << std::setprecision(7) << std::setw(16) << std::left
+              << linevels[i][j](2) << std::endl;
+        }
+    }
+    f.close();
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Writes streamlines and vortex core trajectories as VTK polylines
+//
+/******************************************************************************/
+int Streamlines::writeViz ( const std::string & casename ) const
+{
+    if (writePolylines("visualization/" + casename + "_streamlines.vtk",
+                       _lines, _linevels) != 0)
+        return 1;
+
+    if (_corelines.size() > 0)
+    {
+        if (writePolylines("visualization/" + casename + "_vortex_cores.vtk",
+                           _corelines, _corelinevels) != 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Writes vortex cores found on each cut plane to CSV
+//
+/******************************************************************************/
+int Streamlines::writeCores ( const std::string & casename ) const
+{
+    unsigned int i, j;
+    std::ofstream f;
+    std::string fname;
+
+    if (_cutplanes.size() == 0)
+        return 0;
+
+    fname = "postprocessing/" + casename + "_vortex_cores.csv";
+    f.open(fname.c_str(), std::fstream::out);
+    if (! f.is_open())
+    {
+        print_warning("Streamlines::writeCores",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+    f << "\"Plane\",\"X\",\"Y\",\"Z\",\"NormalVorticity\"" << std::endl;
+
+    f.setf(std::ios_base::scientific);
+    f << std::setprecision(7);
+    for ( i = 0; i < _cores.size(); i++ )
+    {
+        for ( j = 0; j < _cores[i].size(); j++ )
+        {
+            f << "\"" << _cutplanes[i].name << "\",";
+            f << _cores[i][j](0) << ",";
+            f << _cores[i][j](1) << ",";
+            f << _cores[i][j](2) << ",";
+            f << _corevort[i][j] << std::endl;
+        }
+    }
+    f.close();
+
+    return 0;
+}
@@ -0,0 +1,391 @@
+#include <vector>
+#include <map>
+#include <cmath>
+#include <Eigen/Dense>
+#include "panel.h"
+#include "surface_gradient.h"
+
+/******************************************************************************/
+//
+// SurfaceGradient class. Precomputed sparse surface gradient operator for
+// computing surface velocities of all panels at once.
+//
+/******************************************************************************/
+
+/******************************************************************************/
+//
+// Adds a coefficient to a stencil, combining entries with the same column
+//
+/******************************************************************************/
+void add_stencil_entry ( unsigned int col, const Eigen::Vector3d & coef,
+                         std::vector<unsigned int> & cols,
+                         std::vector<double> & coefs )
+{
+    unsigned int i, nentries;
+
+    nentries = cols.size();
+    for ( i = 0; i < nentries; i++ )
+    {
+        if (cols[i] == col)
+        {
+            coefs[3*i+0] += coef(0);
+            coefs[3*i+1] += coef(1);
+            coefs[3*i+2] += coef(2);
+            return;
+        }
+    }
+    cols.push_back(col);
+    coefs.push_back(coef(0));
+    coefs.push_back(coef(1));
+    coefs.push_back(coef(2));
+}
+
+/******************************************************************************/
+//
+// Constructor
+//
+/******************************************************************************/
+SurfaceGradient::SurfaceGradient ()
+{
+    _panels.resize(0);
+    _offsets.resize(1, 0);
+    _cols.resize(0);
+    _coefs.resize(0);
+    _norms.resize(0);
+    _mu.resize(0);
+    _sigma.resize(0);
+    _leastsquares = false;
+}
+
+/******************************************************************************/
+//
+// Central difference stencil in grid coordinates, one-sided at edges, times
+// the inverse grid jacobian. Same as Panel::computeVelocity.
+//
+/******************************************************************************/
+void SurfaceGradient::centralStencil ( unsigned int pidx,
+                          const std::map<const Panel *, unsigned int> & index,
+                          std::vector<unsigned int> & cols,
+                          std::vector<double> & coefs ) const
+{
+    Panel * pan;
+    Eigen::Vector3d dxi, deta;
+
+    pan = _panels[pidx];
+    dxi = pan->inverseJacobian().col(0);
+    deta = pan->inverseJacobian().col(1);
+    cols.resize(0);
+    coefs.resize(0);
+
+    if (pan->frontNeighbor() == NULL)
+    {
+        add_stencil_entry(pidx, deta, cols, coefs);
+        add_stencil_entry(index.at(pan->backNeighbor()), -deta, cols, coefs);
+    }
+    else if (pan->backNeighbor() == NULL)
+    {
+        add_stencil_entry(index.at(pan->frontNeighbor()), deta, cols, coefs);
+        add_stencil_entry(pidx, -deta, cols, coefs);
+    }
+    else
+    {
+        add_stencil_entry(index.at(pan->frontNeighbor()), 0.5*deta, cols,
+                          coefs);
+        add_stencil_entry(index.at(pan->backNeighbor()), -0.5*deta, cols,
+                          coefs);
+    }
+
+    if (pan->rightNeighbor() == NULL)
+    {
+        add_stencil_entry(pidx, dxi, cols, coefs);
+        add_stencil_entry(index.at(pan->leftNeighbor()), -dxi, cols, coefs);
+    }
+    else if (pan->leftNeighbor() == NULL)
+    {
+        add_stencil_entry(index.at(pan->rightNeighbor()), dxi, cols, coefs);
+        add_stencil_entry(pidx, -dxi, cols, coefs);
+    }
+    else
+    {
+        add_stencil_entry(index.at(pan->rightNeighbor()), 0.5*dxi, cols, coefs);
+        add_stencil_entry(index.at(pan->leftNeighbor()), -0.5*dxi, cols, coefs);
+    }
+}
+
+/******************************************************************************/
+//
+// Least-squares stencil. The gradient in the panel's tangent plane is fit to
+// differences in doublet strength to the neighbors and their neighbors in
+// the other grid direction, weighted by inverse distance squared. Distances
+// are projected onto the tangent plane.
+//
+/******************************************************************************/
+int SurfaceGradient::leastSquaresStencil ( unsigned int pidx,
+                          const std::map<const Panel *, unsigned int> & index,
+                          std::vector<unsigned int> & cols,
+                          std::vector<double> & coefs ) const
+{
+    unsigned int i, j, nnbrs;
+    Panel * pan, * nbr;
+    std::vector<Panel *> nbrs, cands;
+    Eigen::Vector3d norm, t1, t2, d, coef, selfcoef;
+    Eigen::Matrix2d M, Minv;
+    Eigen::Vector2d a, g;
+    std::vector<Eigen::Vector2d> as;
+    std::vector<double> weights;
+    double w;
+
+    pan = _panels[pidx];
+
+    // Neighbors, and neighbors of left and right in the front and back
+    // directions and vice versa
+
+    cands.push_back(pan->frontNeighbor());
+    cands.push_back(pan->backNeighbor());
+    cands.push_back(pan->rightNeighbor());
+    cands.push_back(pan->leftNeighbor());
+    for ( i = 0; i < 2; i++ )
+    {
+        nbr = cands[i];
+        if (nbr != NULL)
+        {
+            cands.push_back(nbr->rightNeighbor());
+            cands.push_back(nbr->leftNeighbor());
+        }
+        nbr = cands[i+2];
+        if (nbr != NULL)
+        {
+            cands.push_back(nbr->frontNeighbor());
+            cands.push_back(nbr->backNeighbor());
+        }
+    }
+    for ( i = 0; i < cands.size(); i++ )
+    {
+        if ( (cands[i] == NULL) || (cands[i] == pan) )
+            continue;
+        for ( j = 0; j < nbrs.size(); j++ )
+        {
+            if (nbrs[j] == cands[i])
+                break;
+        }
+        if (j == nbrs.size())
+            nbrs.push_back(cands[i]);
+    }
+    nnbrs = nbrs.size();
+    if (nnbrs < 2)
+        return 1;
+
+    // Tangent plane basis
+
+    norm = pan->normal();
+    if ( (std::abs(norm(0)) <= std::abs(norm(1))) &&
+         (std::abs(norm(0)) <= std::abs(norm(2))) )
+        t1 = norm.cross(Eigen::Vector3d::UnitX());
+    else if (std::abs(norm(1)) <= std::abs(norm(2)))
+        t1 = norm.cross(Eigen::Vector3d::UnitY());
+    else
+        t1 = norm.cross(Eigen::Vector3d::UnitZ());
+    t1.normalize();
+    t2 = norm.cross(t1);
+
+    // Weighted normal equations
+
+    M.setZero();
+    for ( i = 0; i < nnbrs; i++ )
+    {
+        d = nbrs[i]->centroid() - pan->centroid();
+        a << d.dot(t1), d.dot(t2);
+        w = 1./a.squaredNorm();
+        M += w*a*a.transpose();
+        as.push_back(a);
+        weights.push_back(w);
+    }
+    if (std::abs(M.determinant()) < 1.E-12*std::pow(M.trace(),2.))
+        return 1;
+    Minv = M.inverse();
+
+    cols.resize(0);
+    coefs.resize(0);
+    selfcoef.setZero();
+    for ( i = 0; i < nnbrs; i++ )
+    {
+        g = weights[i]*Minv*as[i];
+        coef = g(0)*t1 + g(1)*t2;
+        add_stencil_entry(index.at(nbrs[i]), coef, cols, coefs);
+        selfcoef -= coef;
+    }
+    add_stencil_entry(pidx, selfcoef, cols, coefs);
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Builds the operator. Panels with too few neighbors for the least-squares
+// fit use the central difference stencil.
+//
+/******************************************************************************/
+void SurfaceGradient::setup ( const std::vector<Panel *> & panels,
+                              bool least_squares )
+{
+    unsigned int i, j, npanels;
+    std::vector<unsigned int> cols;
+    std::vector<double> coefs;
+
+    _panels = panels;
+    _leastsquares = least_squares;
+    npanels = _panels.size();
+    _index.clear();
+    for ( i = 0; i < npanels; i++ )
+    {
+        _index[_panels[i]] = i;
+    }
+    _offsets.resize(npanels+1);
+    _offsets[0] = 0;
+    _cols.resize(0);
+    _coefs.resize(0);
+    _norms.resize(3*npanels);
+    for ( i = 0; i < npanels; i++ )
+    {
+        if ( (! least_squares) ||
+             (leastSquaresStencil(i, _index, cols, coefs) != 0) )
+            centralStencil(i, _index, cols, coefs);
+        for ( j = 0; j < cols.size(); j++ )
+        {
+            _cols.push_back(cols[j]);
+        }
+        _coefs.insert(_coefs.end(), coefs.begin(), coefs.end());
+        _offsets[i+1] = _cols.size();
+        for ( j = 0; j < 3; j++ )
+        {
+            _norms[3*i+j] = _panels[i]->normal()(j);
+        }
+    }
+    _mu.resize(npanels);
+    _sigma.resize(npanels);
+}
+
+/******************************************************************************/
+//
+// Recomputes stencils of changed panels and of panels whose stencils contain
+// them, in place
+//
+/******************************************************************************/
+void SurfaceGradient::updateStencils ( const std::vector<bool> & changed )
+{
+    unsigned int i, j, k, npanels, nentries;
+    std::vector<unsigned int> rows, cols;
+    std::vector<double> coefs;
+    bool affected;
+
+    npanels = _panels.size();
+    for ( i = 0; i < npanels; i++ )
+    {
+        affected = changed[i];
+        for ( k = _offsets[i]; (k < _offsets[i+1]) && (! affected); k++ )
+        {
+            if (changed[_cols[k]])
+                affected = true;
+        }
+        if (affected)
+            rows.push_back(i);
+    }
+
+    for ( j = 0; j < rows.size(); j++ )
+    {
+        i = rows[j];
+        if ( (! _leastsquares) ||
+             (leastSquaresStencil(i, _index, cols, coefs) != 0) )
+            centralStencil(i, _index, cols, coefs);
+
+        nentries = _offsets[i+1] - _offsets[i];
+        if (cols.size() != nentries)
+        {
+            setup(_panels, _leastsquares);
+            return;
+        }
+        for ( k = 0; k < nentries; k++ )
+        {
+            if (cols[k] != _cols[_offsets[i]+k])
+            {
+                setup(_panels, _leastsquares);
+                return;
+            }
+        }
+        for ( k = 0; k < 3*nentries; k++ )
+        {
+            _coefs[3*_offsets[i]+k] = coefs[k];
+        }
+        for ( k = 0; k < 3; k++ )
+        {
+            _norms[3*i+k] = _panels[i]->normal()(k);
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Computes surface velocity of all panels: gradient of doublet strength plus
+// source strength times normal plus freestream. Singularity strengths are
+// gathered into contiguous arrays first. Work is shared among the threads of
+// the enclosing parallel region.
+//
+/******************************************************************************/
+void SurfaceGradient::computeVelocity ( const Eigen::Vector3d & uinfvec )
+{
+    unsigned int i, k, npanels;
+    double gx, gy, gz, mu;
+    Eigen::Vector3d vel;
+
+    npanels = _panels.size();
+
+#pragma omp for private(i)
+    for ( i = 0; i < npanels; i++ )
+    {
+        _mu[i] = _panels[i]->doubletStrength();
+        _sigma[i] = _panels[i]->sourceStrength();
+    }
+
+#pragma omp for private(i,k,gx,gy,gz,mu,vel)
+    for ( i = 0; i < npanels; i++ )
+    {
+        gx = 0.;
+        gy = 0.;
+        gz = 0.;
+        for ( k = _offsets[i]; k < _offsets[i+1]; k++ )
+        {
+            mu = _mu[_cols[k]];
+            gx += _coefs[3*k+0]*mu;
+            gy += _coefs[3*k+1]*mu;
+            gz += _coefs[3*k+2]*mu;
+        }
+        vel(0) = gx + _sigma[i]*_norms[3*i+0] + uinfvec(0);
+        vel(1) = gy + _sigma[i]*_norms[3*i+1] + uinfvec(1);
+        vel(2) = gz + _sigma[i]*_norms[3*i+2] + uinfvec(2);
+        _panels[i]->setVelocity(vel);
+    }
+}
+
+/******************************************************************************/
+//
+// Transposed product with the operator, used for adjoint sensitivities.
+// Entries are scattered to columns, so this runs on one thread.
+//
+/******************************************************************************/
+void SurfaceGradient::transposeProduct ( const std::vector<double> & w,
+                                         std::vector<double> & g ) const
+{
+    unsigned int i, k, npanels;
+
+    npanels = _panels.size();
+    g.assign(npanels, 0.);
+    for ( i = 0; i < npanels; i++ )
+    {
+        for ( k = _offsets[i]; k < _offsets[i+1]; k++ )
+        {
+            g[_cols[k]] += _coefs[3*k+0]*w[3*i+0]
+                         + _coefs[3*k+1]*w[3*i+1]
+                         + _coefs[3*k+2]*w[3*i+2];
+        }
+    }
+}
@@ -26,19 +26,79 @@ Vertex::Vertex ()
     _y = 0.0;
     _z = 0.0;
     _npanels = 0;
-    _panels.resize(0);
+    _ownpanels.resize(0);
+    _panels = _ownpanels.data();
     _vizcoords = false;
     _xviz = 0.;
     _yviz = 0.;
     _zviz = 0.;
+    _inccoords = false;
     _xinc = 0.;
     _yinc = 0.;
     _zinc = 0.;
-    _data.resize(Vertex::dataSize);
-    for ( i = 0; i < Vertex::dataSize; i++ ) { _data[i] = 0.; }
+    for ( i = 0; i < Vertex::dataSize; i++ ) { _owndata[i] = 0.; }
+    _data = _owndata;
+    _stride = 1;
     _waketime = 0.;
 }
 
+/******************************************************************************/
+//
+// Copy constructor and copy assignment. The copy holds its own data and
+// panel list even if the original is attached to a VertexStore.
+//
+/******************************************************************************/
+Vertex::Vertex ( const Vertex & vert )
+{
+    *this = vert;
+}
+
+Vertex & Vertex::operator= ( const Vertex & vert )
+{
+    unsigned int i;
+
+    if (this == &vert)
+        return *this;
+
+    _idx = vert._idx;
+    _x = vert._x;
+    _y = vert._y;
+    _z = vert._z;
+    _ownpanels.assign(vert._panels, vert._panels + vert._npanels);
+    _panels = _ownpanels.data();
+    _npanels = vert._npanels;
+    _vizcoords = vert._vizcoords;
+    _xviz = vert._xviz;
+    _yviz = vert._yviz;
+    _zviz = vert._zviz;
+    _inccoords = vert._inccoords;
+    _xinc = vert._xinc;
+    _yinc = vert._yinc;
+    _zinc = vert._zinc;
+    for ( i = 0; i < Vertex::dataSize; i++ ) { _owndata[i] = vert.data(i); }
+    _data = _owndata;
+    _stride = 1;
+    _waketime = vert._waketime;
+
+    return *this;
+}
+
+/******************************************************************************/
+//
+// Attaches to storage in a VertexStore. Data and panel references must
+// already have been copied there.
+//
+/******************************************************************************/
+void Vertex::attach ( double * data, unsigned int stride, Panel ** panels,
+                      unsigned int npanels )
+{
+    _data = data;
+    _stride = stride;
+    _panels = panels;
+    _npanels = npanels;
+    std::vector<Panel *>().swap(_ownpanels);
+}
+
 /******************************************************************************/
 //
 // Set/access index
@@ -188,8 +248,14 @@ int Vertex::addPanel ( Panel * panel )
         }
     }
 
+    // Panels added after attaching to a VertexStore are not part of its
+    // adjacency, so the vertex goes back to its own panel list
+
+    if (_panels != _ownpanels.data())
+        _ownpanels.assign(_panels, _panels + _npanels);
+    _ownpanels.push_back(panel);
+    _panels = _ownpanels.data();
     _npanels += 1;
-    _panels.push_back(panel);
 
     return 0;
 }
@@ -227,14 +293,14 @@ unsigned int Vertex::nPanels () const { return _npanels; }
 int Vertex::setData ( unsigned int idx, const double & var )
 {
 #ifdef DEBUG
-    if (idx >= _data.size())
+    if (idx >= unsigned(Vertex::dataSize))
     {
         conditional_stop(1, "Vertex::setData", "Index out of range.");
         return 1;
     }
 #endif
 
-    _data[idx] = var;
+    _data[idx*_stride] = var;
     
     return 0;
 }
@@ -242,11 +308,11 @@ int Vertex::setData ( unsigned int idx, const double & var )
 const double & Vertex::data ( unsigned int idx ) const
 {
 #ifdef DEBUG
-    if (idx >= _data.size())
+    if (idx >= unsigned(Vertex::dataSize))
         conditional_stop(1, "Vertex::data", "Index out of range.");
 #endif
 
-    return _data[idx];
+    return _data[idx*_stride];
 }
 
 /******************************************************************************/
@@ -273,7 +339,7 @@ void Vertex::averageFromPanels ()
     
     for ( i = 0; i < Vertex::firstBLData; i++ )
     {
-        _data[i] = 0.;
+        _data[i*_stride] = 0.;
     }
     weightsum = 0.;
     for ( i = 0; i < _npanels; i++ )
@@ -284,19 +350,19 @@ void Vertex::averageFromPanels ()
         dz = zInc() - cen(2);
         dist = std::sqrt(std::pow(dx,2.) + std::pow(dy,2.) + std::pow(dz,2.));
         _data[0] += _panels[i]->sourceStrength()/dist;
-        _data[1] += _panels[i]->doubletStrength()/dist;
-        _data[2] += _panels[i]->velocityComp()(0)/dist;
-        _data[3] += _panels[i]->velocityComp()(1)/dist;
-        _data[4] += _panels[i]->velocityComp()(2)/dist;
-        _data[5] += _panels[i]->pressure()/dist;
-        _data[6] += _panels[i]->pressureCoefficient()/dist;
-        _data[7] += _panels[i]->mach()/dist;
-        _data[8] += _panels[i]->density()/dist;
+        _data[_stride] += _panels[i]->doubletStrength()/dist;
+        _data[2*_stride] += _panels[i]->velocityComp()(0)/dist;
+        _data[3*_stride] += _panels[i]->velocityComp()(1)/dist;
+        _data[4*_stride] += _panels[i]->velocityComp()(2)/dist;
+        _data[5*_stride] += _panels[i]->pressure()/dist;
+        _data[6*_stride] += _panels[i]->pressureCoefficient()/dist;
+        _data[7*_stride] += _panels[i]->mach()/dist;
+        _data[8*_stride] += _panels[i]->density()/dist;
         weightsum += 1./dist;
     }
     for ( i = 0; i < Vertex::firstBLData; i++ )
     {
-        _data[i] /= weightsum;
+        _data[i*_stride] /= weightsum;
     }
 }
 
@@ -0,0 +1,390 @@
+#include <vector>
+#include <map>
+#include <cmath>
+#include <Eigen/Core>
+#include "panel.h"
+#include "vertex.h"
+#include "vertex_store.h"
+
+/******************************************************************************/
+//
+// VertexStore class. Contiguous storage of vertex data and vertex to panel
+// adjacency for a set of vertices.
+//
+/******************************************************************************/
+
+/******************************************************************************/
+//
+// Constructor
+//
+/******************************************************************************/
+VertexStore::VertexStore ()
+{
+    _verts.resize(0);
+    _data.resize(0);
+    _paneloffsets.resize(1, 0);
+    _panels.resize(0);
+    _adjcols.resize(0);
+    _pvweights.resize(0);
+    _cols.resize(0);
+    _vertoffsets.resize(1, 0);
+    _vertidx.resize(0);
+    _vpweights.resize(0);
+    _paneldata.resize(0);
+    _extoffsets.resize(1, 0);
+    _extverts.resize(0);
+    _extweights.resize(0);
+}
+
+/******************************************************************************/
+//
+// Copies data and neighboring panels of vertices into the store and attaches
+// the vertices to it. New arrays are filled before the vertices are pointed
+// at them, so vertices already attached to this store can be attached again.
+// Also sets up the sparsity of the averaging operators and computes weights.
+//
+/******************************************************************************/
+void VertexStore::attach ( const std::vector<Vertex *> & verts )
+{
+    unsigned int i, j, nverts, npanels, ncols, npverts;
+    std::vector<double> data;
+    std::vector<unsigned int> paneloffsets;
+    std::vector<Panel *> panels;
+    std::map<const Panel *, unsigned int> colidx;
+    std::map<const Panel *, unsigned int>::iterator colit;
+    std::map<const Vertex *, unsigned int> vertidx;
+    std::map<const Vertex *, unsigned int>::iterator vertit;
+
+    nverts = verts.size();
+    data.resize(Vertex::dataSize*nverts);
+    paneloffsets.resize(nverts+1);
+    npanels = 0;
+    for ( j = 0; j < nverts; j++ )
+    {
+        npanels += verts[j]->nPanels();
+    }
+    panels.resize(npanels);
+
+    paneloffsets[0] = 0;
+    for ( j = 0; j < nverts; j++ )
+    {
+        for ( i = 0; i < Vertex::dataSize; i++ )
+        {
+            data[i*nverts+j] = verts[j]->data(i);
+        }
+        npanels = verts[j]->nPanels();
+        for ( i = 0; i < npanels; i++ )
+        {
+            panels[paneloffsets[j]+i] = verts[j]->panel(i);
+        }
+        paneloffsets[j+1] = paneloffsets[j] + npanels;
+    }
+
+    _verts = verts;
+    _data.swap(data);
+    _paneloffsets.swap(paneloffsets);
+    _panels.swap(panels);
+    for ( j = 0; j < nverts; j++ )
+    {
+        _verts[j]->attach(&_data[j], nverts, _panels.data() + _paneloffsets[j],
+                          _paneloffsets[j+1] - _paneloffsets[j]);
+    }
+
+    // Distinct neighboring panels in order of first appearance, so that the
+    // panels of a contiguous range of vertices are mostly contiguous too
+
+    npanels = _panels.size();
+    _adjcols.resize(npanels);
+    _cols.resize(0);
+    for ( i = 0; i < npanels; i++ )
+    {
+        colit = colidx.find(_panels[i]);
+        if (colit == colidx.end())
+        {
+            colidx[_panels[i]] = _cols.size();
+            _adjcols[i] = _cols.size();
+            _cols.push_back(_panels[i]);
+        }
+        else
+            _adjcols[i] = colit->second;
+    }
+
+    // Vertices of each distinct panel
+
+    for ( j = 0; j < nverts; j++ )
+    {
+        vertidx[_verts[j]] = j;
+    }
+    ncols = _cols.size();
+    _vertoffsets.resize(ncols+1);
+    _vertoffsets[0] = 0;
+    _vertidx.resize(0);
+    for ( j = 0; j < ncols; j++ )
+    {
+        npverts = _cols[j]->nVertices();
+        for ( i = 0; i < npverts; i++ )
+        {
+            vertit = vertidx.find(&_cols[j]->vertex(i));
+            if (vertit == vertidx.end())
+                break;
+            _vertidx.push_back(vertit->second);
+        }
+        if (i < npverts)
+            _vertidx.resize(_vertoffsets[j]);
+        _vertoffsets[j+1] = _vertidx.size();
+    }
+
+    _pvweights.resize(_panels.size());
+    _vpweights.resize(_vertidx.size());
+    _paneldata.resize(ncols*Vertex::firstBLData);
+    computeWeights();
+}
+
+/******************************************************************************/
+//
+// Computes inverse distance weights, normalized so that the weights of each
+// vertex or panel sum to 1. Panel to vertex weights use incompressible
+// coordinates, and vertex to panel weights use actual coordinates, as in
+// Vertex::averageFromPanels and Panel::averageFromVertices.
+//
+/******************************************************************************/
+void VertexStore::computeWeights ()
+{
+    unsigned int i, j, nverts, ncols;
+    double dx, dy, dz, dist, weightsum;
+    Eigen::Vector3d cen;
+    Vertex * vert;
+
+    nverts = _verts.size();
+    ncols = _cols.size();
+
+#pragma omp parallel for private(i,j,dx,dy,dz,dist,weightsum,cen)
+    for ( j = 0; j < nverts; j++ )
+    {
+        weightsum = 0.;
+        for ( i = _paneloffsets[j]; i < _paneloffsets[j+1]; i++ )
+        {
+            cen = _panels[i]->centroid();
+            dx = _verts[j]->xInc() - cen(0);
+            dy = _verts[j]->yInc() - cen(1);
+            dz = _verts[j]->zInc() - cen(2);
+            dist = std::sqrt(std::pow(dx,2.) + std::pow(dy,2.) +
+                             std::pow(dz,2.));
+            _pvweights[i] = 1./dist;
+            weightsum += 1./dist;
+        }
+        for ( i = _paneloffsets[j]; i < _paneloffsets[j+1]; i++ )
+        {
+            _pvweights[i] /= weightsum;
+        }
+    }
+
+#pragma omp parallel for private(i,j,dx,dy,dz,dist,weightsum,cen,vert)
+    for ( j = 0; j < ncols; j++ )
+    {
+        cen = _cols[j]->centroid();
+        weightsum = 0.;
+        for ( i = _vertoffsets[j]; i < _vertoffsets[j+1]; i++ )
+        {
+            vert = _verts[_vertidx[i]];
+            dx = vert->x() - cen(0);
+            dy = vert->y() - cen(1);
+            dz = vert->z() - cen(2);
+            dist = std::sqrt(std::pow(dx,2.) + std::pow(dy,2.) +
+                             std::pow(dz,2.));
+            _vpweights[i] = 1./dist;
+            weightsum += 1./dist;
+        }
+        for ( i = _vertoffsets[j]; i < _vertoffsets[j+1]; i++ )
+        {
+            _vpweights[i] /= weightsum;
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Access to vertex data
+//
+/******************************************************************************/
+unsigned int VertexStore::nVerts () const { return _verts.size(); }
+
+const double * VertexStore::field ( unsigned int idx ) const
+{
+    return &_data[idx*_verts.size()];
+}
+
+/******************************************************************************/
+//
+// Sets edge extrapolations, sorted by stage
+//
+/******************************************************************************/
+void VertexStore::setEdgeExtrapolations ( const std::vector<edge_extrapolation>
+                                          & extraps )
+{
+    unsigned int i, j, nverts, nextraps, stage, nstages;
+    std::map<const Vertex *, unsigned int> vertidx;
+
+    nverts = _verts.size();
+    for ( j = 0; j < nverts; j++ )
+    {
+        vertidx[_verts[j]] = j;
+    }
+
+    nextraps = extraps.size();
+    nstages = 0;
+    for ( i = 0; i < nextraps; i++ )
+    {
+        if (extraps[i].stage + 1 > nstages)
+            nstages = extraps[i].stage + 1;
+    }
+
+    _extoffsets.resize(nstages+1);
+    _extverts.resize(0);
+    _extweights.resize(0);
+    for ( stage = 0; stage < nstages; stage++ )
+    {
+        _extoffsets[stage] = _extweights.size()/3;
+        for ( i = 0; i < nextraps; i++ )
+        {
+            if (extraps[i].stage != stage)
+                continue;
+            for ( j = 0; j < 3; j++ )
+            {
+                _extverts.push_back(vertidx.at(extraps[i].verts[j]));
+                _extweights.push_back(extraps[i].weights[j]);
+            }
+        }
+    }
+    _extoffsets[nstages] = _extweights.size()/3;
+}
+
+/******************************************************************************/
+//
+// Averages panel quantities to vertices. Panel quantities are gathered into
+// rows first, and then multiplied by the sparse panel to vertex weights.
+//
+/******************************************************************************/
+void VertexStore::averageFromPanels ()
+{
+    unsigned int i, j, k, nverts, ncols;
+    double sum[Vertex::firstBLData];
+    const double * row;
+    double * prow;
+    Panel * pan;
+
+    nverts = _verts.size();
+    ncols = _cols.size();
+
+    // Gather inviscid panel quantities. Only these are originally computed
+    // at panel centroids.
+
+#pragma omp for private(j,pan,prow)
+    for ( j = 0; j < ncols; j++ )
+    {
+        pan = _cols[j];
+        prow = &_paneldata[j*Vertex::firstBLData];
+        prow[0] = pan->sourceStrength();
+        prow[1] = pan->doubletStrength();
+        prow[2] = pan->velocityComp()(0);
+        prow[3] = pan->velocityComp()(1);
+        prow[4] = pan->velocityComp()(2);
+        prow[5] = pan->pressure();
+        prow[6] = pan->pressureCoefficient();
+        prow[7] = pan->mach();
+        prow[8] = pan->density();
+    }
+
+    // Sparse matrix product
+
+#pragma omp for private(i,j,k,sum,row)
+    for ( j = 0; j < nverts; j++ )
+    {
+        for ( k = 0; k < Vertex::firstBLData; k++ )
+        {
+            sum[k] = 0.;
+        }
+        for ( i = _paneloffsets[j]; i < _paneloffsets[j+1]; i++ )
+        {
+            row = &_paneldata[_adjcols[i]*Vertex::firstBLData];
+            for ( k = 0; k < Vertex::firstBLData; k++ )
+            {
+                sum[k] += _pvweights[i]*row[k];
+            }
+        }
+        for ( k = 0; k < Vertex::firstBLData; k++ )
+        {
+            _data[k*nverts+j] = sum[k];
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Extrapolates inviscid data to edge vertices, one stage at a time
+//
+/******************************************************************************/
+void VertexStore::extrapolateToEdges ()
+{
+    unsigned int i, k, nverts, nstages, stage, v0, v1, v2;
+    double w0, w1, w2;
+    double * field;
+
+    nverts = _verts.size();
+    nstages = _extoffsets.size() - 1;
+    for ( stage = 0; stage < nstages; stage++ )
+    {
+#pragma omp for private(i,k,v0,v1,v2,w0,w1,w2,field)
+        for ( i = _extoffsets[stage]; i < _extoffsets[stage+1]; i++ )
+        {
+            v0 = _extverts[3*i+0];
+            v1 = _extverts[3*i+1];
+            v2 = _extverts[3*i+2];
+            w0 = _extweights[3*i+0];
+            w1 = _extweights[3*i+1];
+            w2 = _extweights[3*i+2];
+            for ( k = 0; k < Vertex::firstBLData; k++ )
+            {
+                field = &_data[k*nverts];
+                field[v0] = w0*field[v0] + w1*field[v1] + w2*field[v2];
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+//
+// Averages skin friction coefficient and mass defect from vertices to panels.
+// Panels with vertices outside the store are skipped.
+//
+/******************************************************************************/
+void VertexStore::averageToPanels ()
+{
+    unsigned int i, j, nverts, ncols, vidx;
+    double cf, mdefect;
+    const double *cfs, *deltastars, *uedges;
+
+    nverts = _verts.size();
+    ncols = _cols.size();
+    if (nverts == 0)
+        return;
+    cfs = &_data[9*nverts];
+    deltastars = &_data[10*nverts];
+    uedges = &_data[12*nverts];
+
+#pragma omp parallel for private(i,j,vidx,cf,mdefect)
+    for ( j = 0; j < ncols; j++ )
+    {
+        if (_vertoffsets[j] == _vertoffsets[j+1])
+            continue;
+        cf = 0.;
+        mdefect = 0.;
+        for ( i = _vertoffsets[j]; i < _vertoffsets[j+1]; i++ )
+        {
+            vidx = _vertidx[i];
+            cf += _vpweights[i]*cfs[vidx];
+            mdefect += _vpweights[i]*deltastars[vidx]*uedges[vidx];
+        }
+        _cols[j]->setViscousAverages(cf, mdefect);
+    }
+}
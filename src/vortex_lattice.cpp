@@ -0,0 +1,351 @@
+#define _USE_MATH_DEFINES
+
+#include <vector>
+#include <cmath>
+#include <Eigen/Dense>
+#include "settings.h"
+#include "vertex.h"
+#include "section.h"
+#include "vortex_ring.h"
+#include "horseshoe_vortex.h"
+#include "vortex_lattice.h"
+
+/******************************************************************************/
+//
+// VortexLattice class. Vortex lattice on the camber surface of a wing.
+//
+/******************************************************************************/
+
+/******************************************************************************/
+//
+// Default constructor
+//
+/******************************************************************************/
+VortexLattice::VortexLattice ()
+{
+    _nspan = 0;
+    _nchord = 0;
+    _verts.resize(0);
+    _wakeverts.resize(0);
+    _rings.resize(0);
+    _horseshoes.resize(0);
+    _colloc.resize(0);
+    _norms.resize(0);
+    _qc.resize(0);
+    _chords.resize(0);
+    _beta = 1.;
+}
+
+/******************************************************************************/
+//
+// Copy constructor and assignment. Copies are empty.
+//
+/******************************************************************************/
+VortexLattice::VortexLattice ( const VortexLattice & )
+{
+    _nspan = 0;
+    _nchord = 0;
+    _beta = 1.;
+}
+
+VortexLattice & VortexLattice::operator= ( const VortexLattice & )
+{
+    _nspan = 0;
+    _nchord = 0;
+    _verts.resize(0);
+    _wakeverts.resize(0);
+    _rings.resize(0);
+    _horseshoes.resize(0);
+    _colloc.resize(0);
+    _norms.resize(0);
+    _qc.resize(0);
+    _chords.resize(0);
+    _beta = 1.;
+
+    return *this;
+}
+
+/******************************************************************************/
+//
+// Builds the lattice from the wing's sections. The camber line of each section
+// is the average of the top and bottom vertices, which are ordered from the
+// top trailing edge around the leading edge to the bottom trailing edge. The
+// last rings' trailing legs are a quarter panel behind the trailing edge.
+//
+/******************************************************************************/
+void VortexLattice::initialize ( std::vector<Section> & sections,
+                                 unsigned int nchord )
+{
+    unsigned int i, k, nrings;
+    std::vector<std::vector<Eigen::Vector3d> > camber;
+    Eigen::Vector3d top, bot, p, dir, le, te;
+    Vertex * vert;
+
+    _nspan = sections.size();
+    _nchord = nchord-1;
+    _beta = std::sqrt(1. - std::pow(minf,2.));
+    dir = uinfvec / uinf;
+
+    // Camber points in incompressible coordinates, from leading edge to
+    // trailing edge
+
+    camber.resize(_nspan);
+    _qc.resize(_nspan);
+    _chords.resize(_nspan);
+    for ( i = 0; i < _nspan; i++ )
+    {
+        camber[i].resize(nchord);
+        for ( k = 0; k < nchord; k++ )
+        {
+            vert = &sections[i].vert(nchord-1-k);
+            top << vert->xInc(), vert->yInc(), vert->zInc();
+            vert = &sections[i].vert(nchord-1+k);
+            bot << vert->xInc(), vert->yInc(), vert->zInc();
+            camber[i][k] = 0.5*(top + bot);
+        }
+
+        // Quarter chord point in actual coordinates, for sectional moments
+
+        le << sections[i].vert(nchord-1).x(), sections[i].vert(nchord-1).y(),
+              sections[i].vert(nchord-1).z();
+        te << 0.5*(sections[i].vert(0).x() + sections[i].vert(2*nchord-2).x()),
+              0.5*(sections[i].vert(0).y() + sections[i].vert(2*nchord-2).y()),
+              0.5*(sections[i].vert(0).z() + sections[i].vert(2*nchord-2).z());
+        _qc[i] = le + 0.25*(te - le);
+        _chords[i] = sections[i].chord();
+    }
+
+    // Ring corners at quarter chord of each camber panel, and points
+    // downstream of the trailing edge for the wake horseshoes
+
+    _verts.resize(_nspan*(_nchord+1));
+    _wakeverts.resize(_nspan);
+    for ( i = 0; i < _nspan; i++ )
+    {
+        for ( k = 0; k <= _nchord; k++ )
+        {
+            if (k < _nchord)
+                p = camber[i][k] + 0.25*(camber[i][k+1] - camber[i][k]);
+            else
+                p = camber[i][k] + 0.25*(camber[i][k] - camber[i][k-1]);
+            _verts[i*(_nchord+1)+k].setCoordinates(p(0), p(1), p(2));
+        }
+        p += _chords[i]*dir;
+        _wakeverts[i].setCoordinates(p(0), p(1), p(2));
+    }
+
+    // Rings, ordered so that positive circulation gives positive lift, with
+    // collocation points and normals of the camber panels
+
+    nrings = (_nspan-1)*_nchord;
+    _rings.clear();
+    _rings.resize(nrings);
+    _colloc.resize(nrings);
+    _norms.resize(nrings);
+    _horseshoes.clear();
+    _horseshoes.resize(_nspan-1);
+    for ( i = 0; i < _nspan-1; i++ )
+    {
+        for ( k = 0; k < _nchord; k++ )
+        {
+            _rings[i*_nchord+k].addVertex(&_verts[i*(_nchord+1)+k]);
+            _rings[i*_nchord+k].addVertex(&_verts[(i+1)*(_nchord+1)+k]);
+            _rings[i*_nchord+k].addVertex(&_verts[(i+1)*(_nchord+1)+k+1]);
+            _rings[i*_nchord+k].addVertex(&_verts[i*(_nchord+1)+k+1]);
+
+            _colloc[i*_nchord+k] = 0.5*(camber[i][k] + camber[i+1][k])
+                + 0.375*(camber[i][k+1] - camber[i][k]
+                +        camber[i+1][k+1] - camber[i+1][k]);
+            _norms[i*_nchord+k] = (camber[i+1][k+1] - camber[i][k]).cross(
+                                   camber[i+1][k] - camber[i][k+1]);
+            _norms[i*_nchord+k].normalize();
+        }
+
+        // Bound leg of the horseshoe cancels the last ring's trailing leg
+
+        _horseshoes[i].addVertex(&_wakeverts[i]);
+        _horseshoes[i].addVertex(&_verts[i*(_nchord+1)+_nchord]);
+        _horseshoes[i].addVertex(&_verts[(i+1)*(_nchord+1)+_nchord]);
+        _horseshoes[i].addVertex(&_wakeverts[i+1]);
+    }
+}
+
+/******************************************************************************/
+//
+// Number of rings, collocation points, and normals
+//
+/******************************************************************************/
+unsigned int VortexLattice::nRings () const { return _rings.size(); }
+
+const Eigen::Vector3d & VortexLattice::collocationPoint ( unsigned int ridx )
+                                                                          const
+{
+    return _colloc[ridx];
+}
+
+const Eigen::Vector3d & VortexLattice::normal ( unsigned int ridx ) const
+{
+    return _norms[ridx];
+}
+
+/******************************************************************************/
+//
+// Velocity induced by a ring with unit circulation, with its wake horseshoe
+// and mirror image
+//
+/******************************************************************************/
+Eigen::Vector3d VortexLattice::VCoeff ( unsigned int ridx, const double & x,
+                                        const double & y,
+                                        const double & z ) const
+{
+    Eigen::Vector3d vel;
+
+    vel = _rings[ridx].VCoeff(x, y, z, 0., true);
+    if (ridx % _nchord == _nchord-1)
+        vel += _horseshoes[ridx/_nchord].VCoeff(x, y, z, 0., true);
+
+    return vel;
+}
+
+/******************************************************************************/
+//
+// Sets circulation of a ring and its wake horseshoe
+//
+/******************************************************************************/
+void VortexLattice::setCirculation ( unsigned int ridx, const double & gamma )
+{
+    _rings[ridx].setCirculation(gamma);
+    if (ridx % _nchord == _nchord-1)
+        _horseshoes[ridx/_nchord].setCirculation(gamma);
+}
+
+/******************************************************************************/
+//
+// Velocity induced by the lattice and its mirror image
+//
+/******************************************************************************/
+Eigen::Vector3d VortexLattice::inducedVelocity ( const double & x,
+                                                 const double & y,
+                                                 const double & z ) const
+{
+    unsigned int i, nrings, nstrips;
+    Eigen::Vector3d vel;
+
+    vel << 0., 0., 0.;
+    nrings = _rings.size();
+    for ( i = 0; i < nrings; i++ )
+    {
+        vel += _rings[i].inducedVelocity(x, y, z, 0., true);
+    }
+    nstrips = _horseshoes.size();
+    for ( i = 0; i < nstrips; i++ )
+    {
+        vel += _horseshoes[i].inducedVelocity(x, y, z, 0., true);
+    }
+
+    return vel;
+}
+
+/******************************************************************************/
+//
+// Computes force and moment with the Kutta-Joukowski theorem on the spanwise
+// legs of the rings. The strength of a leg is the difference between the
+// circulations of the ring and the ring in front of it. Forces are corrected
+// for compressibility with 1/beta, as pressure coefficients in the panel
+// method. Sectional coefficients are computed for each strip per unit span
+// and averaged from the neighboring strips to the sections.
+//
+/******************************************************************************/
+void VortexLattice::computeForceMoment (
+                              const std::vector<VortexLattice *> & alllattice,
+                              const Eigen::Vector3d & momcen,
+                              Eigen::Vector3d & force, Eigen::Vector3d & moment,
+                              std::vector<double> & cl,
+                              std::vector<double> & cd,
+                              std::vector<double> & cm ) const
+{
+    unsigned int i, j, k, nlattice, nstrips, ridx;
+    double gamma, qinf, width, chord, lift, drag;
+    Eigen::Vector3d a, b, mid, vel, dl, f, r, qc, fstrip, mstrip;
+    std::vector<double> stripcl, stripcd, stripcm;
+
+    force << 0., 0., 0.;
+    moment << 0., 0., 0.;
+    qinf = 0.5*rhoinf*std::pow(uinf,2.);
+    nlattice = alllattice.size();
+    nstrips = _nspan-1;
+    stripcl.resize(nstrips);
+    stripcd.resize(nstrips);
+    stripcm.resize(nstrips);
+
+#pragma omp parallel for private(i,k,ridx,a,b,gamma,mid,dl,vel,j,f,r,qc,\
+                                 fstrip,mstrip,width,chord,lift,drag)
+    for ( i = 0; i < nstrips; i++ )
+    {
+        fstrip << 0., 0., 0.;
+        mstrip << 0., 0., 0.;
+        qc = 0.5*(_qc[i] + _qc[i+1]);
+        for ( k = 0; k < _nchord; k++ )
+        {
+            ridx = i*_nchord+k;
+            a << _verts[i*(_nchord+1)+k].x(), _verts[i*(_nchord+1)+k].y(),
+                 _verts[i*(_nchord+1)+k].z();
+            b << _verts[(i+1)*(_nchord+1)+k].x(),
+                 _verts[(i+1)*(_nchord+1)+k].y(),
+                 _verts[(i+1)*(_nchord+1)+k].z();
+            gamma = _rings[ridx].circulation();
+            if (k > 0)
+                gamma -= _rings[ridx-1].circulation();
+
+            mid = 0.5*(a + b);
+            dl = b - a;
+            vel = uinfvec;
+            for ( j = 0; j < nlattice; j++ )
+            {
+                vel += alllattice[j]->inducedVelocity(mid(0), mid(1), mid(2));
+            }
+            f = rhoinf*gamma*vel.cross(dl) / _beta;
+
+            // Moment arms in actual coordinates
+
+            r << mid(0)*_beta, mid(1), mid(2);
+            fstrip += f;
+            mstrip += (r - qc).cross(f);
+#pragma omp critical
+            moment += (r - momcen).cross(f);
+        }
+#pragma omp critical
+        force += fstrip;
+
+        // Strip coefficients per unit span in the wind frame
+
+        width = std::sqrt(std::pow(_qc[i+1](1) - _qc[i](1), 2.) +
+                          std::pow(_qc[i+1](2) - _qc[i](2), 2.));
+        chord = 0.5*(_chords[i] + _chords[i+1]);
+        lift = -fstrip(0)*sin(alpha*M_PI/180.)
+             +  fstrip(2)*cos(alpha*M_PI/180.);
+        drag =  fstrip(0)*cos(alpha*M_PI/180.)
+             +  fstrip(2)*sin(alpha*M_PI/180.);
+        stripcl[i] = lift / (qinf*chord*width);
+        stripcd[i] = drag / (qinf*chord*width);
+        stripcm[i] = mstrip(1) / (qinf*chord*chord*width);
+    }
+
+    // Average to sections
+
+    cl.resize(_nspan);
+    cd.resize(_nspan);
+    cm.resize(_nspan);
+    cl[0] = stripcl[0];
+    cd[0] = stripcd[0];
+    cm[0] = stripcm[0];
+    for ( i = 1; i < nstrips; i++ )
+    {
+        cl[i] = 0.5*(stripcl[i-1] + stripcl[i]);
+        cd[i] = 0.5*(stripcd[i-1] + stripcd[i]);
+        cm[i] = 0.5*(stripcm[i-1] + stripcm[i]);
+    }
+    cl[nstrips] = stripcl[nstrips-1];
+    cd[nstrips] = stripcd[nstrips-1];
+    cm[nstrips] = stripcm[nstrips-1];
+}
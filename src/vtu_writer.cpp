@@ -0,0 +1,408 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <stdint.h>
+#ifdef HAVE_ZLIB
+  #include <zlib.h>
+#endif
+#include "util.h"
+#include "vtu_writer.h"
+
+// Uncompressed size of zlib blocks, as in VTK's own writers
+
+const uint64_t vtu_blocksize = 32768;
+
+/******************************************************************************/
+//
+// VTUWriter class. Writes unstructured grids as binary XML VTK files (.vtu)
+// with appended raw data, optionally zlib-compressed and/or in single
+// precision. Grids written together at one iteration are grouped in a
+// multiblock file (.vtm), and iterations are indexed in a .pvd collection.
+//
+/******************************************************************************/
+
+/******************************************************************************/
+//
+// Byte order of this machine as a VTK byte_order attribute
+//
+/******************************************************************************/
+std::string vtu_byte_order ()
+{
+    uint16_t one;
+
+    one = 1;
+    if (*reinterpret_cast<unsigned char *>(&one) == 1)
+        return "LittleEndian";
+    else
+        return "BigEndian";
+}
+
+/******************************************************************************/
+//
+// Appends an array to a VTK appended data block. Uncompressed arrays have a
+// UInt64 byte count header. Compressed arrays have a header of UInt64 values:
+// number of blocks, uncompressed block size, uncompressed size of the last
+// block (0 if full), and compressed size of each block.
+//
+/******************************************************************************/
+void vtu_append_array ( const void *data, uint64_t nbytes, bool compress,
+                        std::vector<char> & appended )
+{
+    const char *bytes;
+
+    bytes = static_cast<const char *>(data);
+
+    if (! compress)
+    {
+        appended.insert(appended.end(), reinterpret_cast<char *>(&nbytes),
+                        reinterpret_cast<char *>(&nbytes) + sizeof(nbytes));
+        appended.insert(appended.end(), bytes, bytes + nbytes);
+        return;
+    }
+
+#ifdef HAVE_ZLIB
+    uint64_t nblocks, i, pos, blockbytes, start;
+    std::vector<uint64_t> header;
+    std::vector<char> cdata;
+    uLongf csize;
+
+    nblocks = (nbytes + vtu_blocksize - 1) / vtu_blocksize;
+    header.resize(3+nblocks);
+    header[0] = nblocks;
+    header[1] = vtu_blocksize;
+    header[2] = nbytes % vtu_blocksize;
+    cdata.resize(0);
+    for ( i = 0; i < nblocks; i++ )
+    {
+        pos = i*vtu_blocksize;
+        blockbytes = vtu_blocksize;
+        if (pos + blockbytes > nbytes)
+            blockbytes = nbytes - pos;
+        start = cdata.size();
+        csize = compressBound(blockbytes);
+        cdata.resize(start + csize);
+        compress2(reinterpret_cast<Bytef *>(&cdata[start]), &csize,
+                  reinterpret_cast<const Bytef *>(bytes + pos), blockbytes,
+                  Z_DEFAULT_COMPRESSION);
+        cdata.resize(start + csize);
+        header[3+i] = csize;
+    }
+
+    appended.insert(appended.end(), reinterpret_cast<char *>(&header[0]),
+                    reinterpret_cast<char *>(&header[0]) +
+                    header.size()*sizeof(uint64_t));
+    appended.insert(appended.end(), cdata.begin(), cdata.end());
+#else
+    conditional_stop(1, "vtu_append_array",
+                     "Compiled without zlib support.");
+#endif
+}
+
+/******************************************************************************/
+//
+// Appends a floating point array as Float64 or Float32 and writes its
+// DataArray element
+//
+/******************************************************************************/
+void vtu_append_float ( const std::vector<double> & data,
+                        const std::string & name, unsigned int ncomp,
+                        bool compress, bool float32, std::ostream & xml,
+                        std::vector<char> & appended )
+{
+    unsigned int i;
+    std::vector<float> fdata;
+
+    xml << "        <DataArray type=\"" << (float32 ? "Float32" : "Float64")
+        << "\"";
+    if (name != "")
+        xml << " Name=\"" << name << "\"";
+    xml << " NumberOfComponents=\"" << ncomp << "\" format=\"appended\""
+        << " offset=\"" << appended.size() << "\"/>" << std::endl;
+
+    if (float32)
+    {
+        fdata.resize(data.size());
+        for ( i = 0; i < data.size(); i++ )
+        {
+            fdata[i] = float(data[i]);
+        }
+        vtu_append_array(fdata.data(), fdata.size()*sizeof(float), compress,
+                         appended);
+    }
+    else
+        vtu_append_array(data.data(), data.size()*sizeof(double), compress,
+                         appended);
+}
+
+/******************************************************************************/
+//
+// Default constructor and destructor
+//
+/******************************************************************************/
+VTUWriter::VTUWriter ()
+{
+    _compress = false;
+    _float32 = false;
+    _background = false;
+    _status = 0;
+    _pvdentries.resize(0);
+    _grids.resize(0);
+    _gridfiles.resize(0);
+}
+
+VTUWriter::~VTUWriter ()
+{
+    wait();
+}
+
+/******************************************************************************/
+//
+// Set output options
+//
+/******************************************************************************/
+void VTUWriter::setOptions ( bool compress, bool float32, bool background )
+{
+    wait();
+
+#ifndef HAVE_ZLIB
+    if (compress)
+    {
+        print_warning("VTUWriter::setOptions",
+                      "Compiled without zlib. Writing uncompressed output.");
+        compress = false;
+    }
+#endif
+
+    _compress = compress;
+    _float32 = float32;
+    _background = background;
+}
+
+/******************************************************************************/
+//
+// Writes a single grid to a .vtu file
+//
+/******************************************************************************/
+int VTUWriter::writeGrid ( const std::string & fname,
+                           const vtu_grid & grid ) const
+{
+    std::ofstream f;
+    std::ostringstream xml;
+    std::vector<char> appended;
+    unsigned int i, npoints, ncells;
+
+    npoints = grid.points.size()/3;
+    ncells = grid.types.size();
+
+    // XML header and data array descriptions. Data is appended in the order
+    // arrays are described, so offsets are known as the header is built.
+
+    xml << "<?xml version=\"1.0\"?>" << std::endl;
+    xml << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\""
+        << vtu_byte_order() << "\" header_type=\"UInt64\"";
+    if (_compress)
+        xml << " compressor=\"vtkZLibDataCompressor\"";
+    xml << ">" << std::endl;
+    xml << "  <UnstructuredGrid>" << std::endl;
+    xml << "    <Piece NumberOfPoints=\"" << npoints << "\" NumberOfCells=\""
+        << ncells << "\">" << std::endl;
+
+    xml << "      <PointData>" << std::endl;
+    for ( i = 0; i < grid.pointdata.size(); i++ )
+    {
+        vtu_append_float(grid.pointdata[i].data, grid.pointdata[i].name,
+                         grid.pointdata[i].ncomp, _compress, _float32, xml,
+                         appended);
+    }
+    xml << "      </PointData>" << std::endl;
+
+    xml << "      <CellData>" << std::endl;
+    for ( i = 0; i < grid.celldata.size(); i++ )
+    {
+        vtu_append_float(grid.celldata[i].data, grid.celldata[i].name,
+                         grid.celldata[i].ncomp, _compress, _float32, xml,
+                         appended);
+    }
+    xml << "      </CellData>" << std::endl;
+
+    xml << "      <Points>" << std::endl;
+    vtu_append_float(grid.points, "", 3, _compress, _float32, xml, appended);
+    xml << "      </Points>" << std::endl;
+
+    xml << "      <Cells>" << std::endl;
+    xml << "        <DataArray type=\"Int32\" Name=\"connectivity\""
+        << " format=\"appended\" offset=\"" << appended.size() << "\"/>"
+        << std::endl;
+    vtu_append_array(grid.connectivity.data(),
+                     grid.connectivity.size()*sizeof(int), _compress,
+                     appended);
+    xml << "        <DataArray type=\"Int32\" Name=\"offsets\""
+        << " format=\"appended\" offset=\"" << appended.size() << "\"/>"
+        << std::endl;
+    vtu_append_array(grid.offsets.data(), grid.offsets.size()*sizeof(int),
+                     _compress, appended);
+    xml << "        <DataArray type=\"UInt8\" Name=\"types\""
+        << " format=\"appended\" offset=\"" << appended.size() << "\"/>"
+        << std::endl;
+    vtu_append_array(grid.types.data(), grid.types.size(), _compress,
+                     appended);
+    xml << "      </Cells>" << std::endl;
+
+    xml << "    </Piece>" << std::endl;
+    xml << "  </UnstructuredGrid>" << std::endl;
+    xml << "  <AppendedData encoding=\"raw\">" << std::endl;
+    xml << "   _";
+
+    // Write file
+
+    f.open(fname.c_str(), std::fstream::out | std::fstream::binary);
+    if (! f.is_open())
+    {
+        print_warning("VTUWriter::writeGrid",
+                      "Unable to open " + fname + " for writing.");
+        return 1;
+    }
+    f << xml.str();
+    if (appended.size() > 0)
+        f.write(&appended[0], appended.size());
+    f << std::endl << "  </AppendedData>" << std::endl;
+    f << "</VTKFile>" << std::endl;
+    f.close();
+
+    return 0;
+}
+
+/******************************************************************************/
+//
+// Runs the current write job: grids, multiblock file, and collection file
+//
+/******************************************************************************/
+void VTUWriter::writeJob ()
+{
+    std::ofstream f;
+    std::string fname;
+    unsigned int i, ngrids;
+
+    _status = 0;
+    ngrids = _grids.size();
+    for ( i = 0; i < ngrids; i++ )
+    {
+        if (writeGrid(_dir + _gridfiles[i], _grids[i]) != 0)
+            _status = 1;
+    }
+
+    fname = _dir + _vtmname;
+    f.open(fname.c_str());
+    if (! f.is_open())
+    {
+        print_warning("VTUWriter::writeJob",
+                      "Unable to open " + fname + " for writing.");
+        _status = 1;
+    }
+    else
+    {
+        f << "<?xml version=\"1.0\"?>" << std::endl;
+        f << "<VTKFile type=\"vtkMultiBlockDataSet\" version=\"1.0\""
+          << " byte_order=\"" << vtu_byte_order()
+          << "\" header_type=\"UInt64\">" << std::endl;
+        f << "  <vtkMultiBlockDataSet>" << std::endl;
+        for ( i = 0; i < ngrids; i++ )
+        {
+            f << "    <DataSet index=\"" << i << "\" name=\"" << _grids[i].name
+              << "\" file=\"" << _gridfiles[i] << "\"/>" << std::endl;
+        }
+        f << "  </vtkMultiBlockDataSet>" << std::endl;
+        f << "</VTKFile>" << std::endl;
+        f.close();
+    }
+
+    // The collection file is rewritten each time so that it is always valid
+
+    fname = _dir + _pvdname;
+    f.open(fname.c_str());
+    if (! f.is_open())
+    {
+        print_warning("VTUWriter::writeJob",
+                      "Unable to open " + fname + " for writing.");
+        _status = 1;
+    }
+    else
+    {
+        f << _pvdtext;
+        f.close();
+    }
+
+    _grids.resize(0);
+}
+
+/******************************************************************************/
+//
+// Writes grids for one iteration, on a background thread if requested
+//
+/******************************************************************************/
+int VTUWriter::write ( const std::string & dir, const std::string & prefix,
+                       int iter, std::vector<vtu_grid> & grids )
+{
+    int retval;
+    unsigned int i, ngrids;
+    std::ostringstream pvd;
+
+    retval = wait();
+
+    // Set up job data
+
+    _dir = dir;
+    _grids.swap(grids);
+    grids.resize(0);
+    ngrids = _grids.size();
+    _gridfiles.resize(ngrids);
+    for ( i = 0; i < ngrids; i++ )
+    {
+        _gridfiles[i] = prefix + "_" + _grids[i].name + "_iter" +
+                        int2string(iter) + ".vtu";
+    }
+    _vtmname = prefix + "_iter" + int2string(iter) + ".vtm";
+    if (prefix + ".pvd" != _pvdname)
+        _pvdentries.resize(0);
+    _pvdname = prefix + ".pvd";
+
+    _pvdentries.push_back(std::make_pair(iter, _vtmname));
+    pvd << "<?xml version=\"1.0\"?>" << std::endl;
+    pvd << "<VTKFile type=\"Collection\" version=\"0.1\">" << std::endl;
+    pvd << "  <Collection>" << std::endl;
+    for ( i = 0; i < _pvdentries.size(); i++ )
+    {
+        pvd << "    <DataSet timestep=\"" << _pvdentries[i].first
+            << "\" file=\"" << _pvdentries[i].second << "\"/>" << std::endl;
+    }
+    pvd << "  </Collection>" << std::endl;
+    pvd << "</VTKFile>" << std::endl;
+    _pvdtext = pvd.str();
+
+    // Write
+
+    if (_background)
+        _thread = std::thread(&VTUWriter::writeJob, this);
+    else
+    {
+        writeJob();
+        retval = _status;
+    }
+
+    return retval;
+}
+
+/******************************************************************************/
+//
+// Waits for a pending background write and returns its status
+//
+/******************************************************************************/
+int VTUWriter::wait ()
+{
+    if (_thread.joinable())
+        _thread.join();
+
+    return _status;
+}
@@ -392,6 +392,54 @@ void Wake::update ()
     }
 }
 
+/******************************************************************************/
+//
+// Translates the wake line at spanwise station i with its trailing edge
+// vertex. For a wake that has not rolled up, this is the same as placing it
+// again at the new trailing edge.
+//
+/******************************************************************************/
+void Wake::followTrailingEdge ( unsigned int i )
+{
+    unsigned int j, ntris, nquads;
+    double dx, dy, dz, dxinc, dyinc, dzinc;
+    Vertex * vert;
+
+    vert = &_verts[i*(_nstream+1)];
+    dx = _topteverts[i]->x() - vert->x();
+    dy = _topteverts[i]->y() - vert->y();
+    dz = _topteverts[i]->z() - vert->z();
+    dxinc = _topteverts[i]->xInc() - vert->xInc();
+    dyinc = _topteverts[i]->yInc() - vert->yInc();
+    dzinc = _topteverts[i]->zInc() - vert->zInc();
+
+    for ( j = 0; int(j) < _nstream+1; j++ )
+    {
+        vert = &_verts[i*(_nstream+1)+j];
+        vert->setCoordinates(vert->x()+dx, vert->y()+dy, vert->z()+dz);
+        vert->setIncompressibleCoordinates(vert->xInc()+dxinc,
+                                           vert->yInc()+dyinc,
+                                           vert->zInc()+dzinc);
+        if (int(j) == _nstream)
+            vert->setVizCoordinates(vert->xViz()+dx, vert->yViz()+dy,
+                                    vert->zViz()+dz);
+    }
+
+    // Recompute panel geometry
+
+    ntris = _tris.size();
+    for ( j = 0; j < ntris; j++ )
+    {
+        _tris[j].recomputeGeometry();
+    }
+
+    nquads = _quads.size();
+    for ( j = 0; j < nquads; j++ )
+    {
+        _quads[j].recomputeGeometry();
+    }
+}
+
 /******************************************************************************/
 //
 // Access to verts and panels
@@ -6,6 +6,7 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <chrono>
 #include "algorithms.h"
 #include "util.h"
 #include "settings.h"
@@ -20,7 +21,9 @@
 #include "wake.h"
 #include "wake_strip.h"
 #include "viscous_wake.h"
+#include "vortex_lattice.h"
 #include "wing.h"
+#include "profiler.h"
 
 // Data for optimizing spanwise spacing
 
@@ -463,9 +466,10 @@ int Wing::setupSections ( std::vector<Section> & user_sections )
     std::vector<Section> sorted_user_sections;
     unsigned int i, j, nsecs, nfoils;
     Eigen::Vector2d secvec;
-    double a4, a5, rootsp, tipsp, space, tipy, deltay, deltas, sfrac;
+    double a4, a5, rootsp, tipsp, tipy, deltay, deltas, sfrac;
     double xle, zle, y, chord, twist, roll;
-    std::vector<double> foil_positions;
+    std::vector<double> foil_positions, foilfrac, space;
+    std::vector<unsigned int> foil0, foil1;
     
     // Sort sections
     
@@ -522,13 +526,12 @@ int Wing::setupSections ( std::vector<Section> & user_sections )
     rootsp = _rootsprat * s_wing[nsecs-1] / double(_nspan-1);
     tipsp = _tipsprat * s_wing[nsecs-1] / double(_nspan-1);
     opt_tanh_spacing(_nspan, s_wing[nsecs-1], rootsp, tipsp, a4, a5);
+    space = tanh_spacings(a4, a5, _nspan, s_wing[nsecs-1], rootsp, tipsp);
     nom_stations.resize(_nspan);
     nom_stations[0] = 0.; 
     for ( i = 1; i < _nspan; i++ )
     {
-        space = tanh_spacing(i-1, a4, a5, _nspan, s_wing[nsecs-1], rootsp,
-                             tipsp);
-        nom_stations[i] = nom_stations[i-1] + space;
+        nom_stations[i] = nom_stations[i-1] + space[i-1];
     }
     
     // Optimize stations to be as close as possible to nominal but lining up with
@@ -603,35 +606,39 @@ int Wing::setupSections ( std::vector<Section> & user_sections )
         }
     }
     
-    // Create sections
+    // Find interpolant airfoils and section geometry for each station. This is
+    // cheap and done serially so that errors are reported in station order.
     
     _sections.resize(_nspan);
+    foil0.resize(_nspan);
+    foil1.resize(_nspan);
+    foilfrac.resize(_nspan);
     for ( i = 0; i < _nspan; i++ )
     {
-        // Set airfoil coordinates
-        
         for ( j = 0; j < nfoils-1; j++ )
         {
             if (std::abs(_stations[i]-foil_positions[j]) < 1e-12)
             {
-                _sections[i].airfoil().interpCoordinates(_foils[j], _foils[j],
-                                                         0.);
+                foil0[i] = j;
+                foil1[i] = j;
+                foilfrac[i] = 0.;
                 break;
             }
             else if ( (_stations[i] > foil_positions[j]) &&
                       (_stations[i] < foil_positions[j+1]) )
             {
-                sfrac = (_stations[i] - foil_positions[j]) / 
-                        (foil_positions[j+1] - foil_positions[j]);
-                _sections[i].airfoil().interpCoordinates(_foils[j], _foils[j+1],
-                                                         sfrac);  
+                foil0[i] = j;
+                foil1[i] = j+1;
+                foilfrac[i] = (_stations[i] - foil_positions[j]) / 
+                              (foil_positions[j+1] - foil_positions[j]);
                 break;
             }
             else if ( (j == nfoils-2) &&
                       (std::abs(_stations[i]-foil_positions[j+1]) < 1e-12) )
             {
-                _sections[i].airfoil().interpCoordinates(_foils[j+1],
-                                                         _foils[j+1], 0.);
+                foil0[i] = j+1;
+                foil1[i] = j+1;
+                foilfrac[i] = 0.;
                 break;
             }
             else if (j == nfoils-2)
@@ -641,11 +648,6 @@ int Wing::setupSections ( std::vector<Section> & user_sections )
                 return 1;
             }
         }
-        _sections[i].airfoil().ccwOrderCoordinates();
-        _sections[i].airfoil().splineFit();
-        _sections[i].airfoil().unitTransform();
-        _sections[i].airfoil().setXfoilOptions(xfoil_run_opts, xfoil_geom_opts);
-        _sections[i].airfoil().smoothPaneling();
         
         // Set section position, orientation, and scale
         
@@ -698,6 +700,24 @@ int Wing::setupSections ( std::vector<Section> & user_sections )
             }
         }
         _sections[i].setGeometry(xle, y, zle, chord, twist, roll);
+    }
+    
+    // Create section airfoils and vertices. Each station has its own Xfoil
+    // instance and the tanh spacing routines are reentrant, so stations are
+    // independent.
+    
+#pragma omp parallel for private(i) schedule(dynamic)
+    for ( i = 0; i < _nspan; i++ )
+    {
+        // Set airfoil coordinates
+        
+        _sections[i].airfoil().interpCoordinates(_foils[foil0[i]],
+                                                 _foils[foil1[i]], foilfrac[i]);
+        _sections[i].airfoil().ccwOrderCoordinates();
+        _sections[i].airfoil().splineFit();
+        _sections[i].airfoil().unitTransform();
+        _sections[i].airfoil().setXfoilOptions(xfoil_run_opts, xfoil_geom_opts);
+        _sections[i].airfoil().smoothPaneling();
         
         // Set vertices from spacing distribution
         
@@ -714,6 +734,15 @@ int Wing::setupSections ( std::vector<Section> & user_sections )
             _sections[i].computeReynoldsNumber(rhoinf, uinf, muinf);
             _sections[i].setMachNumber(minf);
         }
+        else
+            _sections[i].airfoil().releaseXfoil();
+    }
+
+    // User-specified airfoils are only needed for their geometry from here on
+
+    for ( i = 0; i < _foils.size(); i++ )
+    {
+        _foils[i].releaseXfoil();
     }
 
     return 0; 
@@ -748,7 +777,6 @@ void Wing::createPanels ( int & next_global_vertidx, int & next_global_elemidx )
     double phin, phi, r, beta;
     Eigen::Matrix3d trans, T1;
     Eigen::Vector3d cen, r0, rb, ri, point, norm, tang, tangb;
-    Eigen::Vector3d tanl, tanr, tanf, tanb, tan;
     double x1, x2, x3, x4, y1, y2, y3, y4, z1, z2, z3, z4;
     
     // Set vertex pointers on top and bottom surfaces
@@ -786,19 +814,6 @@ void Wing::createPanels ( int & next_global_vertidx, int & next_global_elemidx )
             _quads[qcounter].addVertex(&_sections[i+1].vert(j));
             _quads[qcounter].addVertex(&_sections[i+1].vert(j+1));
             _quads[qcounter].addVertex(&_sections[i].vert(j+1));
-            
-            // Compute surface tangent vector at centroid
-            
-            tanl << _sections[i].vert(j+1).x() - _sections[i].vert(j).x(),
-                    _sections[i].vert(j+1).y() - _sections[i].vert(j).y(),
-                    _sections[i].vert(j+1).z() - _sections[i].vert(j).z();
-            tanr << _sections[i+1].vert(j+1).x() - _sections[i+1].vert(j).x(),
-                    _sections[i+1].vert(j+1).y() - _sections[i+1].vert(j).y(),
-                    _sections[i+1].vert(j+1).z() - _sections[i+1].vert(j).z();
-            tan = 0.5*(tanl + tanr);
-            tan /= tan.norm();
-            _quads[qcounter].setTangentComp(tan);
-            
             _panels[i][j] = &_quads[qcounter];
             qcounter += 1;
             next_global_elemidx += 1;
@@ -1059,44 +1074,6 @@ void Wing::createPanels ( int & next_global_vertidx, int & next_global_elemidx )
         }
     }
 
-    // Surface tangent vectors on tip panels
-    
-    for ( i = 0; i < (_ntipcap-1)/2; i++ )
-    {
-        for ( j = 0; j < 2*_nchord-2; j++ )
-        {
-            // Tri panels at TE and LE
-            
-            if ( (j == 0) || (j == _nchord-1) )
-            {
-                tanf = _panels[_nspan-1+i][j+1]->centroidComp()
-                     - _panels[_nspan-1+i][j]->centroidComp();
-                tan = tanf / tanf.norm();
-            }
-            else if ( (j == _nchord-2) || (j == 2*_nchord-3) )
-            {
-                tanb = _panels[_nspan-1+i][j]->centroidComp()
-                     - _panels[_nspan-1+i][j-1]->centroidComp();
-                tan = tanb / tanb.norm();
-            }
-            
-            // Quad panels in between
-            
-            else if (j < _nchord-2)
-            {
-                tanf = _panels[_nspan-1+i][j+1]->centroidComp()
-                     - _panels[_nspan-1+i][j]->centroidComp();
-                tanb = _panels[_nspan-1+i][j]->centroidComp()
-                     - _panels[_nspan-1+i][j-1]->centroidComp();
-                tan = 0.5*(tanf + tanb);
-                tan /= tan.norm();
-            }
-            
-            _panels[_nspan-1+i][j]->setTangentComp(tan);
-        }
-    }
-      
-
     // Set panel neighbors (top and bottom surfaces only for now)
     // We don't add panel neighbors from top/bottom to tip caps, because there
     // can be very large changes in sizing across that boundary, which would
@@ -1147,10 +1124,90 @@ void Wing::createPanels ( int & next_global_vertidx, int & next_global_elemidx )
         }
     }
 
+    // Surface tangent vectors and grid metrics
+
+    computeSurfaceMetrics();
+}
+
+/******************************************************************************/
+//
+// Computes surface tangent vectors and grid metrics of panels in a range of
+// spanwise rows (all rows if lastrow is negative). Panel geometry and
+// neighbors must already be set.
+//
+/******************************************************************************/
+void Wing::computeSurfaceMetrics ( unsigned int firstrow, int lastrow )
+{
+    unsigned int i, j, nrows, lrow;
+    Eigen::Vector3d tanl, tanr, tanf, tanb, tan;
+
+    nrows = _nspan-1+(_ntipcap-1)/2;
+    if ( (lastrow < 0) || (lastrow >= int(nrows)) )
+        lrow = nrows-1;
+    else
+        lrow = lastrow;
+
+    // Surface tangent vectors at centroids of top and bottom surface panels
+
+    for ( i = firstrow; (i < _nspan-1) && (i <= lrow); i++ )
+    {
+        for ( j = 0; j < 2*_nchord-2; j++ )
+        {
+            tanl << _sections[i].vert(j+1).x() - _sections[i].vert(j).x(),
+                    _sections[i].vert(j+1).y() - _sections[i].vert(j).y(),
+                    _sections[i].vert(j+1).z() - _sections[i].vert(j).z();
+            tanr << _sections[i+1].vert(j+1).x() - _sections[i+1].vert(j).x(),
+                    _sections[i+1].vert(j+1).y() - _sections[i+1].vert(j).y(),
+                    _sections[i+1].vert(j+1).z() - _sections[i+1].vert(j).z();
+            tan = 0.5*(tanl + tanr);
+            tan /= tan.norm();
+            _panels[i][j]->setTangentComp(tan);
+        }
+    }
+
+    // Surface tangent vectors on tip panels
+    
+    for ( i = 0; i < (_ntipcap-1)/2; i++ )
+    {
+        if ( (_nspan-1+i < firstrow) || (_nspan-1+i > lrow) )
+            continue;
+        for ( j = 0; j < 2*_nchord-2; j++ )
+        {
+            // Tri panels at TE and LE
+            
+            if ( (j == 0) || (j == _nchord-1) )
+            {
+                tanf = _panels[_nspan-1+i][j+1]->centroidComp()
+                     - _panels[_nspan-1+i][j]->centroidComp();
+                tan = tanf / tanf.norm();
+            }
+            else if ( (j == _nchord-2) || (j == 2*_nchord-3) )
+            {
+                tanb = _panels[_nspan-1+i][j]->centroidComp()
+                     - _panels[_nspan-1+i][j-1]->centroidComp();
+                tan = tanb / tanb.norm();
+            }
+            
+            // Quad panels in between
+            
+            else if (j < _nchord-2)
+            {
+                tanf = _panels[_nspan-1+i][j+1]->centroidComp()
+                     - _panels[_nspan-1+i][j]->centroidComp();
+                tanb = _panels[_nspan-1+i][j]->centroidComp()
+                     - _panels[_nspan-1+i][j-1]->centroidComp();
+                tan = 0.5*(tanf + tanb);
+                tan /= tan.norm();
+            }
+            
+            _panels[_nspan-1+i][j]->setTangentComp(tan);
+        }
+    }
+
     // Compute grid metrics
 
 #pragma omp parallel for private(i,j)
-    for ( i = 0; i < _nspan-1+(_ntipcap-1)/2; i++ )
+    for ( i = firstrow; i <= lrow; i++ )
     {
         for ( j = 0; j < 2*_nchord-2; j++ )
         {
@@ -1159,6 +1216,74 @@ void Wing::createPanels ( int & next_global_vertidx, int & next_global_elemidx )
     }
 }
 
+/******************************************************************************/
+//
+// Changes leading edge position, chord, and twist of a section after panels
+// and wake have been created. The section's vertices are moved, keeping the
+// airfoil and spacing, along with the tip cap if it is the tip section and
+// the wake line behind the section's trailing edge. Surface panels whose
+// geometry changed are appended to moved. Tangents and grid metrics are
+// recomputed for the moved panels and the rows next to them, since grid
+// metrics also depend on neighbors.
+//
+/******************************************************************************/
+void Wing::setSectionGeometry ( unsigned int sidx, const double & xle,
+                                const double & zle, const double & chord,
+                                const double & twist,
+                                std::vector<Panel *> & moved )
+{
+    unsigned int i, j, ifirst, ilast;
+    double beta, x, y, z;
+
+#ifdef DEBUG
+    if (sidx >= _nspan)
+        conditional_stop(1, "Wing::setSectionGeometry",
+                         "Index out of range.");
+#endif
+
+    _sections[sidx].moveVertices(xle, zle, chord, twist);
+    _sections[sidx].transformPrandtlGlauert(minf);
+
+    // Tip cap vertices lie midway between top and bottom vertices of the tip
+    // section, since tips are flat (see createPanels)
+
+    ifirst = sidx > 0 ? sidx-1 : 0;
+    ilast = sidx < _nspan-1 ? sidx : _nspan-2;
+    if (sidx == _nspan-1)
+    {
+        beta = std::sqrt(1. - std::pow(minf,2.));
+        for ( i = 1; i < _ntipcap-1; i++ )
+        {
+            for ( j = 1; j < _nchord-1; j++ )
+            {
+                x = 0.5*(_sections[sidx].vert(j).x() +
+                         _sections[sidx].vert(2*_nchord-2-j).x());
+                y = 0.5*(_sections[sidx].vert(j).y() +
+                         _sections[sidx].vert(2*_nchord-2-j).y());
+                z = 0.5*(_sections[sidx].vert(j).z() +
+                         _sections[sidx].vert(2*_nchord-2-j).z());
+                _tipverts[i-1][j-1].setCoordinates(x, y, z);
+                _tipverts[i-1][j-1].setIncompressibleCoordinates(x/beta, y, z);
+            }
+        }
+        ilast = _nspan-2+(_ntipcap-1)/2;
+    }
+
+    // Panels on either side of the section, and on the tip cap
+
+    for ( i = ifirst; i <= ilast; i++ )
+    {
+        for ( j = 0; j < 2*_nchord-2; j++ )
+        {
+            _panels[i][j]->recomputeGeometry();
+            moved.push_back(_panels[i][j]);
+        }
+    }
+    computeSurfaceMetrics(ifirst > 0 ? ifirst-1 : 0, ilast+1);
+
+    _wake.followTrailingEdge(sidx);
+}
+
 /******************************************************************************/
 //
 // Sets up wake
@@ -1207,133 +1332,85 @@ void Wing::setupWake ( const double & maxspan, int & next_global_vertidx,
 
 /******************************************************************************/
 //
-// Computes velocities and pressures on surface panels, and interpolates to
-// vertices
+// Quadratic extrapolation to an edge vertex v0 from v0 and the next two
+// vertices v1 and v2 away from the edge. The value averaged to v0 actually
+// applies to the midpoint between v0 and v1, so a quadratic in arc length is
+// fit through the midpoint, v1, and v2 and evaluated at v0. The result is a
+// linear combination of the three values, so only the weights are kept.
 //
 /******************************************************************************/
-void Wing::computeSurfaceQuantities ()
+edge_extrapolation quadratic_edge_extrapolation ( Vertex * v0, Vertex * v1,
+                                                  Vertex * v2,
+                                                  unsigned int stage )
 {
-    unsigned int i, j, nverts;
     double s12, s1, s2;
     Eigen::Matrix3d A;
-    Eigen::Vector3d x, b;
-    Eigen::PartialPivLU<Eigen::Matrix3d> lu;
-    Vertex * v0, * v1, * v2;
+    Eigen::RowVector3d weights;
+    edge_extrapolation extrap;
+
+    s1 = v0->distance(*v1);
+    s12 = 0.5*s1;
+    s2 = s1 + v1->distance(*v2);
+    A << std::pow(s12,2.), s12, 1.,
+         std::pow(s1,2.),  s1,  1.,
+         std::pow(s2,2.),  s2,  1.;
+    weights = A.inverse().row(2);
+
+    extrap.verts[0] = v0;
+    extrap.verts[1] = v1;
+    extrap.verts[2] = v2;
+    extrap.weights[0] = weights(0);
+    extrap.weights[1] = weights(1);
+    extrap.weights[2] = weights(2);
+    extrap.stage = stage;
+
+    return extrap;
+}
 
-#pragma omp parallel for private(i,j)
-    for ( i = 0; i < _nspan-1+(_ntipcap-1)/2; i++ )
-    {
-        for ( j = 0; j < 2*_nchord-2; j++ )
-        {
-            _panels[i][j]->computeVelocity(uinfvec);
-            _panels[i][j]->computePressure(uinf, rhoinf, pinf);
-        }
-    }
-    
-    // Interpolate to vertices
-    
-    nverts = _verts.size();
-#pragma omp parallel for private(i)
-    for ( i = 0; i < nverts; i++ )
-    {
-        _verts[i]->averageFromPanels();
-    }
+/******************************************************************************/
+//
+// Adds extrapolations of averaged vertex data to edge vertices at the
+// trailing edge (stage 0), centerline (stage 1), and tip (stage 2). Stages
+// must be applied in order, because centerline values are used at the tip of
+// short wings, and trailing edge extrapolation uses centerline vertices
+// before they are updated.
+//
+/******************************************************************************/
+void Wing::edgeExtrapolations ( std::vector<edge_extrapolation> & extraps )
+{
+    unsigned int i;
 
-    /* Extrapolate to vertices at edges using quadratic fit. Note that the
-       originally calculated values at edge vertices actually apply to the
-       midpoint of the boundary between adjacent panels, since it is averaged
-       only from these two panels. */
+    // Top and bottom trailing edge
 
-    // Top trailing edge
-#pragma omp parallel for private(i,v0,v1,v2,s1,s12,s2,A,lu,j,b,x)
     for ( i = 0; i < _nspan-1; i++ )
     {
-        v0 = &_sections[i].vert(0);
-        v1 = &_sections[i].vert(1);
-        v2 = &_sections[i].vert(2);
-        s1 = v0->distance(*v1);
-        s12 = 0.5*s1;
-        s2 = s1 + v1->distance(*v2);
-        A << std::pow(s12,2.), s12, 1.,
-             std::pow(s1,2.),  s1,  1.,
-             std::pow(s2,2.),  s2,  1.;
-        lu.compute(A);
-        
-        for ( j = 0; j < Vertex::firstBLData; j++ )
-        { 
-            b << v0->data(j), v1->data(j), v2->data(j);
-            x = lu.solve(b);
-            v0->setData(j, x(2));
-        }
+        extraps.push_back(quadratic_edge_extrapolation(&_sections[i].vert(0),
+                          &_sections[i].vert(1), &_sections[i].vert(2), 0));
     }
-    
-    // Bottom trailing edge
-#pragma omp parallel for private(i,v0,v1,v2,s1,s12,s2,A,lu,j,b,x)
     for ( i = 0; i < _nspan-1; i++ )
     {
-        v0 = &_sections[i].vert(2*_nchord-2);
-        v1 = &_sections[i].vert(2*_nchord-3);
-        v2 = &_sections[i].vert(2*_nchord-4);
-        s1 = v0->distance(*v1);
-        s12 = 0.5*s1;
-        s2 = s1 + v1->distance(*v2);
-        A << std::pow(s12,2.), s12, 1.,
-             std::pow(s1,2.),  s1,  1.,
-             std::pow(s2,2.),  s2,  1.;
-        lu.compute(A);
-        
-        for ( j = 0; j < Vertex::firstBLData; j++ )
-        { 
-            b << v0->data(j), v1->data(j), v2->data(j);
-            x = lu.solve(b);
-            v0->setData(j, x(2));
-        }
+        extraps.push_back(quadratic_edge_extrapolation(
+                          &_sections[i].vert(2*_nchord-2),
+                          &_sections[i].vert(2*_nchord-3),
+                          &_sections[i].vert(2*_nchord-4), 0));
     }
 
     // Centerline
-#pragma omp parallel for private(i,v0,v1,v2,s1,s12,s2,A,lu,j,b,x)
+
     for ( i = 1; i < 2*_nchord-2; i++ )
     {
-        v0 = &_sections[0].vert(i);
-        v1 = &_sections[1].vert(i);
-        v2 = &_sections[2].vert(i);
-        s1 = v0->distance(*v1);
-        s12 = 0.5*s1;
-        s2 = s1 + v1->distance(*v2);
-        A << std::pow(s12,2.), s12, 1.,
-             std::pow(s1,2.),  s1,  1.,
-             std::pow(s2,2.),  s2,  1.;
-        lu.compute(A);
-        
-        for ( j = 0; j < Vertex::firstBLData; j++ )
-        { 
-            b << v0->data(j), v1->data(j), v2->data(j);
-            x = lu.solve(b);
-            v0->setData(j, x(2));
-        }
+        extraps.push_back(quadratic_edge_extrapolation(&_sections[0].vert(i),
+                          &_sections[1].vert(i), &_sections[2].vert(i), 1));
     }
 
     // Tip
-#pragma omp parallel for private(i,v0,v1,v2,s1,s12,s2,A,lu,j,b,x)
+
     for ( i = 1; i < 2*_nchord-2; i++ )
     {
-        v0 = &_sections[_nspan-1].vert(i);
-        v1 = &_sections[_nspan-2].vert(i);
-        v2 = &_sections[_nspan-3].vert(i);
-        s1 = v0->distance(*v1);
-        s12 = 0.5*s1;
-        s2 = s1 + v1->distance(*v2);
-        A << std::pow(s12,2.), s12, 1.,
-             std::pow(s1,2.),  s1,  1.,
-             std::pow(s2,2.),  s2,  1.;
-        lu.compute(A);
-        
-        for ( j = 0; j < Vertex::firstBLData; j++ )
-        { 
-            b << v0->data(j), v1->data(j), v2->data(j);
-            x = lu.solve(b);
-            v0->setData(j, x(2));
-        }
+        extraps.push_back(quadratic_edge_extrapolation(
+                          &_sections[_nspan-1].vert(i),
+                          &_sections[_nspan-2].vert(i),
+                          &_sections[_nspan-3].vert(i), 2));
     }
 }
 
@@ -1396,10 +1473,36 @@ ViscousWake & Wing::viscousWake () { return _vwake; }
 
 /******************************************************************************/
 //
-// Computes viscous forces (and skin friction, etc.) using Xfoil at sections
+// Access to sections
+//
+/******************************************************************************/
+unsigned int Wing::nSections () const { return _sections.size(); }
+Section & Wing::section ( unsigned int sidx )
+{
+#ifdef DEBUG
+    if (sidx >= _sections.size())
+        conditional_stop(1, "Wing::section", "Index out of range.");
+#endif
+
+    return _sections[sidx];
+}
+
+/******************************************************************************/
+//
+// Set up and access vortex lattice
+//
+/******************************************************************************/
+void Wing::setupVortexLattice () { _vlm.initialize(_sections, _nchord); }
+VortexLattice & Wing::vortexLattice () { return _vlm; }
+
+/******************************************************************************/
+//
+// Computes viscous forces (and skin friction, etc.) using Xfoil at sections.
+// If clspec is given, it holds the lift coefficient to run Xfoil at for each
+// section.
 //
 /******************************************************************************/
-void Wing::computeBL ()
+void Wing::computeBL ( const double * clspec )
 {
     unsigned int i, j, k;
     int l, linterp, rinterp;
@@ -1407,11 +1510,22 @@ void Wing::computeBL ()
     double weightl, weightr;
     std::string warning;
     bool extrapolate;
+    int sectiontimer;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::duration<double> elapsed;
 
-#pragma omp parallel for private(i,warning)
+    sectiontimer = profiler.phase("computeBL/section");
+#pragma omp parallel for private(i,warning,start,elapsed)
     for ( i = 0; i < _nspan; i++ )
     {
-        _sections[i].computeBL(uinfvec, rhoinf, pinf, alpha, reinit_freq);
+        start = std::chrono::steady_clock::now();
+        if (clspec)
+            _sections[i].computeBL(uinfvec, rhoinf, pinf, alpha, reinit_freq,
+                                   &clspec[i]);
+        else
+            _sections[i].computeBL(uinfvec, rhoinf, pinf, alpha, reinit_freq);
+        elapsed = std::chrono::steady_clock::now() - start;
+        profiler.addTime(sectiontimer, elapsed.count());
 
         if (not _sections[i].blConverged())
         {
@@ -1568,6 +1682,39 @@ void Wing::setupViscousWake ( int & next_global_vertidx,
     _vwake.initialize(_sections, next_global_vertidx, next_global_elemidx);
 }
 
+/******************************************************************************/
+//
+// Gets or sets BL restart data for all sections
+//
+/******************************************************************************/
+void Wing::getRestartData ( std::vector<double> & data ) const
+{
+    unsigned int i, nsecs;
+
+    nsecs = _sections.size();
+    for ( i = 0; i < nsecs; i++ )
+    {
+        _sections[i].getRestartData(data);
+    }
+}
+
+unsigned int Wing::setRestartData ( const double *data, unsigned int count )
+{
+    unsigned int i, nsecs, pos, nread;
+
+    pos = 0;
+    nsecs = _sections.size();
+    for ( i = 0; i < nsecs; i++ )
+    {
+        nread = _sections[i].setRestartData(data+pos, count-pos);
+        if (nread == 0)
+            return 0;
+        pos += nread;
+    }
+
+    return pos;
+}
+
 /******************************************************************************/
 //
 // Compute or access forces and moments. Compute part includes section forces
@@ -1587,7 +1734,8 @@ void Wing::computeForceMoment ( const Eigen::Vector3d & momcen,
     mp << 0., 0., 0.;
     mf << 0., 0., 0.;
 
-    // Forces and moments via surface integration
+    // Forces and moments via surface integration. Viscous quantities have
+    // already been averaged from vertices to panels for the whole aircraft.
 
     for ( i = 0; i < _nspan-1+(_ntipcap-1)/2; i++ )
     {
@@ -1653,6 +1801,48 @@ void Wing::computeForceMoment ( const Eigen::Vector3d & momcen,
     _wake.farfieldForces(xtrefftz, ztrefftz, allwake, _lifttr, _dragtr);
 }
 
+/******************************************************************************/
+//
+// Forces and moments from the vortex lattice. Lift and induced drag are from
+// the Kutta-Joukowski theorem on the lattice and are stored as both Trefftz
+// and integrated quantities, so that outputs work as in inviscid panel runs.
+//
+/******************************************************************************/
+void Wing::computeVortexLatticeForceMoment ( const Eigen::Vector3d & momcen,
+                            const std::vector<VortexLattice *> & alllattice )
+{
+    unsigned int i;
+    Eigen::Vector3d f, m;
+    std::vector<double> cl, cd, cm;
+
+    _vlm.computeForceMoment(alllattice, momcen, f, m, cl, cd, cm);
+
+    // Account for mirror image
+
+    f(0) *= 2.;
+    f(2) *= 2.;
+    m(1) *= 2.;
+
+    // Convert to wind frame
+
+    _lifttr = -f(0)*sin(alpha*M_PI/180.) + f(2)*cos(alpha*M_PI/180.);
+    _dragtr =  f(0)*cos(alpha*M_PI/180.) + f(2)*sin(alpha*M_PI/180.);
+    _liftp = _lifttr;
+    _dragp = _dragtr;
+    _momentp = m(1);
+    _liftf = 0.;
+    _dragf = 0.;
+    _dragv = 0.;
+    _momentf = 0.;
+
+    // Section forces and moments
+
+    for ( i = 0; i < _nspan; i++ )
+    {
+        _sections[i].setForceMoment(cl[i], cd[i], cm[i]);
+    }
+}
+
 double Wing::lift () const { return _lifttr + _liftf; }
 const double & Wing::trefftzLift () const { return _lifttr; }
 const double & Wing::skinFrictionLift () const { return _liftf; }
@@ -1757,113 +1947,96 @@ double Wing::skinFrictionPitchingMomentCoefficient () const
 
 /******************************************************************************/
 //
-// Writes forces and moments for aircraft and each wing to CSV formatted files
+// Column names and values of forces and moments for output
 //
 /******************************************************************************/
-int Wing::writeForceMoment ( int iter ) const
+void Wing::forceMomentData ( std::vector<std::string> & columns,
+                             std::vector<double> & values ) const
 {
-    std::ofstream f;
-    std::string fname;
-    
-    fname = "forcemoment/" + _name + "_forcemoment.csv";
-    
-    // Write header during first iteration
-    
-    if (iter == 1)
-    {
-        f.open(fname.c_str(), std::fstream::out);
-        if (! f.is_open())
-        {
-            print_warning("Wing::writeForceMoment",
-                          "Unable to open " + fname + " for writing.");
-            return 1;
-        }
-        if (viscous)
-        {
-            f << "\"Iter\",\"Lift\",\"Lift_trefftz\",\"Lift_skinfric\","
-              <<            "\"Drag\",\"Drag_induced\",\"Drag_parasitic\","
-              <<"\"Moment\",\"Moment_pressure\",\"Moment_skinfric\","
-              <<"\"CL\",\"CL_trefftz\",\"CL_skinfric\","
-              <<"\"CD\",\"CD_induced\",\"CD_parasitic\","
-              <<"\"Cm\",\"Cm_pressure\",\"Cm_skinfric\"" << std::endl;
-        }
-        else
-        {
-            f << "\"Iter\",\"Lift\",\"Lift_integrated\","
-              <<          "\"Drag\",\"Drag_integrated\","
-              << "\"Moment\","
-              << "\"CL\",\"CL_integrated\","
-              << "\"CD\",\"CD_integrated\","
-              << "\"Cm\"" << std::endl;
-        }
-    }
-    else
-    {
-        f.open(fname.c_str(), std::fstream::app);
-        if (! f.is_open())
-        {
-            print_warning("Wing::writeForceMoment",
-                          "Unable to open " + fname + " for writing.");
-            return 1;
-        }
-    }
-    f << iter << ",";
-    f.setf(std::ios_base::scientific);
-    f << std::setprecision(7);
     if (viscous)
     {
-        f << lift() << ",";
-        f << trefftzLift() << ",";
-        f << skinFrictionLift() << ",";
-        f << drag() << ",";
-        f << inducedDrag() << ",";
-        f << parasiticDrag() << ",";
-        f << pitchingMoment() << ",";
-        f << pressurePitchingMoment() << ",";
-        f << skinFrictionPitchingMoment() << ",";
-        f << liftCoefficient() << ",";
-        f << trefftzLiftCoefficient() << ",";
-        f << skinFrictionLiftCoefficient() << ",";
-        f << dragCoefficient() << ",";
-        f << inducedDragCoefficient() << ",";
-        f << parasiticDragCoefficient() << ",";
-        f << pitchingMomentCoefficient() << ",";
-        f << pressurePitchingMomentCoefficient() << ",";
-        f << skinFrictionPitchingMomentCoefficient() << std::endl;
+        const char *names[] = {"Lift", "Lift_trefftz", "Lift_skinfric",
+                               "Drag", "Drag_induced", "Drag_parasitic",
+                               "Moment", "Moment_pressure", "Moment_skinfric",
+                               "CL", "CL_trefftz", "CL_skinfric",
+                               "CD", "CD_induced", "CD_parasitic",
+                               "Cm", "Cm_pressure", "Cm_skinfric"};
+        columns.assign(names, names+18);
+
+        values.resize(18);
+        values[0] = lift();
+        values[1] = trefftzLift();
+        values[2] = skinFrictionLift();
+        values[3] = drag();
+        values[4] = inducedDrag();
+        values[5] = parasiticDrag();
+        values[6] = pitchingMoment();
+        values[7] = pressurePitchingMoment();
+        values[8] = skinFrictionPitchingMoment();
+        values[9] = liftCoefficient();
+        values[10] = trefftzLiftCoefficient();
+        values[11] = skinFrictionLiftCoefficient();
+        values[12] = dragCoefficient();
+        values[13] = inducedDragCoefficient();
+        values[14] = parasiticDragCoefficient();
+        values[15] = pitchingMomentCoefficient();
+        values[16] = pressurePitchingMomentCoefficient();
+        values[17] = skinFrictionPitchingMomentCoefficient();
     }
     else
     {
-        f << lift() << ",";
-        f << integratedLift() << ",";
-        f << drag() << ",";
-        f << integratedDrag() << ",";
-        f << pitchingMoment() << ",";
-        f << liftCoefficient() << ",";
-        f << integratedLiftCoefficient() << ",";
-        f << dragCoefficient() << ",";
-        f << integratedDragCoefficient() << ",";
-        f << pitchingMomentCoefficient() << std::endl;
+        const char *names[] = {"Lift", "Lift_integrated",
+                               "Drag", "Drag_integrated",
+                               "Moment",
+                               "CL", "CL_integrated",
+                               "CD", "CD_integrated",
+                               "Cm"};
+        columns.assign(names, names+10);
+
+        values.resize(10);
+        values[0] = lift();
+        values[1] = integratedLift();
+        values[2] = drag();
+        values[3] = integratedDrag();
+        values[4] = pitchingMoment();
+        values[5] = liftCoefficient();
+        values[6] = integratedLiftCoefficient();
+        values[7] = dragCoefficient();
+        values[8] = integratedDragCoefficient();
+        values[9] = pitchingMomentCoefficient();
     }
-    f.close();
-    
-    return 0;
 }
 
 /******************************************************************************/
 //
-// Writes sectional forces to file
+// Column names and values of sectional forces and moments for output. Rows
+// are given from tip to tip, including the mirror image.
 //
 /******************************************************************************/
-int Wing::writeSectionForceMoment ( int iter ) const
+void Wing::sectionData ( std::vector<std::string> & columns,
+                         std::vector<std::vector<double> > & rows ) const
 {
-    std::ofstream f;
-    std::string fname;
     std::vector<double> y_flat;
-    int i;
-    double dy, dz, ds;
-    
+    std::vector<double> *row;
+    int i, j, nrows;
+    double dy, dz, ds, sign;
+
+    if (viscous)
+    {
+        const char *names[] = {"xle", "y", "y_flat", "zle", "c", "Re",
+                               "Cl", "Clp", "Clv", "Cd", "Cdp", "Cdv",
+                               "Cm", "Cmp", "Cmv", "cCl", "cCd"};
+        columns.assign(names, names+17);
+    }
+    else
+    {
+        const char *names[] = {"xle", "y", "y_flat", "zle", "c",
+                               "Cl", "Cd", "Cm", "cCl", "cCd"};
+        columns.assign(names, names+10);
+    }
+
     // Compute "flattened" spanwise locations
-    
+
     y_flat.resize(_nspan);
     y_flat[0] = 0.;
     for ( i = 1; i < int(_nspan); i++ )
@@ -1873,101 +2046,51 @@ int Wing::writeSectionForceMoment ( int iter ) const
         ds = std::sqrt(dy*dy + dz*dz);
         y_flat[i] = y_flat[i-1] + ds;
     }
-    
-    fname = "sectional/" + _name + "_sectional_iter" + int2string(iter)
-          + ".csv";
-    
-    // Write header
-    
-    f.open(fname.c_str(), std::fstream::out);
-    if (! f.is_open())
-    {
-        print_warning("Wing::writeSectionForces",
-                      "Unable to open " + fname + " for writing.");
-        return 1;
-    }
-    f << "\"xle\",\"y\",\"y_flat\",\"zle\",\"c\",";
-    if (viscous)
-    {
-        f << "\"Re\",\"Cl\",\"Clp\",\"Clv\",\"Cd\",\"Cdp\",\"Cdv\","
-          <<        "\"Cm\",\"Cmp\",\"Cmv\",\"cCl\",\"cCd\"" << std::endl;
-    }
-    else
-    {
-        f << "\"Cl\",\"Cd\",\"Cm\",\"cCl\",\"cCd\"" << std::endl;
-    }
-    
-    // Write data for sections and mirror image
-    
-    f.setf(std::ios_base::scientific);
-    f << std::setprecision(7);
-    for ( i = _nspan-1; i >= 0; i-- )
+
+    // Data for sections and mirror image
+
+    nrows = 2*_nspan-1;
+    rows.resize(nrows);
+    for ( j = 0; j < nrows; j++ )
     {
-        f << _sections[i].xle() << ",";
-        f << _sections[i].y() << ",";
-        f << y_flat[i] << ",";
-        f << _sections[i].zle() << ",";
-        f << _sections[i].chord() << ",";
-        if (viscous)
+        if (j < int(_nspan))
         {
-            f << _sections[i].reynoldsNumber() << ",";
-            f << _sections[i].liftCoefficient() << ",";
-            f << _sections[i].pressureLiftCoefficient() << ",";
-            f << _sections[i].viscousLiftCoefficient() << ",";
-            f << _sections[i].dragCoefficient() << ",";
-            f << _sections[i].pressureDragCoefficient() << ",";
-            f << _sections[i].viscousDragCoefficient() << ",";
-            f << _sections[i].pitchingMomentCoefficient() << ",";
-            f << _sections[i].pressurePitchingMomentCoefficient() << ",";
-            f << _sections[i].viscousPitchingMomentCoefficient() << ",";
-            f << _sections[i].chord() * _sections[i].liftCoefficient() << ",";
-            f << _sections[i].chord() * _sections[i].dragCoefficient()
-              << std::endl;
+            i = _nspan-1-j;
+            sign = 1.;
         }
         else
         {
-            f << _sections[i].liftCoefficient() << ",";
-            f << _sections[i].dragCoefficient() << ",";
-            f << _sections[i].pitchingMomentCoefficient() << ",";
-            f << _sections[i].chord() * _sections[i].liftCoefficient() << ",";
-            f << _sections[i].chord() * _sections[i].dragCoefficient()
-              << std::endl;
+            i = j-_nspan+1;
+            sign = -1.;
         }
-    }
-    for ( i = 1; i < int(_nspan); i++ )
-    {
-        f << _sections[i].xle() << ",";
-        f << -_sections[i].y() << ",";
-        f << -y_flat[i] << ",";
-        f << _sections[i].zle() << ",";
-        f << _sections[i].chord() << ",";
+
+        row = &rows[j];
+        row->resize(0);
+        row->push_back(_sections[i].xle());
+        row->push_back(sign*_sections[i].y());
+        row->push_back(sign*y_flat[i]);
+        row->push_back(_sections[i].zle());
+        row->push_back(_sections[i].chord());
         if (viscous)
         {
-            f << _sections[i].reynoldsNumber() << ",";
-            f << _sections[i].liftCoefficient() << ",";
-            f << _sections[i].pressureLiftCoefficient() << ",";
-            f << _sections[i].viscousLiftCoefficient() << ",";
-            f << _sections[i].dragCoefficient() << ",";
-            f << _sections[i].pressureDragCoefficient() << ",";
-            f << _sections[i].viscousDragCoefficient() << ",";
-            f << _sections[i].pitchingMomentCoefficient() << ",";
-            f << _sections[i].pressurePitchingMomentCoefficient() << ",";
-            f << _sections[i].viscousPitchingMomentCoefficient() << ",";
-            f << _sections[i].chord() * _sections[i].liftCoefficient() << ",";
-            f << _sections[i].chord() * _sections[i].dragCoefficient()
-              << std::endl;
+            row->push_back(_sections[i].reynoldsNumber());
+            row->push_back(_sections[i].liftCoefficient());
+            row->push_back(_sections[i].pressureLiftCoefficient());
+            row->push_back(_sections[i].viscousLiftCoefficient());
+            row->push_back(_sections[i].dragCoefficient());
+            row->push_back(_sections[i].pressureDragCoefficient());
+            row->push_back(_sections[i].viscousDragCoefficient());
+            row->push_back(_sections[i].pitchingMomentCoefficient());
+            row->push_back(_sections[i].pressurePitchingMomentCoefficient());
+            row->push_back(_sections[i].viscousPitchingMomentCoefficient());
         }
         else
         {
-            f << _sections[i].liftCoefficient() << ",";
-            f << _sections[i].dragCoefficient() << ",";
-            f << _sections[i].pitchingMomentCoefficient() << ",";
-            f << _sections[i].chord() * _sections[i].liftCoefficient() << ",";
-            f << _sections[i].chord() * _sections[i].dragCoefficient()
-              << std::endl;
+            row->push_back(_sections[i].liftCoefficient());
+            row->push_back(_sections[i].dragCoefficient());
+            row->push_back(_sections[i].pitchingMomentCoefficient());
         }
+        row->push_back(_sections[i].chord()*_sections[i].liftCoefficient());
+        row->push_back(_sections[i].chord()*_sections[i].dragCoefficient());
     }
-    f.close();
-    
-    return 0;
 }